@@ -15,16 +15,25 @@
 ; EXECUTION FLOW:
 ;   1. Enable A20 line (access memory above 1MB)
 ;   2. Load kernel from disk to 0x100000 (1MB mark)
-;   3. Set up GDT for protected mode
-;   4. Switch to 32-bit protected mode
-;   5. Set up page tables for long mode
-;   6. Switch to 64-bit long mode
-;   7. Jump to kernel entry point
+;   3. Copy the BIOS font, switch to a VBE linear framebuffer mode and
+;      record both in the boot info block
+;   4. Set up GDT for protected mode
+;   5. Switch to 32-bit protected mode
+;   6. Set up page tables for long mode
+;   7. Switch to 64-bit long mode
+;   8. Jump to kernel entry point
 ;
 ; MEMORY MAP:
+;   0x00000500 - Boot info block (see include/squirel/bootinfo.h)
+;   0x00000600 - VBE controller/mode info scratch
+;   0x00001000 - Page tables (PML4, PDPT, PD, PT, framebuffer PD)
 ;   0x00007E00 - Stage 2 code (this file)
-;   0x00010000 - Temporary kernel load buffer
+;   0x0000A000 - BIOS 8x16 font copy
+;   0x00010000 - Temporary kernel load buffer (KERNEL_SECTORS * 512 bytes)
 ;   0x00100000 - Final kernel location (1MB)
+;
+; BUILD OPTIONS:
+;   -DVBE_ENABLE=0 keeps VGA text mode (make VBE=0)
 ; ============================================================================
 
 bits 16
@@ -36,14 +45,52 @@ org 0x7E00
 KERNEL_LOAD_SEG     equ 0x1000      ; Segment for temp kernel load (0x10000)
 KERNEL_LOAD_OFF     equ 0x0000      ; Offset
 KERNEL_FINAL_ADDR   equ 0x100000    ; 1MB - final kernel location
-KERNEL_SECTORS      equ 128         ; 64KB of kernel max
+%ifndef KERNEL_SECTORS
+KERNEL_SECTORS      equ 1024        ; 512KB of kernel max (must match the Makefile)
+%endif                              ; The Makefile passes the chunks kernel.bin uses
+KERNEL_CHUNK        equ 64          ; Sectors per read (32KB, never crosses 64KB)
 KERNEL_START_SECTOR equ 18          ; Sector after bootloader (BIOS 1-indexed: MBR=1, Stage2=2-17, Kernel=18+)
 
 ; Page table locations (must be 4KB aligned)
 PML4_ADDR           equ 0x1000      ; Page Map Level 4
 PDPT_ADDR           equ 0x2000      ; Page Directory Pointer Table
-PD_ADDR             equ 0x3000      ; Page Directory
+PD_ADDR             equ 0x3000      ; Page Directory (first 1GB)
 PT_ADDR             equ 0x4000      ; Page Table
+FB_PD_ADDR          equ 0x5000      ; Page Directory for the GB holding the LFB
+
+; Video mode selection
+%ifndef VBE_ENABLE
+%define VBE_ENABLE 1
+%endif
+VBE_MAX_WIDTH       equ 1024        ; Must match FB_MAX_WIDTH in config.h
+VBE_MAX_HEIGHT      equ 768         ; Must match FB_MAX_HEIGHT in config.h
+VBE_CTRL_INFO       equ 0x0600      ; 512-byte VbeInfoBlock
+VBE_MODE_INFO       equ 0x0800      ; 256-byte ModeInfoBlock
+BOOT_FONT_ADDR      equ 0xA000      ; 256 glyphs x 16 bytes
+BOOT_FONT_HEIGHT    equ 16
+
+; Boot info block (layout must match boot_info_t in bootinfo.h)
+BOOT_INFO_ADDR      equ 0x0500
+BOOT_INFO_SIZE      equ 48
+BOOT_INFO_MAGIC     equ 0x49425153  ; "SQBI"
+BOOT_INFO_FB        equ (1 << 0)
+BOOT_INFO_FONT      equ (1 << 1)
+BI_MAGIC            equ 0
+BI_FLAGS            equ 4
+BI_FB_ADDR          equ 8
+BI_FB_PITCH         equ 16
+BI_FB_WIDTH         equ 20
+BI_FB_HEIGHT        equ 24
+BI_FB_BPP           equ 28
+BI_RED_POS          equ 29
+BI_RED_SIZE         equ 30
+BI_GREEN_POS        equ 31
+BI_GREEN_SIZE       equ 32
+BI_BLUE_POS         equ 33
+BI_BLUE_SIZE        equ 34
+BI_FONT_ADDR        equ 36
+BI_FONT_HEIGHT      equ 40
+BI_VBE_MODE         equ 44
 
 ; ============================================================================
 ; Entry Point (16-bit Real Mode)
@@ -75,28 +122,41 @@ stage2_start:
     mov si, msg_loading_kernel
     call print_string_16
 
-    ; Load kernel using BIOS INT 13h (same as MBR)
-    mov ax, KERNEL_LOAD_SEG
-    mov es, ax                      ; ES = 0x1000
-    xor bx, bx                      ; BX = 0, so ES:BX = 0x10000
-    mov ah, 0x02                    ; Read sectors
-    mov al, KERNEL_SECTORS          ; Number of sectors
-    mov ch, 0                       ; Cylinder 0
-    mov cl, KERNEL_START_SECTOR     ; Starting sector
-    mov dh, 0                       ; Head 0
+    ; Load kernel using BIOS INT 13h extensions (LBA addressing), one
+    ; chunk at a time: a single CHS read cannot exceed 128 sectors, and
+    ; a chunk that stays inside one 64KB segment is safe for DMA
+    mov cx, KERNEL_SECTORS / KERNEL_CHUNK
+.load_chunk:
+    push cx
+    mov word [dap_count], KERNEL_CHUNK
+    mov si, disk_address_packet     ; DS:SI = packet (DS = 0)
+    mov ah, 0x42                    ; Extended read
     mov dl, [boot_drive]            ; Drive
     int 0x13
+    pop cx                          ; (pop leaves CF alone)
     jc disk_error_16
+    add word [dap_segment], KERNEL_CHUNK * 512 / 16
+    add dword [dap_lba], KERNEL_CHUNK
+    loop .load_chunk
 
     mov si, msg_kernel_loaded
     call print_string_16
 
     ; --------------------------------------------------------------------
-    ; Step 3: Enter Protected Mode
+    ; Step 3: Video Setup
+    ; --------------------------------------------------------------------
+    ; The BIOS is only reachable from real mode, so the font and the
+    ; graphics mode are set up here. This is the last step that prints:
+    ; after the mode switch the screen belongs to the kernel.
     ; --------------------------------------------------------------------
     mov si, msg_pmode
     call print_string_16
 
+    call setup_boot_info
+
+    ; --------------------------------------------------------------------
+    ; Step 4: Enter Protected Mode
+    ; --------------------------------------------------------------------
     cli                             ; Disable interrupts
 
     ; Load GDT
@@ -167,6 +227,171 @@ enable_a20:
     jz .wait_output
     ret
 
+; ============================================================================
+; setup_boot_info - Fill the boot info block (font + video mode)
+; ============================================================================
+setup_boot_info:
+    ; Clear the block and stamp it
+    xor ax, ax
+    mov es, ax
+    mov di, BOOT_INFO_ADDR
+    mov cx, BOOT_INFO_SIZE / 2
+    cld
+    rep stosw
+    mov dword [BOOT_INFO_ADDR + BI_MAGIC], BOOT_INFO_MAGIC
+
+    call copy_bios_font
+%if VBE_ENABLE
+    call set_vbe_mode
+%endif
+    ret
+
+; ----------------------------------------------------------------------------
+; copy_bios_font - Copy the VGA BIOS 8x16 font below 1MB where the kernel
+;                  can read it (INT 10h AX=1130h BH=06h returns ES:BP)
+; ----------------------------------------------------------------------------
+copy_bios_font:
+    push ds
+    push es
+    push bp
+
+    mov ax, 0x1130
+    mov bh, 0x06                    ; 8x16 font
+    int 0x10
+
+    push es                         ; DS:SI = font
+    pop ds
+    mov si, bp
+    xor ax, ax                      ; ES:DI = BOOT_FONT_ADDR
+    mov es, ax
+    mov di, BOOT_FONT_ADDR
+    mov cx, 256 * BOOT_FONT_HEIGHT / 2
+    cld
+    rep movsw
+
+    pop bp
+    pop es
+    pop ds
+
+    mov dword [BOOT_INFO_ADDR + BI_FONT_ADDR], BOOT_FONT_ADDR
+    mov dword [BOOT_INFO_ADDR + BI_FONT_HEIGHT], BOOT_FONT_HEIGHT
+    or dword [BOOT_INFO_ADDR + BI_FLAGS], BOOT_INFO_FONT
+    ret
+
+%if VBE_ENABLE
+; ----------------------------------------------------------------------------
+; set_vbe_mode - Pick the largest 32bpp linear framebuffer mode that fits
+;                VBE_MAX_WIDTH x VBE_MAX_HEIGHT and switch to it.
+;                On any failure the screen stays in VGA text mode.
+; ----------------------------------------------------------------------------
+set_vbe_mode:
+    ; Controller info (asking for VBE 2.0+ fields)
+    xor ax, ax
+    mov es, ax
+    mov di, VBE_CTRL_INFO
+    mov dword [di], 'VBE2'
+    mov ax, 0x4F00
+    int 0x10
+    cmp ax, 0x004F
+    jne .fail
+
+    ; FS:SI = mode list (far pointer at offset 14, 0xFFFF terminated)
+    mov si, [VBE_CTRL_INFO + 14]
+    mov ax, [VBE_CTRL_INFO + 16]
+    mov fs, ax
+    mov word [vbe_best_mode], 0xFFFF
+    mov dword [vbe_best_area], 0
+
+.next_mode:
+    mov cx, [fs:si]
+    cmp cx, 0xFFFF
+    je .scan_done
+    add si, 2
+
+    push si
+    push cx
+    mov ax, 0x4F01                  ; Get mode info into ES:DI
+    mov di, VBE_MODE_INFO
+    int 0x10
+    pop cx
+    pop si
+    cmp ax, 0x004F
+    jne .next_mode
+
+    ; Supported (bit 0) + graphics (bit 4) + linear framebuffer (bit 7)
+    mov ax, [VBE_MODE_INFO + 0]
+    and ax, 0x0091
+    cmp ax, 0x0091
+    jne .next_mode
+    cmp byte [VBE_MODE_INFO + 25], 32   ; BitsPerPixel
+    jne .next_mode
+    cmp byte [VBE_MODE_INFO + 27], 6    ; MemoryModel: direct color
+    jne .next_mode
+    mov ax, [VBE_MODE_INFO + 18]        ; XResolution
+    cmp ax, VBE_MAX_WIDTH
+    ja .next_mode
+    mov bx, [VBE_MODE_INFO + 20]        ; YResolution
+    cmp bx, VBE_MAX_HEIGHT
+    ja .next_mode
+
+    ; Keep the mode with the most pixels
+    mul bx                          ; DX:AX = width * height
+    shl edx, 16
+    mov dx, ax
+    cmp edx, [vbe_best_area]
+    jbe .next_mode
+    mov [vbe_best_area], edx
+    mov [vbe_best_mode], cx
+    jmp .next_mode
+
+.scan_done:
+    mov cx, [vbe_best_mode]
+    cmp cx, 0xFFFF
+    je .fail
+
+    ; Reload the chosen mode's info, then set it with the LFB bit (14)
+    mov ax, 0x4F01
+    mov di, VBE_MODE_INFO
+    int 0x10
+    cmp ax, 0x004F
+    jne .fail
+    mov bx, cx
+    or bx, 0x4000
+    mov ax, 0x4F02
+    int 0x10
+    cmp ax, 0x004F
+    jne .fail
+
+    ; Record the framebuffer for the kernel
+    mov eax, [VBE_MODE_INFO + 40]       ; PhysBasePtr
+    mov [BOOT_INFO_ADDR + BI_FB_ADDR], eax
+    movzx eax, word [VBE_MODE_INFO + 16]    ; BytesPerScanLine
+    mov [BOOT_INFO_ADDR + BI_FB_PITCH], eax
+    movzx eax, word [VBE_MODE_INFO + 18]
+    mov [BOOT_INFO_ADDR + BI_FB_WIDTH], eax
+    movzx eax, word [VBE_MODE_INFO + 20]
+    mov [BOOT_INFO_ADDR + BI_FB_HEIGHT], eax
+    mov al, [VBE_MODE_INFO + 25]
+    mov [BOOT_INFO_ADDR + BI_FB_BPP], al
+    mov al, [VBE_MODE_INFO + 31]        ; RedMaskSize
+    mov [BOOT_INFO_ADDR + BI_RED_SIZE], al
+    mov al, [VBE_MODE_INFO + 32]        ; RedFieldPosition
+    mov [BOOT_INFO_ADDR + BI_RED_POS], al
+    mov al, [VBE_MODE_INFO + 33]
+    mov [BOOT_INFO_ADDR + BI_GREEN_SIZE], al
+    mov al, [VBE_MODE_INFO + 34]
+    mov [BOOT_INFO_ADDR + BI_GREEN_POS], al
+    mov al, [VBE_MODE_INFO + 35]
+    mov [BOOT_INFO_ADDR + BI_BLUE_SIZE], al
+    mov al, [VBE_MODE_INFO + 36]
+    mov [BOOT_INFO_ADDR + BI_BLUE_POS], al
+    mov [BOOT_INFO_ADDR + BI_VBE_MODE], cx
+    or dword [BOOT_INFO_ADDR + BI_FLAGS], BOOT_INFO_FB
+
+.fail:
+    ret
+%endif
+
 ; ============================================================================
 ; 16-bit Helper Functions
 ; ============================================================================
@@ -194,6 +419,18 @@ disk_error_16:
 ; ============================================================================
 boot_drive:         db 0
 
+; INT 13h AH=42h disk address packet (kernel load)
+align 4
+disk_address_packet:
+                    db 16           ; Packet size
+                    db 0            ; Reserved
+dap_count:          dw 0            ; Sectors to read
+dap_offset:         dw KERNEL_LOAD_OFF
+dap_segment:        dw KERNEL_LOAD_SEG
+dap_lba:            dq KERNEL_START_SECTOR - 1  ; LBA is 0-indexed
+vbe_best_mode:      dw 0xFFFF
+vbe_best_area:      dd 0
+
 msg_stage2:         db "Stage 2: Starting...", 13, 10, 0
 msg_a20_ok:         db "Stage 2: A20 enabled", 13, 10, 0
 msg_loading_kernel: db "Stage 2: Loading kernel...", 13, 10, 0
@@ -297,7 +534,7 @@ protected_mode_start:
 
     ; --------------------------------------------------------------------
     ; Set up paging for long mode
-    ; We create identity mapping for first 2MB
+    ; We identity map the first 1GB and the framebuffer
     ; (virtual address = physical address)
     ; --------------------------------------------------------------------
     call setup_page_tables
@@ -342,7 +579,8 @@ protected_mode_start:
 ; ============================================================================
 ; setup_page_tables - Create identity-mapped page tables
 ; ============================================================================
-; Creates a simple identity mapping for the first 2MB of memory.
+; Identity maps the first 1GB of memory, plus the 1GB region holding the
+; linear framebuffer when one was set (it usually sits just below 4GB).
 ; This means virtual address X maps to physical address X.
 ;
 ; Page table structure (4-level paging):
@@ -353,7 +591,7 @@ protected_mode_start:
 setup_page_tables:
     ; Clear page table memory
     mov edi, PML4_ADDR
-    mov ecx, 4096                   ; 4 pages * 4KB = 16KB
+    mov ecx, 5 * 1024               ; 5 pages * 4KB = 20KB
     xor eax, eax
     rep stosd
 
@@ -363,12 +601,36 @@ setup_page_tables:
     ; PDPT[0] -> PD
     mov dword [PDPT_ADDR], PD_ADDR | 0x03       ; Present + Writable
 
-    ; PD[0] -> 2MB page at 0x000000 (using huge pages)
-    mov dword [PD_ADDR], 0x000000 | 0x83        ; Present + Writable + Huge (2MB)
-
-    ; PD[1] -> 2MB page at 0x200000 (covers kernel at 1MB)
-    mov dword [PD_ADDR + 8], 0x200000 | 0x83    ; Present + Writable + Huge
+    ; PD[0..511] -> 2MB pages covering 0 - 1GB
+    mov edi, PD_ADDR
+    mov eax, 0x000000 | 0x83                    ; Present + Writable + Huge (2MB)
+    mov ecx, 512
+.map_low:
+    mov [edi], eax
+    add eax, 0x200000
+    add edi, 8
+    loop .map_low
+
+    ; Framebuffer outside the first GB gets its own PD
+    test dword [BOOT_INFO_ADDR + BI_FLAGS], BOOT_INFO_FB
+    jz .done
+    mov ebx, [BOOT_INFO_ADDR + BI_FB_ADDR]
+    shr ebx, 30                     ; PDPT index (0-3)
+    jz .done
+    mov dword [PDPT_ADDR + ebx * 8], FB_PD_ADDR | 0x03
+
+    mov eax, ebx
+    shl eax, 30
+    or eax, 0x83
+    mov edi, FB_PD_ADDR
+    mov ecx, 512
+.map_fb:
+    mov [edi], eax
+    add eax, 0x200000
+    add edi, 8
+    loop .map_fb
 
+.done:
     ret
 
 ; ============================================================================
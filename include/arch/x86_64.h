@@ -35,6 +35,27 @@ static ALWAYS_INLINE void sti(void) {
     __asm__ volatile("sti");
 }
 
+/**
+ * @brief Disable interrupts, returning the previous RFLAGS
+ *
+ * Unlike cli()/sti() pairs this nests, and is safe in exception
+ * handlers that run with interrupts already off.
+ */
+static ALWAYS_INLINE uint64_t irq_save(void) {
+    uint64_t flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+/**
+ * @brief Restore the interrupt flag saved by irq_save()
+ */
+static ALWAYS_INLINE void irq_restore(uint64_t flags) {
+    if (flags & (1ull << 9)) {
+        __asm__ volatile("sti" ::: "memory");
+    }
+}
+
 /**
  * @brief Disable interrupts and halt (for panic situations)
  */
@@ -98,6 +119,31 @@ static ALWAYS_INLINE uint64_t read_cr4(void) {
     return val;
 }
 
+/**
+ * @brief Write CR4 register
+ */
+static ALWAYS_INLINE void write_cr4(uint64_t val) {
+    __asm__ volatile("mov %0, %%cr4" : : "r"(val));
+}
+
+/**
+ * @brief Read an extended control register (requires CR4.OSXSAVE)
+ */
+static ALWAYS_INLINE uint64_t xgetbv(uint32_t xcr) {
+    uint32_t low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(xcr));
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * @brief Write an extended control register (XCR0 selects XSAVE state)
+ */
+static ALWAYS_INLINE void xsetbv(uint32_t xcr, uint64_t value) {
+    uint32_t low = value & 0xFFFFFFFF;
+    uint32_t high = value >> 32;
+    __asm__ volatile("xsetbv" : : "c"(xcr), "a"(low), "d"(high));
+}
+
 /* ============================================================================
  * MSR (Model-Specific Registers)
  * ============================================================================ */
@@ -126,6 +172,53 @@ static ALWAYS_INLINE void write_msr(uint32_t msr, uint64_t value) {
     __asm__ volatile("wrmsr" : : "c"(msr), "a"(low), "d"(high));
 }
 
+/* ============================================================================
+ * Time Stamp Counter
+ * ============================================================================ */
+
+/**
+ * @brief Read the Time Stamp Counter
+ *
+ * @return Cycles since reset (see tsc.h for conversion to wall time)
+ */
+static ALWAYS_INLINE uint64_t rdtsc(void) {
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * @brief Spin-loop hint (reduces power and pipeline flushes in busy waits)
+ */
+static ALWAYS_INLINE void cpu_relax(void) {
+    __asm__ volatile("pause" ::: "memory");
+}
+
+/* ============================================================================
+ * Memory Barriers
+ * ============================================================================ */
+
+/**
+ * @brief Compiler barrier (prevents reordering of memory accesses by GCC)
+ */
+static ALWAYS_INLINE void barrier(void) {
+    __asm__ volatile("" ::: "memory");
+}
+
+/**
+ * @brief Full memory barrier (orders loads and stores against devices)
+ */
+static ALWAYS_INLINE void mfence(void) {
+    __asm__ volatile("mfence" ::: "memory");
+}
+
+/**
+ * @brief Store barrier (drains write-combining and non-temporal stores)
+ */
+static ALWAYS_INLINE void sfence(void) {
+    __asm__ volatile("sfence" ::: "memory");
+}
+
 /* ============================================================================
  * CPUID
  * ============================================================================ */
@@ -149,4 +242,17 @@ static ALWAYS_INLINE void cpuid(uint32_t leaf,
     );
 }
 
+/**
+ * @brief Execute CPUID with a subleaf (ECX input)
+ */
+static ALWAYS_INLINE void cpuid_count(uint32_t leaf, uint32_t subleaf,
+                                      uint32_t *eax, uint32_t *ebx,
+                                      uint32_t *ecx, uint32_t *edx) {
+    __asm__ volatile(
+        "cpuid"
+        : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+        : "a"(leaf), "c"(subleaf)
+    );
+}
+
 #endif /* _ARCH_X86_64_H */
@@ -0,0 +1,68 @@
+/**
+ * @file bootinfo.h
+ * @brief Boot information handed from stage 2 to the kernel
+ *
+ * Stage 2 gathers what only the BIOS can tell us (video mode, font)
+ * while still in real mode and leaves it in a fixed low-memory block.
+ * The kernel reads it once during early init.
+ *
+ * LOW MEMORY USED BY STAGE 2:
+ *   0x0500 - 0x05FF : boot_info_t (this structure)
+ *   0x0600 - 0x08FF : VBE scratch buffers (not preserved)
+ *   0x5000 - 0x5FFF : Page directory for the GB holding the framebuffer
+ *   0xA000 - 0xAFFF : Copy of the BIOS 8x16 font
+ *
+ * @note The layout must match the BI_* offsets in boot/stage2/loader.asm
+ */
+
+#ifndef _SQUIREL_BOOTINFO_H
+#define _SQUIREL_BOOTINFO_H
+
+#include <squirel/types.h>
+
+/** @brief Physical address of the boot info block */
+#define BOOT_INFO_ADDR      0x500
+
+/** @brief "SQBI" - written first so stale memory is never trusted */
+#define BOOT_INFO_MAGIC     0x49425153
+
+/* Flags */
+#define BOOT_INFO_FB        (1u << 0)   /**< Linear framebuffer mode is active */
+#define BOOT_INFO_FONT      (1u << 1)   /**< BIOS font was copied */
+
+/**
+ * @brief Boot information block
+ */
+typedef struct PACKED {
+    uint32_t magic;         /**< BOOT_INFO_MAGIC */
+    uint32_t flags;         /**< BOOT_INFO_* */
+    uint64_t fb_addr;       /**< Framebuffer physical address */
+    uint32_t fb_pitch;      /**< Bytes per scanline */
+    uint32_t fb_width;      /**< Pixels */
+    uint32_t fb_height;     /**< Pixels */
+    uint8_t  fb_bpp;        /**< Bits per pixel (always 32 when set) */
+    uint8_t  fb_red_pos;    /**< Bit position of the red field */
+    uint8_t  fb_red_size;   /**< Width of the red field */
+    uint8_t  fb_green_pos;
+    uint8_t  fb_green_size;
+    uint8_t  fb_blue_pos;
+    uint8_t  fb_blue_size;
+    uint8_t  reserved0;
+    uint32_t font_addr;     /**< 256 glyphs, 8 pixels wide, 1 byte per row */
+    uint32_t font_height;   /**< Rows per glyph */
+    uint16_t vbe_mode;      /**< VBE mode number that was set */
+    uint16_t reserved1;
+} boot_info_t;
+
+/**
+ * @brief Get the boot info block, or NULL if stage 2 did not write one
+ */
+static inline const boot_info_t *boot_info(void) {
+    const boot_info_t *info;
+
+    /* Hide the constant from GCC, which warns on accesses below 4KB */
+    __asm__("" : "=r"(info) : "0"((uintptr_t)BOOT_INFO_ADDR));
+    return info->magic == BOOT_INFO_MAGIC ? info : NULL;
+}
+
+#endif /* _SQUIREL_BOOTINFO_H */
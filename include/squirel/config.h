@@ -32,6 +32,39 @@
 /** @brief Kernel stack size (64KB) */
 #define KERNEL_STACK_SIZE       0x10000
 
+/** @brief End of the user half of the address space (copy_from_user limit) */
+#define USER_ADDR_LIMIT         0x0000800000000000ull
+
+/** @brief Physical memory managed by the frame allocator (the identity-mapped GB) */
+#define PMM_MAX_MEMORY          0x40000000ull
+
+/** @brief Kernel virtual region handed out by vmalloc() (PML4 slot 402) */
+#define VMALLOC_START           0xFFFFC90000000000ull
+#define VMALLOC_SIZE            0x0000001000000000ull   /* 64GB */
+
+/** @brief Live vmalloc() allocations at most */
+#define VMALLOC_MAX_AREAS       32
+
+/** @brief Pages the compressed RAM store can hold (128MB of swapped data) */
+#define ZRAM_MAX_PAGES          32768
+
+/** @brief Distinct merged pages the same-page merging scanner can track */
+#define KSM_MAX_STABLE          4096
+
+/* ============================================================================
+ * CPU / Interrupt Configuration
+ * ============================================================================ */
+
+/**
+ * @brief Size of per-CPU tables (only the boot CPU runs today)
+ *
+ * Must match PERCPU_COPIES in link/kernel.ld.
+ */
+#define MAX_CPUS                8
+
+/** @brief PIT channel 0 tick rate (IRQ0) */
+#define PIT_TICK_HZ             100
+
 /* ============================================================================
  * VGA Configuration
  * ============================================================================ */
@@ -45,6 +78,31 @@
 /** @brief VGA text mode height in characters */
 #define VGA_HEIGHT              25
 
+/** @brief Virtual consoles (Alt+F1 .. Alt+F6) */
+#define VGA_NUM_CONSOLES        6
+
+/** @brief Console the shell runs on */
+#define VC_SHELL                0
+
+/** @brief Console mirroring all kernel output (the "vclog" sink) */
+#define VC_LOG                  1
+
+/** @brief Console the top dashboard draws on */
+#define VC_DASHBOARD            2
+
+/* ============================================================================
+ * Framebuffer Configuration
+ * ============================================================================ */
+
+/** @brief Largest VBE mode stage 2 may pick (must match loader.asm) */
+#define FB_MAX_WIDTH            1024
+
+/** @brief Largest VBE mode height stage 2 may pick (must match loader.asm) */
+#define FB_MAX_HEIGHT           768
+
+/** @brief Attribute slots in the framebuffer console glyph cache */
+#define FBCON_GLYPH_SLOTS       8
+
 /* ============================================================================
  * Serial Port Configuration
  * ============================================================================ */
@@ -58,6 +116,72 @@
 /** @brief Default baud rate for serial */
 #define SERIAL_BAUD_RATE        115200
 
+/** @brief QEMU/Bochs debug console port */
+#define DEBUGCON_PORT           0xE9
+
+/* ============================================================================
+ * Disk Configuration
+ * ============================================================================ */
+
+/** @brief Primary ATA channel command block and control ports */
+#define ATA_PRIMARY_IO          0x1F0
+#define ATA_PRIMARY_CTRL        0x3F6
+
+/** @brief Boot disk LBA of the module archive (after the kernel area) */
+#define MODULE_ARCHIVE_LBA      1041
+
+/** @brief Boot disk LBA of the hibernation image (2MB in, after the archive) */
+#define HIBERNATE_LBA           4096
+
+/** @brief Boot disk LBA of the crash dump (after room for a 1GB hibernation image) */
+#define KDUMP_LBA               2105344
+
+/* ============================================================================
+ * Console Configuration
+ * ============================================================================ */
+
+/**
+ * @brief Sinks that receive kprintf output by default
+ *
+ * List of: vga, vclog, serial, debugcon, virtio, separated by ',' or '+'.
+ * Overridden at boot by the QEMU fw_cfg file CONSOLE_FW_CFG_FILE
+ * (e.g. -fw_cfg name=opt/squirel/console,string=vga+debugcon; QEMU
+ * treats ',' as an option separator, hence '+').
+ */
+#define CONSOLE_DEFAULT_SINKS   "vga,vclog,virtio"
+
+/** @brief fw_cfg file holding the boot-time sink selection */
+#define CONSOLE_FW_CFG_FILE     "opt/squirel/console"
+
+/** @brief Most recent console output kept in RAM (the log ring crash dumps carry) */
+#define CONSOLE_LOG_SIZE        (16 * 1024)
+
+/* ============================================================================
+ * Metrics Configuration
+ * ============================================================================ */
+
+/** @brief Serial port answering metrics requests (QEMU: second -serial) */
+#define METRICS_PORT            COM2_PORT
+
+/** @brief Preallocated buffer one metrics snapshot is rendered into */
+#define METRICS_BUF_SIZE        32768
+
+/* ============================================================================
+ * Virtio Console Configuration
+ * ============================================================================ */
+
+/** @brief Name the host gives the trace port (-device virtserialport,name=...) */
+#define VIRTIO_CONSOLE_TRACE_NAME   "org.squirel.trace"
+
+/** @brief Number of TX staging buffers per port */
+#define VIRTIO_CONSOLE_TX_SLOTS     16
+
+/** @brief Size of one TX staging buffer (one descriptor each) */
+#define VIRTIO_CONSOLE_SLOT_SIZE    4096
+
+/** @brief Give up on a port the host stopped draining after this long */
+#define VIRTIO_CONSOLE_TIMEOUT_US   50000
+
 /* ============================================================================
  * Keyboard Configuration
  * ============================================================================ */
@@ -84,6 +208,18 @@
 /** @brief Maximum number of command arguments */
 #define SHELL_MAX_ARGS          16
 
+/** @brief First chunk of the per-command arena (grows by 4KB frames) */
+#define SHELL_ARENA_SIZE        4096
+
+/**
+ * @brief QEMU fw_cfg file with command lines run before the first prompt
+ * (make pgo: -fw_cfg name=opt/squirel/autorun,file=<script>)
+ */
+#define SHELL_AUTORUN_FW_CFG_FILE   "opt/squirel/autorun"
+
+/** @brief Largest autorun script */
+#define SHELL_AUTORUN_MAX       4096
+
 /* ============================================================================
  * Debug Configuration
  * ============================================================================ */
@@ -0,0 +1,102 @@
+/**
+ * @file elf.h
+ * @brief ELF64 file format definitions (the subset the kernel reads)
+ *
+ * Field names follow the System V ABI so they can be checked against
+ * the specification and readelf output.
+ */
+
+#ifndef _SQUIREL_ELF_H
+#define _SQUIREL_ELF_H
+
+#include <squirel/types.h>
+
+/* e_ident */
+#define ELF_MAGIC           0x464C457Fu     /* "\x7FELF" little-endian */
+#define EI_CLASS            4
+#define EI_DATA             5
+#define ELFCLASS64          2
+#define ELFDATA2LSB         1
+
+/* e_type, e_machine */
+#define ET_REL              1
+#define EM_X86_64           62
+
+/* sh_type */
+#define SHT_PROGBITS        1
+#define SHT_SYMTAB          2
+#define SHT_STRTAB          3
+#define SHT_RELA            4
+#define SHT_NOBITS          8
+
+/* sh_flags */
+#define SHF_ALLOC           0x2
+
+/* Special section indexes */
+#define SHN_UNDEF           0
+#define SHN_ABS             0xFFF1
+#define SHN_COMMON          0xFFF2
+
+/* st_info */
+#define ELF64_ST_BIND(i)    ((i) >> 4)
+#define STB_WEAK            2
+
+/* r_info */
+#define ELF64_R_SYM(i)      ((uint32_t)((i) >> 32))
+#define ELF64_R_TYPE(i)     ((uint32_t)(i))
+
+/* x86_64 relocation types */
+#define R_X86_64_NONE       0
+#define R_X86_64_64         1
+#define R_X86_64_PC32       2
+#define R_X86_64_PLT32      4
+#define R_X86_64_32         10
+#define R_X86_64_32S        11
+#define R_X86_64_PC64       24
+
+typedef struct {
+    uint8_t  e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} Elf64_Ehdr;
+
+typedef struct {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+} Elf64_Shdr;
+
+typedef struct {
+    uint32_t st_name;
+    uint8_t  st_info;
+    uint8_t  st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+} Elf64_Sym;
+
+typedef struct {
+    uint64_t r_offset;
+    uint64_t r_info;
+    int64_t  r_addend;
+} Elf64_Rela;
+
+#endif /* _SQUIREL_ELF_H */
@@ -124,6 +124,20 @@ typedef _Bool               bool;
  */
 #define ALIGNED(x) __attribute__((aligned(x)))
 
+/* ============================================================================
+ * Struct Helpers
+ * ============================================================================ */
+
+/** @brief Byte offset of a member within a struct */
+#define offsetof(type, member) __builtin_offsetof(type, member)
+
+/**
+ * @brief Get the struct containing an embedded member
+ * @example task_t *t = container_of(node, task_t, list);
+ */
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
 /* ============================================================================
  * Limit Macros
  * ============================================================================ */
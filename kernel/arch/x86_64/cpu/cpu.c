@@ -0,0 +1,116 @@
+/**
+ * @file cpu.c
+ * @brief CPU feature detection and SIMD state setup
+ */
+
+#include "cpu.h"
+#include <arch/x86_64.h>
+#include <core/export.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define CR0_MP              (1ull << 1)
+#define CR0_EM              (1ull << 2)
+#define CR0_WP              (1ull << 16)
+
+#define CR4_OSFXSR          (1ull << 9)
+#define CR4_OSXMMEXCPT      (1ull << 10)
+#define CR4_OSXSAVE         (1ull << 18)
+
+#define CPUID1_EDX_MTRR     (1u << 12)
+#define CPUID1_EDX_PAT      (1u << 16)
+#define CPUID1_EDX_SSE2     (1u << 26)
+#define CPUID1_ECX_PCLMUL   (1u << 1)
+#define CPUID1_ECX_SSE42    (1u << 20)
+#define CPUID1_ECX_POPCNT   (1u << 23)
+#define CPUID1_ECX_XSAVE    (1u << 26)
+#define CPUID1_ECX_AVX      (1u << 28)
+#define CPUID7_EBX_AVX2     (1u << 5)
+
+#define XCR0_X87            (1ull << 0)
+#define XCR0_SSE            (1ull << 1)
+#define XCR0_AVX            (1ull << 2)
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static uint32_t features = 0;
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void cpu_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+
+    /*
+     * x87/SSE execute natively, WAIT honours TS. WP makes ring 0 writes
+     * fault on read-only pages too: the kernel runs in ring 0, and the
+     * copy-on-write of merged pages (ksm.c) depends on that fault.
+     */
+    write_cr0((read_cr0() & ~CR0_EM) | CR0_MP | CR0_WP);
+
+    uint64_t cr4 = read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT;
+    if (ecx & CPUID1_ECX_XSAVE) {
+        cr4 |= CR4_OSXSAVE;
+        features |= CPU_FEAT_XSAVE;
+    }
+    write_cr4(cr4);
+    __asm__ volatile("fninit");
+
+    if (edx & CPUID1_EDX_SSE2) {
+        features |= CPU_FEAT_SSE2;
+    }
+    if (edx & CPUID1_EDX_PAT) {
+        features |= CPU_FEAT_PAT;
+    }
+    if (edx & CPUID1_EDX_MTRR) {
+        features |= CPU_FEAT_MTRR;
+    }
+    if (ecx & CPUID1_ECX_POPCNT) {
+        features |= CPU_FEAT_POPCNT;
+    }
+    if (ecx & CPUID1_ECX_SSE42) {
+        features |= CPU_FEAT_SSE42;
+    }
+    if (ecx & CPUID1_ECX_PCLMUL) {
+        features |= CPU_FEAT_PCLMUL;
+    }
+
+    /* AVX is only usable once XCR0 enables the upper YMM state */
+    if ((features & CPU_FEAT_XSAVE) && (ecx & CPUID1_ECX_AVX)) {
+        xsetbv(0, XCR0_X87 | XCR0_SSE | XCR0_AVX);
+        features |= CPU_FEAT_AVX;
+
+        uint32_t max_leaf;
+        cpuid(0, &max_leaf, &ebx, &ecx, &edx);
+        if (max_leaf >= 7) {
+            cpuid_count(7, 0, &eax, &ebx, &ecx, &edx);
+            if (ebx & CPUID7_EBX_AVX2) {
+                features |= CPU_FEAT_AVX2;
+            }
+        }
+    }
+}
+
+uint32_t cpu_features(void) {
+    return features;
+}
+
+bool cpu_has(uint32_t feature) {
+    return (features & feature) == feature;
+}
+EXPORT_SYMBOL(cpu_has);
+
+int cpu_id(void) {
+    return 0;   /* APs are never started */
+}
+
+int cpu_count(void) {
+    return 1;
+}
+EXPORT_SYMBOL(cpu_count);
@@ -0,0 +1,74 @@
+/**
+ * @file cpu.h
+ * @brief CPU feature detection and SIMD state setup
+ *
+ * The bootloader leaves the FPU/SSE unit in its reset state: CR4.OSFXSR
+ * is clear, so any SSE instruction raises #UD. cpu_init() turns on the
+ * SIMD state the kernel is allowed to use and records which optional
+ * instruction sets are present so hot paths can pick an implementation
+ * once at init time.
+ *
+ * ENABLED STATE:
+ *   CR0: EM cleared, MP set         (x87/SSE execute natively)
+ *   CR4: OSFXSR, OSXMMEXCPT         (SSE, SIMD FP exceptions)
+ *   CR4: OSXSAVE + XCR0 = x87|SSE|AVX  (only when the CPU has AVX)
+ *
+ * IRQ handlers run between FXSAVE/FXRSTOR (see interrupts.asm), so they
+ * may use SSE but not AVX.
+ *
+ * CPU NUMBERING:
+ *   Only the boot CPU is brought up, so cpu_id() is always 0; per-CPU
+ *   tables are still indexed by it and sized by MAX_CPUS.
+ */
+
+#ifndef _ARCH_X86_64_CPU_H
+#define _ARCH_X86_64_CPU_H
+
+#include <squirel/types.h>
+
+/* ============================================================================
+ * Feature Bits
+ * ============================================================================ */
+
+#define CPU_FEAT_SSE2       (1u << 0)
+#define CPU_FEAT_XSAVE      (1u << 1)
+#define CPU_FEAT_AVX        (1u << 2)   /**< Usable: OS state enabled too */
+#define CPU_FEAT_PAT        (1u << 3)
+#define CPU_FEAT_MTRR       (1u << 4)
+#define CPU_FEAT_POPCNT     (1u << 5)
+#define CPU_FEAT_SSE42      (1u << 6)
+#define CPU_FEAT_PCLMUL     (1u << 7)
+#define CPU_FEAT_AVX2       (1u << 8)   /**< Usable: implies CPU_FEAT_AVX */
+
+/* ============================================================================
+ * CPU Functions
+ * ============================================================================ */
+
+/**
+ * @brief Detect features and enable SSE (and AVX when available)
+ *
+ * @note Must run before any code that may use SIMD registers
+ */
+void cpu_init(void);
+
+/**
+ * @brief Get the CPU_FEAT_* mask detected by cpu_init()
+ */
+uint32_t cpu_features(void);
+
+/**
+ * @brief Check for a CPU_FEAT_* feature
+ */
+bool cpu_has(uint32_t feature);
+
+/**
+ * @brief Index of the calling CPU (0 .. MAX_CPUS-1)
+ */
+int cpu_id(void);
+
+/**
+ * @brief Number of CPUs running kernel code
+ */
+int cpu_count(void);
+
+#endif /* _ARCH_X86_64_CPU_H */
@@ -18,6 +18,7 @@
  *       a proper kernel GDT and allows runtime modifications (TSS).
  */
 
+#include "gdt.h"
 #include <squirel/types.h>
 #include <lib/memory/memory.h>
 
@@ -0,0 +1,20 @@
+/**
+ * @file gdt.h
+ * @brief Global Descriptor Table interface
+ */
+
+#ifndef _ARCH_X86_64_GDT_H
+#define _ARCH_X86_64_GDT_H
+
+/** @brief Kernel code segment selector */
+#define GDT_KERNEL_CODE     0x08
+
+/** @brief Kernel data segment selector */
+#define GDT_KERNEL_DATA     0x10
+
+/**
+ * @brief Load the kernel GDT and reload the segment registers
+ */
+void gdt_init(void);
+
+#endif /* _ARCH_X86_64_GDT_H */
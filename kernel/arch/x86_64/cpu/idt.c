@@ -9,11 +9,16 @@
  *   0-31:   CPU exceptions (divide by zero, page fault, etc.)
  *   32-255: External interrupts (IRQs from PIC/APIC)
  * 
- * NOTE: For now, we don't use interrupts - keyboard uses polling.
- *       This is just a stub to set up valid exception handlers.
+ * Vectors 32-47 (the remapped PIC IRQs) are filled in by irq_init()
+ * through idt_set_gate().
  */
 
-#include <squirel/types.h>
+#include "idt.h"
+#include "gdt.h"
+#include <arch/x86_64.h>
+#include <arch/x86_64/mm/extable.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <core/kdump.h>
 #include <lib/memory/memory.h>
 #include <lib/printf/printf.h>
 #include <drivers/vga/vga_text.h>
@@ -99,9 +104,24 @@ static void idt_set_entry(int index, uint64_t handler, uint16_t selector,
 /**
  * @brief Default exception handler (C part)
  * 
- * Called by the assembly stubs when an exception occurs.
+ * Called by the assembly stubs when an exception occurs. A #GP or #PF
+ * on an instruction listed in the exception table resumes at its fixup;
+ * anything else is a panic, written out as a crash dump (core/kdump.h).
  */
-void exception_handler(uint64_t vector, uint64_t error_code) {
+void exception_handler(interrupt_frame_t *frame) {
+    uint64_t start = rdtsc();
+    uint64_t vector = frame->vector;
+
+    /* First touch of a vmalloc page: map it and restart the instruction */
+    if (vector == EXC_PAGE_FAULT && vmalloc_fault(read_cr2(), frame->error_code, start)) {
+        return;
+    }
+
+    if ((vector == EXC_GENERAL_PROTECTION || vector == EXC_PAGE_FAULT) &&
+        extable_fixup(frame)) {
+        return;
+    }
+
     vga_set_color(VGA_WHITE, VGA_RED);
     vga_clear();
     
@@ -110,8 +130,13 @@ void exception_handler(uint64_t vector, uint64_t error_code) {
     
     const char *name = (vector < 22) ? exception_names[vector] : "Unknown";
     kprintf("  Exception: %s (#%d)\n", name, (int)vector);
-    kprintf("  Error Code: 0x%016llX\n", error_code);
+    kprintf("  Error Code: 0x%016llX\n", frame->error_code);
+    kprintf("  RIP:        0x%016llX\n", frame->rip);
+    if (vector == EXC_PAGE_FAULT) {
+        kprintf("  Address:    0x%016llX\n", read_cr2());
+    }
     kprintf("\n");
+    kdump_write(frame, name);
     kprintf("  System halted.\n");
     
     /* Halt forever */
@@ -152,6 +177,13 @@ extern void isr_stub_21(void);
  * Public Functions
  * ============================================================================ */
 
+void idt_set_gate(int vector, void (*handler)(void)) {
+    if (vector < 0 || vector >= IDT_ENTRIES) {
+        return;
+    }
+    idt_set_entry(vector, (uint64_t)handler, GDT_KERNEL_CODE, 0, 0x8E);
+}
+
 /**
  * @brief Initialize the IDT
  */
@@ -0,0 +1,50 @@
+/**
+ * @file idt.h
+ * @brief Interrupt Descriptor Table interface
+ */
+
+#ifndef _ARCH_X86_64_IDT_H
+#define _ARCH_X86_64_IDT_H
+
+#include <squirel/types.h>
+
+/* Exception vectors */
+#define EXC_GENERAL_PROTECTION  13
+#define EXC_PAGE_FAULT          14
+
+/**
+ * @brief Registers saved by an exception stub (isr_common), lowest address first
+ *
+ * Changing rip (or a saved register) changes where and how the
+ * interrupted code resumes.
+ */
+typedef struct {
+    uint64_t r15, r14, r13, r12, r11, r10, r9, r8;
+    uint64_t rbp, rdi, rsi, rdx, rcx, rbx, rax;
+    uint64_t vector;        /**< Pushed by the stub */
+    uint64_t error_code;    /**< Pushed by the CPU, or 0 by the stub */
+    uint64_t rip, cs, rflags, rsp, ss;      /**< Pushed by the CPU */
+} interrupt_frame_t;
+
+/**
+ * @brief Handle a CPU exception (called by isr_common)
+ *
+ * Returns only if an exception table entry covers the faulting
+ * instruction (see mm/extable.h); everything else is a panic.
+ */
+void exception_handler(interrupt_frame_t *frame);
+
+/**
+ * @brief Install the exception handlers and load the IDT
+ */
+void idt_init(void);
+
+/**
+ * @brief Point a vector at an entry stub (ring 0 interrupt gate)
+ *
+ * @param vector   Interrupt vector (0-255)
+ * @param handler  Assembly entry stub
+ */
+void idt_set_gate(int vector, void (*handler)(void));
+
+#endif /* _ARCH_X86_64_IDT_H */
@@ -1,7 +1,8 @@
 ; ============================================================================
 ; interrupts.asm - Low-level Interrupt Service Routine Stubs
 ; ============================================================================
-; PURPOSE: Provides assembly entry points for CPU exceptions.
+; PURPOSE: Provides assembly entry points for CPU exceptions and the
+;          16 legacy PIC IRQs (vectors 32-47).
 ;          These stubs save registers, call the C handler, then restore.
 ;
 ; CALLING CONVENTION:
@@ -16,8 +17,8 @@
 ;     - Push exception number
 ;     - Jump to common handler
 ;     - Common handler saves all registers
-;     - Calls C function exception_handler(vector, error_code)
-;     - Restores registers
+;     - Calls C function exception_handler(frame), frame = saved registers
+;     - Restores registers (exception_handler may have changed RIP)
 ;     - Returns with IRETQ
 ;
 ; REGISTER PRESERVATION:
@@ -25,13 +26,22 @@
 ;     Caller-saved (we can clobber): RAX, RCX, RDX, RSI, RDI, R8-R11
 ;     Callee-saved (must preserve): RBX, RBP, R12-R15
 ;   We save ALL registers for safety in exception context.
+;
+; SIMD STATE:
+;   IRQs interrupt code that uses SSE/AVX (memcpy, framebuffer blits), and
+;   the C handlers are free to use SSE registers, so both common handlers
+;   save the x87/SSE state with FXSAVE around the call (an exception
+;   returns too when its fault has an exception table fixup). The upper YMM halves need
+;   no saving: handlers are built without -mavx, and legacy SSE
+;   instructions leave bits 255:128 untouched.
 ; ============================================================================
 
 bits 64
 section .text
 
-; External C handler
+; External C handlers
 extern exception_handler
+extern irq_dispatch
 
 ; ============================================================================
 ; Macro: ISR stub without error code
@@ -55,6 +65,17 @@ isr_stub_%1:
     jmp isr_common
 %endmacro
 
+; ============================================================================
+; Macro: IRQ stub (hardware interrupt, vector = 32 + IRQ number)
+; ============================================================================
+%macro IRQ 1
+global irq_stub_%1
+irq_stub_%1:
+    push 0                      ; Keep the frame layout of ISR stubs
+    push %1 + 32                ; Push vector number
+    jmp irq_common
+%endmacro
+
 ; ============================================================================
 ; Exception Stubs (0-21)
 ; ============================================================================
@@ -82,6 +103,27 @@ ISR_NOERR 19    ; SIMD Exception
 ISR_NOERR 20    ; Virtualization Exception
 ISR_ERR   21    ; Control Protection Exception
 
+; ============================================================================
+; IRQ Stubs (PIC IRQ 0-15 remapped to vectors 32-47)
+; ============================================================================
+
+IRQ 0           ; PIT timer
+IRQ 1           ; PS/2 keyboard
+IRQ 2           ; Cascade (never raised)
+IRQ 3           ; COM2
+IRQ 4           ; COM1
+IRQ 5
+IRQ 6           ; Floppy
+IRQ 7           ; LPT1 / spurious
+IRQ 8           ; CMOS RTC
+IRQ 9
+IRQ 10
+IRQ 11
+IRQ 12          ; PS/2 mouse
+IRQ 13          ; FPU
+IRQ 14          ; Primary ATA
+IRQ 15          ; Secondary ATA / spurious
+
 ; ============================================================================
 ; Common ISR Handler
 ; ============================================================================
@@ -108,15 +150,20 @@ isr_common:
     push r14
     push r15
 
-    ; Load exception number and error code for C handler
-    ; After pushes: vector is at [RSP + 120], error at [RSP + 128]
-    mov rdi, [rsp + 120]        ; First arg: exception number
-    mov rsi, [rsp + 128]        ; Second arg: error code
+    ; The pushes above form an interrupt_frame_t (idt.h)
+    mov rbp, rsp                ; RBP already saved above
+    sub rsp, 512
+    and rsp, -16
+    fxsave [rsp]
+    cld
 
-    ; Call C handler
+    mov rdi, rbp                ; First arg: interrupt_frame_t *
     call exception_handler
 
-    ; Handler should not return, but just in case...
+    ; Returns only after a fixup rewrote the saved RIP
+    fxrstor [rsp]
+    mov rsp, rbp
+
     ; Restore registers
     pop r15
     pop r14
@@ -139,3 +186,61 @@ isr_common:
 
     ; Return from interrupt
     iretq
+
+; ============================================================================
+; Common IRQ Handler
+; ============================================================================
+; Same frame as isr_common, plus a 512-byte FXSAVE area below the
+; registers. The CPU aligns RSP to 16 before pushing its 40-byte frame,
+; so after the 2 + 15 pushes RSP is 16-byte aligned again; it is
+; realigned anyway since FXSAVE faults on a misaligned operand.
+; ============================================================================
+irq_common:
+    push rax
+    push rbx
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push rbp
+    push r8
+    push r9
+    push r10
+    push r11
+    push r12
+    push r13
+    push r14
+    push r15
+
+    mov rbp, rsp                ; RBP already saved above
+    sub rsp, 512
+    and rsp, -16
+    fxsave [rsp]
+    cld                         ; memmove may have been interrupted mid-STD
+
+    mov rdi, [rbp + 120]        ; First arg: vector number
+    call irq_dispatch
+
+    fxrstor [rsp]
+    mov rsp, rbp
+
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rbp
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rbx
+    pop rax
+
+    ; Remove vector number and dummy error code
+    add rsp, 16
+
+    iretq
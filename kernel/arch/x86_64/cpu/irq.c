@@ -0,0 +1,255 @@
+/**
+ * @file irq.c
+ * @brief Legacy 8259 PIC interrupt routing and accounting implementation
+ */
+
+#include "irq.h"
+#include "idt.h"
+#include "cpu.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/io/port.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <core/cpustat.h>
+#include <core/metrics.h>
+
+/* ============================================================================
+ * PIC Constants
+ * ============================================================================ */
+
+#define PIC1_CMD            0x20
+#define PIC1_DATA           0x21
+#define PIC2_CMD            0xA0
+#define PIC2_DATA           0xA1
+
+#define PIC_ICW1_INIT       0x11    /* Edge triggered, cascade, ICW4 follows */
+#define PIC_ICW4_8086       0x01
+#define PIC_EOI             0x20
+#define PIC_READ_ISR        0x0B
+
+/* ============================================================================
+ * Assembly Stubs (defined in interrupts.asm)
+ * ============================================================================ */
+
+extern void irq_stub_0(void);
+extern void irq_stub_1(void);
+extern void irq_stub_2(void);
+extern void irq_stub_3(void);
+extern void irq_stub_4(void);
+extern void irq_stub_5(void);
+extern void irq_stub_6(void);
+extern void irq_stub_7(void);
+extern void irq_stub_8(void);
+extern void irq_stub_9(void);
+extern void irq_stub_10(void);
+extern void irq_stub_11(void);
+extern void irq_stub_12(void);
+extern void irq_stub_13(void);
+extern void irq_stub_14(void);
+extern void irq_stub_15(void);
+
+static void (*const irq_stubs[IRQ_COUNT])(void) = {
+    irq_stub_0,  irq_stub_1,  irq_stub_2,  irq_stub_3,
+    irq_stub_4,  irq_stub_5,  irq_stub_6,  irq_stub_7,
+    irq_stub_8,  irq_stub_9,  irq_stub_10, irq_stub_11,
+    irq_stub_12, irq_stub_13, irq_stub_14, irq_stub_15,
+};
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/**
+ * @brief Per-CPU interrupt counters (one cache line set per CPU)
+ */
+typedef struct {
+    uint64_t count[IRQ_COUNT];
+    uint64_t spurious;
+} ALIGNED(64) irq_cpu_stats_t;
+
+static irq_cpu_stats_t irq_stats[MAX_CPUS];
+
+/** @brief Handler durations in ns, one histogram per CPU */
+static histogram_t handler_ns[MAX_CPUS];
+
+static irq_handler_t handlers[IRQ_COUNT];
+static const char *names[IRQ_COUNT];
+
+/** @brief Current mask (bit set = line disabled), master in the low byte */
+static uint16_t irq_mask = 0xFFFF;
+
+static bool active = false;
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static void pic_write_mask(void) {
+    outb(PIC1_DATA, (uint8_t)(irq_mask & 0xFF));
+    outb(PIC2_DATA, (uint8_t)(irq_mask >> 8));
+}
+
+static uint16_t pic_read_isr(void) {
+    outb(PIC1_CMD, PIC_READ_ISR);
+    outb(PIC2_CMD, PIC_READ_ISR);
+    return (uint16_t)inb(PIC1_CMD) | ((uint16_t)inb(PIC2_CMD) << 8);
+}
+
+/**
+ * @brief Detect a spurious IRQ 7/15 (line not actually in service)
+ */
+static bool irq_is_spurious(int irq) {
+    if (irq != 7 && irq != 15) {
+        return false;
+    }
+    return (pic_read_isr() & (1u << irq)) == 0;
+}
+
+/**
+ * @brief Program both PICs for vectors 32-47 (leaves the mask alone)
+ */
+static void pic_remap(void) {
+    /* ICW1-ICW4: master on vectors 32-39, slave on 40-47, slave at IRQ 2 */
+    outb(PIC1_CMD, PIC_ICW1_INIT);
+    io_wait();
+    outb(PIC2_CMD, PIC_ICW1_INIT);
+    io_wait();
+    outb(PIC1_DATA, IRQ_BASE_VECTOR);
+    io_wait();
+    outb(PIC2_DATA, IRQ_BASE_VECTOR + 8);
+    io_wait();
+    outb(PIC1_DATA, 1 << IRQ_CASCADE);
+    io_wait();
+    outb(PIC2_DATA, IRQ_CASCADE);
+    io_wait();
+    outb(PIC1_DATA, PIC_ICW4_8086);
+    io_wait();
+    outb(PIC2_DATA, PIC_ICW4_8086);
+    io_wait();
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void irq_init(void) {
+    pic_remap();
+
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        hist_init(&handler_ns[cpu]);
+    }
+
+    /* Everything masked until a driver registers */
+    irq_mask = 0xFFFF;
+    pic_write_mask();
+
+    for (int i = 0; i < IRQ_COUNT; i++) {
+        idt_set_gate(IRQ_BASE_VECTOR + i, irq_stubs[i]);
+    }
+
+    active = true;
+    sti();
+}
+
+void irq_resume(void) {
+    pic_remap();
+    pic_write_mask();
+}
+
+bool irq_register(int irq, const char *name, irq_handler_t handler) {
+    if (irq < 0 || irq >= IRQ_COUNT || irq == IRQ_CASCADE || handlers[irq]) {
+        return false;
+    }
+
+    uint64_t flags = irq_save();
+    handlers[irq] = handler;
+    names[irq] = name;
+    irq_mask &= (uint16_t)~(1u << irq);
+    if (irq >= 8) {
+        irq_mask &= (uint16_t)~(1u << IRQ_CASCADE);
+    }
+    pic_write_mask();
+    irq_restore(flags);
+    return true;
+}
+
+bool irq_active(void) {
+    return active;
+}
+
+uint64_t irq_get_count(int irq) {
+    uint64_t total = 0;
+    if (irq < 0 || irq >= IRQ_COUNT) {
+        return 0;
+    }
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        total += irq_stats[cpu].count[irq];
+    }
+    return total;
+}
+
+uint64_t irq_get_spurious(void) {
+    uint64_t total = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        total += irq_stats[cpu].spurious;
+    }
+    return total;
+}
+
+void irq_get_handler_hist(histogram_t *out) {
+    hist_init(out);
+    for (int cpu = 0; cpu < cpu_count(); cpu++) {
+        hist_merge(out, &handler_ns[cpu]);
+    }
+}
+
+void irq_reset_handler_hist(void) {
+    uint64_t flags = irq_save();
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        hist_init(&handler_ns[cpu]);
+    }
+    irq_restore(flags);
+}
+
+const char *irq_name(int irq) {
+    return (irq >= 0 && irq < IRQ_COUNT) ? names[irq] : NULL;
+}
+
+void irq_dispatch(uint64_t vector) {
+    uint64_t start = rdtsc();
+    int irq = (int)vector - IRQ_BASE_VECTOR;
+    irq_cpu_stats_t *stats = &irq_stats[cpu_id()];
+
+    if (irq < 0 || irq >= IRQ_COUNT) {
+        return;
+    }
+
+    if (irq_is_spurious(irq)) {
+        stats->spurious++;
+        if (irq == 15) {
+            outb(PIC1_CMD, PIC_EOI);    /* The master did see the cascade */
+        }
+        return;
+    }
+
+    stats->count[irq]++;
+    if (handlers[irq]) {
+        handlers[irq]();
+    }
+
+    if (irq >= 8) {
+        outb(PIC2_CMD, PIC_EOI);
+    }
+    outb(PIC1_CMD, PIC_EOI);
+
+    uint64_t cycles = rdtsc() - start;
+    cpustat_account_irq(cycles);
+    hist_record(&handler_ns[cpu_id()], tsc_cycles_to_ns(cycles));
+}
+
+/* ============================================================================
+ * Metrics
+ * ============================================================================ */
+
+DEFINE_HISTOGRAM_METRIC(irq_handler_seconds,
+                        "Interrupt handler duration", 1000000000, irq_get_handler_hist);
@@ -0,0 +1,107 @@
+/**
+ * @file irq.h
+ * @brief Legacy 8259 PIC interrupt routing and accounting
+ *
+ * The two cascaded PICs are remapped so IRQ 0-15 arrive on vectors
+ * 32-47 instead of colliding with CPU exceptions. Every line starts
+ * masked; irq_register() installs a handler and unmasks its line.
+ *
+ * ACCOUNTING:
+ *   irq_dispatch() counts every interrupt per CPU and per line, charges
+ *   the cycles spent in the handler to the CPU's irq time (see
+ *   core/cpustat.h) and records the handler duration in a per-CPU
+ *   histogram.
+ *
+ * SPURIOUS IRQS:
+ *   IRQ 7 and 15 are checked against the PIC in-service register; a
+ *   spurious one is counted but not passed to the handler (and the
+ *   slave one still needs an EOI on the master).
+ */
+
+#ifndef _ARCH_X86_64_IRQ_H
+#define _ARCH_X86_64_IRQ_H
+
+#include <squirel/types.h>
+#include <lib/histogram/histogram.h>
+
+/** @brief Vector of IRQ 0 after remapping */
+#define IRQ_BASE_VECTOR     32
+
+/** @brief Number of PIC interrupt lines */
+#define IRQ_COUNT           16
+
+/** @brief Well-known lines */
+#define IRQ_TIMER           0
+#define IRQ_KEYBOARD        1
+#define IRQ_CASCADE         2
+#define IRQ_COM2            3
+#define IRQ_COM1            4
+
+/**
+ * @brief Interrupt handler (runs with interrupts disabled)
+ */
+typedef void (*irq_handler_t)(void);
+
+/**
+ * @brief Remap and mask the PICs, install the IRQ gates, enable interrupts
+ *
+ * @note Requires idt_init()
+ */
+void irq_init(void);
+
+/**
+ * @brief Program the PICs again after a resume from hibernation
+ *
+ * The restored mask is what the hibernated kernel had enabled; the PICs
+ * still hold whatever the kernel that loaded the image left in them.
+ */
+void irq_resume(void);
+
+/**
+ * @brief Install a handler and unmask its line
+ *
+ * @param irq      Line (0-15)
+ * @param name     Short name shown by top
+ * @param handler  Called on every interrupt; the EOI is sent afterwards
+ * @return         false if the line is out of range or already taken
+ */
+bool irq_register(int irq, const char *name, irq_handler_t handler);
+
+/**
+ * @brief Check whether irq_init() has enabled interrupts
+ */
+bool irq_active(void);
+
+/**
+ * @brief Interrupts taken on a line, summed over all CPUs
+ */
+uint64_t irq_get_count(int irq);
+
+/**
+ * @brief Spurious IRQ 7/15 deliveries, summed over all CPUs
+ */
+uint64_t irq_get_spurious(void);
+
+/**
+ * @brief Merge the per-CPU handler duration histograms (nanoseconds)
+ *
+ * @param out  Receives the merged histogram (any previous contents are lost)
+ */
+void irq_get_handler_hist(histogram_t *out);
+
+/**
+ * @brief Clear the handler duration histograms
+ */
+void irq_reset_handler_hist(void);
+
+/**
+ * @brief Name a line was registered with, or NULL if it is unused
+ */
+const char *irq_name(int irq);
+
+/**
+ * @brief Common C entry point (called from irq_common in interrupts.asm)
+ */
+void irq_dispatch(uint64_t vector);
+
+#endif /* _ARCH_X86_64_IRQ_H */
@@ -0,0 +1,99 @@
+/**
+ * @file pit.c
+ * @brief PIT channel 0 periodic tick implementation
+ */
+
+#include "pit.h"
+#include "irq.h"
+#include "cpu.h"
+#include <arch/x86_64.h>
+#include <squirel/config.h>
+#include <arch/x86_64/io/port.h>
+#include <core/metrics.h>
+
+/* ============================================================================
+ * PIT Constants
+ * ============================================================================ */
+
+#define PIT_FREQUENCY_HZ    1193182
+#define PIT_CH0_DATA        0x40
+#define PIT_COMMAND         0x43
+
+#define PIT_DIVISOR         (PIT_FREQUENCY_HZ / PIT_TICK_HZ)
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static volatile uint64_t ticks = 0;
+
+/** @brief Edge-to-handler latency in ns, one histogram per CPU */
+static histogram_t latency_ns[MAX_CPUS];
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief Read the channel 0 count without disturbing it
+ */
+static uint16_t pit_read_count(void) {
+    outb(PIT_COMMAND, 0x00);    /* Latch channel 0 */
+    uint8_t lo = inb(PIT_CH0_DATA);
+    uint8_t hi = inb(PIT_CH0_DATA);
+    return (uint16_t)lo | ((uint16_t)hi << 8);
+}
+
+static void pit_irq(void) {
+    uint64_t elapsed = PIT_DIVISOR - pit_read_count();
+    hist_record(&latency_ns[cpu_id()], elapsed * 1000000000ull / PIT_FREQUENCY_HZ);
+    ticks++;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void pit_init(void) {
+    uint16_t divisor = (uint16_t)PIT_DIVISOR;
+
+    pit_reset_latency();
+
+    /* Channel 0, lobyte/hibyte, mode 2 (rate generator), binary */
+    outb(PIT_COMMAND, 0x34);
+    outb(PIT_CH0_DATA, divisor & 0xFF);
+    outb(PIT_CH0_DATA, divisor >> 8);
+
+    irq_register(IRQ_TIMER, "timer", pit_irq);
+}
+
+uint64_t pit_ticks(void) {
+    return ticks;
+}
+
+void pit_get_latency(histogram_t *out) {
+    hist_init(out);
+    for (int cpu = 0; cpu < cpu_count(); cpu++) {
+        hist_merge(out, &latency_ns[cpu]);
+    }
+}
+
+void pit_reset_latency(void) {
+    bool enabled = irq_active();
+    cli();
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        hist_init(&latency_ns[cpu]);
+    }
+    if (enabled) {
+        sti();
+    }
+}
+
+/* ============================================================================
+ * Metrics
+ * ============================================================================ */
+
+DEFINE_METRIC(timer_ticks_total, METRIC_COUNTER,
+              "PIT interrupts handled", 1, pit_ticks);
+DEFINE_HISTOGRAM_METRIC(timer_irq_latency_seconds,
+                        "PIT edge to timer handler latency", 1000000000, pit_get_latency);
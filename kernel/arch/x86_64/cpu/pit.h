@@ -0,0 +1,46 @@
+/**
+ * @file pit.h
+ * @brief PIT channel 0 periodic tick (IRQ 0)
+ *
+ * Channel 0 runs in mode 2 (rate generator) at PIT_TICK_HZ. The tick
+ * mainly exists so hlt-based idle loops wake up regularly; time itself
+ * is still measured with the TSC. Channel 2 stays reserved for TSC
+ * calibration (see tsc.c).
+ *
+ * LATENCY:
+ *   The IRQ 0 handler latches the channel 0 count: in mode 2 the count
+ *   restarts from the divisor at the edge that raised the interrupt, so
+ *   divisor - count is the time from that edge to the handler, at PIT
+ *   resolution (838 ns). It is recorded in a per-CPU histogram. A delay
+ *   of more than one tick period cannot be told apart from a short one.
+ */
+
+#ifndef _ARCH_X86_64_PIT_H
+#define _ARCH_X86_64_PIT_H
+
+#include <squirel/types.h>
+#include <lib/histogram/histogram.h>
+
+/**
+ * @brief Program channel 0 and register the IRQ 0 handler
+ *
+ * @note Requires irq_init()
+ */
+void pit_init(void);
+
+/**
+ * @brief Timer interrupts since pit_init()
+ */
+uint64_t pit_ticks(void);
+
+/**
+ * @brief Merge the per-CPU timer interrupt latency histograms (nanoseconds)
+ */
+void pit_get_latency(histogram_t *out);
+
+/**
+ * @brief Clear the timer interrupt latency histograms
+ */
+void pit_reset_latency(void);
+
+#endif /* _ARCH_X86_64_PIT_H */
@@ -0,0 +1,153 @@
+; ============================================================================
+; resume.asm - Hibernation Context Save and Image Restore
+; ============================================================================
+; PURPOSE: The two pieces of hibernation (core/hibernate.c) that C cannot
+;          express: capturing the CPU state the snapshot resumes into, and
+;          the final copy that puts the snapshot back in place over the
+;          running kernel.
+;
+; SAVE (hibernate_save):
+;   Works like setjmp: records the callee-saved registers, the stack
+;   pointer and return address of its caller, RFLAGS and CR3 in the
+;   context, and returns 0. When a snapshot taken after this point is
+;   restored, hibernate_restore returns here a second time with the
+;   token it was given, which is never 0.
+;
+; RESTORE (hibernate_restore):
+;   Runs in the freshly booted kernel once every page of the image is
+;   either in place or staged in a frame the image does not use. It
+;   switches to a page table built in such a frame (an identity map of
+;   the first 1GB with 2MB pages), walks the list of (destination,
+;   source) pairs copying or zeroing each page, then loads the CR3 and
+;   registers saved in hibernate_ctx - which the copy just brought back
+;   - and jumps to the saved return address.
+;
+;   The copy overwrites this kernel's data, stack and page tables, so
+;   it runs with interrupts off, never touches the stack, and keeps its
+;   state in registers. The kernel text is overwritten too, but with the
+;   same bytes: a snapshot is only restored by the kernel that wrote it.
+;
+; PAIR LIST PAGE (hibernate.c, restore_page_t):
+;   +0      Physical address of the next list page (0 = last)
+;   +8      Pairs on this page
+;   +16     { destination, source } pairs, 16 bytes each; a source of 0
+;           means the destination is zero-filled
+;
+; CONTEXT (hibernate.c, hibernate_cpu_t):
+;   +0 RBX  +8 RBP  +16 R12  +24 R13  +32 R14  +40 R15
+;   +48 RSP +56 RIP +64 RFLAGS +72 CR3
+; ============================================================================
+
+bits 64
+section .text
+
+global hibernate_save
+global hibernate_restore
+extern hibernate_ctx
+
+; Context offsets
+CTX_RBX     equ 0
+CTX_RBP     equ 8
+CTX_R12     equ 16
+CTX_R13     equ 24
+CTX_R14     equ 32
+CTX_R15     equ 40
+CTX_RSP     equ 48
+CTX_RIP     equ 56
+CTX_RFLAGS  equ 64
+CTX_CR3     equ 72
+
+; Pair list page offsets
+LIST_NEXT   equ 0
+LIST_COUNT  equ 8
+LIST_PAIRS  equ 16
+
+; ============================================================================
+; uint64_t hibernate_save(hibernate_cpu_t *ctx)
+; ============================================================================
+; RDI = context. Returns 0 now, and the restore token after a resume.
+; ============================================================================
+hibernate_save:
+    mov [rdi + CTX_RBX], rbx
+    mov [rdi + CTX_RBP], rbp
+    mov [rdi + CTX_R12], r12
+    mov [rdi + CTX_R13], r13
+    mov [rdi + CTX_R14], r14
+    mov [rdi + CTX_R15], r15
+
+    ; The caller's stack pointer once this call has returned
+    lea rax, [rsp + 8]
+    mov [rdi + CTX_RSP], rax
+    mov rax, [rsp]                  ; Return address
+    mov [rdi + CTX_RIP], rax
+
+    pushfq
+    pop rax
+    mov [rdi + CTX_RFLAGS], rax
+    mov rax, cr3
+    mov [rdi + CTX_CR3], rax
+
+    xor eax, eax
+    ret
+
+; ============================================================================
+; void hibernate_restore(uint64_t list, uint64_t cr3, uint64_t token)
+; ============================================================================
+; RDI = first pair list page, RSI = temporary PML4, RDX = token returned
+; by hibernate_save in the resumed kernel. Does not return.
+;
+; Registers during the copy:
+;   R8  = token          R9  = current list page
+;   R10 = pairs left     R11 = current pair
+; ============================================================================
+hibernate_restore:
+    cli
+    cld
+    mov r8, rdx
+    mov r9, rdi
+    mov cr3, rsi                    ; Page tables outside the image
+
+.next_page:
+    test r9, r9
+    jz .copied
+    mov r10, [r9 + LIST_COUNT]
+    lea r11, [r9 + LIST_PAIRS]
+
+.next_pair:
+    test r10, r10
+    jz .page_done
+    mov rdi, [r11]                  ; Destination
+    mov rsi, [r11 + 8]              ; Source, or 0
+    mov ecx, 512                    ; Qwords per 4KB page
+    test rsi, rsi
+    jz .zero
+    rep movsq
+    jmp .pair_done
+.zero:
+    xor eax, eax
+    rep stosq
+.pair_done:
+    add r11, 16
+    dec r10
+    jmp .next_pair
+
+.page_done:
+    mov r9, [r9 + LIST_NEXT]
+    jmp .next_page
+
+.copied:
+    ; Memory is the snapshot again: continue in its saved context
+    mov rdi, hibernate_ctx
+    mov rax, [rdi + CTX_CR3]
+    mov cr3, rax
+    mov rbx, [rdi + CTX_RBX]
+    mov rbp, [rdi + CTX_RBP]
+    mov r12, [rdi + CTX_R12]
+    mov r13, [rdi + CTX_R13]
+    mov r14, [rdi + CTX_R14]
+    mov r15, [rdi + CTX_R15]
+    mov rsp, [rdi + CTX_RSP]
+    push qword [rdi + CTX_RFLAGS]
+    popfq
+    mov rax, r8                     ; hibernate_save() returns the token
+    jmp [rdi + CTX_RIP]
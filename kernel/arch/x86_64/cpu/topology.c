@@ -0,0 +1,184 @@
+/**
+ * @file topology.c
+ * @brief Cache, TLB and CPU topology discovery implementation
+ */
+
+#include "topology.h"
+#include <arch/x86_64.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define LEAF_CACHE          0x04
+#define LEAF_TOPOLOGY       0x0B
+#define LEAF_TLB            0x18
+#define LEAF_EXT_MAX        0x80000000u
+#define LEAF_AMD_CACHE      0x8000001Du
+
+/** @brief Leaf 0xB level types (ECX[15:8]) */
+#define TOPO_LEVEL_SMT      1
+#define TOPO_LEVEL_CORE     2
+
+/** @brief Subleaves tried before giving up on a list that never ends */
+#define MAX_SUBLEAVES       32
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static topo_cache_t caches[TOPO_MAX_CACHES];
+static int cache_count = 0;
+
+static topo_tlb_t tlbs[TOPO_MAX_TLBS];
+static int tlb_count = 0;
+
+static topo_cpu_t cpu_topo;
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static inline uint32_t bits(uint32_t v, int lo, int hi) {
+    return (v >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+static bool vendor_is_amd(uint32_t *max_leaf) {
+    uint32_t ebx, ecx, edx;
+    cpuid(0, max_leaf, &ebx, &ecx, &edx);
+    /* "AuthenticAMD" */
+    return ebx == 0x68747541 && edx == 0x69746E65 && ecx == 0x444D4163;
+}
+
+/**
+ * @brief Read a leaf 4 style cache list (same layout in 0x8000001D)
+ */
+static void read_caches(uint32_t leaf) {
+    for (uint32_t sub = 0; sub < MAX_SUBLEAVES && cache_count < TOPO_MAX_CACHES; sub++) {
+        uint32_t eax, ebx, ecx, edx;
+        cpuid_count(leaf, sub, &eax, &ebx, &ecx, &edx);
+        uint32_t type = bits(eax, 0, 4);
+        if (type == 0) {
+            break;
+        }
+
+        topo_cache_t *c = &caches[cache_count++];
+        c->type = (uint8_t)type;
+        c->level = (uint8_t)bits(eax, 5, 7);
+        c->fully_assoc = (eax >> 9) & 1;
+        c->shared_by = bits(eax, 14, 25) + 1;
+        c->line = bits(ebx, 0, 11) + 1;
+        c->partitions = bits(ebx, 12, 21) + 1;
+        c->ways = bits(ebx, 22, 31) + 1;
+        c->sets = ecx + 1;
+        c->inclusive = (edx >> 1) & 1;
+        c->size = (uint64_t)c->ways * c->partitions * c->line * c->sets;
+    }
+}
+
+static void read_tlbs(void) {
+    uint32_t max_sub, ebx, ecx, edx;
+    cpuid_count(LEAF_TLB, 0, &max_sub, &ebx, &ecx, &edx);
+
+    for (uint32_t sub = 0; sub <= max_sub && sub < MAX_SUBLEAVES; sub++) {
+        uint32_t eax;
+        cpuid_count(LEAF_TLB, sub, &eax, &ebx, &ecx, &edx);
+        uint32_t type = bits(edx, 0, 4);
+        if (type == 0) {
+            continue;   /* Invalid subleaves may sit between valid ones */
+        }
+        if (tlb_count == TOPO_MAX_TLBS) {
+            break;
+        }
+
+        topo_tlb_t *t = &tlbs[tlb_count++];
+        t->type = (uint8_t)type;
+        t->level = (uint8_t)bits(edx, 5, 7);
+        t->fully_assoc = (edx >> 8) & 1;
+        t->shared_by = bits(edx, 14, 25) + 1;
+        t->pages = (uint8_t)bits(ebx, 0, 3);
+        t->ways = bits(ebx, 16, 31);
+        t->sets = ecx;
+        t->entries = t->ways * t->sets;
+    }
+}
+
+static void read_cpu_topology(void) {
+    for (uint32_t sub = 0; sub < MAX_SUBLEAVES; sub++) {
+        uint32_t eax, ebx, ecx, edx;
+        cpuid_count(LEAF_TOPOLOGY, sub, &eax, &ebx, &ecx, &edx);
+        uint32_t type = bits(ecx, 8, 15);
+        if (type == 0 || bits(ebx, 0, 15) == 0) {
+            break;
+        }
+
+        cpu_topo.valid = true;
+        cpu_topo.x2apic_id = edx;
+        if (type == TOPO_LEVEL_SMT) {
+            cpu_topo.threads_per_core = bits(ebx, 0, 15);
+        } else if (type == TOPO_LEVEL_CORE) {
+            cpu_topo.threads_per_package = bits(ebx, 0, 15);
+        }
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void topology_init(void) {
+    uint32_t max_leaf, max_ext, ebx, ecx, edx;
+    bool amd = vendor_is_amd(&max_leaf);
+    cpuid(LEAF_EXT_MAX, &max_ext, &ebx, &ecx, &edx);
+
+    cache_count = 0;
+    tlb_count = 0;
+    if (amd && max_ext >= LEAF_AMD_CACHE) {
+        read_caches(LEAF_AMD_CACHE);
+    } else if (!amd && max_leaf >= LEAF_CACHE) {
+        read_caches(LEAF_CACHE);
+    }
+    if (!amd && max_leaf >= LEAF_TLB) {
+        read_tlbs();
+    }
+    if (max_leaf >= LEAF_TOPOLOGY) {
+        read_cpu_topology();
+    }
+}
+
+int topology_get_caches(const topo_cache_t **out) {
+    *out = caches;
+    return cache_count;
+}
+
+int topology_get_tlbs(const topo_tlb_t **out) {
+    *out = tlbs;
+    return tlb_count;
+}
+
+const topo_cpu_t *topology_get_cpu(void) {
+    return &cpu_topo;
+}
+
+const topo_cache_t *topology_find_cache(int level) {
+    for (int i = 0; i < cache_count; i++) {
+        if (caches[i].level == level && caches[i].type != TOPO_INSTRUCTION) {
+            return &caches[i];
+        }
+    }
+    return NULL;
+}
+
+uint32_t topology_page_colors(int level) {
+    const topo_cache_t *c = topology_find_cache(level);
+    if (!c || c->fully_assoc) {
+        return 1;
+    }
+
+    uint64_t span = (uint64_t)c->sets * c->line;
+    uint32_t colors = 1;
+    while ((uint64_t)colors * 2 * 4096 <= span) {
+        colors *= 2;
+    }
+    return colors;
+}
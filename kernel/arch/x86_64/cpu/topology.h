@@ -0,0 +1,126 @@
+/**
+ * @file topology.h
+ * @brief Cache, TLB and CPU topology discovery (CPUID)
+ *
+ * SOURCES:
+ *   Leaf 4 (Intel) / 0x8000001D (AMD) - one subleaf per cache: level,
+ *       type, line size, ways, partitions, sets, and how many logical
+ *       CPUs share it
+ *   Leaf 0x18 - one subleaf per TLB: level, type, page sizes, ways and
+ *       sets (Intel only; the TLB list is empty elsewhere)
+ *   Leaf 0xB  - x2APIC topology: logical CPUs per core and per package
+ *
+ * PAGE COLORS:
+ *   In a physically indexed cache of S sets of L-byte lines, address bits
+ *   [log2(L), log2(S*L)) pick the set. The bits above bit 11 are fixed by
+ *   the physical frame, so frames fall into S*L/4096 "colors"; frames of
+ *   different colors never compete for the same sets. For a 1MB 16-way
+ *   L2 that is 16 colors. topology_page_colors() gives the count the
+ *   frame allocator uses for colored allocation (see pmm.h).
+ */
+
+#ifndef _ARCH_X86_64_TOPOLOGY_H
+#define _ARCH_X86_64_TOPOLOGY_H
+
+#include <squirel/types.h>
+
+#define TOPO_MAX_CACHES     8
+#define TOPO_MAX_TLBS       16
+
+/**
+ * @brief What a cache or TLB holds
+ */
+typedef enum {
+    TOPO_DATA = 1,
+    TOPO_INSTRUCTION = 2,
+    TOPO_UNIFIED = 3,
+    TOPO_LOAD = 4,              /**< TLB for loads only (leaf 0x18) */
+    TOPO_STORE = 5,             /**< TLB for stores only (leaf 0x18) */
+} topo_type_t;
+
+/** @brief TLB page size bits (leaf 0x18 EBX[3:0]) */
+#define TOPO_PAGE_4K        (1u << 0)
+#define TOPO_PAGE_2M        (1u << 1)
+#define TOPO_PAGE_4M        (1u << 2)
+#define TOPO_PAGE_1G        (1u << 3)
+
+/**
+ * @brief One cache
+ */
+typedef struct {
+    uint8_t level;
+    uint8_t type;               /**< topo_type_t */
+    bool fully_assoc;
+    bool inclusive;             /**< Includes the lower levels */
+    uint32_t line;              /**< Bytes per line */
+    uint32_t ways;
+    uint32_t partitions;
+    uint32_t sets;
+    uint32_t shared_by;         /**< Logical CPUs sharing it (upper bound) */
+    uint64_t size;              /**< Bytes */
+} topo_cache_t;
+
+/**
+ * @brief One TLB
+ */
+typedef struct {
+    uint8_t level;
+    uint8_t type;               /**< topo_type_t */
+    bool fully_assoc;
+    uint8_t pages;              /**< TOPO_PAGE_* */
+    uint32_t ways;
+    uint32_t sets;
+    uint32_t entries;
+    uint32_t shared_by;
+} topo_tlb_t;
+
+/**
+ * @brief Processor topology from leaf 0xB
+ */
+typedef struct {
+    bool valid;                 /**< Leaf 0xB present */
+    uint32_t x2apic_id;         /**< Of the boot CPU */
+    uint32_t threads_per_core;
+    uint32_t threads_per_package;
+} topo_cpu_t;
+
+/**
+ * @brief Read the CPUID cache, TLB and topology leaves
+ *
+ * @note Call after cpu_init()
+ */
+void topology_init(void);
+
+/**
+ * @brief Get the caches, in CPUID order (usually L1d, L1i, L2, L3)
+ *
+ * @return Number of entries
+ */
+int topology_get_caches(const topo_cache_t **out);
+
+/**
+ * @brief Get the TLBs (empty without leaf 0x18)
+ *
+ * @return Number of entries
+ */
+int topology_get_tlbs(const topo_tlb_t **out);
+
+/**
+ * @brief Get the processor topology
+ */
+const topo_cpu_t *topology_get_cpu(void);
+
+/**
+ * @brief Find the data or unified cache of a level
+ *
+ * @return The cache, or NULL if there is none
+ */
+const topo_cache_t *topology_find_cache(int level);
+
+/**
+ * @brief Page colors of a cache level: sets * line / 4096, rounded down
+ *        to a power of two (1 if the level is missing or smaller)
+ */
+uint32_t topology_page_colors(int level);
+
+#endif /* _ARCH_X86_64_TOPOLOGY_H */
@@ -0,0 +1,86 @@
+/**
+ * @file tsc.c
+ * @brief Time Stamp Counter calibration implementation
+ *
+ * PIT channel 2 is gated through port 0x61:
+ *   Bit 0: Gate input of channel 2 (1 = counting enabled)
+ *   Bit 1: Speaker data enable (kept 0 so nothing is audible)
+ *   Bit 5: Channel 2 output (goes high when a mode 0 count expires)
+ */
+
+#include "tsc.h"
+#include <arch/x86_64/io/port.h>
+#include <core/export.h>
+
+/* ============================================================================
+ * PIT Constants
+ * ============================================================================ */
+
+#define PIT_FREQUENCY_HZ    1193182
+#define PIT_CH2_DATA        0x42
+#define PIT_COMMAND         0x43
+#define PIT_GATE_PORT       0x61
+
+/** @brief Calibration window (10ms) */
+#define CALIBRATE_MS        10
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/** @brief Calibrated TSC frequency in kHz */
+static uint64_t tsc_freq_khz = 0;
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void tsc_init(void) {
+    uint16_t latch = (uint16_t)(PIT_FREQUENCY_HZ / (1000 / CALIBRATE_MS));
+
+    /* Gate high, speaker off */
+    outb(PIT_GATE_PORT, (inb(PIT_GATE_PORT) & ~0x02) | 0x01);
+
+    /* Channel 2, lobyte/hibyte, mode 0 (interrupt on terminal count), binary */
+    outb(PIT_COMMAND, 0xB0);
+    outb(PIT_CH2_DATA, latch & 0xFF);
+    outb(PIT_CH2_DATA, latch >> 8);
+
+    uint64_t start = rdtsc();
+    while ((inb(PIT_GATE_PORT) & 0x20) == 0) {
+        /* Wait for channel 2 output to go high */
+    }
+    uint64_t end = rdtsc();
+
+    tsc_freq_khz = (end - start) / CALIBRATE_MS;
+    if (tsc_freq_khz == 0) {
+        tsc_freq_khz = 1;  /* Never divide by zero in conversions */
+    }
+}
+
+uint64_t tsc_khz(void) {
+    return tsc_freq_khz;
+}
+
+uint64_t tsc_cycles_to_ns(uint64_t cycles) {
+    if (tsc_freq_khz == 0) {
+        return 0;
+    }
+    /* Split to avoid overflowing cycles * 1000000 for long intervals */
+    return (cycles / tsc_freq_khz) * 1000000 +
+           ((cycles % tsc_freq_khz) * 1000000) / tsc_freq_khz;
+}
+EXPORT_SYMBOL(tsc_cycles_to_ns);
+
+uint64_t tsc_cycles_to_us(uint64_t cycles) {
+    if (tsc_freq_khz == 0) {
+        return 0;
+    }
+    return (cycles / tsc_freq_khz) * 1000 +
+           ((cycles % tsc_freq_khz) * 1000) / tsc_freq_khz;
+}
+EXPORT_SYMBOL(tsc_cycles_to_us);
+
+uint64_t tsc_us_to_cycles(uint64_t us) {
+    return (us * tsc_freq_khz) / 1000;
+}
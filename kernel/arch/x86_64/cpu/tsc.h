@@ -0,0 +1,51 @@
+/**
+ * @file tsc.h
+ * @brief Time Stamp Counter calibration and conversion
+ *
+ * The TSC is the cheapest timestamp source on x86_64 (a single RDTSC
+ * instruction), which makes it the right clock for benchmarks and
+ * throughput reporting. Its frequency is not architecturally exposed,
+ * so we calibrate it once at boot against the PIT.
+ *
+ * CALIBRATION:
+ *   PIT channel 2 (the PC speaker channel) is programmed for a one-shot
+ *   10ms countdown. Its output can be polled through port 0x61 bit 5
+ *   without any interrupt, so calibration works with IF=0.
+ */
+
+#ifndef _ARCH_X86_64_TSC_H
+#define _ARCH_X86_64_TSC_H
+
+#include <squirel/types.h>
+#include <arch/x86_64.h>
+
+/**
+ * @brief Calibrate the TSC against the PIT
+ *
+ * @note Takes ~10ms. Must be called before any tsc_*_to_* conversion.
+ */
+void tsc_init(void);
+
+/**
+ * @brief Get the calibrated TSC frequency
+ *
+ * @return Frequency in kHz (0 if tsc_init() has not run)
+ */
+uint64_t tsc_khz(void);
+
+/**
+ * @brief Convert a TSC delta to nanoseconds
+ */
+uint64_t tsc_cycles_to_ns(uint64_t cycles);
+
+/**
+ * @brief Convert a TSC delta to microseconds
+ */
+uint64_t tsc_cycles_to_us(uint64_t cycles);
+
+/**
+ * @brief Convert microseconds to a TSC delta (for timeouts)
+ */
+uint64_t tsc_us_to_cycles(uint64_t us);
+
+#endif /* _ARCH_X86_64_TSC_H */
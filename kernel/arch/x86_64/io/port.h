@@ -150,6 +150,74 @@ static ALWAYS_INLINE uint32_t inl(uint16_t port) {
     return ret;
 }
 
+/* ============================================================================
+ * String Port I/O
+ * ============================================================================ */
+
+/**
+ * @brief Write a buffer of bytes to a single I/O port
+ * 
+ * @param port  The port number
+ * @param buf   Bytes to write
+ * @param len   Number of bytes
+ * 
+ * ASSEMBLY:
+ *   rep outsb
+ *   - RSI points at the data, RCX holds the count, DX the port
+ *   - One instruction for the whole buffer: under KVM this costs one
+ *     exit per page of data instead of one exit per byte
+ */
+static ALWAYS_INLINE void outsb(uint16_t port, const void *buf, size_t len) {
+    __asm__ volatile (
+        "rep outsb"
+        : "+S"(buf), "+c"(len)
+        : "d"(port)
+        : "memory"
+    );
+}
+
+/**
+ * @brief Read words from a port into a buffer (16-bit string input)
+ * 
+ * @param port   The port number
+ * @param buf    Destination
+ * @param count  Number of words
+ * 
+ * ASSEMBLY:
+ *   rep insw
+ *   - RDI points at the buffer, RCX holds the count, DX the port
+ *   - Used for PIO data transfers (one ATA sector = 256 words)
+ */
+static ALWAYS_INLINE void insw(uint16_t port, void *buf, size_t count) {
+    __asm__ volatile (
+        "rep insw"
+        : "+D"(buf), "+c"(count)
+        : "d"(port)
+        : "memory"
+    );
+}
+
+/**
+ * @brief Write words from a buffer to a port (16-bit string output)
+ * 
+ * @param port   The port number
+ * @param buf    Source
+ * @param count  Number of words
+ * 
+ * ASSEMBLY:
+ *   rep outsw
+ *   - RSI points at the buffer, RCX holds the count, DX the port
+ *   - The write half of ATA PIO transfers
+ */
+static ALWAYS_INLINE void outsw(uint16_t port, const void *buf, size_t count) {
+    __asm__ volatile (
+        "rep outsw"
+        : "+S"(buf), "+c"(count)
+        : "d"(port)
+        : "memory"
+    );
+}
+
 /* ============================================================================
  * I/O Wait (for slow devices)
  * ============================================================================ */
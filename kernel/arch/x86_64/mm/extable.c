@@ -0,0 +1,33 @@
+/**
+ * @file extable.c
+ * @brief Exception fixup table implementation
+ */
+
+#include "extable.h"
+#include <core/stat.h>
+
+/* Linker script symbols: the table */
+extern const extable_entry_t __ex_table_start[];
+extern const extable_entry_t __ex_table_end[];
+
+DEFINE_STAT(extable_fixups, "Faults recovered through the exception table");
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool extable_fixup(interrupt_frame_t *frame) {
+    /* A handful of entries: a linear scan beats keeping the table sorted */
+    for (const extable_entry_t *e = __ex_table_start; e < __ex_table_end; e++) {
+        if (e->insn == frame->rip) {
+            frame->rip = e->fixup;
+            stat_inc(extable_fixups);
+            return true;
+        }
+    }
+    return false;
+}
+
+int extable_count(void) {
+    return (int)(__ex_table_end - __ex_table_start);
+}
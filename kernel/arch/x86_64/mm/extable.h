@@ -0,0 +1,61 @@
+/**
+ * @file extable.h
+ * @brief Exception fixup table
+ *
+ * An instruction that may legitimately fault (reading an address typed
+ * by the operator, copying from a user buffer) is annotated with
+ * _ASM_EXTABLE(insn, fixup). If it raises #PF or #GP, the exception
+ * handler looks its address up in the table and resumes at the fixup
+ * label instead of panicking. Accesses that do not fault pay nothing:
+ * no page table walk, no check, just the instruction.
+ *
+ * TABLE:
+ *   Each annotation emits one { insn, fixup } pair into the __ex_table
+ *   section; the linker script gathers them into an array between
+ *   __ex_table_start and __ex_table_end.
+ *
+ * @example
+ *   __asm__ volatile("1: rep movsb\n"
+ *                    "2:\n"
+ *                    _ASM_EXTABLE(1b, 2b)
+ *                    : "+D"(dst), "+S"(src), "+c"(len) :: "memory");
+ *   // On a fault, len holds the bytes that were not copied
+ */
+
+#ifndef _ARCH_X86_64_EXTABLE_H
+#define _ARCH_X86_64_EXTABLE_H
+
+#include <squirel/types.h>
+#include <arch/x86_64/cpu/idt.h>
+
+/**
+ * @brief One fixup: a fault at insn resumes at fixup
+ */
+typedef struct {
+    uint64_t insn;
+    uint64_t fixup;
+} extable_entry_t;
+
+/**
+ * @brief Annotate the instruction at label 'from' (inline asm string)
+ */
+#define _ASM_EXTABLE(from, to)                                              \
+    ".pushsection __ex_table, \"a\"\n"                                      \
+    ".balign 8\n"                                                           \
+    ".quad " #from ", " #to "\n"                                            \
+    ".popsection\n"
+
+/**
+ * @brief Redirect a faulting frame to its fixup
+ *
+ * @param frame  Exception frame (rip is rewritten on success)
+ * @return       false if the faulting instruction is not annotated
+ */
+bool extable_fixup(interrupt_frame_t *frame);
+
+/**
+ * @brief Number of annotated instructions
+ */
+int extable_count(void);
+
+#endif /* _ARCH_X86_64_EXTABLE_H */
@@ -0,0 +1,355 @@
+/**
+ * @file ksm.c
+ * @brief Same-page merging implementation
+ */
+
+#include "ksm.h"
+#include "paging.h"
+#include "pmm.h"
+#include "vmalloc.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <lib/memory/memory.h>
+#include <core/stat.h>
+#include <core/cpustat.h>
+#include <core/metrics.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define PAGE_SIZE           4096ull
+
+/** @brief Unstable table slots (power of two, kept at most 3/4 full) */
+#define UNSTABLE_SLOTS      16384
+
+/** @brief Addresses visited per page hashed at most (skipping holes) */
+#define VISITS_PER_PAGE     8
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+typedef struct {
+    uint64_t hash;
+    uint64_t frame;
+    uint64_t refs;          /**< Mappings onto the frame */
+} stable_node_t;
+
+typedef struct {
+    uint64_t hash;
+    uint64_t va;            /**< 0 = empty slot */
+} unstable_node_t;
+
+/** @brief Merged frames, sorted by hash */
+static stable_node_t stable[KSM_MAX_STABLE];
+static int stable_count = 0;
+
+static unstable_node_t unstable[UNSTABLE_SLOTS];
+static int unstable_count = 0;
+
+static uint64_t zero_frame = 0;
+static uint64_t zero_hash = 0;
+
+static bool enabled = false;
+static uint64_t cursor = VMALLOC_START;
+static uint64_t last_run = 0;
+
+static uint64_t mappings = 0;
+static uint64_t zero_mappings = 0;
+static uint64_t full_scans = 0;
+
+/** @brief Area snapshot for a scan (too large for the stack) */
+static vm_area_t snapshot[VMALLOC_MAX_AREAS];
+
+DEFINE_STAT(ksm_pages_scanned, "Pages hashed by the same-page merging scanner");
+DEFINE_STAT(ksm_pages_merged, "Pages merged onto a shared frame");
+DEFINE_STAT(ksm_scan_ns, "CPU time of the same-page merging scanner (ns)");
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/**
+ * @brief 64-bit content hash of a page (xxHash64-style rounds)
+ */
+static uint64_t page_hash(const void *page) {
+    const uint64_t *w = (const uint64_t *)page;
+    uint64_t h = 0x27D4EB2F165667C5ull;
+    for (int i = 0; i < (int)(PAGE_SIZE / 8); i++) {
+        h ^= rotl64(w[i] * 0xC2B2AE3D27D4EB4Full, 31) * 0x9E3779B185EBCA87ull;
+        h = rotl64(h, 27) * 0x9E3779B185EBCA87ull + 0x85EBCA77C2B2AE63ull;
+    }
+    h ^= h >> 33;
+    h *= 0xC2B2AE3D27D4EB4Full;
+    h ^= h >> 29;
+    return h;
+}
+
+static const void *frame_ptr(uint64_t frame) {
+    return (const void *)(uintptr_t)frame;
+}
+
+/**
+ * @brief First stable index whose hash is >= h
+ */
+static int stable_lower_bound(uint64_t h) {
+    int lo = 0;
+    int hi = stable_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (stable[mid].hash < h) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Find a merged frame with the same contents
+ */
+static stable_node_t *stable_find(uint64_t h, const void *page) {
+    for (int i = stable_lower_bound(h); i < stable_count && stable[i].hash == h; i++) {
+        if (memcmp(frame_ptr(stable[i].frame), page, PAGE_SIZE) == 0) {
+            return &stable[i];
+        }
+    }
+    return NULL;
+}
+
+static bool stable_insert(uint64_t h, uint64_t frame, uint64_t refs) {
+    if (stable_count >= KSM_MAX_STABLE) {
+        return false;
+    }
+    int i = stable_lower_bound(h);
+    memmove(&stable[i + 1], &stable[i], (size_t)(stable_count - i) * sizeof(stable_node_t));
+    stable[i].hash = h;
+    stable[i].frame = frame;
+    stable[i].refs = refs;
+    stable_count++;
+    return true;
+}
+
+/**
+ * @brief Find a page seen this pass that still has the same contents
+ *
+ * @return Its address, or 0
+ */
+static uint64_t unstable_match(uint64_t h, uint64_t va, const void *page) {
+    for (uint64_t i = h & (UNSTABLE_SLOTS - 1); unstable[i].va; i = (i + 1) & (UNSTABLE_SLOTS - 1)) {
+        uint64_t other = unstable[i].va;
+        if (unstable[i].hash != h || other == va) {
+            continue;
+        }
+        uint64_t frame = paging_translate(other);
+        if (frame && paging_is_writable(other) &&
+            memcmp(frame_ptr(frame), page, PAGE_SIZE) == 0) {
+            return other;
+        }
+    }
+    return 0;
+}
+
+static void unstable_insert(uint64_t h, uint64_t va) {
+    if (unstable_count >= UNSTABLE_SLOTS / 4 * 3) {
+        return;
+    }
+    uint64_t i = h & (UNSTABLE_SLOTS - 1);
+    while (unstable[i].va) {
+        i = (i + 1) & (UNSTABLE_SLOTS - 1);
+    }
+    unstable[i].hash = h;
+    unstable[i].va = va;
+    unstable_count++;
+}
+
+/**
+ * @brief Point va at a shared frame, read-only, and free its own frame
+ */
+static void remap_shared(uint64_t va, uint64_t frame, uint64_t shared) {
+    paging_map_page(va, shared, false);
+    if (frame != shared) {
+        pmm_free(frame);
+    }
+    stat_inc(ksm_pages_merged);
+}
+
+/**
+ * @brief Hash one page and merge it if a twin is known
+ *
+ * @return false if va holds no private 4KB page
+ */
+static bool scan_page(uint64_t va) {
+    uint64_t frame = paging_translate(va);
+    if (!frame || !paging_is_writable(va)) {
+        return false;   /* Not mapped, 2MB, swapped out, or already merged */
+    }
+
+    const void *page = frame_ptr(frame);
+    uint64_t h = page_hash(page);
+    stat_inc(ksm_pages_scanned);
+
+    if (h == zero_hash && memcmp(page, frame_ptr(zero_frame), PAGE_SIZE) == 0) {
+        remap_shared(va, frame, zero_frame);
+        zero_mappings++;
+        return true;
+    }
+
+    stable_node_t *node = stable_find(h, page);
+    if (node) {
+        remap_shared(va, frame, node->frame);
+        node->refs++;
+        mappings++;
+        return true;
+    }
+
+    uint64_t twin = unstable_match(h, va, page);
+    if (twin) {
+        /* The twin's frame becomes the shared copy */
+        uint64_t shared = paging_translate(twin);
+        if (stable_insert(h, shared, 2)) {
+            paging_map_page(twin, shared, false);
+            remap_shared(va, frame, shared);
+            mappings += 2;
+        }
+        return true;
+    }
+
+    unstable_insert(h, va);
+    return true;
+}
+
+/**
+ * @brief Idle hook: one rate-limited scanner run
+ */
+static void ksm_idle(void) {
+    if (!enabled || rdtsc() - last_run < tsc_us_to_cycles(KSM_SLEEP_US)) {
+        return;
+    }
+    ksm_scan(KSM_PAGES_PER_RUN);
+    last_run = rdtsc();
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void ksm_init(void) {
+    zero_frame = pmm_alloc_zeroed();
+    if (!zero_frame) {
+        return;
+    }
+    zero_hash = page_hash(frame_ptr(zero_frame));
+    cpu_idle_add_hook(ksm_idle);
+}
+
+void ksm_set_enabled(bool on) {
+    enabled = on && zero_frame;
+}
+
+bool ksm_enabled(void) {
+    return enabled;
+}
+
+uint64_t ksm_scan(uint64_t pages) {
+    if (!zero_frame) {
+        return 0;
+    }
+
+    uint64_t flags = irq_save();
+    uint64_t start = rdtsc();
+    int n = vmalloc_get_areas(snapshot, VMALLOC_MAX_AREAS);
+    uint64_t scanned = 0;
+    uint64_t visits = pages * VISITS_PER_PAGE;
+
+    while (scanned < pages && visits > 0 && n > 0) {
+        int i = 0;
+        while (i < n && snapshot[i].start + snapshot[i].pages * PAGE_SIZE <= cursor) {
+            i++;
+        }
+        if (i == n) {
+            /* Pass complete: candidates from it are stale now */
+            cursor = VMALLOC_START;
+            memset(unstable, 0, sizeof(unstable));
+            unstable_count = 0;
+            full_scans++;
+            continue;
+        }
+
+        uint64_t va = cursor > snapshot[i].start ? cursor : snapshot[i].start;
+        uint64_t end = snapshot[i].start + snapshot[i].pages * PAGE_SIZE;
+        for (; va < end && scanned < pages && visits > 0; va += PAGE_SIZE, visits--) {
+            if (scan_page(va)) {
+                scanned++;
+            }
+        }
+        cursor = va;
+    }
+
+    stat_add(ksm_scan_ns, tsc_cycles_to_ns(rdtsc() - start));
+    irq_restore(flags);
+    return scanned;
+}
+
+bool ksm_put_page(uint64_t frame) {
+    if (frame == zero_frame && frame) {
+        zero_mappings--;
+        return true;
+    }
+
+    uint64_t flags = irq_save();
+    for (int i = 0; i < stable_count; i++) {
+        if (stable[i].frame != frame) {
+            continue;
+        }
+        mappings--;
+        if (--stable[i].refs == 0) {
+            pmm_free(frame);
+            memmove(&stable[i], &stable[i + 1],
+                    (size_t)(stable_count - i - 1) * sizeof(stable_node_t));
+            stable_count--;
+        }
+        irq_restore(flags);
+        return true;
+    }
+    irq_restore(flags);
+    return false;
+}
+
+void ksm_get_stats(ksm_stats_t *out) {
+    out->shared = (uint64_t)stable_count;
+    out->sharing = mappings;
+    out->zero = zero_mappings;
+    out->full_scans = full_scans;
+}
+
+/* ============================================================================
+ * Metrics
+ * ============================================================================ */
+
+static uint64_t metric_shared(void) {
+    return (uint64_t)stable_count;
+}
+
+static uint64_t metric_sharing(void) {
+    return mappings;
+}
+
+/** @brief Frames given back: every mapping beyond the first, and all zero ones */
+static uint64_t metric_saved_bytes(void) {
+    return (mappings - (uint64_t)stable_count + zero_mappings) * PAGE_SIZE;
+}
+
+DEFINE_METRIC(ksm_pages_shared, METRIC_GAUGE,
+              "Frames shared by merged pages", 1, metric_shared);
+DEFINE_METRIC(ksm_pages_sharing, METRIC_GAUGE,
+              "Mappings onto shared frames", 1, metric_sharing);
+DEFINE_METRIC(ksm_saved_bytes, METRIC_GAUGE,
+              "Memory freed by same-page and zero-page merging", 1, metric_saved_bytes);
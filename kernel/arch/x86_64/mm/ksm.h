@@ -0,0 +1,90 @@
+/**
+ * @file ksm.h
+ * @brief Same-page merging of vmalloc memory
+ *
+ * A background scanner walks the 4KB pages of the vmalloc areas, and
+ * maps pages with identical contents onto one read-only frame. A write
+ * to a merged page faults, and the #PF handler gives the writer a
+ * private copy again (copy-on-write).
+ *
+ * ZERO PAGES:
+ *   All-zero pages are mapped onto a single zero frame that is never
+ *   freed, and need no tracking beyond a counter.
+ *
+ * STABLE AND UNSTABLE TABLES:
+ *   Every page scanned is hashed. Merged frames live in the stable
+ *   table, sorted by hash and binary searched; a page that matches one
+ *   (hash, then a full compare) joins it. Otherwise the page is looked
+ *   up in the unstable table, a hash table of pages seen during this
+ *   pass; on a match both pages are merged into a new stable frame,
+ *   else the page is added. Unstable entries are compared against their
+ *   current contents on use, so pages that changed since never merge
+ *   wrongly, and the table is cleared after each full pass.
+ *
+ * RATE LIMITING:
+ *   The scanner runs from the idle loop, at most KSM_PAGES_PER_RUN pages
+ *   per run and one run every KSM_SLEEP_US. It is off until enabled.
+ *   Its CPU time is accounted (stat ksm_scan_ns) so the cost of the
+ *   memory saved can be judged.
+ */
+
+#ifndef _ARCH_X86_64_KSM_H
+#define _ARCH_X86_64_KSM_H
+
+#include <squirel/types.h>
+
+/** @brief Pages hashed per scanner run */
+#define KSM_PAGES_PER_RUN   64
+
+/** @brief Pause between scanner runs */
+#define KSM_SLEEP_US        20000
+
+/**
+ * @brief Merging counters
+ */
+typedef struct {
+    uint64_t shared;        /**< Frames in the stable table */
+    uint64_t sharing;       /**< Mappings onto those frames */
+    uint64_t zero;          /**< Mappings onto the zero frame */
+    uint64_t full_scans;    /**< Passes over all areas completed */
+} ksm_stats_t;
+
+/**
+ * @brief Set up the zero frame and register the idle-time scanner
+ */
+void ksm_init(void);
+
+/**
+ * @brief Start or stop background scanning (merged pages stay merged)
+ */
+void ksm_set_enabled(bool enabled);
+
+/**
+ * @brief Check whether background scanning is on
+ */
+bool ksm_enabled(void);
+
+/**
+ * @brief Scan pages now, regardless of the rate limit
+ *
+ * @param pages  Pages to hash at most
+ * @return       Pages hashed
+ */
+uint64_t ksm_scan(uint64_t pages);
+
+/**
+ * @brief Drop one mapping of a merged frame
+ *
+ * Called when a read-only vmalloc mapping goes away (copy-on-write or
+ * vfree). The frame is freed with its last mapping.
+ *
+ * @return false if the frame is not a merged one
+ */
+bool ksm_put_page(uint64_t frame);
+
+/**
+ * @brief Read the merging counters
+ */
+void ksm_get_stats(ksm_stats_t *out);
+
+#endif /* _ARCH_X86_64_KSM_H */
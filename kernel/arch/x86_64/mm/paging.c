@@ -0,0 +1,491 @@
+/**
+ * @file paging.c
+ * @brief Page table attribute management implementation
+ */
+
+#include "paging.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <lib/memory/memory.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define PAGE_SIZE           0x1000ull
+#define HUGE_PAGE_SIZE      0x200000ull
+
+/* Page table entry bits */
+#define PTE_PRESENT         (1ull << 0)
+#define PTE_WRITABLE        (1ull << 1)
+#define PTE_USER            (1ull << 2)
+#define PTE_PWT             (1ull << 3)
+#define PTE_PCD             (1ull << 4)
+#define PTE_ACCESSED        (1ull << 5)
+#define PTE_HUGE            (1ull << 7)     /* In a PDE/PDPTE */
+#define PTE_PAT_4K          (1ull << 7)     /* In a 4KB PTE */
+#define PTE_PAT_HUGE        (1ull << 12)    /* In a 2MB PDE */
+#define PTE_SWAP            (1ull << 9)     /* Not present, swap entry in bits 12+ */
+
+#define PTE_ADDR_MASK       0x000FFFFFFFFFF000ull
+#define PDE_HUGE_ADDR_MASK  0x000FFFFFFFE00000ull
+
+/* MSRs */
+#define MSR_MTRRCAP         0xFE
+#define MSR_MTRR_PHYSBASE0  0x200
+#define MSR_MTRR_PHYSMASK0  0x201
+#define MSR_MTRR_FIX64K     0x250
+#define MSR_MTRR_FIX16K     0x258
+#define MSR_MTRR_FIX4K      0x268
+#define MSR_PAT             0x277
+#define MSR_MTRR_DEF_TYPE   0x2FF
+
+#define MTRR_DEF_ENABLE     (1ull << 11)
+#define MTRR_DEF_FIXED      (1ull << 10)
+#define MTRR_CAP_FIXED      (1ull << 8)
+#define MTRR_MASK_VALID     (1ull << 11)
+
+/* Architectural memory type codes */
+#define MT_UC               0x00
+#define MT_WC               0x01
+#define MT_WT               0x04
+#define MT_WP               0x05
+#define MT_WB               0x06
+#define MT_UC_MINUS         0x07
+
+/** @brief PAT entries: WB, WC, UC-, UC (twice) - see paging.h */
+#define PAT_VALUE           0x0007010600070106ull
+
+/** @brief Page tables available for splitting 2MB pages */
+#define PT_POOL_SIZE        8
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static uint64_t pt_pool[PT_POOL_SIZE][512] ALIGNED(4096);
+static int pt_pool_used = 0;
+
+static bool pat_enabled = false;
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static inline void wbinvd(void) {
+    __asm__ volatile("wbinvd" ::: "memory");
+}
+
+static inline void invlpg(uint64_t va) {
+    __asm__ volatile("invlpg (%0)" :: "r"(va) : "memory");
+}
+
+/**
+ * @brief Find (or create) the next-level table behind an entry
+ *
+ * @return The table, or NULL if it is missing and create is false, the
+ *         entry maps a huge page, or no frame is left
+ */
+static uint64_t *next_table(uint64_t *entry, bool create) {
+    if (*entry & PTE_PRESENT) {
+        if (*entry & PTE_HUGE) {
+            return NULL;
+        }
+        return (uint64_t *)(*entry & PTE_ADDR_MASK);
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    uint64_t table = pmm_alloc_zeroed();
+    if (!table) {
+        return NULL;
+    }
+    *entry = table | PTE_PRESENT | PTE_WRITABLE;
+    return (uint64_t *)(uintptr_t)table;
+}
+
+/**
+ * @brief Find the page directory entry of a dynamic address (present or not)
+ */
+static uint64_t *pde_slot(uint64_t va, bool create) {
+    uint64_t *pml4 = (uint64_t *)(read_cr3() & PTE_ADDR_MASK);
+    uint64_t *pdpt = next_table(&pml4[(va >> 39) & 511], create);
+    if (!pdpt) {
+        return NULL;
+    }
+    uint64_t *pd = next_table(&pdpt[(va >> 30) & 511], create);
+    if (!pd) {
+        return NULL;
+    }
+    return &pd[(va >> 21) & 511];
+}
+
+/**
+ * @brief Find the 4KB page table entry of an address
+ */
+static uint64_t *pte_lookup(uint64_t va, bool create) {
+    uint64_t *pde = pde_slot(va, create);
+    if (!pde) {
+        return NULL;
+    }
+    uint64_t *pt = next_table(pde, create);
+    if (!pt) {
+        return NULL;
+    }
+    return &pt[(va >> 12) & 511];
+}
+
+/**
+ * @brief Encode a memory type as PWT/PCD bits (PAT bit is never used)
+ */
+static uint64_t cache_bits(page_cache_t type) {
+    return ((type & 1) ? PTE_PWT : 0) | ((type & 2) ? PTE_PCD : 0);
+}
+
+/**
+ * @brief Find the page directory entry mapping an address
+ *
+ * Tables are identity mapped, so physical addresses can be dereferenced.
+ */
+static uint64_t *pde_lookup(uint64_t addr) {
+    uint64_t *pml4 = (uint64_t *)(read_cr3() & PTE_ADDR_MASK);
+    uint64_t pml4e = pml4[(addr >> 39) & 511];
+    if (!(pml4e & PTE_PRESENT)) {
+        return NULL;
+    }
+
+    uint64_t *pdpt = (uint64_t *)(pml4e & PTE_ADDR_MASK);
+    uint64_t pdpte = pdpt[(addr >> 30) & 511];
+    if (!(pdpte & PTE_PRESENT) || (pdpte & PTE_HUGE)) {
+        return NULL;    /* 1GB pages are never created */
+    }
+
+    uint64_t *pd = (uint64_t *)(pdpte & PTE_ADDR_MASK);
+    uint64_t *pde = &pd[(addr >> 21) & 511];
+    return (*pde & PTE_PRESENT) ? pde : NULL;
+}
+
+/**
+ * @brief Replace a 2MB page by a page table of 512 equivalent 4KB pages
+ */
+static bool split_huge(uint64_t *pde) {
+    if (pt_pool_used >= PT_POOL_SIZE) {
+        return false;
+    }
+    uint64_t *pt = pt_pool[pt_pool_used++];
+
+    uint64_t base = *pde & PDE_HUGE_ADDR_MASK;
+    uint64_t flags = *pde & (PTE_PRESENT | PTE_WRITABLE | PTE_USER | PTE_PWT | PTE_PCD);
+    if (*pde & PTE_PAT_HUGE) {
+        flags |= PTE_PAT_4K;
+    }
+
+    for (int i = 0; i < 512; i++) {
+        pt[i] = (base + (uint64_t)i * PAGE_SIZE) | flags;
+    }
+    *pde = (uint64_t)(uintptr_t)pt | (*pde & (PTE_PRESENT | PTE_WRITABLE | PTE_USER));
+    return true;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void paging_init(void) {
+    if (!cpu_has(CPU_FEAT_PAT)) {
+        return;
+    }
+
+    /* Nothing uses PWT yet, so entry 1 can change from WT to WC safely */
+    wbinvd();
+    write_msr(MSR_PAT, PAT_VALUE);
+    wbinvd();
+    write_cr3(read_cr3());
+    pat_enabled = true;
+
+    /* VGA text buffer (0xB8000 - 0xBFFFF) */
+    paging_set_cache(VGA_BUFFER_ADDR, 0x8000, PAGE_CACHE_WC);
+}
+
+bool paging_wc_supported(void) {
+    return pat_enabled;
+}
+
+bool paging_set_cache(uint64_t addr, uint64_t size, page_cache_t type) {
+    if (type == PAGE_CACHE_WC && !pat_enabled) {
+        return false;
+    }
+
+    uint64_t va = addr & ~(PAGE_SIZE - 1);
+    uint64_t end = (addr + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    bool ok = true;
+
+    while (va < end) {
+        uint64_t *pde = pde_lookup(va);
+        if (!pde) {
+            ok = false;
+            break;
+        }
+
+        if (*pde & PTE_HUGE) {
+            /* Whole 2MB page inside the range: change it in place */
+            if ((va & (HUGE_PAGE_SIZE - 1)) == 0 && va + HUGE_PAGE_SIZE <= end) {
+                *pde = (*pde & ~(PTE_PWT | PTE_PCD | PTE_PAT_HUGE)) | cache_bits(type);
+                va += HUGE_PAGE_SIZE;
+                continue;
+            }
+            if (!split_huge(pde)) {
+                ok = false;
+                break;
+            }
+        }
+
+        uint64_t *pt = (uint64_t *)(*pde & PTE_ADDR_MASK);
+        uint64_t *pte = &pt[(va >> 12) & 511];
+        *pte = (*pte & ~(PTE_PWT | PTE_PCD | PTE_PAT_4K)) | cache_bits(type);
+        va += PAGE_SIZE;
+    }
+
+    /* Old cached lines must not outlive the type change */
+    wbinvd();
+    write_cr3(read_cr3());
+    return ok;
+}
+
+page_cache_t paging_get_cache(uint64_t addr) {
+    uint64_t *pde = pde_lookup(addr);
+    if (!pde) {
+        return PAGE_CACHE_UC;
+    }
+
+    uint64_t entry = *pde;
+    if (!(entry & PTE_HUGE)) {
+        entry = ((uint64_t *)(entry & PTE_ADDR_MASK))[(addr >> 12) & 511];
+    }
+    return (page_cache_t)(((entry & PTE_PWT) ? 1 : 0) | ((entry & PTE_PCD) ? 2 : 0));
+}
+
+bool paging_map_page(uint64_t va, uint64_t pa, bool writable) {
+    uint64_t *pte = pte_lookup(va, true);
+    if (!pte) {
+        return false;
+    }
+    *pte = (pa & PTE_ADDR_MASK) | PTE_PRESENT | (writable ? PTE_WRITABLE : 0);
+    invlpg(va);     /* Not-present entries may be cached on some CPUs */
+    return true;
+}
+
+uint64_t paging_unmap_page(uint64_t va) {
+    uint64_t *pte = pte_lookup(va, false);
+    if (!pte) {
+        return 0;
+    }
+    if (!(*pte & PTE_PRESENT)) {
+        *pte = 0;       /* Drop a swap entry, if any */
+        return 0;
+    }
+    uint64_t pa = *pte & PTE_ADDR_MASK;
+    *pte = 0;
+    invlpg(va);
+    return pa;
+}
+
+uint64_t paging_translate(uint64_t va) {
+    uint64_t *pte = pte_lookup(va, false);
+    if (!pte || !(*pte & PTE_PRESENT)) {
+        return 0;
+    }
+    return *pte & PTE_ADDR_MASK;
+}
+
+bool paging_is_mapped(uint64_t va) {
+    uint64_t *pde = pde_slot(va, false);
+    if (!pde || !(*pde & PTE_PRESENT)) {
+        return false;
+    }
+    if (*pde & PTE_HUGE) {
+        return true;
+    }
+    uint64_t *pte = pte_lookup(va, false);
+    return pte && (*pte & PTE_PRESENT);
+}
+
+bool paging_is_writable(uint64_t va) {
+    uint64_t *pte = pte_lookup(va, false);
+    return pte && (*pte & (PTE_PRESENT | PTE_WRITABLE)) == (PTE_PRESENT | PTE_WRITABLE);
+}
+
+int paging_test_and_clear_young(uint64_t va) {
+    uint64_t *pte = pte_lookup(va, false);
+    if (!pte || !(*pte & PTE_PRESENT)) {
+        return -1;
+    }
+    if (!(*pte & PTE_ACCESSED)) {
+        return 0;
+    }
+    *pte &= ~PTE_ACCESSED;
+    invlpg(va);     /* Otherwise the cached entry never sets the bit again */
+    return 1;
+}
+
+uint64_t paging_swap_out(uint64_t va, uint64_t entry) {
+    uint64_t *pte = pte_lookup(va, false);
+    if (!pte || !(*pte & PTE_PRESENT)) {
+        return 0;
+    }
+    uint64_t pa = *pte & PTE_ADDR_MASK;
+    *pte = ((entry << 12) & PTE_ADDR_MASK) | PTE_SWAP;
+    invlpg(va);
+    return pa;
+}
+
+uint64_t paging_swap_entry(uint64_t va) {
+    uint64_t *pte = pte_lookup(va, false);
+    if (!pte || (*pte & PTE_PRESENT) || !(*pte & PTE_SWAP)) {
+        return 0;
+    }
+    return (*pte & PTE_ADDR_MASK) >> 12;
+}
+
+bool paging_map_huge(uint64_t va, uint64_t pa, bool writable) {
+    uint64_t *pde = pde_slot(va, true);
+    if (!pde || (*pde & PTE_PRESENT)) {
+        return false;
+    }
+    *pde = (pa & PDE_HUGE_ADDR_MASK) | PTE_PRESENT | PTE_HUGE | (writable ? PTE_WRITABLE : 0);
+    invlpg(va);
+    return true;
+}
+
+uint64_t paging_unmap_huge(uint64_t va) {
+    uint64_t *pde = pde_slot(va, false);
+    if (!pde || (*pde & (PTE_PRESENT | PTE_HUGE)) != (PTE_PRESENT | PTE_HUGE)) {
+        return 0;
+    }
+    uint64_t pa = *pde & PDE_HUGE_ADDR_MASK;
+    *pde = 0;
+    invlpg(va);     /* One invalidation covers the whole 2MB page */
+    return pa;
+}
+
+int paging_count_mapped(uint64_t va) {
+    uint64_t *pde = pde_slot(va, false);
+    if (!pde || !(*pde & PTE_PRESENT) || (*pde & PTE_HUGE)) {
+        return -1;
+    }
+
+    const uint64_t *pt = (const uint64_t *)(uintptr_t)(*pde & PTE_ADDR_MASK);
+    int count = 0;
+    for (int i = 0; i < 512; i++) {
+        count += (int)(pt[i] & PTE_PRESENT);
+    }
+    return count;
+}
+
+int paging_collapse_huge(uint64_t va, uint64_t pa) {
+    uint64_t *pde = pde_slot(va, false);
+    if (!pde || !(*pde & PTE_PRESENT) || (*pde & PTE_HUGE)) {
+        return -1;
+    }
+
+    /*
+     * Swapped-out pages would be lost, and shared (read-only) frames freed
+     * under their other users: leave such ranges alone
+     */
+    uint64_t *pt = (uint64_t *)(uintptr_t)(*pde & PTE_ADDR_MASK);
+    for (int i = 0; i < 512; i++) {
+        if ((pt[i] & (PTE_PRESENT | PTE_WRITABLE)) != (PTE_PRESENT | PTE_WRITABLE) && pt[i]) {
+            return -1;
+        }
+    }
+
+    /* Build the 2MB copy: populated pages are copied, holes become zeros */
+    int moved = 0;
+    for (int i = 0; i < 512; i++) {
+        void *dst = (void *)(uintptr_t)(pa + (uint64_t)i * PAGE_SIZE);
+        if (pt[i] & PTE_PRESENT) {
+            memcpy(dst, (const void *)(uintptr_t)(pt[i] & PTE_ADDR_MASK), PAGE_SIZE);
+            moved++;
+        } else {
+            memset(dst, 0, PAGE_SIZE);
+        }
+    }
+
+    /* Swap the table for the huge page, then drop every stale 4KB entry */
+    *pde = (pa & PDE_HUGE_ADDR_MASK) | PTE_PRESENT | PTE_HUGE | PTE_WRITABLE;
+    write_cr3(read_cr3());
+
+    for (int i = 0; i < 512; i++) {
+        if (pt[i] & PTE_PRESENT) {
+            pmm_free(pt[i] & PTE_ADDR_MASK);
+        }
+    }
+    pmm_free((uint64_t)(uintptr_t)pt);
+    return moved;
+}
+
+uint8_t mtrr_get_type(uint64_t addr) {
+    if (!cpu_has(CPU_FEAT_MTRR)) {
+        return MT_UC;
+    }
+
+    uint64_t cap = read_msr(MSR_MTRRCAP);
+    uint64_t def = read_msr(MSR_MTRR_DEF_TYPE);
+    if (!(def & MTRR_DEF_ENABLE)) {
+        return MT_UC;
+    }
+
+    /* Fixed-range MTRRs cover the first 1MB */
+    if (addr < 0x100000 && (cap & MTRR_CAP_FIXED) && (def & MTRR_DEF_FIXED)) {
+        uint32_t msr;
+        int index;
+        if (addr < 0x80000) {
+            msr = MSR_MTRR_FIX64K;
+            index = (int)(addr >> 16);
+        } else if (addr < 0xC0000) {
+            msr = MSR_MTRR_FIX16K + (uint32_t)((addr - 0x80000) >> 17);
+            index = (int)((addr - 0x80000) >> 14) & 7;
+        } else {
+            msr = MSR_MTRR_FIX4K + (uint32_t)((addr - 0xC0000) >> 15);
+            index = (int)((addr - 0xC0000) >> 12) & 7;
+        }
+        return (uint8_t)(read_msr(msr) >> (index * 8));
+    }
+
+    /* Variable ranges: UC wins, WT wins over WB */
+    int type = -1;
+    int count = (int)(cap & 0xFF);
+    for (int i = 0; i < count; i++) {
+        uint64_t base = read_msr(MSR_MTRR_PHYSBASE0 + 2 * i);
+        uint64_t mask = read_msr(MSR_MTRR_PHYSMASK0 + 2 * i);
+        if (!(mask & MTRR_MASK_VALID) ||
+            ((addr ^ base) & mask & PTE_ADDR_MASK) != 0) {
+            continue;
+        }
+        int t = (int)(base & 0xFF);
+        if (type < 0 || t == MT_UC || (t == MT_WT && type == MT_WB)) {
+            type = t;
+        }
+    }
+    return type >= 0 ? (uint8_t)type : (uint8_t)(def & 0xFF);
+}
+
+const char *memtype_name(uint8_t type) {
+    switch (type) {
+        case MT_UC:       return "UC";
+        case MT_WC:       return "WC";
+        case MT_WT:       return "WT";
+        case MT_WP:       return "WP";
+        case MT_WB:       return "WB";
+        case MT_UC_MINUS: return "UC-";
+        default:          return "?";
+    }
+}
+
+const char *paging_cache_name(page_cache_t type) {
+    static const char *names[] = { "WB", "WC", "UC-", "UC" };
+    return names[type & 3];
+}
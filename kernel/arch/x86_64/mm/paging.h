@@ -0,0 +1,199 @@
+/**
+ * @file paging.h
+ * @brief Page table attribute management (memory types via PAT)
+ *
+ * Stage 2 identity maps memory with 2MB pages, all write-back. Device
+ * memory such as the framebuffer then inherits whatever the MTRRs say,
+ * which for MMIO is normally uncached: every store is a separate bus
+ * transaction. Write-combining lets the CPU merge stores into full
+ * 64-byte bursts, which is what video memory wants.
+ *
+ * PAT LAYOUT (IA32_PAT, MSR 0x277):
+ *   Entry  PAT PCD PWT   Type
+ *     0     0   0   0    WB   (power-on default)
+ *     1     0   0   1    WC   (power-on default is WT)
+ *     2     0   1   0    UC-
+ *     3     0   1   1    UC
+ *   Entries 4-7 mirror 0-3, so the PAT bit is never needed.
+ *
+ * EFFECTIVE TYPE:
+ *   A PAT WC mapping stays WC even where the MTRRs say UC, so the
+ *   MTRRs are only read (for reporting), never reprogrammed.
+ *
+ * SPLITTING:
+ *   Ranges that do not cover a whole 2MB page get that page split into
+ *   4KB pages, using page tables from a small static pool.
+ *
+ * DYNAMIC MAPPINGS:
+ *   paging_map_page()/paging_unmap_page() manage single 4KB pages outside
+ *   the identity map (vmalloc). Missing page tables come from the frame
+ *   allocator and are kept once created. paging_map_huge() installs a
+ *   2MB page in an empty directory slot, and paging_collapse_huge()
+ *   replaces a page table of 4KB pages by one 2MB copy of them.
+ *
+ * SWAP ENTRIES:
+ *   A page that reclaim compressed away keeps a non-present PTE with
+ *   bit 9 set and its swap entry in bits 12-51. The CPU ignores the
+ *   other bits of a non-present entry, so the fault handler finds the
+ *   entry right where the mapping was.
+ */
+
+#ifndef _ARCH_X86_64_PAGING_H
+#define _ARCH_X86_64_PAGING_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Memory types selectable per page
+ */
+typedef enum {
+    PAGE_CACHE_WB = 0,      /**< Write-back (normal RAM) */
+    PAGE_CACHE_WC = 1,      /**< Write-combining (frame buffers) */
+    PAGE_CACHE_UC_MINUS = 2,/**< Uncached, MTRR may override to WC */
+    PAGE_CACHE_UC = 3       /**< Strongly uncached (device registers) */
+} page_cache_t;
+
+/**
+ * @brief Program the PAT and map the VGA text buffer write-combining
+ *
+ * @note Call after cpu_init() and before the display is initialized
+ */
+void paging_init(void);
+
+/**
+ * @brief Check whether write-combining mappings are available
+ */
+bool paging_wc_supported(void);
+
+/**
+ * @brief Change the memory type of an identity-mapped range
+ *
+ * @param addr  Start address (rounded down to 4KB)
+ * @param size  Length in bytes (rounded up to 4KB)
+ * @param type  New memory type
+ * @return      false if the range is not mapped, WC is unavailable, or
+ *              the split page table pool is exhausted
+ */
+bool paging_set_cache(uint64_t addr, uint64_t size, page_cache_t type);
+
+/**
+ * @brief Get the page table memory type of an address
+ */
+page_cache_t paging_get_cache(uint64_t addr);
+
+/**
+ * @brief Map one 4KB page, creating page tables as needed
+ *
+ * @param va        Virtual address (page aligned, not identity mapped)
+ * @param pa        Physical frame
+ * @param writable  Allow writes
+ * @return          false if a page table could not be allocated, or the
+ *                  address is covered by a 2MB/1GB page
+ */
+bool paging_map_page(uint64_t va, uint64_t pa, bool writable);
+
+/**
+ * @brief Remove a 4KB mapping (or swap entry) and flush it from the TLB
+ *
+ * @return The physical frame it mapped, or 0 if nothing was mapped
+ */
+uint64_t paging_unmap_page(uint64_t va);
+
+/**
+ * @brief Physical frame behind a 4KB mapping
+ *
+ * @return Frame address, or 0 if va is not mapped by a 4KB page
+ */
+uint64_t paging_translate(uint64_t va);
+
+/**
+ * @brief Check whether an address is mapped, by a 4KB or a 2MB page
+ */
+bool paging_is_mapped(uint64_t va);
+
+/**
+ * @brief Check for a present, writable 4KB mapping
+ */
+bool paging_is_writable(uint64_t va);
+
+/**
+ * @brief Read and clear the accessed bit of a 4KB mapping
+ *
+ * @return 1 if the page was accessed since the last call, 0 if not, -1
+ *         if va is not mapped by a 4KB page
+ */
+int paging_test_and_clear_young(uint64_t va);
+
+/**
+ * @brief Replace a 4KB mapping by a swap entry
+ *
+ * @param entry  Non-zero swap entry (at most 40 bits)
+ * @return       The frame it mapped (now unused by the mapping), or 0 if
+ *               va was not mapped by a 4KB page
+ */
+uint64_t paging_swap_out(uint64_t va, uint64_t entry);
+
+/**
+ * @brief Swap entry stored in place of a 4KB mapping
+ *
+ * @return The entry, or 0 if va holds none
+ */
+uint64_t paging_swap_entry(uint64_t va);
+
+/**
+ * @brief Map one 2MB page in an empty page directory slot
+ *
+ * @param va        Virtual address (2MB aligned, not identity mapped)
+ * @param pa        Physical address of a 2MB aligned block
+ * @param writable  Allow writes
+ * @return          false if a table could not be allocated, or the slot
+ *                  already holds a page table or a 2MB page
+ */
+bool paging_map_huge(uint64_t va, uint64_t pa, bool writable);
+
+/**
+ * @brief Remove a 2MB mapping and flush it from the TLB
+ *
+ * @return The block it mapped, or 0 if va is not mapped by a 2MB page
+ */
+uint64_t paging_unmap_huge(uint64_t va);
+
+/**
+ * @brief Count the 4KB pages mapped in the 2MB range holding va
+ *
+ * @return 0-512, or -1 if the range has no page table (unmapped, or
+ *         already a 2MB page)
+ */
+int paging_count_mapped(uint64_t va);
+
+/**
+ * @brief Replace the 4KB pages of a 2MB range by one 2MB page
+ *
+ * Copies every mapped page into the block at pa (zero-filling the holes),
+ * installs it and returns the old frames and the page table to the frame
+ * allocator. The caller must keep the range from being written meanwhile.
+ *
+ * @return Number of 4KB pages that were mapped, or -1 if the range has
+ *         no page table, or holds swap entries or read-only pages
+ */
+int paging_collapse_huge(uint64_t va, uint64_t pa);
+
+/**
+ * @brief Get the MTRR memory type of an address
+ *
+ * @return Architectural type code (0=UC 1=WC 4=WT 5=WP 6=WB), or 0 if
+ *         MTRRs are unsupported or disabled
+ */
+uint8_t mtrr_get_type(uint64_t addr);
+
+/**
+ * @brief Name of a PAT/MTRR memory type code
+ */
+const char *memtype_name(uint8_t type);
+
+/**
+ * @brief Name of a page_cache_t value
+ */
+const char *paging_cache_name(page_cache_t type);
+
+#endif /* _ARCH_X86_64_PAGING_H */
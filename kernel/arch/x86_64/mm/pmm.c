@@ -0,0 +1,342 @@
+/**
+ * @file pmm.c
+ * @brief Physical frame allocator implementation
+ */
+
+#include "pmm.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/io/port.h>
+#include <lib/memory/memory.h>
+#include <core/metrics.h>
+#include <core/export.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define PMM_MAX_FRAMES      (PMM_MAX_MEMORY / PMM_FRAME_SIZE)
+#define PMM_WORDS           (PMM_MAX_FRAMES / 64)
+
+/** @brief Bitmap words covering one 2MB block */
+#define HUGE_WORDS          (PMM_HUGE_FRAMES / 64)
+
+/* CMOS memory size registers */
+#define CMOS_INDEX          0x70
+#define CMOS_DATA           0x71
+#define CMOS_NMI_DISABLE    0x80
+#define CMOS_EXT_MEM_LO     0x30    /* KB above 1MB (max 64MB) */
+#define CMOS_EXT_MEM_HI     0x31
+#define CMOS_HIGH_MEM_LO    0x34    /* 64KB blocks above 16MB */
+#define CMOS_HIGH_MEM_HI    0x35
+
+/* Linker script symbol */
+extern char __kernel_end[];
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/** @brief One bit per frame, set = in use (everything starts in use) */
+static uint64_t bitmap[PMM_WORDS];
+
+static uint64_t mem_top = 0;
+static uint64_t base_frame = 0;
+static uint64_t top_frame = 0;
+static uint64_t free_frames = 0;
+
+/** @brief Word to start the next search at */
+static uint64_t hint = 0;
+
+/** @brief 2MB block to start the next huge search at */
+static uint64_t huge_hint = 0;
+
+/** @brief Page colors (1 = coloring off) */
+static uint32_t colors = 1;
+
+/** @brief Word to start the next colored search at */
+static uint64_t color_hint = 0;
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static bool huge_block_free(uint64_t block) {
+    const uint64_t *w = &bitmap[block * HUGE_WORDS];
+    for (uint64_t i = 0; i < HUGE_WORDS; i++) {
+        if (w[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t cmos_read(uint8_t reg) {
+    outb(CMOS_INDEX, reg | CMOS_NMI_DISABLE);
+    return inb(CMOS_DATA);
+}
+
+/**
+ * @brief End of RAM from the BIOS CMOS memory size fields
+ */
+static uint64_t detect_mem_top(void) {
+    uint64_t high = (uint64_t)cmos_read(CMOS_HIGH_MEM_LO) |
+                    ((uint64_t)cmos_read(CMOS_HIGH_MEM_HI) << 8);
+    if (high) {
+        return 0x1000000ull + high * 0x10000;
+    }
+
+    uint64_t ext_kb = (uint64_t)cmos_read(CMOS_EXT_MEM_LO) |
+                      ((uint64_t)cmos_read(CMOS_EXT_MEM_HI) << 8);
+    return 0x100000ull + ext_kb * 1024;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void pmm_init(void) {
+    memset(bitmap, 0xFF, sizeof(bitmap));
+
+    mem_top = detect_mem_top();
+    if (mem_top > PMM_MAX_MEMORY) {
+        mem_top = PMM_MAX_MEMORY;
+    }
+
+    base_frame = ((uint64_t)(uintptr_t)__kernel_end + PMM_FRAME_SIZE - 1) / PMM_FRAME_SIZE;
+    top_frame = mem_top / PMM_FRAME_SIZE;
+    free_frames = 0;
+
+    for (uint64_t f = base_frame; f < top_frame; f++) {
+        bitmap[f / 64] &= ~(1ull << (f % 64));
+        free_frames++;
+    }
+    hint = base_frame / 64;
+}
+
+uint64_t pmm_alloc(void) {
+    uint64_t flags = irq_save();
+    uint64_t words = (top_frame + 63) / 64;
+
+    for (uint64_t n = 0; n < words; n++) {
+        uint64_t w = hint + n;
+        if (w >= words) {
+            w -= words;
+        }
+        if (bitmap[w] == ~0ull) {
+            continue;
+        }
+
+        uint64_t frame = w * 64 + (uint64_t)__builtin_ctzll(~bitmap[w]);
+        if (frame >= top_frame) {
+            continue;   /* Bits past the end of RAM in the last word */
+        }
+        bitmap[w] |= 1ull << (frame % 64);
+        free_frames--;
+        hint = w;
+        irq_restore(flags);
+        return frame * PMM_FRAME_SIZE;
+    }
+
+    irq_restore(flags);
+    return 0;
+}
+EXPORT_SYMBOL(pmm_alloc);
+
+uint64_t pmm_alloc_color(uint64_t color) {
+    if (colors <= 1) {
+        return pmm_alloc();
+    }
+
+    uint64_t flags = irq_save();
+    uint64_t words = (top_frame + 63) / 64;
+    uint64_t want = color & (colors - 1);
+
+    /*
+     * Up to 64 colors, every word holds each color at a fixed bit pattern.
+     * Beyond that, only one word in colors/64 holds the color, at one bit.
+     */
+    uint64_t step = 1;
+    uint64_t first = 0;
+    uint64_t mask = 0;
+    if (colors <= 64) {
+        for (uint64_t b = want; b < 64; b += colors) {
+            mask |= 1ull << b;
+        }
+    } else {
+        step = colors / 64;
+        first = want / 64;
+        mask = 1ull << (want % 64);
+    }
+
+    uint64_t slots = (words + step - 1) / step;
+    uint64_t start = color_hint / step;
+    for (uint64_t n = 0; n < slots; n++) {
+        uint64_t slot = start + n;
+        if (slot >= slots) {
+            slot -= slots;
+        }
+        uint64_t w = slot * step + first;
+        if (w >= words) {
+            continue;
+        }
+        uint64_t avail = ~bitmap[w] & mask;
+        if (!avail) {
+            continue;
+        }
+
+        uint64_t frame = w * 64 + (uint64_t)__builtin_ctzll(avail);
+        if (frame >= top_frame) {
+            continue;
+        }
+        bitmap[w] |= 1ull << (frame % 64);
+        free_frames--;
+        color_hint = w;
+        irq_restore(flags);
+        return frame * PMM_FRAME_SIZE;
+    }
+
+    irq_restore(flags);
+    return pmm_alloc();
+}
+
+bool pmm_set_colors(uint32_t n) {
+    if (n == 0) {
+        n = 1;
+    }
+    if (n > PMM_MAX_COLORS || (n & (n - 1)) != 0) {
+        return false;
+    }
+    colors = n;
+    return true;
+}
+
+uint32_t pmm_get_colors(void) {
+    return colors;
+}
+
+uint64_t pmm_alloc_zeroed(void) {
+    uint64_t phys = pmm_alloc();
+    if (phys) {
+        memset((void *)(uintptr_t)phys, 0, PMM_FRAME_SIZE);
+    }
+    return phys;
+}
+
+uint64_t pmm_alloc_huge(void) {
+    uint64_t flags = irq_save();
+    uint64_t blocks = top_frame / PMM_HUGE_FRAMES;
+
+    /* Bits outside [base, top) are always set, so a clear block is RAM */
+    for (uint64_t n = 0; n < blocks; n++) {
+        uint64_t b = huge_hint + n;
+        if (b >= blocks) {
+            b -= blocks;
+        }
+        if (!huge_block_free(b)) {
+            continue;
+        }
+
+        memset(&bitmap[b * HUGE_WORDS], 0xFF, HUGE_WORDS * sizeof(uint64_t));
+        free_frames -= PMM_HUGE_FRAMES;
+        huge_hint = b;
+        irq_restore(flags);
+        return b * PMM_HUGE_FRAMES * PMM_FRAME_SIZE;
+    }
+
+    irq_restore(flags);
+    return 0;
+}
+EXPORT_SYMBOL(pmm_alloc_huge);
+
+void pmm_free_huge(uint64_t phys) {
+    uint64_t frame = phys / PMM_FRAME_SIZE;
+    if ((frame % PMM_HUGE_FRAMES) != 0 || frame < base_frame ||
+        frame + PMM_HUGE_FRAMES > top_frame) {
+        return;
+    }
+
+    uint64_t flags = irq_save();
+    for (uint64_t f = frame; f < frame + PMM_HUGE_FRAMES; f++) {
+        uint64_t bit = 1ull << (f % 64);
+        if (bitmap[f / 64] & bit) {
+            bitmap[f / 64] &= ~bit;
+            free_frames++;
+        }
+    }
+    irq_restore(flags);
+}
+
+void pmm_free(uint64_t phys) {
+    uint64_t frame = phys / PMM_FRAME_SIZE;
+    if (frame < base_frame || frame >= top_frame) {
+        return;
+    }
+
+    uint64_t flags = irq_save();
+    uint64_t bit = 1ull << (frame % 64);
+    if (bitmap[frame / 64] & bit) {
+        bitmap[frame / 64] &= ~bit;
+        free_frames++;
+    }
+    irq_restore(flags);
+}
+EXPORT_SYMBOL(pmm_free);
+
+bool pmm_claim(uint64_t phys) {
+    uint64_t frame = phys / PMM_FRAME_SIZE;
+    if (frame < base_frame || frame >= top_frame) {
+        return false;
+    }
+
+    uint64_t flags = irq_save();
+    uint64_t bit = 1ull << (frame % 64);
+    bool was_free = !(bitmap[frame / 64] & bit);
+    if (was_free) {
+        bitmap[frame / 64] |= bit;
+        free_frames--;
+    }
+    irq_restore(flags);
+    return was_free;
+}
+
+bool pmm_frame_in_use(uint64_t phys) {
+    uint64_t frame = phys / PMM_FRAME_SIZE;
+    if (frame < base_frame) {
+        return true;
+    }
+    if (frame >= top_frame) {
+        return false;
+    }
+    return (bitmap[frame / 64] >> (frame % 64)) & 1;
+}
+
+void pmm_get_stats(pmm_stats_t *out) {
+    out->mem_top = mem_top;
+    out->base = base_frame * PMM_FRAME_SIZE;
+    out->total = top_frame > base_frame ? top_frame - base_frame : 0;
+    out->free = free_frames;
+
+    out->free_huge = 0;
+    for (uint64_t b = 0; b < top_frame / PMM_HUGE_FRAMES; b++) {
+        out->free_huge += huge_block_free(b) ? 1 : 0;
+    }
+}
+EXPORT_SYMBOL(pmm_get_stats);
+
+/* ============================================================================
+ * Metrics
+ * ============================================================================ */
+
+static uint64_t metric_free_bytes(void) {
+    return free_frames * PMM_FRAME_SIZE;
+}
+
+static uint64_t metric_total_bytes(void) {
+    return (top_frame > base_frame ? top_frame - base_frame : 0) * PMM_FRAME_SIZE;
+}
+
+DEFINE_METRIC(pmm_free_bytes, METRIC_GAUGE,
+              "Free physical memory", 1, metric_free_bytes);
+DEFINE_METRIC(pmm_managed_bytes, METRIC_GAUGE,
+              "Physical memory managed by the frame allocator", 1, metric_total_bytes);
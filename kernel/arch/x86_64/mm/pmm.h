@@ -0,0 +1,136 @@
+/**
+ * @file pmm.h
+ * @brief Physical frame allocator (4KB frames, bitmap)
+ *
+ * MEMORY SIZE:
+ *   Stage 2 does not pass a BIOS memory map, so the size of RAM comes
+ *   from the CMOS registers the BIOS fills at POST (extended memory
+ *   above 1MB, and memory above 16MB in 64KB units). Only the first
+ *   PMM_MAX_MEMORY bytes are managed: that is what stage 2 identity
+ *   maps, so every frame can be reached (and zeroed) at its physical
+ *   address.
+ *
+ * LAYOUT:
+ *   Everything below the end of the kernel image and BSS stays reserved
+ *   (BIOS data, page tables, stage 2, stack, kernel); frames from there
+ *   to the top of RAM are free.
+ *
+ * BITMAP:
+ *   One bit per frame, set = in use. Allocation scans 64 frames per
+ *   word starting at a rotating hint, so it is next-fit and rarely
+ *   rescans the full part at the bottom.
+ *
+ * HUGE BLOCKS:
+ *   pmm_alloc_huge() hands out a 2MB aligned run of 512 free frames (an
+ *   order-9 block) for 2MB mappings. A block is free when its eight
+ *   bitmap words are all zero, so the search costs eight loads per 2MB.
+ *
+ * PAGE COLORING (optional, off by default):
+ *   With pmm_set_colors(n), frame f has color f mod n (n = page colors
+ *   of a cache, see topology.h). pmm_alloc_color() then returns a frame
+ *   of the requested color, so a caller that asks for color = virtual
+ *   page number gets a buffer whose pages cover the colors evenly and
+ *   never pile up in a few cache sets. Only the bitmap words that can
+ *   hold that color are scanned. When no frame of the color is left any
+ *   free frame is returned.
+ */
+
+#ifndef _ARCH_X86_64_PMM_H
+#define _ARCH_X86_64_PMM_H
+
+#include <squirel/types.h>
+
+#define PMM_FRAME_SIZE      4096ull
+#define PMM_HUGE_FRAMES     512ull      /* Frames per 2MB block */
+#define PMM_MAX_COLORS      1024u
+
+/**
+ * @brief Allocator counters
+ */
+typedef struct {
+    uint64_t mem_top;       /**< End of RAM (as reported by CMOS, capped) */
+    uint64_t base;          /**< First managed frame */
+    uint64_t total;         /**< Managed frames */
+    uint64_t free;          /**< Frames not allocated */
+    uint64_t free_huge;     /**< Fully free 2MB aligned blocks */
+} pmm_stats_t;
+
+/**
+ * @brief Size RAM and mark the frames above the kernel free
+ */
+void pmm_init(void);
+
+/**
+ * @brief Allocate one frame
+ *
+ * @return Physical address, or 0 if memory is exhausted
+ */
+uint64_t pmm_alloc(void);
+
+/**
+ * @brief Allocate one frame filled with zeros
+ *
+ * @return Physical address, or 0 if memory is exhausted
+ */
+uint64_t pmm_alloc_zeroed(void);
+
+/**
+ * @brief Return a frame from pmm_alloc()
+ */
+void pmm_free(uint64_t phys);
+
+/**
+ * @brief Allocate a particular frame
+ * @return false if it is in use or outside the managed range
+ */
+bool pmm_claim(uint64_t phys);
+
+/**
+ * @brief Check whether a frame holds anything
+ * @return true for allocated frames and for everything below the first
+ *         managed frame (BIOS areas, page tables, kernel); false for free
+ *         frames and addresses past the end of RAM
+ */
+bool pmm_frame_in_use(uint64_t phys);
+
+/**
+ * @brief Allocate one frame of a page color
+ *
+ * @param color  Wanted color, taken modulo the color count (a virtual
+ *               page number may be passed as is); any frame when
+ *               coloring is off
+ * @return       Physical address, or 0 if memory is exhausted
+ */
+uint64_t pmm_alloc_color(uint64_t color);
+
+/**
+ * @brief Set the number of page colors (0 or 1 turns coloring off)
+ *
+ * @param colors  Power of two up to PMM_MAX_COLORS
+ * @return        false if the count is not allowed
+ */
+bool pmm_set_colors(uint32_t colors);
+
+/**
+ * @brief Current number of page colors (1 when coloring is off)
+ */
+uint32_t pmm_get_colors(void);
+
+/**
+ * @brief Allocate a 2MB aligned block of 512 frames (not zeroed)
+ *
+ * @return Physical address, or 0 if no free block is left
+ */
+uint64_t pmm_alloc_huge(void);
+
+/**
+ * @brief Return a block from pmm_alloc_huge()
+ */
+void pmm_free_huge(uint64_t phys);
+
+/**
+ * @brief Read the allocator counters
+ */
+void pmm_get_stats(pmm_stats_t *out);
+
+#endif /* _ARCH_X86_64_PMM_H */
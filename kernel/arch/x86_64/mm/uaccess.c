@@ -0,0 +1,58 @@
+/**
+ * @file uaccess.c
+ * @brief Fault-tolerant memory copies implementation
+ */
+
+#include "uaccess.h"
+#include "extable.h"
+#include <squirel/config.h>
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief Copy until done or until an access faults
+ *
+ * rep movsb keeps RDI/RSI/RCX up to date byte by byte, so after a fault
+ * RCX is exactly the number of bytes left.
+ *
+ * @return Bytes not copied
+ */
+static size_t copy_nofault(void *dst, const void *src, size_t len) {
+    __asm__ volatile(
+        "1: rep movsb\n"
+        "2:\n"
+        _ASM_EXTABLE(1b, 2b)
+        : "+D"(dst), "+S"(src), "+c"(len)
+        :
+        : "memory");
+    return len;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool access_ok(const void *addr, size_t len) {
+    uint64_t start = (uint64_t)(uintptr_t)addr;
+    return start + len >= start && start + len <= USER_ADDR_LIMIT;
+}
+
+bool probe_kernel_read(void *dst, const void *src, size_t len) {
+    return copy_nofault(dst, src, len) == 0;
+}
+
+size_t copy_from_user(void *dst, const void *user_src, size_t len) {
+    if (!access_ok(user_src, len)) {
+        return len;
+    }
+    return copy_nofault(dst, user_src, len);
+}
+
+size_t copy_to_user(void *user_dst, const void *src, size_t len) {
+    if (!access_ok(user_dst, len)) {
+        return len;
+    }
+    return copy_nofault(user_dst, src, len);
+}
@@ -0,0 +1,49 @@
+/**
+ * @file uaccess.h
+ * @brief Fault-tolerant memory copies
+ *
+ * These copy with a single annotated rep movsb (see extable.h): an
+ * unmapped or non-canonical address ends the copy early instead of
+ * halting the machine, and a valid one costs exactly a memcpy.
+ *
+ * USER COPIES:
+ *   There is no user mode yet. copy_from_user()/copy_to_user() already
+ *   enforce the split future user-copy paths need: the user range must
+ *   lie entirely below USER_ADDR_LIMIT, otherwise nothing is copied.
+ */
+
+#ifndef _ARCH_X86_64_UACCESS_H
+#define _ARCH_X86_64_UACCESS_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Check that a user range does not reach kernel-only addresses
+ */
+bool access_ok(const void *addr, size_t len);
+
+/**
+ * @brief Read kernel memory that may not be mapped
+ *
+ * @param dst  Destination (must be valid)
+ * @param src  Source address, possibly bad
+ * @param len  Bytes to copy
+ * @return     false if any byte could not be read (dst is then partial)
+ */
+bool probe_kernel_read(void *dst, const void *src, size_t len);
+
+/**
+ * @brief Copy from a user buffer
+ *
+ * @return Bytes NOT copied (0 on success)
+ */
+size_t copy_from_user(void *dst, const void *user_src, size_t len);
+
+/**
+ * @brief Copy to a user buffer
+ *
+ * @return Bytes NOT copied (0 on success)
+ */
+size_t copy_to_user(void *user_dst, const void *src, size_t len);
+
+#endif /* _ARCH_X86_64_UACCESS_H */
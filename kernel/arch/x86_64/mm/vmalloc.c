@@ -0,0 +1,522 @@
+/**
+ * @file vmalloc.c
+ * @brief Demand-zero virtual allocations implementation
+ */
+
+#include "vmalloc.h"
+#include "paging.h"
+#include "pmm.h"
+#include "zram.h"
+#include "ksm.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <lib/memory/memory.h>
+#include <core/stat.h>
+#include <core/cpustat.h>
+#include <core/metrics.h>
+#include <core/export.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define PAGE_SIZE           4096ull
+#define HUGE_SIZE           0x200000ull
+#define HUGE_PAGES          (HUGE_SIZE / PAGE_SIZE)
+#define VMALLOC_END         (VMALLOC_START + VMALLOC_SIZE)
+
+/** @brief Collapse a 2MB range once this many of its 4KB pages exist */
+#define THP_COLLAPSE_MIN    448
+
+/** @brief 2MB ranges the collapser examines per idle call */
+#define THP_SCAN_RANGES     16
+
+/** @brief Pages direct reclaim frees when an allocation finds none */
+#define RECLAIM_BATCH       32
+
+/* #PF error code bits */
+#define PF_PRESENT          (1ull << 0)     /* Protection violation, not a missing page */
+#define PF_WRITE            (1ull << 1)
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/** @brief Live areas, sorted by start address */
+static vm_area_t areas[VMALLOC_MAX_AREAS];
+static int area_count = 0;
+
+/** @brief Fault service time in ns, one histogram per CPU */
+static histogram_t fault_ns[MAX_CPUS];
+
+/** @brief Swap-in (decompress and map) time in ns, one histogram per CPU */
+static histogram_t swapin_ns[MAX_CPUS];
+
+/** @brief Clock hand of page reclaim */
+static uint64_t reclaim_cursor = VMALLOC_START;
+
+static bool thp_enabled = true;
+
+/** @brief Next 2MB range the collapser looks at */
+static uint64_t scan_cursor = VMALLOC_START;
+
+DEFINE_STAT(vmalloc_faults, "Demand-zero pages populated by the #PF handler");
+DEFINE_STAT(thp_fault_alloc, "vmalloc faults served with a 2MB page");
+DEFINE_STAT(thp_fault_fallback, "vmalloc faults that found no free 2MB block");
+DEFINE_STAT(thp_collapse, "2MB ranges of 4KB pages collapsed into a 2MB page");
+DEFINE_STAT(reclaim_scanned, "Resident pages examined by page reclaim");
+DEFINE_STAT(reclaim_evicted, "Pages reclaim moved to zram");
+DEFINE_STAT(reclaim_ns, "Time spent in page reclaim (ns)");
+DEFINE_STAT(swapin_faults, "vmalloc faults served from zram");
+DEFINE_STAT(cow_faults, "Writes that gave a merged page a private copy");
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief Find the area containing an address (guard page excluded)
+ */
+static vm_area_t *find_area(uint64_t addr) {
+    for (int i = 0; i < area_count; i++) {
+        if (addr < areas[i].start) {
+            break;
+        }
+        if (addr < areas[i].start + areas[i].pages * PAGE_SIZE) {
+            return &areas[i];
+        }
+    }
+    return NULL;
+}
+
+static uint64_t area_end(const vm_area_t *area) {
+    return area->start + area->pages * PAGE_SIZE;
+}
+
+/**
+ * @brief Try to serve a fault with a 2MB page
+ */
+static bool fault_huge(vm_area_t *area, uint64_t addr) {
+    uint64_t va = addr & ~(HUGE_SIZE - 1);
+    if (va < area->start || va + HUGE_SIZE > area_end(area)) {
+        return false;
+    }
+
+    uint64_t block = pmm_alloc_huge();
+    if (!block) {
+        stat_inc(thp_fault_fallback);
+        return false;
+    }
+
+    /* Fails when 4KB pages already exist here: those stay 4KB */
+    if (!paging_map_huge(va, block, true)) {
+        pmm_free_huge(block);
+        return false;
+    }
+    memset((void *)(uintptr_t)block, 0, HUGE_SIZE);
+
+    area->resident += HUGE_PAGES;
+    area->huge++;
+    stat_inc(thp_fault_alloc);
+    return true;
+}
+
+/**
+ * @brief Idle hook: collapse at most one densely populated 2MB range
+ *
+ * Runs with interrupts off, so nothing can touch the range while it is
+ * copied.
+ */
+static void collapse_scan(void) {
+    if (!thp_enabled) {
+        return;
+    }
+
+    uint64_t flags = irq_save();
+    int budget = THP_SCAN_RANGES;
+
+    for (int i = 0; i < area_count && budget > 0; i++) {
+        vm_area_t *area = &areas[i];
+        uint64_t va = (area->start + HUGE_SIZE - 1) & ~(HUGE_SIZE - 1);
+        uint64_t end = area_end(area) & ~(HUGE_SIZE - 1);
+        if (va < scan_cursor) {
+            va = scan_cursor;
+        }
+
+        for (; va < end && budget > 0; va += HUGE_SIZE, budget--) {
+            scan_cursor = va + HUGE_SIZE;
+            if (paging_count_mapped(va) < THP_COLLAPSE_MIN) {
+                continue;
+            }
+
+            uint64_t block = pmm_alloc_huge();
+            if (!block) {
+                budget = 0;
+                break;
+            }
+            int moved = paging_collapse_huge(va, block);
+            if (moved < 0) {
+                pmm_free_huge(block);   /* Holds swapped-out pages */
+                continue;
+            }
+            area->resident += HUGE_PAGES - (uint64_t)moved;
+            area->huge++;
+            stat_inc(thp_collapse);
+            budget = 0;
+            break;
+        }
+    }
+
+    /* Ran off the last area: start over on the next call */
+    if (budget > 0) {
+        scan_cursor = VMALLOC_START;
+    }
+    irq_restore(flags);
+}
+
+/**
+ * @brief First area that ends above va
+ */
+static vm_area_t *area_from(uint64_t va) {
+    for (int i = 0; i < area_count; i++) {
+        if (area_end(&areas[i]) > va) {
+            return &areas[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Compress one page into zram and free its frame
+ */
+static bool evict(vm_area_t *area, uint64_t va) {
+    uint64_t frame = paging_translate(va);
+    uint64_t entry;
+    bool kept;
+
+    if (!zram_store((const void *)(uintptr_t)frame, frame, &entry, &kept)) {
+        return false;
+    }
+    paging_swap_out(va, entry);
+    if (!kept) {
+        pmm_free(frame);
+    }
+    area->resident--;
+    area->swapped++;
+    return true;
+}
+
+/**
+ * @brief Second-chance (CLOCK) sweep over the 4KB pages of all areas
+ *
+ * A page accessed since the hand last passed loses its accessed bit and
+ * stays; one that was not is evicted. Two full sweeps therefore always
+ * find the cold pages, so the scan stops there. Interrupts must be off.
+ */
+static uint64_t reclaim_locked(uint64_t target) {
+    uint64_t start = rdtsc();
+    uint64_t evicted = 0;
+    uint64_t budget = 0;
+    for (int i = 0; i < area_count; i++) {
+        budget += areas[i].pages;
+    }
+    budget *= 2;
+
+    uint64_t va = reclaim_cursor;
+    while (evicted < target && budget > 0) {
+        vm_area_t *area = area_from(va);
+        if (!area) {
+            area = area_from(VMALLOC_START);
+            if (!area) {
+                break;
+            }
+            va = area->start;
+        }
+        if (va < area->start) {
+            va = area->start;
+        }
+
+        uint64_t end = area_end(area);
+        for (; va < end && evicted < target && budget > 0; va += PAGE_SIZE, budget--) {
+            if (paging_test_and_clear_young(va) != 0 || !paging_is_writable(va)) {
+                continue;   /* Not a private resident 4KB page, or recently used */
+            }
+            stat_inc(reclaim_scanned);
+            if (evict(area, va)) {
+                evicted++;
+            }
+        }
+    }
+    reclaim_cursor = va;
+
+    stat_add(reclaim_evicted, evicted);
+    stat_add(reclaim_ns, tsc_cycles_to_ns(rdtsc() - start));
+    return evicted;
+}
+
+/**
+ * @brief Allocate a frame for a virtual address, reclaiming pages if none
+ *        is free
+ *
+ * With page coloring on, the frame's color follows the virtual page
+ * number, so consecutive pages of an area land in different cache sets.
+ */
+static uint64_t alloc_frame(uint64_t va) {
+    uint64_t frame = pmm_alloc_color(va / PAGE_SIZE);
+    if (!frame && reclaim_locked(RECLAIM_BATCH) > 0) {
+        frame = pmm_alloc_color(va / PAGE_SIZE);
+    }
+    return frame;
+}
+
+/**
+ * @brief Bring a swapped-out page back from zram
+ */
+static bool swap_in(vm_area_t *area, uint64_t addr, uint64_t entry, uint64_t start_tsc) {
+    uint64_t frame = alloc_frame(addr);
+    if (!frame) {
+        return false;
+    }
+    if (!zram_load(entry, (void *)(uintptr_t)frame) ||
+        !paging_map_page(addr & ~(PAGE_SIZE - 1), frame, true)) {
+        pmm_free(frame);
+        return false;
+    }
+    zram_free(entry);
+    area->swapped--;
+    area->resident++;
+
+    stat_inc(swapin_faults);
+    hist_record(&swapin_ns[cpu_id()], tsc_cycles_to_ns(rdtsc() - start_tsc));
+    return true;
+}
+
+/**
+ * @brief Give a write to a merged (read-only) page its own copy
+ */
+static bool cow_fault(uint64_t addr) {
+    uint64_t va = addr & ~(PAGE_SIZE - 1);
+    uint64_t shared = paging_translate(va);
+    if (!shared || paging_is_writable(va)) {
+        return false;
+    }
+
+    uint64_t frame = alloc_frame(va);
+    if (!frame) {
+        return false;
+    }
+    memcpy((void *)(uintptr_t)frame, (const void *)(uintptr_t)shared, PAGE_SIZE);
+    paging_map_page(va, frame, true);
+    ksm_put_page(shared);
+
+    stat_inc(cow_faults);
+    return true;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void vmalloc_init(void) {
+    cpu_idle_add_hook(collapse_scan);
+}
+
+void *vmalloc(size_t size) {
+    if (size == 0 || size > VMALLOC_SIZE) {
+        return NULL;
+    }
+
+    uint64_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint64_t span = (pages + 1) * PAGE_SIZE;    /* Plus the guard page */
+    uint64_t align = pages >= HUGE_PAGES ? HUGE_SIZE : PAGE_SIZE;
+    uint64_t flags = irq_save();
+
+    if (area_count >= VMALLOC_MAX_AREAS) {
+        irq_restore(flags);
+        return NULL;
+    }
+
+    /*
+     * First fit: the gap before areas[pos], or the space after the last
+     * one. Large areas start 2MB aligned so they can use 2MB pages.
+     */
+    uint64_t cursor = VMALLOC_START;
+    int pos;
+    for (pos = 0; pos < area_count; pos++) {
+        cursor = (cursor + align - 1) & ~(align - 1);
+        if (cursor <= areas[pos].start && areas[pos].start - cursor >= span) {
+            break;
+        }
+        cursor = areas[pos].start + (areas[pos].pages + 1) * PAGE_SIZE;
+    }
+    cursor = (cursor + align - 1) & ~(align - 1);
+    if (cursor > VMALLOC_END || VMALLOC_END - cursor < span) {
+        irq_restore(flags);
+        return NULL;
+    }
+
+    memmove(&areas[pos + 1], &areas[pos], (size_t)(area_count - pos) * sizeof(vm_area_t));
+    areas[pos].start = cursor;
+    areas[pos].pages = pages;
+    areas[pos].resident = 0;
+    areas[pos].huge = 0;
+    areas[pos].swapped = 0;
+    area_count++;
+
+    irq_restore(flags);
+    return (void *)(uintptr_t)cursor;
+}
+EXPORT_SYMBOL(vmalloc);
+
+void vfree(void *addr) {
+    uint64_t start = (uint64_t)(uintptr_t)addr;
+    if (!addr) {
+        return;
+    }
+
+    /* Unlink first: from here on nothing can fault pages back in */
+    uint64_t flags = irq_save();
+    vm_area_t area;
+    int i;
+    for (i = 0; i < area_count && areas[i].start != start; i++) {
+    }
+    if (i == area_count) {
+        irq_restore(flags);
+        return;
+    }
+    area = areas[i];
+    memmove(&areas[i], &areas[i + 1], (size_t)(area_count - i - 1) * sizeof(vm_area_t));
+    area_count--;
+    irq_restore(flags);
+
+    /* Stop as soon as every populated or swapped page has been found */
+    uint64_t left = area.resident + area.swapped;
+    for (uint64_t p = 0; p < area.pages && left > 0; p++) {
+        uint64_t va = area.start + p * PAGE_SIZE;
+        uint64_t entry = paging_swap_entry(va);
+        if (entry) {
+            zram_free(entry);
+            paging_unmap_page(va);
+            left--;
+            continue;
+        }
+        if (area.huge && (va & (HUGE_SIZE - 1)) == 0) {
+            uint64_t block = paging_unmap_huge(va);
+            if (block) {
+                pmm_free_huge(block);
+                left -= HUGE_PAGES;
+                p += HUGE_PAGES - 1;
+                continue;
+            }
+        }
+        bool shared = !paging_is_writable(va);
+        uint64_t frame = paging_unmap_page(va);
+        if (frame) {
+            if (!shared || !ksm_put_page(frame)) {
+                pmm_free(frame);
+            }
+            left--;
+        }
+    }
+}
+EXPORT_SYMBOL(vfree);
+
+bool vmalloc_fault(uint64_t addr, uint64_t error_code, uint64_t start_tsc) {
+    if (addr < VMALLOC_START || addr >= VMALLOC_END) {
+        return false;
+    }
+
+    vm_area_t *area = find_area(addr);
+    if (!area) {
+        return false;   /* Guard page or freed memory */
+    }
+
+    /* Present page: only a write to a merged page is expected */
+    if (error_code & PF_PRESENT) {
+        return (error_code & PF_WRITE) && cow_fault(addr);
+    }
+
+    uint64_t entry = paging_swap_entry(addr);
+    if (entry) {
+        return swap_in(area, addr, entry, start_tsc);
+    }
+
+    if (!thp_enabled || !fault_huge(area, addr)) {
+        uint64_t frame = alloc_frame(addr);
+        if (!frame) {
+            return false;
+        }
+        memset((void *)(uintptr_t)frame, 0, PAGE_SIZE);
+        if (!paging_map_page(addr & ~(PAGE_SIZE - 1), frame, true)) {
+            pmm_free(frame);
+            return false;
+        }
+        area->resident++;
+    }
+
+    stat_inc(vmalloc_faults);
+    hist_record(&fault_ns[cpu_id()], tsc_cycles_to_ns(rdtsc() - start_tsc));
+    return true;
+}
+
+void vmalloc_set_thp(bool enabled) {
+    thp_enabled = enabled;
+}
+
+bool vmalloc_thp_enabled(void) {
+    return thp_enabled;
+}
+
+int vmalloc_get_areas(vm_area_t *out, int max) {
+    uint64_t flags = irq_save();
+    int n = area_count < max ? area_count : max;
+    for (int i = 0; i < n; i++) {
+        out[i] = areas[i];
+    }
+    irq_restore(flags);
+    return n;
+}
+
+void vmalloc_get_fault_hist(histogram_t *out) {
+    hist_init(out);
+    for (int cpu = 0; cpu < cpu_count(); cpu++) {
+        hist_merge(out, &fault_ns[cpu]);
+    }
+}
+
+uint64_t vmalloc_reclaim(uint64_t pages) {
+    uint64_t flags = irq_save();
+    uint64_t evicted = reclaim_locked(pages);
+    irq_restore(flags);
+    return evicted;
+}
+
+void vmalloc_get_swapin_hist(histogram_t *out) {
+    hist_init(out);
+    for (int cpu = 0; cpu < cpu_count(); cpu++) {
+        hist_merge(out, &swapin_ns[cpu]);
+    }
+}
+
+/* ============================================================================
+ * Metrics
+ * ============================================================================ */
+
+static uint64_t metric_resident_bytes(void) {
+    uint64_t pages = 0;
+    for (int i = 0; i < area_count; i++) {
+        pages += areas[i].resident;
+    }
+    return pages * PAGE_SIZE;
+}
+
+DEFINE_METRIC(vmalloc_resident_bytes, METRIC_GAUGE,
+              "Memory populated in vmalloc areas", 1, metric_resident_bytes);
+DEFINE_HISTOGRAM_METRIC(vmalloc_fault_seconds,
+                        "Demand-zero page fault service time", 1000000000,
+                        vmalloc_get_fault_hist);
+DEFINE_HISTOGRAM_METRIC(vmalloc_swapin_seconds,
+                        "Fault-in time of pages compressed in zram", 1000000000,
+                        vmalloc_get_swapin_hist);
@@ -0,0 +1,136 @@
+/**
+ * @file vmalloc.h
+ * @brief Virtually contiguous kernel allocations with demand-zero pages
+ *
+ * vmalloc() only reserves address space in [VMALLOC_START,
+ * VMALLOC_START + VMALLOC_SIZE); no memory is committed. The first touch
+ * of each page raises #PF, and vmalloc_fault() maps a zeroed frame there
+ * and restarts the instruction. A large, sparsely used buffer (a trace
+ * ring, a cache) therefore costs only the pages actually touched, and
+ * never needs physically contiguous frames.
+ *
+ * LAYOUT:
+ *   Areas are kept sorted by address and placed first-fit, each followed
+ *   by an unmapped guard page so an overrun faults instead of spilling
+ *   into the next area.
+ *
+ * TRANSPARENT HUGE PAGES:
+ *   Areas of 2MB or more start 2MB aligned. A fault in a 2MB range that
+ *   lies wholly inside its area first tries to map a zeroed 2MB block,
+ *   so one fault and one TLB entry cover 512 pages; without a free block
+ *   it falls back to 4KB. An idle hook (the collapser) walks the areas a
+ *   few ranges per call and replaces ranges that are at least 7/8
+ *   populated with 4KB pages by a 2MB copy. "vmalloc thp off" turns both
+ *   paths off.
+ *
+ * RECLAIM:
+ *   Under memory pressure cold 4KB pages are compressed into zram (see
+ *   zram.h) instead of letting allocations fail. A second-chance clock
+ *   hand sweeps the areas using the PTE accessed bits as the LRU
+ *   approximation: a page touched since the last pass is spared once,
+ *   an untouched one is evicted and its PTE left holding the swap entry.
+ *   A fault on it decompresses the page into a new frame. Reclaim runs
+ *   directly when a fault finds no free frame, or on request through
+ *   vmalloc_reclaim(). 2MB pages are never reclaimed.
+ *
+ * SHARING:
+ *   Pages merged by the same-page scanner (ksm.h) are mapped read-only.
+ *   A write to one faults, and the handler copies it into a private
+ *   frame. Reclaim and collapsing skip such pages.
+ *
+ * ACCOUNTING:
+ *   Each fault served is counted (stat vmalloc_faults) and its duration,
+ *   from exception entry to the mapping, is recorded in a per-CPU
+ *   histogram in nanoseconds. 2MB faults, fallbacks and collapses are
+ *   counted by stats thp_fault_alloc, thp_fault_fallback and
+ *   thp_collapse. Swap-ins get a histogram of their own; reclaim counts
+ *   pages scanned and evicted and the time it took.
+ */
+
+#ifndef _ARCH_X86_64_VMALLOC_H
+#define _ARCH_X86_64_VMALLOC_H
+
+#include <squirel/types.h>
+#include <lib/histogram/histogram.h>
+
+/**
+ * @brief One live allocation
+ */
+typedef struct {
+    uint64_t start;         /**< First byte */
+    uint64_t pages;         /**< Reserved 4KB pages (guard not included) */
+    uint64_t resident;      /**< 4KB pages populated so far (2MB pages count 512) */
+    uint64_t huge;          /**< 2MB pages among them */
+    uint64_t swapped;       /**< 4KB pages held compressed in zram */
+} vm_area_t;
+
+/**
+ * @brief Register the huge page collapser
+ */
+void vmalloc_init(void);
+
+/**
+ * @brief Reserve virtually contiguous memory (zero-filled on first touch)
+ *
+ * @param size  Bytes (rounded up to 4KB)
+ * @return      Page-aligned address, or NULL if the region or the area
+ *              table is full
+ */
+void *vmalloc(size_t size);
+
+/**
+ * @brief Release an area and every frame that was populated in it
+ *
+ * @param addr  Address returned by vmalloc() (NULL is ignored)
+ */
+void vfree(void *addr);
+
+/**
+ * @brief Populate the page holding a faulting address
+ *
+ * Called by the #PF handler.
+ *
+ * @param addr        Faulting address (CR2)
+ * @param error_code  #PF error code
+ * @param start_tsc   TSC when the fault was taken (latency accounting)
+ * @return            false if the address is not in a live area, the
+ *                    page was already present (other than for a write
+ *                    to a merged page), or memory ran out
+ */
+bool vmalloc_fault(uint64_t addr, uint64_t error_code, uint64_t start_tsc);
+
+/**
+ * @brief Enable or disable transparent huge pages (on by default)
+ */
+void vmalloc_set_thp(bool enabled);
+
+/**
+ * @brief Check whether transparent huge pages are enabled
+ */
+bool vmalloc_thp_enabled(void);
+
+/**
+ * @brief Copy the live areas
+ *
+ * @return Number of entries written
+ */
+int vmalloc_get_areas(vm_area_t *out, int max);
+
+/**
+ * @brief Merge the per-CPU fault latency histograms (nanoseconds)
+ */
+void vmalloc_get_fault_hist(histogram_t *out);
+
+/**
+ * @brief Compress up to pages cold pages into zram
+ *
+ * @return Pages evicted (fewer if everything left is hot or incompressible)
+ */
+uint64_t vmalloc_reclaim(uint64_t pages);
+
+/**
+ * @brief Merge the per-CPU swap-in latency histograms (nanoseconds)
+ */
+void vmalloc_get_swapin_hist(histogram_t *out);
+
+#endif /* _ARCH_X86_64_VMALLOC_H */
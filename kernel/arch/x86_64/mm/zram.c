@@ -0,0 +1,261 @@
+/**
+ * @file zram.c
+ * @brief Compressed in-RAM page store implementation
+ */
+
+#include "zram.h"
+#include "pmm.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <lib/lz4/lz4.h>
+#include <lib/memory/memory.h>
+#include <core/stat.h>
+#include <core/metrics.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define PAGE_SIZE           4096
+
+/* Slot flags */
+#define SLOT_USED           0x01
+#define SLOT_SAME           0x02    /* handle holds the fill word */
+
+/** @brief Pool frame header: live bytes in the frame */
+#define POOL_HEADER         8
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+typedef struct {
+    uint64_t handle;        /**< Physical address of the data, fill word, or next free slot */
+    uint16_t len;           /**< Compressed size */
+    uint8_t flags;
+} zram_slot_t;
+
+static zram_slot_t slots[ZRAM_MAX_PAGES];
+
+/** @brief Free slot list head (0 = empty), and slots never used yet */
+static uint64_t free_head = 0;
+static uint64_t next_unused = 1;
+
+/** @brief Pool frame being filled, and the offset of its free space */
+static uint64_t pool_frame = 0;
+static uint64_t pool_off = PAGE_SIZE;
+
+static uint8_t scratch[ZRAM_MAX_OBJECT];
+static uint8_t lz4_work[LZ4_WORK_SIZE];
+
+static uint64_t stored = 0;
+static uint64_t same = 0;
+static uint64_t compressed_bytes = 0;
+static uint64_t pool_frames = 0;
+
+DEFINE_STAT(zram_stores, "Pages compressed into zram");
+DEFINE_STAT(zram_same_filled, "Pages stored by zram as a single fill word");
+DEFINE_STAT(zram_rejects, "Pages zram refused as incompressible");
+DEFINE_STAT(zram_loads, "Pages decompressed from zram");
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static uint32_t *pool_live(uint64_t frame) {
+    return (uint32_t *)(uintptr_t)frame;
+}
+
+/**
+ * @brief Find room for len bytes in the pool
+ *
+ * @return Physical address, or 0 if no frame could be found
+ */
+static uint64_t pool_alloc(size_t len, uint64_t spare, bool *spare_used) {
+    if (!pool_frame || pool_off + len > PAGE_SIZE) {
+        uint64_t frame = pmm_alloc();
+        if (!frame) {
+            if (!spare || *spare_used) {
+                return 0;
+            }
+            frame = spare;
+            *spare_used = true;
+        }
+        /* The old frame still holds live data; it is freed when that goes */
+        pool_frame = frame;
+        pool_off = POOL_HEADER;
+        *pool_live(frame) = 0;
+        pool_frames++;
+    }
+
+    uint64_t at = pool_frame + pool_off;
+    pool_off += len;
+    *pool_live(pool_frame) += (uint32_t)len;
+    return at;
+}
+
+static void pool_release(uint64_t at, size_t len) {
+    uint64_t frame = at & ~(uint64_t)(PAGE_SIZE - 1);
+    uint32_t *live = pool_live(frame);
+    *live -= (uint32_t)len;
+    if (*live != 0) {
+        return;
+    }
+
+    if (frame == pool_frame) {
+        pool_off = POOL_HEADER;     /* Empty again: refill from the start */
+    } else {
+        pmm_free(frame);
+        pool_frames--;
+    }
+}
+
+static uint64_t slot_alloc(void) {
+    if (free_head) {
+        uint64_t entry = free_head;
+        free_head = slots[entry].handle;
+        return entry;
+    }
+    if (next_unused < ZRAM_MAX_PAGES) {
+        return next_unused++;
+    }
+    return 0;
+}
+
+static void slot_release(uint64_t entry) {
+    slots[entry].flags = 0;
+    slots[entry].handle = free_head;
+    free_head = entry;
+}
+
+/**
+ * @brief Check for a page made of one repeated 64-bit word
+ */
+static bool same_filled(const void *page, uint64_t *word) {
+    const uint64_t *w = (const uint64_t *)page;
+    for (int i = 1; i < PAGE_SIZE / 8; i++) {
+        if (w[i] != w[0]) {
+            return false;
+        }
+    }
+    *word = w[0];
+    return true;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool zram_store(const void *page, uint64_t frame, uint64_t *entry, bool *frame_kept) {
+    uint64_t flags = irq_save();
+    *frame_kept = false;
+
+    uint64_t e = slot_alloc();
+    if (!e) {
+        irq_restore(flags);
+        return false;
+    }
+
+    uint64_t word;
+    if (same_filled(page, &word)) {
+        slots[e].handle = word;
+        slots[e].len = 0;
+        slots[e].flags = SLOT_USED | SLOT_SAME;
+        same++;
+        stored++;
+        stat_inc(zram_same_filled);
+        *entry = e;
+        irq_restore(flags);
+        return true;
+    }
+
+    /* Compress first: the page frame may be reused as pool storage */
+    size_t len = lz4_compress(page, PAGE_SIZE, scratch, sizeof(scratch), lz4_work);
+    uint64_t at = len ? pool_alloc(len, frame, frame_kept) : 0;
+    if (!at) {
+        slot_release(e);
+        if (!len) {
+            stat_inc(zram_rejects);
+        }
+        irq_restore(flags);
+        return false;
+    }
+    memcpy((void *)(uintptr_t)at, scratch, len);
+
+    slots[e].handle = at;
+    slots[e].len = (uint16_t)len;
+    slots[e].flags = SLOT_USED;
+    compressed_bytes += len;
+    stored++;
+    stat_inc(zram_stores);
+    *entry = e;
+    irq_restore(flags);
+    return true;
+}
+
+bool zram_load(uint64_t entry, void *page) {
+    if (entry == 0 || entry >= ZRAM_MAX_PAGES || !(slots[entry].flags & SLOT_USED)) {
+        return false;
+    }
+
+    const zram_slot_t *slot = &slots[entry];
+    stat_inc(zram_loads);
+    if (slot->flags & SLOT_SAME) {
+        uint64_t *w = (uint64_t *)page;
+        for (int i = 0; i < PAGE_SIZE / 8; i++) {
+            w[i] = slot->handle;
+        }
+        return true;
+    }
+    return lz4_decompress((const void *)(uintptr_t)slot->handle, slot->len,
+                          page, PAGE_SIZE) == PAGE_SIZE;
+}
+
+void zram_free(uint64_t entry) {
+    if (entry == 0 || entry >= ZRAM_MAX_PAGES || !(slots[entry].flags & SLOT_USED)) {
+        return;
+    }
+
+    uint64_t flags = irq_save();
+    zram_slot_t *slot = &slots[entry];
+    if (slot->flags & SLOT_SAME) {
+        same--;
+    } else {
+        pool_release(slot->handle, slot->len);
+        compressed_bytes -= slot->len;
+    }
+    stored--;
+    slot_release(entry);
+    irq_restore(flags);
+}
+
+void zram_get_stats(zram_stats_t *out) {
+    out->stored = stored;
+    out->same = same;
+    out->compressed_bytes = compressed_bytes;
+    out->pool_frames = pool_frames;
+}
+
+/* ============================================================================
+ * Metrics
+ * ============================================================================ */
+
+static uint64_t metric_stored_bytes(void) {
+    return stored * PAGE_SIZE;
+}
+
+static uint64_t metric_pool_bytes(void) {
+    return pool_frames * PAGE_SIZE;
+}
+
+/** @brief Original size over pool size, in thousandths */
+static uint64_t metric_ratio(void) {
+    return pool_frames ? stored * 1000 / pool_frames : 0;
+}
+
+DEFINE_METRIC(zram_stored_bytes, METRIC_GAUGE,
+              "Uncompressed size of the pages held by zram", 1, metric_stored_bytes);
+DEFINE_METRIC(zram_pool_bytes, METRIC_GAUGE,
+              "Memory used by zram to hold them", 1, metric_pool_bytes);
+DEFINE_METRIC(zram_compression_ratio, METRIC_GAUGE,
+              "zram stored bytes per pool byte", 1000, metric_ratio);
@@ -0,0 +1,77 @@
+/**
+ * @file zram.h
+ * @brief Compressed in-RAM page store (swap target of page reclaim)
+ *
+ * Reclaim hands cold pages to zram_store(), which keeps them LZ4
+ * compressed in RAM and returns a swap entry for the PTE; the fault
+ * handler brings them back with zram_load().
+ *
+ * SAME-FILLED PAGES:
+ *   A page whose 64-bit words are all equal (zero pages above all) is
+ *   stored as just that word: no compression, no pool space.
+ *
+ * POOL:
+ *   Compressed pages are packed back to back into pool frames taken from
+ *   the frame allocator. Each pool frame starts with a count of the live
+ *   bytes in it and is returned once that reaches zero. When no free
+ *   frame is left, the frame of the page being stored becomes the next
+ *   pool frame, so reclaim makes progress even at zero free memory.
+ *   Pages that compress to more than ZRAM_MAX_OBJECT bytes are rejected:
+ *   keeping them would save too little.
+ *
+ * ENTRIES:
+ *   Swap entries index a fixed table of ZRAM_MAX_PAGES slots (entry 0 is
+ *   never used); free slots form a list.
+ */
+
+#ifndef _ARCH_X86_64_ZRAM_H
+#define _ARCH_X86_64_ZRAM_H
+
+#include <squirel/types.h>
+
+/** @brief Largest compressed page worth storing */
+#define ZRAM_MAX_OBJECT     3072
+
+/**
+ * @brief Store counters
+ */
+typedef struct {
+    uint64_t stored;            /**< Pages held */
+    uint64_t same;              /**< Of which same-filled (no data) */
+    uint64_t compressed_bytes;  /**< Compressed size of the others */
+    uint64_t pool_frames;       /**< Frames holding compressed data */
+} zram_stats_t;
+
+/**
+ * @brief Compress a page into the store
+ *
+ * @param page        Page contents (read before anything is written)
+ * @param frame       Physical frame of the page; may become pool storage
+ * @param entry       Out: swap entry
+ * @param frame_kept  Out: true if the frame now belongs to the pool and
+ *                    must not be freed by the caller
+ * @return            false if the page is incompressible or the store
+ *                    is full
+ */
+bool zram_store(const void *page, uint64_t frame, uint64_t *entry, bool *frame_kept);
+
+/**
+ * @brief Decompress a stored page
+ *
+ * @param entry  Entry from zram_store()
+ * @param page   4KB destination
+ * @return       false if the entry is invalid or its data corrupt
+ */
+bool zram_load(uint64_t entry, void *page);
+
+/**
+ * @brief Drop a stored page
+ */
+void zram_free(uint64_t entry);
+
+/**
+ * @brief Read the store counters
+ */
+void zram_get_stats(zram_stats_t *out);
+
+#endif /* _ARCH_X86_64_ZRAM_H */
@@ -0,0 +1,102 @@
+/**
+ * @file cpustat.c
+ * @brief Per-CPU busy/idle/irq time accounting implementation
+ */
+
+#include "cpustat.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/irq.h>
+#include <core/stat.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define IDLE_MAX_HOOKS  4
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/**
+ * @brief Counters of one CPU, on their own cache line
+ */
+typedef struct {
+    volatile uint64_t idle;
+    volatile uint64_t irq;
+} ALIGNED(64) cpu_time_t;
+
+static cpu_time_t cpu_time[MAX_CPUS];
+
+static uint64_t start_tsc = 0;
+
+static idle_hook_t idle_hooks[IDLE_MAX_HOOKS];
+static int idle_hook_count = 0;
+static bool in_hooks = false;
+
+DEFINE_STAT(cpu_idle_calls, "Passes through the idle loop");
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void cpustat_init(void) {
+    start_tsc = rdtsc();
+}
+
+void cpu_idle(void) {
+    /* A hook that waits must not re-enter the hooks */
+    if (!in_hooks) {
+        in_hooks = true;
+        for (int i = 0; i < idle_hook_count; i++) {
+            idle_hooks[i]();
+        }
+        in_hooks = false;
+    }
+
+    cpu_time_t *t = &cpu_time[cpu_id()];
+    uint64_t irq_before = t->irq;
+    uint64_t start = rdtsc();
+
+    stat_inc(cpu_idle_calls);
+    if (irq_active()) {
+        halt();
+    } else {
+        cpu_relax();
+    }
+
+    /* The wake-up interrupt already charged itself to irq */
+    uint64_t spent = rdtsc() - start;
+    uint64_t irq_spent = t->irq - irq_before;
+    if (spent > irq_spent) {
+        t->idle += spent - irq_spent;
+    }
+}
+
+bool cpu_idle_add_hook(idle_hook_t hook) {
+    if (idle_hook_count >= IDLE_MAX_HOOKS) {
+        return false;
+    }
+    idle_hooks[idle_hook_count++] = hook;
+    return true;
+}
+
+void cpustat_account_irq(uint64_t cycles) {
+    cpu_time[cpu_id()].irq += cycles;
+}
+
+void cpustat_get(int cpu, cpustat_t *out) {
+    out->total = out->busy = out->idle = out->irq = 0;
+    if (cpu < 0 || cpu >= MAX_CPUS || start_tsc == 0) {
+        return;
+    }
+
+    out->total = rdtsc() - start_tsc;
+    out->idle = cpu_time[cpu].idle;
+    out->irq = cpu_time[cpu].irq;
+    if (out->total > out->idle + out->irq) {
+        out->busy = out->total - out->idle - out->irq;
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file cpustat.h
+ * @brief Per-CPU busy/idle/irq time accounting
+ *
+ * Time is counted in TSC cycles per CPU:
+ *   idle - spent halted in cpu_idle()
+ *   irq  - spent in interrupt handlers (charged by irq_dispatch())
+ *   busy - everything else since cpustat_init()
+ * An interrupt that wakes the CPU from cpu_idle() is charged to irq
+ * only, never to both.
+ *
+ * IDLE LOOPS:
+ *   Code that waits for something (keyboard input, a timeout) calls
+ *   cpu_idle() in its loop instead of spinning on pause. Once interrupts
+ *   are on this halts until the next one (at most 1/PIT_TICK_HZ later).
+ *
+ * IDLE HOOKS:
+ *   Work that an interrupt handler defers (e.g. answering a request that
+ *   arrived on a serial port) is registered with cpu_idle_add_hook() and
+ *   runs at the top of every cpu_idle() call, with interrupts enabled.
+ *   Hook time is charged to busy, not idle.
+ */
+
+#ifndef _CORE_CPUSTAT_H
+#define _CORE_CPUSTAT_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Accumulated time of one CPU, in TSC cycles
+ */
+typedef struct {
+    uint64_t total;         /**< Since cpustat_init() */
+    uint64_t busy;          /**< Running kernel code */
+    uint64_t idle;          /**< Halted in cpu_idle() */
+    uint64_t irq;           /**< In interrupt handlers */
+} cpustat_t;
+
+/**
+ * @brief Start accounting (total time is measured from here)
+ */
+void cpustat_init(void);
+
+/**
+ * @brief Wait for the next interrupt, accounting the time as idle
+ *
+ * Falls back to a pause instruction while interrupts are not enabled.
+ */
+void cpu_idle(void);
+
+/**
+ * @brief Deferred work run by cpu_idle()
+ */
+typedef void (*idle_hook_t)(void);
+
+/**
+ * @brief Run a function at the top of every cpu_idle() call
+ *
+ * @return false if all hook slots are taken
+ */
+bool cpu_idle_add_hook(idle_hook_t hook);
+
+/**
+ * @brief Charge interrupt handler time to the calling CPU
+ */
+void cpustat_account_irq(uint64_t cycles);
+
+/**
+ * @brief Read the accumulated times of a CPU
+ */
+void cpustat_get(int cpu, cpustat_t *out);
+
+#endif /* _CORE_CPUSTAT_H */
@@ -0,0 +1,50 @@
+/**
+ * @file export.h
+ * @brief Kernel symbols visible to loadable modules
+ *
+ * A module (core/module.h) can only call what the kernel exports.
+ * EXPORT_SYMBOL() next to a function or variable definition adds its
+ * name and address to the .ksymtab section (__ksymtab_start ..
+ * __ksymtab_end), which the module loader searches when it resolves a
+ * module's undefined symbols. Like the other registries, nothing has to
+ * call a register function.
+ *
+ * @example
+ *   int kprintf(const char *fmt, ...) { ... }
+ *   EXPORT_SYMBOL(kprintf);
+ */
+
+#ifndef _CORE_EXPORT_H
+#define _CORE_EXPORT_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Registry entry emitted by EXPORT_SYMBOL (one per symbol)
+ *
+ * Sized and aligned to 16 bytes so the .ksymtab section is a plain array.
+ */
+typedef struct {
+    const char *name;
+    uint64_t addr;
+} ALIGNED(16) ksym_t;
+
+/**
+ * @brief Export a function or variable to modules
+ */
+#define EXPORT_SYMBOL(sym)                                                  \
+    static const ksym_t ksym_##sym                                          \
+        __attribute__((section(".ksymtab"), used)) =                        \
+        { #sym, (uint64_t)(uintptr_t)&sym }
+
+/**
+ * @brief Address of an exported symbol, or 0 if it is not exported
+ */
+uint64_t ksym_lookup(const char *name);
+
+/**
+ * @brief Number of exported symbols
+ */
+int ksym_count(void);
+
+#endif /* _CORE_EXPORT_H */
@@ -0,0 +1,360 @@
+/**
+ * @file gcov.c
+ * @brief Minimal gcov runtime implementation
+ *
+ * The structures below mirror gcc/libgcov.h, whose layout follows the
+ * compiler version: GCC 10 or later is assumed, with the extra checksum
+ * and byte-sized record lengths of GCC 12 and the condition counters of
+ * GCC 14. This file itself is built without instrumentation.
+ */
+
+#include "gcov.h"
+#include "initcall.h"
+#include <squirel/config.h>
+#include <drivers/debugcon/debugcon.h>
+#include <drivers/serial/serial.h>
+#include <lib/checksum/checksum.h>
+#include <lib/memory/memory.h>
+#include <lib/string/string.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/* Counter kinds per function (gcc/gcov-counter.def) */
+#if __GNUC__ >= 14
+#define GCOV_COUNTERS           9
+#else
+#define GCOV_COUNTERS           8
+#endif
+
+/* Unit of record lengths: bytes from GCC 12, 32-bit words before */
+#if __GNUC__ >= 12
+#define GCOV_UNIT_SIZE          4
+#else
+#define GCOV_UNIT_SIZE          1
+#endif
+
+#define GCOV_DATA_MAGIC         0x67636461u     /* "gcda" */
+#define GCOV_TAG_FUNCTION       0x01000000u
+#define GCOV_TAG_FUNCTION_LENGTH 3
+#define GCOV_TAG_COUNTER_BASE   0x01a10000u
+#define GCOV_TAG_FOR_COUNTER(n) (GCOV_TAG_COUNTER_BASE + ((uint32_t)(n) << 17))
+#define GCOV_TAG_OBJECT_SUMMARY 0xa1000000u
+#define GCOV_TAG_SUMMARY_LENGTH 2
+
+/** @brief Export bytes per base64 line (76 characters) */
+#define B64_LINE_BYTES          57
+
+#define EXPORT_BEGIN            "\n-----BEGIN SQUIREL GCOV-----\n"
+#define EXPORT_END              "-----END SQUIREL GCOV-----\n"
+
+/* ============================================================================
+ * Types (gcc/libgcov.h)
+ * ============================================================================ */
+
+typedef uint64_t gcov_type;
+
+struct gcov_info;
+
+/** @brief One kind of counter of one function */
+typedef struct {
+    uint32_t num;
+    gcov_type *values;
+} gcov_ctr_info_t;
+
+/** @brief A function: checksums and one gcov_ctr_info_t per active kind */
+typedef struct {
+    const struct gcov_info *key;    /**< Owning object (else a COMDAT copy) */
+    uint32_t ident;
+    uint32_t lineno_checksum;
+    uint32_t cfg_checksum;
+    gcov_ctr_info_t ctrs[];
+} gcov_fn_info_t;
+
+typedef void (*gcov_merge_fn)(gcov_type *counters, uint32_t n);
+
+/** @brief An object file, as handed to __gcov_init() */
+typedef struct gcov_info {
+    uint32_t version;
+    struct gcov_info *next;
+    uint32_t stamp;
+#if __GNUC__ >= 12
+    uint32_t checksum;
+#endif
+    const char *filename;                   /**< .gcda path at compile time */
+    gcov_merge_fn merge[GCOV_COUNTERS];     /**< NULL for inactive kinds */
+    uint32_t n_functions;
+    const gcov_fn_info_t *const *functions;
+} gcov_info_t;
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/** @brief Registered objects, newest first */
+static gcov_info_t *objects;
+
+/* Export stream: a NULL writer only counts bytes */
+static void (*out_write)(const char *buf, size_t len);
+static uint64_t out_bytes;
+static uint32_t out_crc;
+
+static const char b64_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static uint8_t b64_buf[B64_LINE_BYTES];
+static size_t b64_len;
+
+/* Constructors the compiler emits for each profiled object (kernel.ld) */
+typedef void (*ctor_fn)(void);
+extern ctor_fn __init_array_start[];
+extern ctor_fn __init_array_end[];
+
+/* ============================================================================
+ * Compiler Interface
+ * ============================================================================ */
+
+void __gcov_init(gcov_info_t *info);
+void __gcov_exit(void);
+void __gcov_merge_add(gcov_type *counters, uint32_t n);
+
+void __gcov_init(gcov_info_t *info) {
+    info->next = objects;
+    objects = info;
+}
+
+/* Destructor; the kernel never exits */
+void __gcov_exit(void) {
+}
+
+/* Only its address is used: merge[] marks which counter kinds exist */
+void __gcov_merge_add(gcov_type *counters, uint32_t n) {
+    (void)counters;
+    (void)n;
+}
+
+static bool gcov_initcall(void) {
+    for (ctor_fn *fn = __init_array_start; fn < __init_array_end; fn++) {
+        (*fn)();
+    }
+    return objects != NULL;
+}
+DEFINE_INITCALL(gcov, gcov_initcall, "", 0);
+
+/* ============================================================================
+ * Private Functions
+ * ============================================================================ */
+
+static bool fn_valid(const gcov_info_t *info, const gcov_fn_info_t *fn) {
+    return fn != NULL && fn->key == info;
+}
+
+/**
+ * @brief Largest arc counter of the whole kernel (libgcov's sum_max)
+ */
+static uint64_t max_count(void) {
+    uint64_t max = 0;
+
+    for (gcov_info_t *info = objects; info; info = info->next) {
+        for (uint32_t f = 0; f < info->n_functions; f++) {
+            const gcov_fn_info_t *fn = info->functions[f];
+            if (!fn_valid(info, fn)) {
+                continue;
+            }
+            for (uint32_t i = 0; i < fn->ctrs[0].num; i++) {
+                if (fn->ctrs[0].values[i] > max) {
+                    max = fn->ctrs[0].values[i];
+                }
+            }
+        }
+    }
+    return max;
+}
+
+static void b64_line(void) {
+    char line[B64_LINE_BYTES / 3 * 4 + 1];
+    size_t o = 0;
+
+    for (size_t i = 0; i < b64_len; i += 3) {
+        uint32_t v = (uint32_t)b64_buf[i] << 16;
+        v |= i + 1 < b64_len ? (uint32_t)b64_buf[i + 1] << 8 : 0;
+        v |= i + 2 < b64_len ? b64_buf[i + 2] : 0;
+        line[o++] = b64_digits[v >> 18 & 63];
+        line[o++] = b64_digits[v >> 12 & 63];
+        line[o++] = i + 1 < b64_len ? b64_digits[v >> 6 & 63] : '=';
+        line[o++] = i + 2 < b64_len ? b64_digits[v & 63] : '=';
+    }
+    line[o++] = '\n';
+    out_write(line, o);
+    b64_len = 0;
+}
+
+static void put(const void *buf, size_t len) {
+    const uint8_t *src = buf;
+
+    out_bytes += len;
+    if (!out_write) {
+        return;
+    }
+    out_crc = crc32c(out_crc, buf, len);
+    for (size_t i = 0; i < len; i++) {
+        b64_buf[b64_len++] = src[i];
+        if (b64_len == B64_LINE_BYTES) {
+            b64_line();
+        }
+    }
+}
+
+static void put_u32(uint32_t v) {
+    put(&v, sizeof(v));
+}
+
+/**
+ * @brief Stream one object's .gcda file, as libgcov writes it for one run
+ *
+ * Unlike libgcov, counters that are all zero are written out too, so the
+ * size depends only on the object: the export path is instrumented, and
+ * its counters move between gcda_size() and the write.
+ */
+static void put_gcda(const gcov_info_t *info, uint64_t max) {
+    put_u32(GCOV_DATA_MAGIC);
+    put_u32(info->version);
+    put_u32(info->stamp);
+#if __GNUC__ >= 12
+    put_u32(info->checksum);
+#endif
+    put_u32(GCOV_TAG_OBJECT_SUMMARY);
+    put_u32(GCOV_TAG_SUMMARY_LENGTH * GCOV_UNIT_SIZE);
+    put_u32(1);                     /* runs */
+    put_u32((uint32_t)max);         /* sum_max (32 bits in the file) */
+
+    for (uint32_t f = 0; f < info->n_functions; f++) {
+        const gcov_fn_info_t *fn = info->functions[f];
+
+        put_u32(GCOV_TAG_FUNCTION);
+        if (!fn_valid(info, fn)) {
+            put_u32(0);
+            continue;
+        }
+        put_u32(GCOV_TAG_FUNCTION_LENGTH * GCOV_UNIT_SIZE);
+        put_u32(fn->ident);
+        put_u32(fn->lineno_checksum);
+        put_u32(fn->cfg_checksum);
+
+        const gcov_ctr_info_t *ctr = fn->ctrs;
+        for (int kind = 0; kind < GCOV_COUNTERS; kind++) {
+            if (!info->merge[kind]) {
+                continue;
+            }
+            put_u32(GCOV_TAG_FOR_COUNTER(kind));
+            put_u32(ctr->num * 2 * GCOV_UNIT_SIZE);
+            put(ctr->values, ctr->num * sizeof(gcov_type));
+            ctr++;
+        }
+    }
+}
+
+static uint64_t gcda_size(const gcov_info_t *info, uint64_t max) {
+    void (*write)(const char *buf, size_t len) = out_write;
+
+    out_write = NULL;
+    out_bytes = 0;
+    put_gcda(info, max);
+    out_write = write;
+    return out_bytes;
+}
+
+static void debugcon_out(const char *buf, size_t len) {
+    debugcon_write(buf, len);
+}
+
+static void serial_out(const char *buf, size_t len) {
+    serial_write(buf, len);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool gcov_enabled(void) {
+    return objects != NULL;
+}
+
+void gcov_get_summary(gcov_summary_t *out) {
+    uint64_t max = max_count();
+
+    memset(out, 0, sizeof(*out));
+    out->max_count = max;
+    out_write = NULL;
+    for (gcov_info_t *info = objects; info; info = info->next) {
+        out->objects++;
+        out->export_bytes += gcda_size(info, max);
+        for (uint32_t f = 0; f < info->n_functions; f++) {
+            const gcov_fn_info_t *fn = info->functions[f];
+            if (fn_valid(info, fn)) {
+                out->functions++;
+                out->counters += fn->ctrs[0].num;
+            }
+        }
+    }
+}
+
+void gcov_reset(void) {
+    for (gcov_info_t *info = objects; info; info = info->next) {
+        for (uint32_t f = 0; f < info->n_functions; f++) {
+            const gcov_fn_info_t *fn = info->functions[f];
+            if (!fn_valid(info, fn)) {
+                continue;
+            }
+            const gcov_ctr_info_t *ctr = fn->ctrs;
+            for (int kind = 0; kind < GCOV_COUNTERS; kind++) {
+                if (info->merge[kind]) {
+                    memset(ctr->values, 0, ctr->num * sizeof(gcov_type));
+                    ctr++;
+                }
+            }
+        }
+    }
+}
+
+bool gcov_export(gcov_sink_t sink) {
+    if (!objects) {
+        return false;
+    }
+    if (sink == GCOV_SINK_AUTO) {
+        sink = debugcon_present() ? GCOV_SINK_DEBUGCON : GCOV_SINK_SERIAL;
+    }
+    if (sink == GCOV_SINK_DEBUGCON && !debugcon_present()) {
+        return false;
+    }
+
+    uint64_t max = max_count();
+    void (*write)(const char *buf, size_t len) =
+        sink == GCOV_SINK_DEBUGCON ? debugcon_out : serial_out;
+
+    out_crc = 0;
+    b64_len = 0;
+    write(EXPORT_BEGIN, sizeof(EXPORT_BEGIN) - 1);
+    for (gcov_info_t *info = objects; info; info = info->next) {
+        uint32_t name_len = (uint32_t)strlen(info->filename);
+        uint32_t data_len = (uint32_t)gcda_size(info, max);
+
+        out_write = write;
+        put_u32(name_len);
+        put(info->filename, name_len);
+        put_u32(data_len);
+        put_gcda(info, max);
+    }
+    put_u32(0);
+
+    uint32_t crc = out_crc;
+    put_u32(crc);
+    if (b64_len > 0) {
+        b64_line();
+    }
+    write(EXPORT_END, sizeof(EXPORT_END) - 1);
+
+    out_write = NULL;
+    return true;
+}
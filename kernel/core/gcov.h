@@ -0,0 +1,80 @@
+/**
+ * @file gcov.h
+ * @brief Minimal gcov runtime for profile-guided builds
+ *
+ * "make pgo" compiles the kernel once with -fprofile-generate. GCC then
+ * gives every object file a block of arc counters, bumped inline as
+ * code runs, and a constructor that hands a description of the object
+ * (struct gcov_info) to __gcov_init(). This file is the part of libgcov
+ * the kernel needs: it keeps the list of objects, clears the counters
+ * and writes one .gcda file per object to a port, where
+ * scripts/pgo.py picks them up for the -fprofile-use build.
+ *
+ * WHAT IS RECORDED:
+ *   Arc counters only (-fno-profile-values). Value profiling keeps its
+ *   indirect-call state in thread-local storage, which the kernel does
+ *   not set up; arc counts alone drive block layout, hot/cold splitting,
+ *   inlining and unrolling. Counter updates are plain adds: one CPU, and
+ *   an interrupt landing in the middle of one costs at most a count.
+ *
+ * EXPORT FORMAT:
+ *   Base64 lines between "-----BEGIN SQUIREL GCOV-----" and
+ *   "-----END SQUIREL GCOV-----" (like the serial crash dump), holding
+ *   for each object a uint32 name length, the .gcda path the compiler
+ *   chose, a uint32 data length and the .gcda contents; then a zero
+ *   name length and the CRC32C of everything before it. The .gcda data
+ *   is what libgcov writes for a single run.
+ *
+ * In a kernel built without profiling there are no objects and every
+ * function here does nothing.
+ */
+
+#ifndef _CORE_GCOV_H
+#define _CORE_GCOV_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Ports profiles can be exported to
+ */
+typedef enum {
+    GCOV_SINK_AUTO = 0,         /**< debugcon if present, else serial */
+    GCOV_SINK_DEBUGCON,
+    GCOV_SINK_SERIAL
+} gcov_sink_t;
+
+/**
+ * @brief What the profiled objects hold
+ */
+typedef struct {
+    uint32_t objects;           /**< Object files registered */
+    uint32_t functions;         /**< Functions with counters */
+    uint64_t counters;          /**< Arc counters */
+    uint64_t max_count;         /**< Largest counter (the hottest arc) */
+    uint64_t export_bytes;      /**< Size of all .gcda files together */
+} gcov_summary_t;
+
+/**
+ * @brief Whether this kernel was built with -fprofile-generate
+ */
+bool gcov_enabled(void);
+
+/**
+ * @brief Count objects, counters and export size
+ */
+void gcov_get_summary(gcov_summary_t *out);
+
+/**
+ * @brief Zero every counter (profile only what follows)
+ */
+void gcov_reset(void);
+
+/**
+ * @brief Write the .gcda files of all objects to a port
+ *
+ * @param sink  Port to use
+ * @return false if the kernel is not profiled or the port is absent
+ */
+bool gcov_export(gcov_sink_t sink);
+
+#endif /* _CORE_GCOV_H */
@@ -0,0 +1,781 @@
+/**
+ * @file hibernate.c
+ * @brief Hibernation to disk and resume implementation
+ */
+
+#include "hibernate.h"
+#include "initcall.h"
+#include "metrics.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/cpu/irq.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <drivers/ata/ata.h>
+#include <drivers/vga/vga_text.h>
+#include <drivers/virtio/virtio_console.h>
+#include <lib/bitmap/bitmap.h>
+#include <lib/checksum/checksum.h>
+#include <lib/lz4/lz4.h>
+#include <lib/memory/memory.h>
+#include <lib/printf/printf.h>
+
+/* Linker script symbols */
+extern char __kernel_start[];
+extern char __rodata_end[];
+extern char __kernel_end[];
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define HIBERNATE_MAGIC     0x3152454249485153ull   /* "SQHIBER1" */
+#define HIBERNATE_VERSION   1
+
+/* Legacy video memory and option ROMs: never saved */
+#define HOLE_START          0xA0000ull
+#define HOLE_END            0x100000ull
+
+/* Record lengths with a special meaning */
+#define REC_ZERO            0                       /* Page of zeros */
+#define REC_RAW             PMM_FRAME_SIZE          /* Stored as is */
+#define REC_HEADER          2                       /* 16-bit length */
+
+/* Snapshot buffers, carved from one 2MB block that is not saved */
+#define BLOCK_SIZE          (PMM_HUGE_FRAMES * PMM_FRAME_SIZE)
+#define BLOCK_WORK          0                       /* LZ4 hash table */
+#define BLOCK_MAP           LZ4_WORK_SIZE           /* Page map */
+#define BLOCK_OUT           (64 * 1024)             /* Records being written */
+
+/** @brief Page map of the largest RAM the allocator manages */
+#define MAP_MAX_BYTES       (PMM_MAX_MEMORY / PMM_FRAME_SIZE / 8)
+
+_Static_assert(BLOCK_MAP + MAP_MAX_BYTES <= BLOCK_OUT, "page map overlaps the output");
+
+/** @brief Records read from disk per refill while resuming */
+#define READ_BUF_SIZE       (256 * 1024)
+
+/** @brief Copy pairs per list page */
+#define PAIRS_PER_PAGE      ((PMM_FRAME_SIZE - 16) / 16)
+
+/* Temporary page table entries */
+#define PTE_TABLE           0x03                    /* Present, writable */
+#define PDE_LARGE           0x83                    /* Present, writable, 2MB */
+#define LARGE_PAGE_SIZE     0x200000ull
+#define ENTRIES             512
+
+#define MSR_TSC             0x10
+
+/* ============================================================================
+ * Types
+ * ============================================================================ */
+
+/**
+ * @brief Image header (first sector)
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_crc;        /**< CRC32C of the header with this field 0 */
+    uint32_t kernel_crc;        /**< CRC32C of .text and .rodata */
+    uint32_t data_crc;          /**< CRC32C of the record sectors */
+    uint64_t kernel_end;        /**< First frame the allocator may manage */
+    uint64_t mem_top;
+    uint64_t frames;            /**< Bits in the page map */
+    uint64_t pages;
+    uint64_t zero_pages;
+    uint64_t raw_pages;
+    uint64_t map_sectors;
+    uint64_t data_sectors;
+    uint64_t save_ns;
+} image_header_t;
+
+/**
+ * @brief CPU state recorded by hibernate_save() (layout shared with resume.asm)
+ */
+typedef struct {
+    uint64_t rbx, rbp, r12, r13, r14, r15;
+    uint64_t rsp, rip, rflags, cr3;
+} hibernate_cpu_t;
+
+/**
+ * @brief Page of the final copy list (layout shared with resume.asm)
+ */
+typedef struct {
+    uint64_t next;              /**< Physical address of the next page, or 0 */
+    uint64_t count;
+    struct {
+        uint64_t dst;
+        uint64_t src;           /**< 0: zero-fill dst */
+    } pairs[PAIRS_PER_PAGE];
+} copy_page_t;
+
+_Static_assert(sizeof(copy_page_t) <= PMM_FRAME_SIZE, "copy list page too large");
+
+/**
+ * @brief What the booting kernel hands the resumed one
+ *
+ * Sits in a frame the image does not use, so the final copy leaves it
+ * alone; its address is what hibernate_save() returns the second time.
+ */
+typedef struct {
+    uint64_t found_tsc;         /**< Image accepted */
+    uint64_t loaded_tsc;        /**< Every page read and decompressed */
+    uint64_t jump_tsc;          /**< Final copy starts */
+    uint64_t pages;
+    uint64_t direct_pages;
+    uint64_t staged_pages;
+    uint64_t image_bytes;
+    uint64_t zero_pages;        /**< From the header, for the save figures */
+    uint64_t raw_pages;
+    uint64_t save_ns;
+} resume_report_t;
+
+/**
+ * @brief Sector-buffered record output
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    uint64_t lba;               /**< Where the next whole sector goes */
+    uint64_t sectors;           /**< Written so far */
+    uint32_t crc;
+} image_writer_t;
+
+/**
+ * @brief Sector-buffered record input
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t pos;
+    size_t len;
+    uint64_t lba;               /**< Next sector to read */
+    uint64_t left;              /**< Sectors not read yet */
+    uint32_t crc;
+} image_reader_t;
+
+/* resume.asm */
+uint64_t hibernate_save(hibernate_cpu_t *ctx) __attribute__((returns_twice));
+NORETURN void hibernate_restore(uint64_t list, uint64_t cr3, uint64_t token);
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/** @brief Saved by hibernate_save(), reloaded by hibernate_restore() */
+hibernate_cpu_t hibernate_ctx;
+
+/** @brief TSC at the snapshot, put back on resume */
+static uint64_t snapshot_tsc;
+
+static bool have_save_stats = false;
+static hibernate_save_stats_t save_stats;
+static bool have_resume_stats = false;
+static hibernate_resume_stats_t resume_stats;
+
+/** @brief Header sector being read or written */
+static uint8_t header_sector[ATA_SECTOR_SIZE] ALIGNED(8);
+
+/** @brief Final copy list being built (physical addresses) */
+static uint64_t copy_head;
+static copy_page_t *copy_tail;
+
+/* ============================================================================
+ * Header
+ * ============================================================================ */
+
+static uint32_t kernel_checksum(void) {
+    return crc32c(0, __kernel_start, (size_t)(__rodata_end - __kernel_start));
+}
+
+static uint32_t header_checksum(const image_header_t *h) {
+    image_header_t copy = *h;
+    copy.header_crc = 0;
+    return crc32c(0, &copy, sizeof(copy));
+}
+
+static uint64_t map_sectors(uint64_t frames) {
+    return ((frames + 7) / 8 + ATA_SECTOR_SIZE - 1) / ATA_SECTOR_SIZE;
+}
+
+static uint64_t image_bytes(const image_header_t *h) {
+    return (1 + h->map_sectors + h->data_sectors) * ATA_SECTOR_SIZE;
+}
+
+static bool header_read(image_header_t *h) {
+    if (!ata_read(HIBERNATE_LBA, 1, header_sector)) {
+        return false;
+    }
+    memcpy(h, header_sector, sizeof(*h));
+    return true;
+}
+
+static bool header_write(const image_header_t *h) {
+    memset(header_sector, 0, sizeof(header_sector));
+    if (h) {
+        memcpy(header_sector, h, sizeof(*h));
+    }
+    return ata_write(HIBERNATE_LBA, 1, header_sector) && ata_flush();
+}
+
+static bool header_valid(const image_header_t *h) {
+    return h->magic == HIBERNATE_MAGIC && h->version == HIBERNATE_VERSION &&
+           h->header_crc == header_checksum(h);
+}
+
+/**
+ * @brief Why this kernel cannot resume from a valid image, or NULL
+ */
+static const char *header_mismatch(const image_header_t *h) {
+    pmm_stats_t pmm;
+    pmm_get_stats(&pmm);
+
+    if (h->kernel_crc != kernel_checksum() ||
+        h->kernel_end != (uint64_t)(uintptr_t)__kernel_end) {
+        return "written by another kernel";
+    }
+    if (h->mem_top != pmm.mem_top || h->frames != pmm.mem_top / PMM_FRAME_SIZE ||
+        h->map_sectors != map_sectors(h->frames)) {
+        return "RAM size differs";
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * Snapshot
+ * ============================================================================ */
+
+static bool frame_saved(uint64_t phys, uint64_t block) {
+    if (phys >= HOLE_START && phys < HOLE_END) {
+        return false;
+    }
+    if (phys >= block && phys < block + BLOCK_SIZE) {
+        return false;
+    }
+    return pmm_frame_in_use(phys);
+}
+
+static bool page_is_zero(const uint64_t *p) {
+    for (size_t i = 0; i < PMM_FRAME_SIZE / sizeof(uint64_t); i++) {
+        if (p[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Write the whole sectors collected, keep the partial one
+ *
+ * @param last  Pad the partial sector with zeros and write it too
+ */
+static bool writer_flush(image_writer_t *w, bool last) {
+    if (last && w->len % ATA_SECTOR_SIZE) {
+        size_t pad = ATA_SECTOR_SIZE - w->len % ATA_SECTOR_SIZE;
+        memset(w->buf + w->len, 0, pad);
+        w->len += pad;
+    }
+
+    size_t n = w->len / ATA_SECTOR_SIZE;
+    size_t bytes = n * ATA_SECTOR_SIZE;
+    if (n == 0) {
+        return true;
+    }
+    if (!ata_write(w->lba, (uint32_t)n, w->buf)) {
+        return false;
+    }
+    w->crc = crc32c(w->crc, w->buf, bytes);
+    w->lba += n;
+    w->sectors += n;
+    memmove(w->buf, w->buf + bytes, w->len - bytes);
+    w->len -= bytes;
+    return true;
+}
+
+/**
+ * @brief Write the page map, the records and then the header
+ *
+ * Runs with interrupts off between hibernate_save() and the return to
+ * the shell, so the pages it reads are the ones the snapshot resumes
+ * with; only its own stack frame and counters move meanwhile.
+ *
+ * @param block  The 2MB buffer block (identity mapped, not saved)
+ */
+static bool write_image(uint8_t *block, image_header_t *h) {
+    uint64_t start = rdtsc();
+    uint64_t block_phys = (uint64_t)(uintptr_t)block;
+    uint64_t *map = (uint64_t *)(block + BLOCK_MAP);
+
+    memset(map, 0, h->map_sectors * ATA_SECTOR_SIZE);
+    for (uint64_t f = 0; f < h->frames; f++) {
+        if (frame_saved(f * PMM_FRAME_SIZE, block_phys)) {
+            bitmap_set(map, f);
+            h->pages++;
+        }
+    }
+    if (!ata_write(HIBERNATE_LBA + 1, (uint32_t)h->map_sectors, map)) {
+        return false;
+    }
+
+    image_writer_t w = {
+        .buf = block + BLOCK_OUT,
+        .cap = BLOCK_SIZE - BLOCK_OUT,
+        .lba = HIBERNATE_LBA + 1 + h->map_sectors,
+    };
+    for (size_t f = bitmap_find_next_set(map, h->frames, 0); f < h->frames;
+         f = bitmap_find_next_set(map, h->frames, f + 1)) {
+        const void *page = (const void *)(uintptr_t)(f * PMM_FRAME_SIZE);
+
+        if (w.cap - w.len < REC_HEADER + PMM_FRAME_SIZE && !writer_flush(&w, false)) {
+            return false;
+        }
+        uint8_t *rec = w.buf + w.len;
+        size_t len;
+        if (page_is_zero(page)) {
+            len = REC_ZERO;
+            h->zero_pages++;
+        } else {
+            /* Anything LZ4 cannot get below a page is stored as is */
+            len = lz4_compress(page, PMM_FRAME_SIZE, rec + REC_HEADER, PMM_FRAME_SIZE - 1,
+                               block + BLOCK_WORK);
+            if (len == 0) {
+                memcpy(rec + REC_HEADER, page, PMM_FRAME_SIZE);
+                len = REC_RAW;
+                h->raw_pages++;
+            }
+        }
+        rec[0] = (uint8_t)len;
+        rec[1] = (uint8_t)(len >> 8);
+        w.len += REC_HEADER + len;
+    }
+    if (!writer_flush(&w, true)) {
+        return false;
+    }
+
+    h->data_sectors = w.sectors;
+    h->data_crc = w.crc;
+    h->save_ns = tsc_cycles_to_ns(rdtsc() - start);
+    h->header_crc = header_checksum(h);
+    return header_write(h);
+}
+
+/**
+ * @brief Second half of hibernate_snapshot() in the resumed kernel
+ *
+ * @param report    What the booting kernel measured
+ * @param resumed   TSC on return from hibernate_save()
+ */
+static void finish_resume(const resume_report_t *report, uint64_t resumed) {
+    resume_report_t r = *report;    /* Its frame is free from now on */
+
+    irq_resume();
+    virtio_console_resume();
+    metrics_serve_resume();
+    vga_refresh();
+
+    uint64_t ready = rdtsc();
+    initcall_summary_t cold;
+    initcall_get_summary(&cold);
+
+    resume_stats.pages = r.pages;
+    resume_stats.direct_pages = r.direct_pages;
+    resume_stats.staged_pages = r.staged_pages;
+    resume_stats.image_bytes = r.image_bytes;
+    resume_stats.boot_ns = tsc_cycles_to_ns(r.found_tsc);
+    resume_stats.load_ns = tsc_cycles_to_ns(r.loaded_tsc - r.found_tsc);
+    resume_stats.copy_ns = tsc_cycles_to_ns(resumed - r.jump_tsc);
+    resume_stats.devices_ns = tsc_cycles_to_ns(ready - resumed);
+    resume_stats.total_ns = tsc_cycles_to_ns(ready);
+    resume_stats.cold_ns = cold.ready_ns;
+    have_resume_stats = true;
+
+    /* The snapshot may have been written in the middle of its own counters */
+    save_stats.pages = r.pages;
+    save_stats.zero_pages = r.zero_pages;
+    save_stats.raw_pages = r.raw_pages;
+    save_stats.image_bytes = r.image_bytes;
+    save_stats.save_ns = r.save_ns;
+    have_save_stats = true;
+
+    /* Timestamps taken before the snapshot stay in the past */
+    write_msr(MSR_TSC, snapshot_tsc);
+}
+
+/* ============================================================================
+ * Resume
+ * ============================================================================ */
+
+/**
+ * @brief Make at least need bytes of records available at r->pos
+ */
+static bool reader_fill(image_reader_t *r, size_t need) {
+    if (r->len - r->pos >= need) {
+        return true;
+    }
+    memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+    r->len -= r->pos;
+    r->pos = 0;
+
+    uint64_t n = (READ_BUF_SIZE - r->len) / ATA_SECTOR_SIZE;
+    if (n > r->left) {
+        n = r->left;
+    }
+    if (n > 0) {
+        if (!ata_read(r->lba, (uint32_t)n, r->buf + r->len)) {
+            return false;
+        }
+        r->crc = crc32c(r->crc, r->buf + r->len, n * ATA_SECTOR_SIZE);
+        r->lba += n;
+        r->left -= n;
+        r->len += n * ATA_SECTOR_SIZE;
+    }
+    return r->len - r->pos >= need;
+}
+
+/**
+ * @brief Queue a page for the final copy (src 0 zero-fills dst)
+ */
+static bool copy_add(uint64_t dst, uint64_t src) {
+    if (!copy_tail || copy_tail->count == PAIRS_PER_PAGE) {
+        uint64_t phys = pmm_alloc();
+        if (!phys) {
+            return false;
+        }
+        copy_page_t *page = (copy_page_t *)(uintptr_t)phys;
+        page->next = 0;
+        page->count = 0;
+        if (copy_tail) {
+            copy_tail->next = phys;
+        } else {
+            copy_head = phys;
+        }
+        copy_tail = page;
+    }
+    copy_tail->pairs[copy_tail->count].dst = dst;
+    copy_tail->pairs[copy_tail->count].src = src;
+    copy_tail->count++;
+    return true;
+}
+
+/**
+ * @brief Free the staged pages and the copy list
+ */
+static void copy_discard(void) {
+    uint64_t phys = copy_head;
+    while (phys) {
+        copy_page_t *page = (copy_page_t *)(uintptr_t)phys;
+        uint64_t next = page->next;
+        for (uint64_t i = 0; i < page->count; i++) {
+            if (page->pairs[i].src) {
+                pmm_free(page->pairs[i].src);
+            }
+        }
+        pmm_free(phys);
+        phys = next;
+    }
+    copy_head = 0;
+    copy_tail = NULL;
+}
+
+/**
+ * @brief Read every record into its frame or a staging frame
+ *
+ * @param map     Page map of the image
+ * @param direct  Frames claimed for the image (decompressed in place)
+ */
+static bool load_records(const image_header_t *h, const uint64_t *map, const uint64_t *direct,
+                         image_reader_t *r, resume_report_t *report) {
+    for (size_t f = bitmap_find_next_set(map, h->frames, 0); f < h->frames;
+         f = bitmap_find_next_set(map, h->frames, f + 1)) {
+        uint64_t dst = f * PMM_FRAME_SIZE;
+        bool in_place = bitmap_test(direct, f);
+
+        if (!reader_fill(r, REC_HEADER)) {
+            return false;
+        }
+        size_t len = r->buf[r->pos] | (size_t)r->buf[r->pos + 1] << 8;
+        r->pos += REC_HEADER;
+        if (len > REC_RAW || !reader_fill(r, len)) {
+            return false;
+        }
+
+        if (len == REC_ZERO && !in_place) {
+            if (!copy_add(dst, 0)) {
+                return false;
+            }
+            report->staged_pages++;
+            continue;
+        }
+
+        uint64_t frame = dst;
+        if (!in_place) {
+            frame = pmm_alloc();
+            if (!frame) {
+                return false;
+            }
+            if (!copy_add(dst, frame)) {
+                pmm_free(frame);
+                return false;
+            }
+            report->staged_pages++;
+        } else {
+            report->direct_pages++;
+        }
+
+        void *out = (void *)(uintptr_t)frame;
+        if (len == REC_ZERO) {
+            memset(out, 0, PMM_FRAME_SIZE);
+        } else if (len == REC_RAW) {
+            memcpy(out, r->buf + r->pos, PMM_FRAME_SIZE);
+        } else if (lz4_decompress(r->buf + r->pos, len, out, PMM_FRAME_SIZE) !=
+                   (int)PMM_FRAME_SIZE) {
+            return false;
+        }
+        r->pos += len;
+        report->pages++;
+    }
+    return r->left == 0 && r->crc == h->data_crc;
+}
+
+/**
+ * @brief Identity map of the first 1GB in three frames outside the image
+ *
+ * @return The PML4, or 0 if frames ran out
+ */
+static uint64_t build_page_tables(void) {
+    uint64_t pml4 = pmm_alloc_zeroed();
+    uint64_t pdpt = pmm_alloc_zeroed();
+    uint64_t pd = pmm_alloc_zeroed();
+    if (!pml4 || !pdpt || !pd) {
+        if (pml4) pmm_free(pml4);
+        if (pdpt) pmm_free(pdpt);
+        if (pd) pmm_free(pd);
+        return 0;
+    }
+    ((uint64_t *)(uintptr_t)pml4)[0] = pdpt | PTE_TABLE;
+    ((uint64_t *)(uintptr_t)pdpt)[0] = pd | PTE_TABLE;
+    for (int i = 0; i < ENTRIES; i++) {
+        ((uint64_t *)(uintptr_t)pd)[i] = i * LARGE_PAGE_SIZE | PDE_LARGE;
+    }
+    return pml4;
+}
+
+/**
+ * @brief Load the image and jump into it
+ *
+ * Only returns if the image turns out to be unreadable or memory runs
+ * short, after giving back everything it took.
+ */
+static void resume_from(const image_header_t *h, uint64_t found) {
+    pmm_stats_t pmm;
+    pmm_get_stats(&pmm);
+
+    size_t map_bytes = h->map_sectors * ATA_SECTOR_SIZE;
+    uint64_t *map = vmalloc(map_bytes);
+    uint64_t *direct = vmalloc(map_bytes);
+    uint8_t *buf = vmalloc(READ_BUF_SIZE);
+    resume_report_t report = {.found_tsc = found};
+    uint64_t report_phys = 0;
+    const char *error = "out of memory";
+
+    if (!map || !direct || !buf) {
+        goto out;
+    }
+    if (!ata_read(HIBERNATE_LBA + 1, (uint32_t)h->map_sectors, map)) {
+        error = "page map unreadable";
+        goto out;
+    }
+
+    /*
+     * Free frames the image needs are taken now, before anything below
+     * allocates, so the staging frames are never image frames.
+     */
+    memset(direct, 0, map_bytes);
+    for (size_t f = bitmap_find_next_set(map, h->frames, pmm.base / PMM_FRAME_SIZE);
+         f < h->frames; f = bitmap_find_next_set(map, h->frames, f + 1)) {
+        if (pmm_claim(f * PMM_FRAME_SIZE)) {
+            bitmap_set(direct, f);
+        }
+    }
+
+    image_reader_t r = {
+        .buf = buf,
+        .lba = HIBERNATE_LBA + 1 + h->map_sectors,
+        .left = h->data_sectors,
+    };
+    if (!load_records(h, map, direct, &r, &report)) {
+        error = "image data corrupt or unreadable";
+        goto out;
+    }
+    report.loaded_tsc = rdtsc();
+
+    report_phys = pmm_alloc();
+    uint64_t cr3 = build_page_tables();
+    if (!report_phys || !cr3) {
+        goto out;
+    }
+    report.image_bytes = image_bytes(h);
+    report.zero_pages = h->zero_pages;
+    report.raw_pages = h->raw_pages;
+    report.save_ns = h->save_ns;
+    report.jump_tsc = rdtsc();
+    memcpy((void *)(uintptr_t)report_phys, &report, sizeof(report));
+
+    hibernate_restore(copy_head, cr3, report_phys);
+
+out:
+    kprintf("hibernate: not resuming: %s\n", error);
+    if (report_phys) {
+        pmm_free(report_phys);
+    }
+    copy_discard();
+    if (direct) {
+        for (size_t f = bitmap_find_next_set(direct, h->frames, 0); f < h->frames;
+             f = bitmap_find_next_set(direct, h->frames, f + 1)) {
+            pmm_free(f * PMM_FRAME_SIZE);
+        }
+    }
+    vfree(buf);
+    vfree(direct);
+    vfree(map);
+}
+
+/**
+ * @brief Resume from the image on disk, if there is one for this kernel
+ *
+ * Runs once the devices the snapshot set up at its own boot are up;
+ * returns only when booting on cold.
+ */
+static bool resume_initcall(void) {
+    image_header_t h;
+
+    if (!ata_present() || !header_read(&h)) {
+        return false;
+    }
+    uint64_t found = rdtsc();
+    if (!header_valid(&h)) {
+        return true;                /* No image: cold boot */
+    }
+    const char *why = header_mismatch(&h);
+    if (why) {
+        kprintf("hibernate: ignoring image: %s\n", why);
+        return true;
+    }
+    resume_from(&h, found);
+    return false;
+}
+DEFINE_INITCALL(resume, resume_initcall, "tsc ata vmalloc pit keyboard console", 0);
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+hibernate_result_t hibernate_snapshot(void) {
+    pmm_stats_t pmm;
+    pmm_get_stats(&pmm);
+
+    if (!ata_present()) {
+        kprintf("hibernate: no disk\n");
+        return HIBERNATE_FAILED;
+    }
+    uint64_t frames = pmm.mem_top / PMM_FRAME_SIZE;
+    uint64_t sectors = map_sectors(frames);
+    /* Worst case: every frame saved raw */
+    uint64_t worst = 1 + sectors +
+                     (frames * (REC_HEADER + PMM_FRAME_SIZE) + ATA_SECTOR_SIZE - 1) /
+                     ATA_SECTOR_SIZE;
+    if (HIBERNATE_LBA + worst > ata_sectors()) {
+        kprintf("hibernate: disk too small (%llu MB needed from LBA %u)\n",
+                worst * ATA_SECTOR_SIZE >> 20, HIBERNATE_LBA);
+        return HIBERNATE_FAILED;
+    }
+    uint64_t block_phys = pmm_alloc_huge();
+    if (!block_phys) {
+        kprintf("hibernate: no free 2MB block for buffers\n");
+        return HIBERNATE_FAILED;
+    }
+    uint8_t *block = (uint8_t *)(uintptr_t)block_phys;
+
+    /* A crash from here on leaves no image rather than half of one */
+    if (!header_write(NULL)) {
+        kprintf("hibernate: disk write failed\n");
+        pmm_free_huge(block_phys);
+        return HIBERNATE_FAILED;
+    }
+    kprintf("Hibernating...\n");
+
+    image_header_t h = {
+        .magic = HIBERNATE_MAGIC,
+        .version = HIBERNATE_VERSION,
+        .kernel_crc = kernel_checksum(),
+        .kernel_end = (uint64_t)(uintptr_t)__kernel_end,
+        .mem_top = pmm.mem_top,
+        .frames = frames,
+        .map_sectors = sectors,
+    };
+    uint64_t flags = irq_save();
+    snapshot_tsc = rdtsc();
+
+    uint64_t token = hibernate_save(&hibernate_ctx);
+    if (token) {
+        finish_resume((const resume_report_t *)(uintptr_t)token, rdtsc());
+        irq_restore(flags);
+        pmm_free_huge(block_phys);
+        return HIBERNATE_RESUMED;
+    }
+
+    bool ok = write_image(block, &h);
+    irq_restore(flags);
+    pmm_free_huge(block_phys);
+    if (!ok) {
+        kprintf("hibernate: disk write failed\n");
+        return HIBERNATE_FAILED;
+    }
+
+    save_stats.pages = h.pages;
+    save_stats.zero_pages = h.zero_pages;
+    save_stats.raw_pages = h.raw_pages;
+    save_stats.image_bytes = image_bytes(&h);
+    save_stats.save_ns = h.save_ns;
+    have_save_stats = true;
+    return HIBERNATE_SAVED;
+}
+
+bool hibernate_image_info(hibernate_image_t *out) {
+    image_header_t h;
+
+    memset(out, 0, sizeof(*out));
+    if (!ata_present() || !header_read(&h)) {
+        return false;
+    }
+    out->valid = header_valid(&h);
+    if (out->valid) {
+        out->usable = header_mismatch(&h) == NULL;
+        out->pages = h.pages;
+        out->image_bytes = image_bytes(&h);
+        out->mem_top = h.mem_top;
+    }
+    return true;
+}
+
+bool hibernate_discard(void) {
+    return ata_present() && header_write(NULL);
+}
+
+bool hibernate_get_save_stats(hibernate_save_stats_t *out) {
+    if (!have_save_stats) {
+        return false;
+    }
+    *out = save_stats;
+    return true;
+}
+
+bool hibernate_get_resume_stats(hibernate_resume_stats_t *out) {
+    if (!have_resume_stats) {
+        return false;
+    }
+    *out = resume_stats;
+    return true;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file hibernate.h
+ * @brief Hibernation to disk and resume at boot
+ *
+ * hibernate_snapshot() writes every page in use to the boot disk at
+ * HIBERNATE_LBA and lets the system carry on. From then on, every boot
+ * of the same kernel with the same amount of RAM finds the image once
+ * its devices are up and continues from the snapshot instead of
+ * starting the shell afresh: caches, loaded modules, consoles and
+ * counters are as they were. The image stays until it is discarded or
+ * replaced, so one snapshot can start any number of short-lived VMs.
+ *
+ * IMAGE (sectors from HIBERNATE_LBA):
+ *   0          Header: magic, checksums of the kernel and the data, RAM
+ *              size, page counts. Written last, and zeroed first, so a
+ *              half-written image is never taken for a whole one.
+ *   1..        Page map: one bit per 4KB frame up to the end of RAM
+ *   then       One record per page in the map, in frame order: a 16-bit
+ *              length and that many bytes of LZ4 block. Length 0 is a
+ *              page of zeros, 4096 a page LZ4 could not shrink.
+ *
+ * WHAT IS SAVED:
+ *   Frames the allocator hands out, and everything below its first
+ *   frame (BIOS data, page tables, stack, kernel image) except the
+ *   legacy video and ROM hole at 640KB-1MB. Free frames are not saved.
+ *   Interrupts are off while pages are read, and nothing the resumed
+ *   kernel relies on changes meanwhile: the snapshot resumes in
+ *   hibernate_save() (cpu/resume.asm), which works like setjmp.
+ *
+ * RESUME:
+ *   The resume initcall runs after the interrupt controller, timer,
+ *   keyboard and consoles are up, so the hardware is in the state the
+ *   hibernated kernel left it in when it booted. Pages whose frame is
+ *   free in the booting kernel are decompressed straight into place;
+ *   the others (its own image, stack, page tables and allocations) are
+ *   staged in frames the image does not use. resume.asm then copies the
+ *   staged pages over the running kernel and jumps into the snapshot,
+ *   which sets up again what the booting kernel left differently (PIC
+ *   mask, virtio rings, COM2, the screen), puts the TSC back to its
+ *   value at the snapshot and returns from hibernate_snapshot().
+ *
+ * TIMING:
+ *   Both ends measure from power-on (the TSC starts at reset), so the
+ *   resume-to-prompt time and the snapshotted kernel's own cold boot
+ *   (initcall_summary_t.ready_ns) include firmware and loaders alike.
+ *
+ * LIMITS:
+ *   One CPU only. The image is only accepted by the kernel build that
+ *   wrote it (checksum of .text and .rodata) with the same RAM size.
+ *   Devices without a resume step keep the state the booting kernel
+ *   gave them.
+ */
+
+#ifndef _CORE_HIBERNATE_H
+#define _CORE_HIBERNATE_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Outcome of hibernate_snapshot()
+ */
+typedef enum {
+    HIBERNATE_FAILED = 0,       /**< No image written (errors printed) */
+    HIBERNATE_SAVED,            /**< Image written; running on */
+    HIBERNATE_RESUMED           /**< Returning a second time, in a new boot */
+} hibernate_result_t;
+
+/**
+ * @brief Figures of the last snapshot written by this kernel
+ */
+typedef struct {
+    uint64_t pages;             /**< Pages in the image */
+    uint64_t zero_pages;        /**< Of them all zeros (no data stored) */
+    uint64_t raw_pages;         /**< Of them stored uncompressed */
+    uint64_t image_bytes;       /**< On disk, header and page map included */
+    uint64_t save_ns;           /**< Reading, compressing and writing */
+} hibernate_save_stats_t;
+
+/**
+ * @brief Figures of the resume that started this kernel
+ */
+typedef struct {
+    uint64_t pages;             /**< Pages restored */
+    uint64_t direct_pages;      /**< Decompressed straight into their frame */
+    uint64_t staged_pages;      /**< Copied over the booting kernel at the end */
+    uint64_t image_bytes;       /**< Read from disk */
+    uint64_t boot_ns;           /**< Power-on until the image was found */
+    uint64_t load_ns;           /**< Reading and decompressing */
+    uint64_t copy_ns;           /**< Final copy and jump */
+    uint64_t devices_ns;        /**< Resume steps of the restored kernel */
+    uint64_t total_ns;          /**< Power-on to prompt */
+    uint64_t cold_ns;           /**< Power-on to prompt of the cold boot the
+                                     snapshot descends from */
+} hibernate_resume_stats_t;
+
+/**
+ * @brief An image found on disk
+ */
+typedef struct {
+    bool valid;                 /**< Header and magic are intact */
+    bool usable;                /**< Written by this kernel, same RAM size */
+    uint64_t pages;
+    uint64_t image_bytes;
+    uint64_t mem_top;           /**< End of RAM of the kernel that wrote it */
+} hibernate_image_t;
+
+/**
+ * @brief Write a snapshot of memory to the boot disk
+ *
+ * Returns once the image is written (HIBERNATE_SAVED), and once more
+ * in every boot that resumes from it (HIBERNATE_RESUMED).
+ *
+ * @note Needs a free 2MB block for its buffers
+ */
+hibernate_result_t hibernate_snapshot(void);
+
+/**
+ * @brief Read the header of the image on disk
+ *
+ * @return false without a disk
+ */
+bool hibernate_image_info(hibernate_image_t *out);
+
+/**
+ * @brief Invalidate the image, so the next boot starts cold
+ *
+ * @return false if the disk could not be written
+ */
+bool hibernate_discard(void);
+
+/**
+ * @brief Figures of the last snapshot
+ *
+ * @return false if this kernel has not written one
+ */
+bool hibernate_get_save_stats(hibernate_save_stats_t *out);
+
+/**
+ * @brief Figures of the resume that started this kernel
+ *
+ * @return false after a cold boot
+ */
+bool hibernate_get_resume_stats(hibernate_resume_stats_t *out);
+
+#endif /* _CORE_HIBERNATE_H */
@@ -0,0 +1,350 @@
+/**
+ * @file initcall.c
+ * @brief Dependency-ordered subsystem initialization implementation
+ */
+
+#include "initcall.h"
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <core/cpustat.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <lib/printf/printf.h>
+
+/* Linker script symbols: the registry */
+extern const initcall_t __initcalls_start[];
+extern const initcall_t __initcalls_end[];
+
+/** @brief Longest dependency name */
+#define NAME_MAX            32
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/**
+ * @brief Sequencer state of one initcall (same index as the registry)
+ */
+typedef struct {
+    int8_t deps[INITCALL_MAX_DEPS];
+    int ndeps;
+    int parent;             /**< Dependency that finished last, or -1 */
+    uint8_t status;         /**< initcall_status_t */
+    bool async;             /**< Left to the idle loop */
+    uint64_t start;         /**< TSC */
+    uint64_t end;
+    uint64_t path;          /**< Critical-path finish, cycles */
+} call_state_t;
+
+static call_state_t calls[INITCALL_MAX];
+static int call_count = 0;
+
+/** @brief Registry indexes in the order they ran */
+static int ran[INITCALL_MAX];
+static int ran_count = 0;
+
+static uint64_t run_start = 0;
+static uint64_t run_end = 0;
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static int find(const char *name) {
+    for (int i = 0; i < call_count; i++) {
+        if (strcmp(__initcalls_start[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Turn an initcall's dependency string into registry indexes
+ */
+static void resolve(int index) {
+    const initcall_t *ic = &__initcalls_start[index];
+    call_state_t *c = &calls[index];
+    const char *p = ic->deps ? ic->deps : "";
+
+    while (*p) {
+        while (*p == ' ') {
+            p++;
+        }
+        char name[NAME_MAX];
+        size_t len = 0;
+        while (*p && *p != ' ') {
+            if (len < NAME_MAX - 1) {
+                name[len++] = *p;
+            }
+            p++;
+        }
+        name[len] = '\0';
+        if (len == 0) {
+            break;
+        }
+
+        int dep = find(name);
+        if (dep < 0 || dep == index) {
+            kprintf("initcall: %s: unknown dependency '%s'\n", ic->name, name);
+        } else if (c->ndeps == INITCALL_MAX_DEPS) {
+            kprintf("initcall: %s: more than %d dependencies\n", ic->name,
+                    INITCALL_MAX_DEPS);
+        } else {
+            c->deps[c->ndeps++] = (int8_t)dep;
+        }
+    }
+}
+
+/**
+ * @brief Run whatever a synchronous initcall needs synchronously
+ */
+static void promote_deps(void) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < call_count; i++) {
+            if (calls[i].async) {
+                continue;
+            }
+            for (int d = 0; d < calls[i].ndeps; d++) {
+                if (calls[calls[i].deps[d]].async) {
+                    calls[calls[i].deps[d]].async = false;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+static bool is_ready(int index) {
+    const call_state_t *c = &calls[index];
+    if (c->status != INITCALL_PENDING) {
+        return false;
+    }
+    for (int d = 0; d < c->ndeps; d++) {
+        if (calls[c->deps[d]].status == INITCALL_PENDING) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief First pending initcall of a kind, ready ones preferred
+ *
+ * @param ready_only  Only return a ready initcall
+ * @return Registry index, or -1
+ */
+static int next(bool async, bool ready_only) {
+    int fallback = -1;
+    for (int i = 0; i < call_count; i++) {
+        if (calls[i].async != async || calls[i].status != INITCALL_PENDING) {
+            continue;
+        }
+        if (is_ready(i)) {
+            return i;
+        }
+        if (fallback < 0) {
+            fallback = i;
+        }
+    }
+    return ready_only ? -1 : fallback;
+}
+
+static void run_one(int index) {
+    call_state_t *c = &calls[index];
+    uint64_t before = 0;
+
+    c->parent = -1;
+    for (int d = 0; d < c->ndeps; d++) {
+        const call_state_t *dep = &calls[c->deps[d]];
+        if (dep->status != INITCALL_PENDING && dep->path >= before) {
+            before = dep->path;
+            c->parent = c->deps[d];
+        }
+    }
+
+    c->start = rdtsc();
+    bool ok = __initcalls_start[index].fn();
+    c->end = rdtsc();
+
+    c->status = ok ? INITCALL_OK : INITCALL_FAILED;
+    c->path = before + (c->end - c->start);
+    ran[ran_count++] = index;
+}
+
+/**
+ * @brief Report the initcalls a dependency cycle left behind
+ */
+static void report_cycle(bool async) {
+    kprintf("initcall: dependency cycle among:");
+    for (int i = 0; i < call_count; i++) {
+        if (calls[i].async == async && calls[i].status == INITCALL_PENDING) {
+            kprintf(" %s", __initcalls_start[i].name);
+        }
+    }
+    kprintf("\n");
+}
+
+/**
+ * @brief Idle hook: start one deferred initcall
+ */
+static void run_deferred(void) {
+    int i = next(true, true);
+    if (i < 0) {
+        i = next(true, false);
+        if (i < 0) {
+            return;
+        }
+        report_cycle(true);
+    }
+    run_one(i);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void initcall_run(void) {
+    int total = (int)(__initcalls_end - __initcalls_start);
+    call_count = total > INITCALL_MAX ? INITCALL_MAX : total;
+    if (total > INITCALL_MAX) {
+        kprintf("initcall: %d initcalls, only the first %d run\n", total, INITCALL_MAX);
+    }
+
+    bool any_async = false;
+    for (int i = 0; i < call_count; i++) {
+        calls[i].async = (__initcalls_start[i].flags & INITCALL_ASYNC) != 0;
+        resolve(i);
+    }
+    promote_deps();
+    for (int i = 0; i < call_count; i++) {
+        any_async |= calls[i].async;
+    }
+
+    /* Wave by wave: everything ready now could run side by side */
+    run_start = rdtsc();
+    for (;;) {
+        int wave[INITCALL_MAX];
+        int n = 0;
+        for (int i = 0; i < call_count; i++) {
+            if (!calls[i].async && is_ready(i)) {
+                wave[n++] = i;
+            }
+        }
+        if (n == 0) {
+            int i = next(false, false);
+            if (i < 0) {
+                break;
+            }
+            report_cycle(false);
+            wave[n++] = i;
+        }
+        for (int k = 0; k < n; k++) {
+            run_one(wave[k]);
+        }
+    }
+    run_end = rdtsc();
+
+    if (any_async && !cpu_idle_add_hook(run_deferred)) {
+        /* No idle hook slot: nothing would ever start them */
+        while (next(true, false) >= 0) {
+            run_deferred();
+        }
+    }
+}
+
+int initcall_count(void) {
+    return call_count;
+}
+
+bool initcall_get(int index, initcall_info_t *out) {
+    if (index < 0 || index >= call_count) {
+        return false;
+    }
+
+    /* Pending ones follow the ones that ran, in registry order */
+    int i = -1;
+    if (index < ran_count) {
+        i = ran[index];
+    } else {
+        int skip = index - ran_count;
+        for (int j = 0; j < call_count; j++) {
+            if (calls[j].status == INITCALL_PENDING && skip-- == 0) {
+                i = j;
+                break;
+            }
+        }
+        if (i < 0) {
+            return false;
+        }
+    }
+
+    /* Walk back from the synchronous initcall that finished last */
+    int last = -1;
+    for (int j = 0; j < call_count; j++) {
+        if (!calls[j].async && calls[j].status != INITCALL_PENDING &&
+            (last < 0 || calls[j].path > calls[last].path)) {
+            last = j;
+        }
+    }
+    bool critical = false;
+    for (int j = last; j >= 0; j = calls[j].parent) {
+        if (j == i) {
+            critical = true;
+            break;
+        }
+    }
+
+    const initcall_t *ic = &__initcalls_start[i];
+    const call_state_t *c = &calls[i];
+    out->name = ic->name;
+    out->deps = ic->deps ? ic->deps : "";
+    out->status = (initcall_status_t)c->status;
+    out->deferred = c->async;
+    out->critical = critical;
+    if (c->status == INITCALL_PENDING) {
+        out->start_ns = out->time_ns = out->path_ns = 0;
+    } else {
+        out->start_ns = tsc_cycles_to_ns(c->start - run_start);
+        out->time_ns = tsc_cycles_to_ns(c->end - c->start);
+        out->path_ns = tsc_cycles_to_ns(c->path);
+    }
+    return true;
+}
+
+void initcall_get_summary(initcall_summary_t *out) {
+    uint64_t serial = 0, critical = 0, deferred = 0;
+
+    memset(out, 0, sizeof(*out));
+    out->count = call_count;
+    for (int i = 0; i < call_count; i++) {
+        const call_state_t *c = &calls[i];
+        uint64_t spent = c->end - c->start;
+        if (c->async) {
+            out->deferred++;
+        }
+        if (c->status == INITCALL_PENDING) {
+            out->pending++;
+            continue;
+        }
+        if (c->status == INITCALL_FAILED) {
+            out->failed++;
+        }
+        if (c->async) {
+            deferred += spent;
+        } else {
+            serial += spent;
+            if (c->path > critical) {
+                critical = c->path;
+            }
+        }
+    }
+
+    out->serial_ns = tsc_cycles_to_ns(serial);
+    out->critical_ns = tsc_cycles_to_ns(critical);
+    out->wall_ns = tsc_cycles_to_ns(run_end - run_start);
+    out->ready_ns = tsc_cycles_to_ns(run_end);
+    out->deferred_ns = tsc_cycles_to_ns(deferred);
+}
@@ -0,0 +1,170 @@
+/**
+ * @file initcall.h
+ * @brief Dependency-ordered subsystem initialization
+ *
+ * Subsystems declare their init function with DEFINE_INITCALL() and
+ * name what must be up before it runs; initcall_run() works out the
+ * order. Like the stat and metric registries, descriptors live in a
+ * linker section (.initcalls, __initcalls_start .. __initcalls_end), so
+ * adding a driver never means editing kmain().
+ *
+ * ORDERING:
+ *   Dependencies are a space-separated list of other initcall names. An
+ *   initcall becomes ready once every dependency has finished. The
+ *   sequencer runs in waves: every initcall ready at the start of a wave
+ *   runs in it, in registry order, which need not be the order of the
+ *   definitions in a file, so anything that must come first has to be a
+ *   dependency. Dependencies only order: a function returning false
+ *   (device absent, probe failed) is recorded as such and its dependents
+ *   still run. An unknown name is reported and ignored; initcalls left
+ *   in a cycle are reported and then run one at a time, so a bad
+ *   declaration never stops the boot.
+ *
+ * ASYNCHRONOUS INITCALLS:
+ *   INITCALL_ASYNC marks work nothing at the prompt waits for (scanners,
+ *   network services). initcall_run() leaves it to an idle hook, which
+ *   starts one ready asynchronous initcall per pass through cpu_idle()
+ *   once the shell is waiting for input. An asynchronous initcall that a
+ *   synchronous one depends on is run synchronously instead.
+ *
+ * CONCURRENCY:
+ *   The initcalls of a wave are independent of each other, but only the
+ *   boot CPU is started, so they run one after the other. The timeline
+ *   still records what parallel bring-up would buy: each initcall's
+ *   critical-path finish is its own time plus the latest finish among
+ *   its dependencies, and the largest one is the boot time with
+ *   unlimited CPUs. Compare it with the serial total to see how much
+ *   starting the other CPUs early would save.
+ *
+ * @example
+ *   static bool ata_initcall(void) { return ata_init(); }
+ *   DEFINE_INITCALL(ata, ata_initcall, "tsc irq", INITCALL_ASYNC);
+ */
+
+#ifndef _CORE_INITCALL_H
+#define _CORE_INITCALL_H
+
+#include <squirel/types.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/** @brief Largest number of initcalls the sequencer tracks */
+#define INITCALL_MAX        64
+
+/** @brief Largest number of dependencies per initcall */
+#define INITCALL_MAX_DEPS   8
+
+/** @brief Run from the idle loop once the shell is up */
+#define INITCALL_ASYNC      (1u << 0)
+
+/* ============================================================================
+ * Types
+ * ============================================================================ */
+
+/**
+ * @brief Init function: false if the subsystem is absent or failed
+ */
+typedef bool (*initcall_fn_t)(void);
+
+/**
+ * @brief Registry entry emitted by DEFINE_INITCALL (one per initcall)
+ *
+ * Sized and aligned to 32 bytes so the .initcalls section is a plain
+ * array.
+ */
+typedef struct {
+    const char *name;       /**< Name other initcalls depend on */
+    initcall_fn_t fn;
+    const char *deps;       /**< Space-separated names ("" for none) */
+    uint32_t flags;         /**< INITCALL_* */
+    uint32_t reserved;
+} ALIGNED(32) initcall_t;
+
+/**
+ * @brief Where an initcall is
+ */
+typedef enum {
+    INITCALL_PENDING = 0,   /**< Not run yet (deferred ones until idle) */
+    INITCALL_OK,
+    INITCALL_FAILED         /**< Returned false */
+} initcall_status_t;
+
+/**
+ * @brief One line of the boot timeline
+ */
+typedef struct {
+    const char *name;
+    const char *deps;
+    initcall_status_t status;
+    bool deferred;          /**< Ran from the idle loop */
+    bool critical;          /**< On the boot critical path */
+    uint64_t start_ns;      /**< After initcall_run() started */
+    uint64_t time_ns;       /**< Time spent in the function */
+    uint64_t path_ns;       /**< Critical-path finish (see CONCURRENCY) */
+} initcall_info_t;
+
+/**
+ * @brief Whole-boot figures
+ */
+typedef struct {
+    int count;              /**< Initcalls in the registry */
+    int deferred;           /**< Of them left to the idle loop */
+    int pending;            /**< Deferred ones not run yet */
+    int failed;
+    uint64_t serial_ns;     /**< Sum of synchronous initcall times */
+    uint64_t critical_ns;   /**< Longest synchronous dependency chain */
+    uint64_t wall_ns;       /**< initcall_run() start to shell */
+    uint64_t ready_ns;      /**< Power-on to shell (the TSC starts at reset,
+                                 so firmware and loaders are included) */
+    uint64_t deferred_ns;   /**< Sum of deferred initcall times so far */
+} initcall_summary_t;
+
+/* ============================================================================
+ * Definition Macro
+ * ============================================================================ */
+
+/**
+ * @brief Register an init function
+ *
+ * @param id     C identifier, also the name dependents use
+ * @param fn     bool fn(void)
+ * @param deps   Space-separated names of initcalls to run first
+ * @param flags  0 or INITCALL_ASYNC
+ */
+#define DEFINE_INITCALL(id, fn, deps, flags)                                \
+    static const initcall_t initcall_desc_##id                              \
+        __attribute__((section(".initcalls"), used)) =                      \
+        { #id, fn, deps, flags, 0 }
+
+/* ============================================================================
+ * Functions
+ * ============================================================================ */
+
+/**
+ * @brief Run every synchronous initcall, and defer the asynchronous ones
+ *
+ * @note Call once, after the console is up (errors are printed)
+ */
+void initcall_run(void);
+
+/**
+ * @brief Number of initcalls in the registry
+ */
+int initcall_count(void);
+
+/**
+ * @brief Get a timeline entry, in the order the initcalls started
+ *        (pending ones last)
+ *
+ * @return false if index is out of range
+ */
+bool initcall_get(int index, initcall_info_t *out);
+
+/**
+ * @brief Get the boot totals
+ */
+void initcall_get_summary(initcall_summary_t *out);
+
+#endif /* _CORE_INITCALL_H */
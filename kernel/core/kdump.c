@@ -0,0 +1,452 @@
+/**
+ * @file kdump.c
+ * @brief Crash dump implementation
+ */
+
+#include "kdump.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <arch/x86_64/mm/paging.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <drivers/ata/ata.h>
+#include <drivers/console/console.h>
+#include <drivers/serial/serial.h>
+#include <drivers/virtio/virtio_console.h>
+#include <lib/checksum/checksum.h>
+#include <lib/lz4/lz4.h>
+#include <lib/memory/memory.h>
+#include <lib/string/string.h>
+#include <lib/printf/printf.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/* Legacy video memory and option ROMs: never dumped */
+#define HOLE_START          0xA0000ull
+#define HOLE_END            0x100000ull
+
+#define MSR_FS_BASE         0xC0000100
+#define MSR_GS_BASE         0xC0000101
+
+/** @brief Sectors collected before a disk write */
+#define DISK_BUF_SIZE       (64 * 1024)
+
+/** @brief Dump bytes per base64 line on the serial sink (76 characters) */
+#define B64_LINE_BYTES      57
+
+#define SERIAL_BEGIN        "\n-----BEGIN SQUIREL KDUMP-----\n"
+#define SERIAL_END          "-----END SQUIREL KDUMP-----\n"
+
+/* ============================================================================
+ * Types
+ * ============================================================================ */
+
+/**
+ * @brief A place dumps can go
+ */
+typedef struct {
+    const char *name;
+    bool (*available)(void);
+    bool (*begin)(void);
+    bool (*write)(const void *buf, size_t len);
+    bool (*end)(void);
+    bool memory;                /**< Memory pages under KDUMP_MEMORY_AUTO */
+} kdump_sink_ops_t;
+
+/* ============================================================================
+ * Sinks
+ * ============================================================================ */
+
+static bool virtio_available(void) {
+    return virtio_console_port_ready(VIRTIO_CONSOLE_PORT_TRACE);
+}
+
+static bool virtio_begin(void) {
+    return true;
+}
+
+static bool virtio_write(const void *buf, size_t len) {
+    return virtio_console_write(VIRTIO_CONSOLE_PORT_TRACE, buf, len) == len;
+}
+
+static bool virtio_end(void) {
+    return virtio_console_drain(VIRTIO_CONSOLE_PORT_TRACE);
+}
+
+static uint8_t disk_buf[DISK_BUF_SIZE] ALIGNED(8);
+static size_t disk_len;
+static uint64_t disk_lba;
+
+/** @brief First sector of the dump (the header), written last */
+static uint8_t disk_first[ATA_SECTOR_SIZE] ALIGNED(8);
+
+static bool disk_available(void) {
+    return ata_present() && ata_sectors() > KDUMP_LBA;
+}
+
+static bool disk_begin(void) {
+    disk_len = 0;
+    disk_lba = KDUMP_LBA;
+    memset(disk_first, 0, sizeof(disk_first));
+    /* Until the header goes in at the end, the disk holds no dump */
+    return ata_write(KDUMP_LBA, 1, disk_first);
+}
+
+static bool disk_flush(void) {
+    size_t n = disk_len / ATA_SECTOR_SIZE;
+    size_t bytes = n * ATA_SECTOR_SIZE;
+    if (n == 0) {
+        return true;
+    }
+    if (disk_lba == KDUMP_LBA) {
+        memcpy(disk_first, disk_buf, ATA_SECTOR_SIZE);
+        memset(disk_buf, 0, ATA_SECTOR_SIZE);
+    }
+    if (!ata_write(disk_lba, (uint32_t)n, disk_buf)) {
+        return false;
+    }
+    disk_lba += n;
+    memmove(disk_buf, disk_buf + bytes, disk_len - bytes);
+    disk_len -= bytes;
+    return true;
+}
+
+static bool disk_write(const void *buf, size_t len) {
+    const uint8_t *src = buf;
+    while (len > 0) {
+        size_t n = DISK_BUF_SIZE - disk_len < len ? DISK_BUF_SIZE - disk_len : len;
+        memcpy(disk_buf + disk_len, src, n);
+        disk_len += n;
+        src += n;
+        len -= n;
+        if (disk_len == DISK_BUF_SIZE && !disk_flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool disk_end(void) {
+    if (disk_len % ATA_SECTOR_SIZE) {
+        size_t pad = ATA_SECTOR_SIZE - disk_len % ATA_SECTOR_SIZE;
+        memset(disk_buf + disk_len, 0, pad);
+        disk_len += pad;
+    }
+    return disk_flush() && ata_write(KDUMP_LBA, 1, disk_first) && ata_flush();
+}
+
+static const char b64_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static uint8_t b64_buf[B64_LINE_BYTES];
+static size_t b64_len;
+
+static void b64_line(void) {
+    char line[B64_LINE_BYTES / 3 * 4 + 1];
+    size_t o = 0;
+
+    for (size_t i = 0; i < b64_len; i += 3) {
+        uint32_t v = (uint32_t)b64_buf[i] << 16;
+        v |= i + 1 < b64_len ? (uint32_t)b64_buf[i + 1] << 8 : 0;
+        v |= i + 2 < b64_len ? b64_buf[i + 2] : 0;
+        line[o++] = b64_digits[v >> 18 & 63];
+        line[o++] = b64_digits[v >> 12 & 63];
+        line[o++] = i + 1 < b64_len ? b64_digits[v >> 6 & 63] : '=';
+        line[o++] = i + 2 < b64_len ? b64_digits[v & 63] : '=';
+    }
+    line[o++] = '\n';
+    serial_write(line, o);
+    b64_len = 0;
+}
+
+static bool serial_available(void) {
+    return true;
+}
+
+static bool serial_begin(void) {
+    b64_len = 0;
+    serial_write(SERIAL_BEGIN, sizeof(SERIAL_BEGIN) - 1);
+    return true;
+}
+
+static bool serial_dump_write(const void *buf, size_t len) {
+    const uint8_t *src = buf;
+    for (size_t i = 0; i < len; i++) {
+        b64_buf[b64_len++] = src[i];
+        if (b64_len == B64_LINE_BYTES) {
+            b64_line();
+        }
+    }
+    return true;
+}
+
+static bool serial_end(void) {
+    if (b64_len > 0) {
+        b64_line();
+    }
+    serial_write(SERIAL_END, sizeof(SERIAL_END) - 1);
+    return true;
+}
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static const kdump_sink_ops_t sinks[KDUMP_SINK_COUNT] = {
+    [KDUMP_SINK_AUTO]   = { "auto",   NULL, NULL, NULL, NULL, false },
+    [KDUMP_SINK_VIRTIO] = { "virtio", virtio_available, virtio_begin, virtio_write,
+                            virtio_end, true },
+    [KDUMP_SINK_DISK]   = { "disk",   disk_available, disk_begin, disk_write, disk_end, true },
+    [KDUMP_SINK_SERIAL] = { "serial", serial_available, serial_begin, serial_dump_write,
+                            serial_end, false },
+    [KDUMP_SINK_NONE]   = { "none",   NULL, NULL, NULL, NULL, false },
+};
+
+static kdump_sink_t sink_setting = KDUMP_SINK_AUTO;
+static kdump_memory_t memory_setting = KDUMP_MEMORY_AUTO;
+
+/** @brief Set while a dump is written: a fault meanwhile does not start another */
+static volatile bool dumping = false;
+
+/* Stream being written */
+static const kdump_sink_ops_t *out;
+static bool out_ok;
+static uint32_t out_crc;
+static uint64_t out_bytes;
+static uint64_t out_pages;
+
+/* Dump contents; static, as the crash may be a stack overflow */
+static uint8_t lz4_work[LZ4_WORK_SIZE];
+static uint8_t page_buf[PMM_FRAME_SIZE];
+static char log_copy[CONSOLE_LOG_SIZE];
+static vm_area_t areas[VMALLOC_MAX_AREAS];
+static uint8_t sector[ATA_SECTOR_SIZE] ALIGNED(8);
+
+/* ============================================================================
+ * Stream
+ * ============================================================================ */
+
+static void emit(const void *buf, size_t len) {
+    if (!out_ok || len == 0) {
+        return;
+    }
+    out_crc = crc32c(out_crc, buf, len);
+    out_bytes += len;
+    out_ok = out->write(buf, len);
+}
+
+static void emit_record(uint32_t type, uint64_t len) {
+    uint32_t rec[2] = { type, (uint32_t)len };
+    emit(rec, sizeof(rec));
+}
+
+static bool page_is_zero(const uint64_t *p) {
+    for (size_t i = 0; i < PMM_FRAME_SIZE / sizeof(uint64_t); i++) {
+        if (p[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void emit_page(uint64_t addr) {
+    const void *page = (const void *)(uintptr_t)addr;
+    const void *data = page_buf;
+    size_t len = 0;
+
+    if (!page_is_zero(page)) {
+        len = lz4_compress(page, PMM_FRAME_SIZE, page_buf, PMM_FRAME_SIZE - 1, lz4_work);
+        if (len == 0) {
+            data = page;
+            len = PMM_FRAME_SIZE;
+        }
+    }
+    emit_record(KDUMP_REC_PAGE, sizeof(addr) + len);
+    emit(&addr, sizeof(addr));
+    emit(data, len);
+    out_pages++;
+}
+
+/**
+ * @brief Pages from the page RSP is in up to the top of its stack
+ */
+static void emit_stack(uint64_t rsp) {
+    uint64_t start = rsp & ~(PMM_FRAME_SIZE - 1);
+    uint64_t end = start;
+
+    if (rsp > KERNEL_STACK_TOP - KERNEL_STACK_SIZE && rsp <= KERNEL_STACK_TOP) {
+        end = KERNEL_STACK_TOP;
+    } else {
+        while (end - start < KDUMP_STACK_MAX && paging_is_mapped(end)) {
+            end += PMM_FRAME_SIZE;
+        }
+    }
+    if (end - start > KDUMP_STACK_MAX) {
+        end = start + KDUMP_STACK_MAX;
+    }
+    if (end == start || !paging_is_mapped(start)) {
+        return;
+    }
+    emit_record(KDUMP_REC_STACK, sizeof(start) + (end - start));
+    emit(&start, sizeof(start));
+    emit((const void *)(uintptr_t)start, end - start);
+}
+
+static void emit_memory(void) {
+    pmm_stats_t pmm;
+    pmm_get_stats(&pmm);
+
+    for (uint64_t a = 0; a < pmm.mem_top && out_ok; a += PMM_FRAME_SIZE) {
+        if ((a >= HOLE_START && a < HOLE_END) || !pmm_frame_in_use(a)) {
+            continue;
+        }
+        emit_page(a);
+    }
+
+    int n = vmalloc_get_areas(areas, VMALLOC_MAX_AREAS);
+    for (int i = 0; i < n && out_ok; i++) {
+        for (uint64_t p = 0; p < areas[i].pages && out_ok; p++) {
+            uint64_t va = areas[i].start + p * PMM_FRAME_SIZE;
+            if (paging_is_mapped(va)) {
+                emit_page(va);
+            }
+        }
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void kdump_write(const interrupt_frame_t *frame, const char *reason) {
+    if (dumping) {
+        return;
+    }
+    dumping = true;
+
+    kdump_sink_t sink = kdump_current_sink();
+    if (sink == KDUMP_SINK_NONE) {
+        kprintf("  Crash dump: no sink\n\n");
+        return;
+    }
+    out = &sinks[sink];
+    if (!out->available()) {
+        kprintf("  Crash dump: %s not available\n\n", out->name);
+        return;
+    }
+    bool memory = memory_setting == KDUMP_MEMORY_ON ||
+                  (memory_setting == KDUMP_MEMORY_AUTO && out->memory);
+    kprintf("  Writing crash dump to %s%s...\n", out->name, memory ? " with memory" : "");
+    uint64_t start = rdtsc();
+
+    kdump_header_t h;
+    memset(&h, 0, sizeof(h));
+    h.magic = KDUMP_MAGIC;
+    h.version = KDUMP_VERSION;
+    h.flags = memory ? KDUMP_F_MEMORY : 0;
+    h.tsc = start;
+    h.tsc_khz = tsc_khz();
+    ksnprintf(h.reason, sizeof(h.reason), "%s (#%llu) at RIP 0x%016llX", reason,
+              frame->vector, frame->rip);
+
+    kdump_cpu_t cpu = {
+        .frame = *frame,
+        .cr0 = read_cr0(),
+        .cr2 = read_cr2(),
+        .cr3 = read_cr3(),
+        .cr4 = read_cr4(),
+        .fs_base = read_msr(MSR_FS_BASE),
+        .gs_base = read_msr(MSR_GS_BASE),
+    };
+
+    out_crc = 0;
+    out_bytes = 0;
+    out_pages = 0;
+    out_ok = out->begin();
+    emit(&h, sizeof(h));
+    emit_record(KDUMP_REC_CPU, sizeof(cpu));
+    emit(&cpu, sizeof(cpu));
+    emit_stack(frame->rsp);
+
+    size_t log_len = console_log_read(log_copy, sizeof(log_copy));
+    emit_record(KDUMP_REC_LOG, log_len);
+    emit(log_copy, log_len);
+
+    if (memory) {
+        emit_memory();
+    }
+
+    uint32_t crc = out_crc;
+    emit_record(KDUMP_REC_END, sizeof(crc));
+    emit(&crc, sizeof(crc));
+    if (out_ok) {
+        out_ok = out->end();
+    }
+
+    uint64_t ms = tsc_cycles_to_us(rdtsc() - start) / 1000;
+    if (out_ok) {
+        kprintf("  Crash dump: %llu KB, %llu pages, %llu ms\n\n", out_bytes >> 10, out_pages, ms);
+    } else {
+        kprintf("  Crash dump to %s failed after %llu KB\n\n", out->name, out_bytes >> 10);
+    }
+}
+
+void kdump_set_sink(kdump_sink_t sink) {
+    if (sink < KDUMP_SINK_COUNT) {
+        sink_setting = sink;
+    }
+}
+
+kdump_sink_t kdump_get_sink(void) {
+    return sink_setting;
+}
+
+kdump_sink_t kdump_current_sink(void) {
+    if (sink_setting != KDUMP_SINK_AUTO) {
+        return sink_setting;
+    }
+    for (int s = KDUMP_SINK_VIRTIO; s <= KDUMP_SINK_SERIAL; s++) {
+        if (sinks[s].available()) {
+            return (kdump_sink_t)s;
+        }
+    }
+    return KDUMP_SINK_NONE;
+}
+
+const char *kdump_sink_name(kdump_sink_t sink) {
+    return sink < KDUMP_SINK_COUNT ? sinks[sink].name : "?";
+}
+
+bool kdump_parse_sink(const char *name, kdump_sink_t *out_sink) {
+    for (int s = 0; s < KDUMP_SINK_COUNT; s++) {
+        if (strcmp(name, sinks[s].name) == 0) {
+            *out_sink = (kdump_sink_t)s;
+            return true;
+        }
+    }
+    return false;
+}
+
+void kdump_set_memory(kdump_memory_t memory) {
+    memory_setting = memory;
+}
+
+kdump_memory_t kdump_get_memory(void) {
+    return memory_setting;
+}
+
+bool kdump_disk_info(kdump_disk_info_t *info) {
+    if (!disk_available() || !ata_read(KDUMP_LBA, 1, sector)) {
+        return false;
+    }
+    memcpy(&info->header, sector, sizeof(info->header));
+    if (info->header.magic != KDUMP_MAGIC || info->header.version != KDUMP_VERSION) {
+        return false;
+    }
+    info->header.reason[sizeof(info->header.reason) - 1] = '\0';
+    info->uptime_ms = info->header.tsc_khz ? info->header.tsc / info->header.tsc_khz : 0;
+    return true;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file kdump.h
+ * @brief Crash dumps written from the exception handler
+ *
+ * When an exception is fatal, exception_handler() prints the panic
+ * screen and then calls kdump_write(), which streams the state of the
+ * machine to the fastest sink available and halts. On the host,
+ * scripts/kdump2core.py turns the dump into an ELF core file and a log
+ * ("make kdump" opens it in gdb next to build/kernel.elf).
+ *
+ * CONTENTS:
+ *   - Registers at the fault (the exception frame), CR0/CR2/CR3/CR4 and
+ *     the FS/GS bases
+ *   - The faulting stack, from the page RSP is in up to the top of the
+ *     kernel stack (or up to KDUMP_STACK_MAX bytes of mapped pages)
+ *   - The console log ring (drivers/console/console.h)
+ *   - Optionally every page in use: the frames the allocator hands out
+ *     and everything below them at their identity address, and the
+ *     populated pages of every vmalloc area at their virtual address
+ *     (a frame behind a vmalloc page is therefore stored twice). All-zero
+ *     pages take no data; the others are LZ4 blocks.
+ *
+ * FORMAT:
+ *   A kdump_header_t, then records of { uint32 type, uint32 length,
+ *   data }. KDUMP_REC_PAGE data is the page's 64-bit address and its LZ4
+ *   block (4096 bytes: stored as is, none: zeros); KDUMP_REC_STACK is the
+ *   64-bit address of the first byte and the bytes. The stream ends with
+ *   KDUMP_REC_END, holding the CRC32C of every byte before it, so a dump
+ *   cut short (a fault while dumping, a full disk) is recognised.
+ *
+ * SINKS:
+ *   virtio  Trace port of the virtio console (build/trace.bin under
+ *           "make run"), at memory speed
+ *   disk    Boot disk from KDUMP_LBA; "make image" keeps it
+ *   serial  COM1, base64 between BEGIN/END marker lines, for a terminal
+ *           log; without memory pages by default (11 KB/s)
+ *   "auto" picks the first one present, in that order.
+ */
+
+#ifndef _CORE_KDUMP_H
+#define _CORE_KDUMP_H
+
+#include <squirel/types.h>
+#include <arch/x86_64/cpu/idt.h>
+
+/* ============================================================================
+ * Format
+ * ============================================================================ */
+
+#define KDUMP_MAGIC         0x31504D55444B5153ull   /* "SQKDUMP1" */
+#define KDUMP_VERSION       1
+
+/** @brief Header flag: memory pages follow */
+#define KDUMP_F_MEMORY      (1u << 0)
+
+/** @brief Largest stack record */
+#define KDUMP_STACK_MAX     (64 * 1024)
+
+/* Record types */
+#define KDUMP_REC_END       0
+#define KDUMP_REC_CPU       1
+#define KDUMP_REC_STACK     2
+#define KDUMP_REC_LOG       3
+#define KDUMP_REC_PAGE      4
+
+/**
+ * @brief Start of a dump
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t flags;             /**< KDUMP_F_* */
+    uint64_t tsc;               /**< At the crash (cycles since power-on) */
+    uint64_t tsc_khz;           /**< To turn it into time */
+    char reason[96];            /**< Panic line, NUL terminated */
+} kdump_header_t;
+
+/**
+ * @brief KDUMP_REC_CPU data
+ */
+typedef struct {
+    interrupt_frame_t frame;
+    uint64_t cr0, cr2, cr3, cr4;
+    uint64_t fs_base, gs_base;
+} kdump_cpu_t;
+
+/* ============================================================================
+ * Settings
+ * ============================================================================ */
+
+typedef enum {
+    KDUMP_SINK_AUTO = 0,
+    KDUMP_SINK_VIRTIO,
+    KDUMP_SINK_DISK,
+    KDUMP_SINK_SERIAL,
+    KDUMP_SINK_NONE,            /**< Crash without a dump */
+    KDUMP_SINK_COUNT
+} kdump_sink_t;
+
+typedef enum {
+    KDUMP_MEMORY_AUTO = 0,      /**< Pages unless the sink is serial */
+    KDUMP_MEMORY_ON,
+    KDUMP_MEMORY_OFF
+} kdump_memory_t;
+
+/**
+ * @brief A dump found on the disk
+ */
+typedef struct {
+    kdump_header_t header;
+    uint64_t uptime_ms;         /**< Crash time since power-on */
+} kdump_disk_info_t;
+
+/* ============================================================================
+ * Functions
+ * ============================================================================ */
+
+/**
+ * @brief Write a crash dump of the faulting context
+ *
+ * Prints one line before and one after; returns when done (or at once
+ * if a dump is already being written: a fault while dumping).
+ *
+ * @param frame   Registers at the exception
+ * @param reason  Exception name (the header adds the vector and RIP)
+ */
+void kdump_write(const interrupt_frame_t *frame, const char *reason);
+
+void kdump_set_sink(kdump_sink_t sink);
+kdump_sink_t kdump_get_sink(void);
+
+/**
+ * @brief Sink a crash would use now (resolves KDUMP_SINK_AUTO)
+ */
+kdump_sink_t kdump_current_sink(void);
+
+/**
+ * @brief Sink name ("auto", "virtio", "disk", "serial", "none")
+ */
+const char *kdump_sink_name(kdump_sink_t sink);
+
+/**
+ * @brief Parse a sink name
+ *
+ * @return false if the name is not known
+ */
+bool kdump_parse_sink(const char *name, kdump_sink_t *out);
+
+void kdump_set_memory(kdump_memory_t memory);
+kdump_memory_t kdump_get_memory(void);
+
+/**
+ * @brief Read the header of the dump on the disk
+ *
+ * @return false without a disk or a dump
+ */
+bool kdump_disk_info(kdump_disk_info_t *out);
+
+#endif /* _CORE_KDUMP_H */
@@ -0,0 +1,277 @@
+/**
+ * @file metrics.c
+ * @brief Prometheus text exposition serializer
+ */
+
+#include "metrics.h"
+#include "cpustat.h"
+#include "stat.h"
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/cpu/irq.h>
+#include <shell/shell.h>
+#include <stdarg.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define METRIC_PREFIX   "squirel_"
+
+/** @brief Shell commands exported (matches the shell's table size) */
+#define METRICS_MAX_COMMANDS    32
+
+/* Linker script symbols: the registry */
+extern const metric_desc_t __metrics_start[];
+extern const metric_desc_t __metrics_end[];
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/**
+ * @brief Output position in the destination buffer
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool truncated;
+} metrics_out_t;
+
+static char snapshot_buf[METRICS_BUF_SIZE];
+
+/** @brief Histogram snapshots are read one at a time into here (too big for the stack) */
+static histogram_t scratch_hist;
+
+DEFINE_STAT(metrics_snapshots, "Metrics snapshots rendered");
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief Append formatted text; once something does not fit, stop
+ */
+static void emit(metrics_out_t *out, const char *fmt, ...) {
+    if (out->truncated) {
+        return;
+    }
+
+    size_t room = out->size - out->len;
+    va_list args;
+    va_start(args, fmt);
+    int n = kvsnprintf(out->buf + out->len, room, fmt, args);
+    va_end(args);
+
+    if ((size_t)n >= room) {
+        out->truncated = true;
+        return;
+    }
+    out->len += (size_t)n;
+}
+
+/**
+ * @brief Append value / scale in fixed point (scale is 1 or a power of ten)
+ */
+static void emit_scaled(metrics_out_t *out, uint64_t value, uint32_t scale) {
+    if (scale <= 1) {
+        emit(out, "%llu", value);
+        return;
+    }
+
+    char frac[12];
+    int digits = 0;
+    for (uint32_t s = scale; s > 1 && digits < 10; s /= 10) {
+        digits++;
+    }
+
+    uint64_t rem = value % scale;
+    for (int i = digits - 1; i >= 0; i--) {
+        frac[i] = (char)('0' + rem % 10);
+        rem /= 10;
+    }
+    frac[digits] = '\0';
+    emit(out, "%llu.%s", value / scale, frac);
+}
+
+static void emit_header(metrics_out_t *out, const char *name, const char *help,
+                        const char *type) {
+    emit(out, "# HELP " METRIC_PREFIX "%s %s\n", name, help);
+    emit(out, "# TYPE " METRIC_PREFIX "%s %s\n", name, type);
+}
+
+/**
+ * @brief Append a histogram: power-of-two buckets, +Inf, sum and count
+ */
+static void emit_histogram(metrics_out_t *out, const char *name,
+                           const histogram_t *h, uint32_t scale) {
+    uint64_t cumulative = 0;
+    int index = 0;
+
+    /* Bucket k counts values < 2^k, i.e. <= 2^k - 1 */
+    for (int k = HIST_SUB_BITS; k < HIST_MAX_BITS; k++) {
+        int end = hist_bucket_index(1ull << k);
+        while (index < end) {
+            cumulative += h->counts[index++];
+        }
+        emit(out, METRIC_PREFIX "%s_bucket{le=\"", name);
+        emit_scaled(out, (1ull << k) - 1, scale);
+        emit(out, "\"} %llu\n", cumulative);
+    }
+
+    emit(out, METRIC_PREFIX "%s_bucket{le=\"+Inf\"} %llu\n", name, h->total);
+    emit(out, METRIC_PREFIX "%s_sum ", name);
+    emit_scaled(out, h->sum, scale);
+    emit(out, "\n" METRIC_PREFIX "%s_count %llu\n", name, h->total);
+}
+
+/* ============================================================================
+ * Built-in Metrics
+ * ============================================================================ */
+
+static void emit_uptime(metrics_out_t *out) {
+    cpustat_t t;
+    cpustat_get(0, &t);
+    emit_header(out, "uptime_seconds", "Time since interrupts were enabled", "gauge");
+    emit(out, METRIC_PREFIX "uptime_seconds ");
+    emit_scaled(out, tsc_cycles_to_us(t.total), 1000000);
+    emit(out, "\n");
+}
+
+static void emit_cpu_time(metrics_out_t *out) {
+    emit_header(out, "cpu_seconds_total", "CPU time by mode", "counter");
+    for (int cpu = 0; cpu < cpu_count(); cpu++) {
+        cpustat_t t;
+        cpustat_get(cpu, &t);
+
+        const char *modes[] = { "busy", "idle", "irq" };
+        uint64_t cycles[] = { t.busy, t.idle, t.irq };
+        for (int i = 0; i < 3; i++) {
+            emit(out, METRIC_PREFIX "cpu_seconds_total{cpu=\"%d\",mode=\"%s\"} ",
+                 cpu, modes[i]);
+            emit_scaled(out, tsc_cycles_to_us(cycles[i]), 1000000);
+            emit(out, "\n");
+        }
+    }
+}
+
+static void emit_interrupts(metrics_out_t *out) {
+    emit_header(out, "interrupts_total", "Interrupts taken by line", "counter");
+    for (int irq = 0; irq < IRQ_COUNT; irq++) {
+        const char *name = irq_name(irq);
+        if (name) {
+            emit(out, METRIC_PREFIX "interrupts_total{irq=\"%d\",name=\"%s\"} %llu\n",
+                 irq, name, irq_get_count(irq));
+        }
+    }
+
+    emit_header(out, "spurious_interrupts_total", "Spurious IRQ 7/15 deliveries", "counter");
+    emit(out, METRIC_PREFIX "spurious_interrupts_total %llu\n", irq_get_spurious());
+}
+
+static void emit_stats(metrics_out_t *out) {
+    char name[64];
+
+    for (int i = 0; i < stat_count(); i++) {
+        const stat_desc_t *s = stat_get(i);
+        ksnprintf(name, sizeof(name), "%s_total", s->name);
+        emit_header(out, name, s->help, "counter");
+        for (int cpu = 0; cpu < cpu_count(); cpu++) {
+            emit(out, METRIC_PREFIX "%s{cpu=\"%d\"} %llu\n",
+                 name, cpu, stat_read_cpu(s, cpu));
+        }
+    }
+}
+
+static void emit_shell(metrics_out_t *out) {
+    static shell_cmd_stats_t cmds[METRICS_MAX_COMMANDS];
+    int n = shell_get_cmd_stats(cmds, METRICS_MAX_COMMANDS);
+
+    emit_header(out, "shell_command_runs_total", "Completed shell command runs", "counter");
+    for (int i = 0; i < n; i++) {
+        emit(out, METRIC_PREFIX "shell_command_runs_total{command=\"%s\"} %llu\n",
+             cmds[i].name, cmds[i].calls);
+    }
+
+    emit_header(out, "shell_command_seconds_total", "Time spent in shell commands", "counter");
+    for (int i = 0; i < n; i++) {
+        emit(out, METRIC_PREFIX "shell_command_seconds_total{command=\"%s\"} ",
+             cmds[i].name);
+        emit_scaled(out, tsc_cycles_to_us(cmds[i].cycles), 1000000);
+        emit(out, "\n");
+    }
+}
+
+static void emit_registry(metrics_out_t *out) {
+    static const char *type_names[] = { "counter", "gauge", "histogram" };
+
+    for (const metric_desc_t *m = __metrics_start; m < __metrics_end; m++) {
+        if (m->type > METRIC_HISTOGRAM) {
+            continue;
+        }
+        emit_header(out, m->name, m->help, type_names[m->type]);
+
+        if (m->type == METRIC_HISTOGRAM) {
+            m->read_hist(&scratch_hist);
+            emit_histogram(out, m->name, &scratch_hist, m->scale);
+        } else {
+            emit(out, METRIC_PREFIX "%s ", m->name);
+            emit_scaled(out, m->read(), m->scale);
+            emit(out, "\n");
+        }
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+int metrics_count(void) {
+    return (int)(__metrics_end - __metrics_start);
+}
+
+size_t metrics_render(char *buf, size_t size, bool *truncated) {
+    metrics_out_t out = { buf, size, 0, false };
+
+    stat_inc(metrics_snapshots);
+
+    emit_uptime(&out);
+    emit_cpu_time(&out);
+    emit_interrupts(&out);
+    emit_stats(&out);
+    emit_shell(&out);
+    emit_registry(&out);
+
+    /* Never hand out half a sample line */
+    if (out.truncated) {
+        while (out.len > 0 && buf[out.len - 1] != '\n') {
+            out.len--;
+        }
+    }
+    buf[out.len] = '\0';
+
+    if (truncated) {
+        *truncated = out.truncated;
+    }
+    return out.len;
+}
+
+const char *metrics_snapshot(size_t *len) {
+    *len = metrics_render(snapshot_buf, sizeof(snapshot_buf), NULL);
+    return snapshot_buf;
+}
+
+void metrics_dump(void (*write)(const char *buf, size_t len)) {
+    char line[64];
+    size_t len;
+    const char *text = metrics_snapshot(&len);
+
+    int n = ksnprintf(line, sizeof(line), "# BEGIN squirel-metrics len=%llu\n",
+                      (uint64_t)len);
+    write(line, (size_t)n);
+    write(text, len);
+    write("# END\n", 6);
+}
@@ -0,0 +1,171 @@
+/**
+ * @file metrics.h
+ * @brief Kernel metrics in Prometheus text exposition format
+ *
+ * metrics_render() serializes every kernel counter, gauge and histogram
+ * into one text snapshot that Prometheus (or curl) can read directly:
+ *
+ *   # HELP squirel_timer_ticks_total PIT interrupts handled
+ *   # TYPE squirel_timer_ticks_total counter
+ *   squirel_timer_ticks_total 81234
+ *
+ * SOURCES:
+ *   Built in - every DEFINE_STAT counter (one sample per CPU), CPU
+ *              busy/idle/irq seconds, per-line interrupt counts, uptime
+ *              and per-command shell usage.
+ *   Registry - DEFINE_METRIC()/DEFINE_HISTOGRAM_METRIC() anywhere in the
+ *              kernel. Like the stat registry, descriptors live in the
+ *              .metrics section (__metrics_start .. __metrics_end), so
+ *              nothing has to call a register function.
+ *
+ * UNITS:
+ *   Sources keep their natural integer unit; 'scale' is how many of
+ *   them make one base unit (1000000000 for nanoseconds -> seconds) and
+ *   must be 1 or a power of ten. Values are printed in fixed point, so
+ *   no floating point is needed.
+ *
+ * HISTOGRAMS:
+ *   A log-linear histogram (lib/histogram) is exported with one bucket
+ *   per power of two: le="(2^k - 1) / scale" counts every recorded value
+ *   below 2^k, which is exact because power-of-two boundaries are also
+ *   bucket boundaries. The bucket set never changes between scrapes.
+ *
+ * MEMORY:
+ *   Rendering appends to a caller-provided buffer and allocates nothing;
+ *   metrics_snapshot() uses one preallocated METRICS_BUF_SIZE buffer.
+ *
+ * @example
+ *   DEFINE_METRIC(timer_ticks_total, METRIC_COUNTER,
+ *                 "PIT interrupts handled", 1, pit_ticks);
+ */
+
+#ifndef _CORE_METRICS_H
+#define _CORE_METRICS_H
+
+#include <squirel/types.h>
+#include <lib/histogram/histogram.h>
+
+/* ============================================================================
+ * Types
+ * ============================================================================ */
+
+/**
+ * @brief Prometheus metric types
+ */
+typedef enum {
+    METRIC_COUNTER = 0,     /**< Only goes up (name should end in _total) */
+    METRIC_GAUGE,           /**< Goes up and down */
+    METRIC_HISTOGRAM        /**< Distribution (read_hist) */
+} metric_type_t;
+
+/**
+ * @brief Registry entry emitted by DEFINE_METRIC (one per metric)
+ *
+ * Sized and aligned to 64 bytes so the .metrics section is a plain array.
+ */
+typedef struct {
+    const char *name;                       /**< Exported as squirel_<name> */
+    const char *help;                       /**< One-line description */
+    uint32_t type;                          /**< metric_type_t */
+    uint32_t scale;                         /**< Source units per base unit */
+    uint64_t (*read)(void);                 /**< Counter/gauge value */
+    void (*read_hist)(histogram_t *out);    /**< Histogram snapshot */
+} ALIGNED(64) metric_desc_t;
+
+/* ============================================================================
+ * Definition Macros
+ * ============================================================================ */
+
+/**
+ * @brief Register a counter or gauge
+ *
+ * @param var    C identifier, exported as squirel_<var>
+ * @param type   METRIC_COUNTER or METRIC_GAUGE
+ * @param help   Description string
+ * @param scale  Units of fn's value per exported unit (1 = as is)
+ * @param fn     uint64_t fn(void) returning the current value
+ */
+#define DEFINE_METRIC(var, type, help, scale, fn)                           \
+    static const metric_desc_t metric_desc_##var                            \
+        __attribute__((section(".metrics"), used)) =                        \
+        { #var, help, type, scale, fn, NULL }
+
+/**
+ * @brief Register a histogram
+ *
+ * @param var    C identifier, exported as squirel_<var>
+ * @param help   Description string
+ * @param scale  Units of the recorded values per exported unit
+ * @param fn     void fn(histogram_t *out) filling in a snapshot
+ */
+#define DEFINE_HISTOGRAM_METRIC(var, help, scale, fn)                       \
+    static const metric_desc_t metric_desc_##var                            \
+        __attribute__((section(".metrics"), used)) =                        \
+        { #var, help, METRIC_HISTOGRAM, scale, NULL, fn }
+
+/* ============================================================================
+ * Functions
+ * ============================================================================ */
+
+/**
+ * @brief Number of metrics in the .metrics registry
+ */
+int metrics_count(void);
+
+/**
+ * @brief Serialize all metrics into a buffer
+ *
+ * @param buf        Destination (NUL-terminated on return)
+ * @param size       Capacity of buf, at least 1
+ * @param truncated  Set to true if the output did not fit (may be NULL)
+ * @return           Bytes written, excluding the NUL
+ */
+size_t metrics_render(char *buf, size_t size, bool *truncated);
+
+/**
+ * @brief Render into the preallocated snapshot buffer
+ *
+ * The buffer is reused by the next call, and must not be used from
+ * interrupt handlers.
+ *
+ * @param len  Receives the length of the snapshot
+ * @return     The snapshot text
+ */
+const char *metrics_snapshot(size_t *len);
+
+/**
+ * @brief Start answering metrics requests on METRICS_PORT
+ *
+ * REQUESTS (one per line, answered from the idle loop):
+ *   GET /metrics HTTP/1.x   - HTTP/1.0 response (headers are skipped
+ *                             up to the blank line)
+ *   metrics                 - Framed dump:
+ *                               # BEGIN squirel-metrics len=<bytes>
+ *                               <exposition text>
+ *                               # END
+ *
+ * @return false if no UART is present at METRICS_PORT
+ * @note Requires irq_init()
+ */
+bool metrics_serve_init(void);
+
+/**
+ * @brief Set COM2 up again after a resume from hibernation
+ *
+ * The kernel that loaded the image never configured the port.
+ */
+void metrics_serve_resume(void);
+
+/**
+ * @brief Check whether metrics_serve_init() found its port
+ */
+bool metrics_serve_active(void);
+
+/**
+ * @brief Write a framed dump to any output (see metrics_serve_init())
+ *
+ * @param write  Output function (e.g. serial_write)
+ */
+void metrics_dump(void (*write)(const char *buf, size_t len));
+
+#endif /* _CORE_METRICS_H */
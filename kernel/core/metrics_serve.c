@@ -0,0 +1,184 @@
+/**
+ * @file metrics_serve.c
+ * @brief Metrics requests over a serial port (HTTP or framed dump)
+ *
+ * There is no network stack, so the "network path" is QEMU's: the second
+ * -serial is a TCP chardev (see the Makefile), which makes COM2 a socket
+ * on the host. A scraper connects, sends "GET /metrics HTTP/1.1" and gets
+ * an HTTP/1.0 response with the exposition text.
+ *
+ * The RX interrupt only moves bytes into a ring; parsing and rendering
+ * run from an idle hook, so a request is answered the next time the
+ * shell waits for input.
+ */
+
+#include "metrics.h"
+#include "cpustat.h"
+#include "stat.h"
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <drivers/serial/serial.h>
+#include <arch/x86_64/cpu/irq.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/** @brief Receive ring size (power of two) */
+#define RX_RING_SIZE    512
+
+/** @brief Longest request line kept (the rest is dropped) */
+#define LINE_MAX        128
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static volatile uint8_t rx_ring[RX_RING_SIZE];
+static volatile uint32_t rx_head = 0;      /* Written by the IRQ handler */
+static volatile uint32_t rx_tail = 0;      /* Written by the idle hook */
+
+static char line[LINE_MAX];
+static int line_len = 0;
+
+/** @brief Between a GET line and the blank line ending its headers */
+static bool in_headers = false;
+static bool path_found = false;
+
+static bool active = false;
+
+DEFINE_STAT(metrics_requests, "Metrics requests answered on the serial port");
+DEFINE_STAT(metrics_rx_dropped, "Metrics request bytes lost to a full ring");
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static void port_write(const char *buf, size_t len) {
+    serial_port_write(METRICS_PORT, buf, len);
+}
+
+static void metrics_irq(void) {
+    int c;
+    while ((c = serial_port_read(METRICS_PORT)) >= 0) {
+        if (rx_head - rx_tail >= RX_RING_SIZE) {
+            stat_inc(metrics_rx_dropped);
+            continue;
+        }
+        rx_ring[rx_head % RX_RING_SIZE] = (uint8_t)c;
+        rx_head++;
+    }
+}
+
+static void respond_http(void) {
+    char header[160];
+    int n;
+
+    if (!path_found) {
+        static const char not_found[] =
+            "HTTP/1.0 404 Not Found\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 10\r\n"
+            "Connection: close\r\n"
+            "\r\n"
+            "Not Found\n";
+        port_write(not_found, sizeof(not_found) - 1);
+        return;
+    }
+
+    size_t len;
+    const char *body = metrics_snapshot(&len);
+    n = ksnprintf(header, sizeof(header),
+                  "HTTP/1.0 200 OK\r\n"
+                  "Content-Type: text/plain; version=0.0.4\r\n"
+                  "Content-Length: %llu\r\n"
+                  "Connection: close\r\n"
+                  "\r\n", (uint64_t)len);
+    port_write(header, (size_t)n);
+    port_write(body, len);
+}
+
+/**
+ * @brief Act on one complete request line (CR/LF stripped)
+ */
+static void handle_line(void) {
+    /* A new request line also recovers from a client that went away */
+    if (strncmp(line, "GET ", 4) == 0) {
+        const char *path = line + 4;
+        path_found = strncmp(path, "/metrics", 8) == 0 &&
+                     (path[8] == ' ' || path[8] == '\0' || path[8] == '?');
+        if (path[0] == '/' && (path[1] == ' ' || path[1] == '\0')) {
+            path_found = true;
+        }
+        in_headers = true;
+        return;
+    }
+
+    if (in_headers) {
+        if (line_len == 0) {
+            in_headers = false;
+            stat_inc(metrics_requests);
+            respond_http();
+        }
+        return;
+    }
+
+    if (strcmp(line, "metrics") == 0) {
+        stat_inc(metrics_requests);
+        metrics_dump(port_write);
+    }
+}
+
+/**
+ * @brief Idle hook: feed received bytes to the line parser
+ */
+static void metrics_poll(void) {
+    while (rx_tail != rx_head) {
+        char c = (char)rx_ring[rx_tail % RX_RING_SIZE];
+        rx_tail++;
+
+        if (c == '\n') {
+            if (line_len > 0 && line[line_len - 1] == '\r') {
+                line_len--;
+            }
+            line[line_len] = '\0';
+            handle_line();
+            line_len = 0;
+        } else if (line_len < LINE_MAX - 1) {
+            line[line_len++] = c;
+        }
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool metrics_serve_init(void) {
+    if (!serial_port_init(METRICS_PORT)) {
+        return false;
+    }
+    if (!irq_register(IRQ_COM2, "com2", metrics_irq) ||
+        !cpu_idle_add_hook(metrics_poll)) {
+        return false;
+    }
+
+    /* Drop anything that arrived before the handler was installed */
+    while (serial_port_read(METRICS_PORT) >= 0) {
+        /* Discard */
+    }
+    serial_port_enable_rx_irq(METRICS_PORT);
+    active = true;
+    return true;
+}
+
+void metrics_serve_resume(void) {
+    if (active && serial_port_init(METRICS_PORT)) {
+        serial_port_enable_rx_irq(METRICS_PORT);
+    }
+}
+
+bool metrics_serve_active(void) {
+    return active;
+}
@@ -0,0 +1,581 @@
+/**
+ * @file module.c
+ * @brief Loadable kernel modules implementation
+ */
+
+#include "module.h"
+#include "export.h"
+#include <squirel/config.h>
+#include <squirel/elf.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <drivers/ata/ata.h>
+#include <core/initcall.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <lib/printf/printf.h>
+
+/* Linker script symbols: the export table */
+extern const ksym_t __ksymtab_start[];
+extern const ksym_t __ksymtab_end[];
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/* ustar header fields */
+#define TAR_NAME            0
+#define TAR_NAME_LEN        100
+#define TAR_SIZE            124
+#define TAR_SIZE_LEN        12
+#define TAR_TYPE            156
+#define TAR_MAGIC           257
+
+/** @brief Headers read before an archive is considered corrupt */
+#define TAR_MAX_ENTRIES     256
+
+/** @brief Largest section alignment honored */
+#define MAX_ALIGN           4096
+
+/** @brief Largest loaded image, .bss included */
+#define MAX_IMAGE           (64ull << 20)
+
+/** @brief Unresolved symbols named before giving up */
+#define MAX_UNRESOLVED      8
+
+#define NOT_LOADED          UINT64_MAX
+
+/** @brief archive_count before the archive has been read */
+#define ARCHIVE_UNREAD      (-2)
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static module_t modules[MODULE_MAX];
+static int module_count = 0;
+
+/** @brief Archive header being parsed */
+static uint8_t sector[ATA_SECTOR_SIZE];
+
+/**
+ * @brief A module in the archive
+ */
+typedef struct {
+    char name[MODULE_NAME_MAX];
+    uint64_t lba;               /**< First data sector */
+    uint32_t size;              /**< Bytes of the .ko */
+} archive_entry_t;
+
+/** @brief The .ko entries of the archive, filled by archive_scan() */
+static archive_entry_t archive[TAR_MAX_ENTRIES];
+static int archive_count = ARCHIVE_UNREAD;
+
+/** @brief Offset of each loaded section from the module base */
+static uint64_t sec_off[MODULE_MAX_SECTIONS];
+
+/* ============================================================================
+ * Archive
+ * ============================================================================ */
+
+static uint64_t parse_octal(const uint8_t *field, int len) {
+    uint64_t v = 0;
+    for (int i = 0; i < len && field[i] >= '0' && field[i] <= '7'; i++) {
+        v = v * 8 + (field[i] - '0');
+    }
+    return v;
+}
+
+/**
+ * @brief Module name of a "<dir>/<name>.ko" archive path
+ *
+ * @return false if the path is not a .ko or the name is too long
+ */
+static bool entry_name(const uint8_t *hdr, char *out) {
+    char path[TAR_NAME_LEN + 1];
+    memcpy(path, hdr + TAR_NAME, TAR_NAME_LEN);
+    path[TAR_NAME_LEN] = '\0';
+
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    size_t len = strlen(base);
+    if (len <= 3 || len - 3 >= MODULE_NAME_MAX || strcmp(base + len - 3, ".ko") != 0) {
+        return false;
+    }
+    memcpy(out, base, len - 3);
+    out[len - 3] = '\0';
+    return true;
+}
+
+/**
+ * @brief Read the archive index, once
+ *
+ * Every header is an uncached PIO read, and the shell asks for each
+ * unknown command, so the walk happens on first use only and its result
+ * (no archive included) is kept. The archive is written by the build and
+ * never changes while the kernel runs.
+ *
+ * @return Entries in archive[], or -1 when there is no disk or no archive
+ */
+static int archive_scan(void) {
+    uint64_t pos = MODULE_ARCHIVE_LBA;
+
+    if (archive_count != ARCHIVE_UNREAD) {
+        return archive_count;
+    }
+    if (!ata_present()) {
+        return archive_count = -1;
+    }
+
+    archive_count = 0;
+    for (int i = 0; i < TAR_MAX_ENTRIES; i++) {
+        if (!ata_read(pos, 1, sector)) {
+            if (i == 0) {
+                archive_count = -1;
+            }
+            break;
+        }
+        if (sector[TAR_NAME] == '\0') {
+            break;                  /* End-of-archive block */
+        }
+        if (memcmp(sector + TAR_MAGIC, "ustar", 5) != 0) {
+            if (i == 0) {
+                archive_count = -1;
+            }
+            break;
+        }
+
+        uint64_t bytes = parse_octal(sector + TAR_SIZE, TAR_SIZE_LEN);
+        uint8_t type = sector[TAR_TYPE];
+        archive_entry_t *e = &archive[archive_count];
+        if ((type == '0' || type == '\0') && bytes <= UINT32_MAX && entry_name(sector, e->name)) {
+            e->lba = pos + 1;
+            e->size = (uint32_t)bytes;
+            archive_count++;
+        }
+        pos += 1 + (bytes + ATA_SECTOR_SIZE - 1) / ATA_SECTOR_SIZE;
+    }
+    return archive_count;
+}
+
+/**
+ * @brief Find a module in the archive index
+ *
+ * @return The entry, or NULL
+ */
+static const archive_entry_t *archive_find(const char *name) {
+    for (int i = 0; i < archive_scan(); i++) {
+        if (strcmp(archive[i].name, name) == 0) {
+            return &archive[i];
+        }
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * ELF Linking
+ * ============================================================================ */
+
+/**
+ * @brief A NUL-terminated string inside a string table section
+ */
+static const char *elf_str(const uint8_t *file, uint64_t file_size,
+                           const Elf64_Shdr *strtab, uint32_t off) {
+    if (strtab->sh_offset > file_size || strtab->sh_size > file_size - strtab->sh_offset ||
+        off >= strtab->sh_size) {
+        return NULL;
+    }
+    const char *s = (const char *)file + strtab->sh_offset + off;
+    if (!memchr(s, '\0', strtab->sh_size - off)) {
+        return NULL;
+    }
+    return s;
+}
+
+/**
+ * @brief Check the ELF header and the section table bounds
+ */
+static bool elf_check(const uint8_t *file, uint64_t size, const char *name) {
+    const Elf64_Ehdr *eh = (const Elf64_Ehdr *)file;
+    uint32_t magic;
+
+    if (size < sizeof(Elf64_Ehdr)) {
+        kprintf("module: %s: truncated\n", name);
+        return false;
+    }
+    memcpy(&magic, eh->e_ident, sizeof(magic));
+    if (magic != ELF_MAGIC || eh->e_ident[EI_CLASS] != ELFCLASS64 ||
+        eh->e_ident[EI_DATA] != ELFDATA2LSB || eh->e_type != ET_REL ||
+        eh->e_machine != EM_X86_64) {
+        kprintf("module: %s: not an x86_64 relocatable ELF object\n", name);
+        return false;
+    }
+    if (eh->e_shentsize != sizeof(Elf64_Shdr) || eh->e_shnum > MODULE_MAX_SECTIONS ||
+        eh->e_shstrndx >= eh->e_shnum ||
+        eh->e_shoff > size || (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr) > size - eh->e_shoff) {
+        kprintf("module: %s: bad section table\n", name);
+        return false;
+    }
+
+    const Elf64_Shdr *sh = (const Elf64_Shdr *)(file + eh->e_shoff);
+    for (int i = 0; i < eh->e_shnum; i++) {
+        if (sh[i].sh_type != SHT_NOBITS &&
+            (sh[i].sh_offset > size || sh[i].sh_size > size - sh[i].sh_offset)) {
+            kprintf("module: %s: section %d past the end of the file\n", name, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Value of symbol index sym, or false if it cannot be resolved
+ */
+static bool symbol_value(const uint8_t *file, uint64_t size, const Elf64_Shdr *sh,
+                         int shnum, const Elf64_Shdr *symtab, uint32_t index,
+                         uint64_t base, uint64_t *out, const char **undef) {
+    if (((uint64_t)index + 1) * sizeof(Elf64_Sym) > symtab->sh_size) {
+        *undef = "(bad symbol index)";
+        return false;
+    }
+    const Elf64_Sym *sym = (const Elf64_Sym *)(file + symtab->sh_offset) + index;
+
+    switch (sym->st_shndx) {
+    case SHN_UNDEF: {
+        const char *name = elf_str(file, size, &sh[symtab->sh_link], sym->st_name);
+        *out = name ? ksym_lookup(name) : 0;
+        if (*out == 0 && ELF64_ST_BIND(sym->st_info) != STB_WEAK) {
+            *undef = name ? name : "(bad name)";
+            return false;
+        }
+        return true;
+    }
+    case SHN_ABS:
+        *out = sym->st_value;
+        return true;
+    case SHN_COMMON:
+        *undef = "(common symbol: build with -fno-common)";
+        return false;
+    default:
+        if (sym->st_shndx >= shnum || sec_off[sym->st_shndx] == NOT_LOADED) {
+            *undef = "(symbol in a section that is not loaded)";
+            return false;
+        }
+        *out = base + sec_off[sym->st_shndx] + sym->st_value;
+        return true;
+    }
+}
+
+/**
+ * @brief Apply one RELA section
+ */
+static bool relocate(const uint8_t *file, uint64_t size, const Elf64_Shdr *sh, int shnum,
+                     const Elf64_Shdr *rela, uint64_t base, module_t *m) {
+    const Elf64_Shdr *target = &sh[rela->sh_info];
+    const Elf64_Shdr *symtab = &sh[rela->sh_link];
+    const Elf64_Rela *r = (const Elf64_Rela *)(file + rela->sh_offset);
+    uint64_t count = rela->sh_size / sizeof(Elf64_Rela);
+
+    for (uint64_t i = 0; i < count; i++, r++) {
+        uint32_t type = ELF64_R_TYPE(r->r_info);
+        uint64_t width = (type == R_X86_64_64 || type == R_X86_64_PC64) ? 8 : 4;
+        uint64_t s;
+        const char *undef;
+
+        if (type == R_X86_64_NONE) {
+            continue;
+        }
+        if (target->sh_size < width || r->r_offset > target->sh_size - width) {
+            kprintf("module: %s: relocation outside its section\n", m->name);
+            return false;
+        }
+        if (!symbol_value(file, size, sh, shnum, symtab, ELF64_R_SYM(r->r_info),
+                          base, &s, &undef)) {
+            kprintf("module: %s: unresolved symbol %s\n", m->name, undef);
+            return false;
+        }
+
+        uint64_t p = base + sec_off[rela->sh_info] + r->r_offset;
+        uint64_t v = s + (uint64_t)r->r_addend;
+        uint32_t v32;
+        switch (type) {
+        case R_X86_64_64:
+            memcpy((void *)p, &v, 8);
+            break;
+        case R_X86_64_PC64:
+            v -= p;
+            memcpy((void *)p, &v, 8);
+            break;
+        case R_X86_64_32:
+            if (v > UINT32_MAX) {
+                goto overflow;
+            }
+            v32 = (uint32_t)v;
+            memcpy((void *)p, &v32, 4);
+            break;
+        case R_X86_64_32S:
+            if ((int64_t)v != (int32_t)v) {
+                goto overflow;
+            }
+            v32 = (uint32_t)v;
+            memcpy((void *)p, &v32, 4);
+            break;
+        case R_X86_64_PC32:
+        case R_X86_64_PLT32:
+            v -= p;
+            if ((int64_t)v != (int32_t)v) {
+                goto overflow;
+            }
+            v32 = (uint32_t)v;
+            memcpy((void *)p, &v32, 4);
+            break;
+        default:
+            kprintf("module: %s: unsupported relocation type %u\n", m->name, type);
+            return false;
+        }
+        m->relocs++;
+    }
+    return true;
+
+overflow:
+    kprintf("module: %s: relocation out of range (build with -mcmodel=large)\n", m->name);
+    return false;
+}
+
+/**
+ * @brief Report every undefined symbol the kernel does not export
+ */
+static bool check_symbols(const uint8_t *file, uint64_t size, const Elf64_Shdr *sh,
+                          const Elf64_Shdr *symtab, const char *name) {
+    const Elf64_Sym *sym = (const Elf64_Sym *)(file + symtab->sh_offset);
+    uint64_t count = symtab->sh_size / sizeof(Elf64_Sym);
+    int missing = 0;
+
+    for (uint64_t i = 1; i < count; i++) {
+        if (sym[i].st_shndx != SHN_UNDEF || ELF64_ST_BIND(sym[i].st_info) == STB_WEAK) {
+            continue;
+        }
+        const char *sname = elf_str(file, size, &sh[symtab->sh_link], sym[i].st_name);
+        if (sname && ksym_lookup(sname)) {
+            continue;
+        }
+        if (missing++ < MAX_UNRESOLVED) {
+            kprintf("module: %s: %s is not exported\n", name, sname ? sname : "(bad name)");
+        }
+    }
+    return missing == 0;
+}
+
+/**
+ * @brief Load, relocate and initialize an image read from the archive
+ */
+static bool link_image(const uint8_t *file, uint64_t size, module_t *m) {
+    if (!elf_check(file, size, m->name)) {
+        return false;
+    }
+
+    const Elf64_Ehdr *eh = (const Elf64_Ehdr *)file;
+    const Elf64_Shdr *sh = (const Elf64_Shdr *)(file + eh->e_shoff);
+    int shnum = eh->e_shnum;
+    const Elf64_Shdr *symtab = NULL;
+
+    /* Lay the allocated sections out back to back */
+    uint64_t total = 0;
+    for (int i = 0; i < shnum; i++) {
+        sec_off[i] = NOT_LOADED;
+        if (sh[i].sh_type == SHT_SYMTAB) {
+            symtab = &sh[i];
+        }
+        if (!(sh[i].sh_flags & SHF_ALLOC) || sh[i].sh_size == 0) {
+            continue;
+        }
+        uint64_t align = sh[i].sh_addralign ? sh[i].sh_addralign : 1;
+        if (align > MAX_ALIGN || (align & (align - 1))) {
+            kprintf("module: %s: section %d has alignment %llu\n", m->name, i, align);
+            return false;
+        }
+        if (sh[i].sh_size > MAX_IMAGE) {
+            kprintf("module: %s: section %d is %llu bytes\n", m->name, i, sh[i].sh_size);
+            return false;
+        }
+        total = (total + align - 1) & ~(align - 1);
+        sec_off[i] = total;
+        total += sh[i].sh_size;
+        if (total > MAX_IMAGE) {
+            kprintf("module: %s: image larger than %llu MB\n", m->name, MAX_IMAGE >> 20);
+            return false;
+        }
+    }
+    if (!symtab || symtab->sh_link >= (uint32_t)shnum) {
+        kprintf("module: %s: no symbol table\n", m->name);
+        return false;
+    }
+    if (total == 0 || !check_symbols(file, size, sh, symtab, m->name)) {
+        return false;
+    }
+
+    uint8_t *image = vmalloc(total);
+    if (!image) {
+        kprintf("module: %s: out of memory for %llu bytes\n", m->name, total);
+        return false;
+    }
+    uint64_t base = (uint64_t)(uintptr_t)image;
+    for (int i = 0; i < shnum; i++) {
+        if (sec_off[i] != NOT_LOADED && sh[i].sh_type != SHT_NOBITS) {
+            memcpy(image + sec_off[i], file + sh[i].sh_offset, sh[i].sh_size);
+        }
+    }
+
+    for (int i = 0; i < shnum; i++) {
+        if (sh[i].sh_type != SHT_RELA || sh[i].sh_info >= (uint32_t)shnum ||
+            sec_off[sh[i].sh_info] == NOT_LOADED) {
+            continue;       /* Relocations of debug info and the like */
+        }
+        if (&sh[sh[i].sh_link] != symtab) {
+            kprintf("module: %s: relocations against another symbol table\n", m->name);
+            vfree(image);
+            return false;
+        }
+        if (!relocate(file, size, sh, shnum, &sh[i], base, m)) {
+            vfree(image);
+            return false;
+        }
+    }
+
+    m->base = base;
+    m->size = total;
+
+    /* Past this point the module may have registered itself: keep it */
+    const Elf64_Shdr *shstr = &sh[eh->e_shstrndx];
+    for (int i = 0; i < shnum; i++) {
+        const char *sname = elf_str(file, size, shstr, sh[i].sh_name);
+        if (!sname || strcmp(sname, ".initcalls") != 0 || sec_off[i] == NOT_LOADED) {
+            continue;
+        }
+        const initcall_t *ic = (const initcall_t *)(image + sec_off[i]);
+        uint64_t n = sh[i].sh_size / sizeof(initcall_t);
+        for (uint64_t k = 0; k < n; k++, m->initcalls++) {
+            if (!ic[k].fn()) {
+                kprintf("module: %s: initcall %s failed\n", m->name, ic[k].name);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Read, link and record the module of an archive entry
+ */
+static bool load_entry(const archive_entry_t *e) {
+    if (module_count == MODULE_MAX) {
+        kprintf("module: %s: %d modules already loaded\n", e->name, MODULE_MAX);
+        return false;
+    }
+    if (e->size == 0 || e->size > MODULE_MAX_FILE) {
+        kprintf("module: %s: bad size %u\n", e->name, e->size);
+        return false;
+    }
+
+    module_t *m = &modules[module_count];
+    memset(m, 0, sizeof(*m));
+    strcpy(m->name, e->name);
+    m->file_size = e->size;
+
+    uint32_t sectors = (e->size + ATA_SECTOR_SIZE - 1) / ATA_SECTOR_SIZE;
+    uint8_t *file = vmalloc((size_t)sectors * ATA_SECTOR_SIZE);
+    if (!file) {
+        kprintf("module: %s: out of memory\n", e->name);
+        return false;
+    }
+
+    uint64_t start = rdtsc();
+    if (!ata_read(e->lba, sectors, file)) {
+        kprintf("module: %s: disk read failed\n", e->name);
+        vfree(file);
+        return false;
+    }
+    uint64_t read = rdtsc();
+    bool ok = link_image(file, e->size, m);
+    m->read_ns = tsc_cycles_to_ns(read - start);
+    m->link_ns = tsc_cycles_to_ns(rdtsc() - read);
+    vfree(file);
+
+    if (ok) {
+        module_count++;
+    }
+    return ok;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+uint64_t ksym_lookup(const char *name) {
+    for (const ksym_t *k = __ksymtab_start; k < __ksymtab_end; k++) {
+        if (strcmp(k->name, name) == 0) {
+            return k->addr;
+        }
+    }
+    return 0;
+}
+
+int ksym_count(void) {
+    return (int)(__ksymtab_end - __ksymtab_start);
+}
+
+const module_t *module_find(const char *name) {
+    for (int i = 0; i < module_count; i++) {
+        if (strcmp(modules[i].name, name) == 0) {
+            return &modules[i];
+        }
+    }
+    return NULL;
+}
+
+const module_t *module_get(int index) {
+    if (index < 0 || index >= module_count) {
+        return NULL;
+    }
+    return &modules[index];
+}
+
+int module_list(module_entry_t *out, int max) {
+    int n = archive_scan();
+
+    for (int i = 0; i < n && i < max; i++) {
+        strcpy(out[i].name, archive[i].name);
+        out[i].size = archive[i].size;
+    }
+    return n;
+}
+
+bool module_load(const char *name) {
+    if (module_find(name)) {
+        return true;
+    }
+    if (strlen(name) >= MODULE_NAME_MAX) {
+        kprintf("module: %s: name too long\n", name);
+        return false;
+    }
+
+    const archive_entry_t *e = archive_find(name);
+    if (!e) {
+        if (archive_scan() < 0) {
+            kprintf("module: no module archive on the boot disk\n");
+        } else {
+            kprintf("module: %s: not in the archive\n", name);
+        }
+        return false;
+    }
+    return load_entry(e);
+}
+
+bool module_autoload(const char *name) {
+    if (module_find(name)) {
+        return true;
+    }
+
+    const archive_entry_t *e = archive_find(name);
+    return e ? load_entry(e) : false;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file module.h
+ * @brief Loadable kernel modules
+ *
+ * Rarely used code is built as relocatable ELF objects (.ko) instead of
+ * being linked into kernel.bin, so stage 2 has less to read through the
+ * BIOS and the kernel less to hold. The modules travel in a ustar
+ * archive written to the boot disk at MODULE_ARCHIVE_LBA and are read
+ * with the ATA driver the first time something needs them; the shell
+ * loads the module named like an unknown command before giving up.
+ *
+ * LOADING:
+ *   1. Find "<name>.ko" in the archive (whose headers are read once and
+ *      kept) and read it into a vmalloc buffer
+ *   2. Lay out every SHF_ALLOC section in one vmalloc area (.bss comes
+ *      from demand-zero pages, so it is not copied)
+ *   3. Resolve undefined symbols against the kernel's export table
+ *      (core/export.h); an unexported symbol fails the load
+ *   4. Apply the RELA relocations (R_X86_64_64/32/32S/PC32/PLT32/PC64)
+ *   5. Run the module's initcalls (core/initcall.h). Every built-in
+ *      initcall has finished by then, so dependency lists are not
+ *      consulted and entries run in section order.
+ *
+ * BUILDING:
+ *   Module sources compile with the kernel CFLAGS plus -DMODULE. The
+ *   large code model makes every reference to the kernel an absolute
+ *   64-bit relocation, so it does not matter that vmalloc space is far
+ *   from the kernel image.
+ *
+ * LIMITS:
+ *   Modules stay loaded: there is no unload, since nothing tracks who
+ *   holds a pointer into them (registered shell commands, for a start).
+ *   .stats and .metrics entries in a module are not registered.
+ *
+ * @example
+ *   static bool memtest_register(void) {
+ *       shell_register_command("memtest", "Burn-in test", cmd_memtest);
+ *       return true;
+ *   }
+ *   DEFINE_INITCALL(memtest, memtest_register, "", 0);
+ */
+
+#ifndef _CORE_MODULE_H
+#define _CORE_MODULE_H
+
+#include <squirel/types.h>
+
+/** @brief Longest module name, including the NUL */
+#define MODULE_NAME_MAX     32
+
+/** @brief Modules that can be loaded at once */
+#define MODULE_MAX          16
+
+/** @brief Largest .ko file accepted */
+#define MODULE_MAX_FILE     (1u << 20)
+
+/** @brief Largest number of ELF sections in a .ko */
+#define MODULE_MAX_SECTIONS 128
+
+/**
+ * @brief A loaded module
+ */
+typedef struct {
+    char name[MODULE_NAME_MAX];
+    uint64_t base;              /**< Start of the loaded sections */
+    uint64_t size;              /**< Bytes of loaded sections */
+    uint64_t file_size;         /**< Bytes of the .ko */
+    uint32_t relocs;            /**< Relocations applied */
+    uint32_t initcalls;         /**< Initcalls run */
+    uint64_t read_ns;           /**< Reading the .ko from disk */
+    uint64_t link_ns;           /**< Layout, symbols, relocations, init */
+} module_t;
+
+/**
+ * @brief An archive entry
+ */
+typedef struct {
+    char name[MODULE_NAME_MAX]; /**< Without ".ko" */
+    uint32_t size;              /**< Bytes of the .ko */
+} module_entry_t;
+
+/**
+ * @brief Load a module from the archive
+ *
+ * Errors are printed.
+ *
+ * @param name  Module name, without ".ko"
+ * @return      true if it is loaded (now or before)
+ */
+bool module_load(const char *name);
+
+/**
+ * @brief Load a module if the archive has one of that name
+ *
+ * Quiet when there is no disk or no such module.
+ *
+ * @return true if the module is loaded
+ */
+bool module_autoload(const char *name);
+
+/**
+ * @brief Find a loaded module
+ *
+ * @return The module, or NULL
+ */
+const module_t *module_find(const char *name);
+
+/**
+ * @brief Get a loaded module, in load order
+ *
+ * @return The module, or NULL if index is out of range
+ */
+const module_t *module_get(int index);
+
+/**
+ * @brief List the archive
+ *
+ * @param out  Receives up to max entries
+ * @param max  Capacity of out
+ * @return     Entries in the archive (may exceed max), or -1 without a
+ *             disk or archive
+ */
+int module_list(module_entry_t *out, int max);
+
+#endif /* _CORE_MODULE_H */
@@ -0,0 +1,82 @@
+/**
+ * @file stat.c
+ * @brief Per-CPU statistics counters implementation
+ */
+
+#include "stat.h"
+#include <squirel/config.h>
+#include <lib/string/string.h>
+#include <lib/printf/printf.h>
+
+/* Linker script symbols: the registry */
+extern const stat_desc_t __stats_start[];
+extern const stat_desc_t __stats_end[];
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+int stat_count(void) {
+    return (int)(__stats_end - __stats_start);
+}
+
+const stat_desc_t *stat_get(int index) {
+    if (index < 0 || index >= stat_count()) {
+        return NULL;
+    }
+    return &__stats_start[index];
+}
+
+const stat_desc_t *stat_find(const char *name) {
+    for (const stat_desc_t *s = __stats_start; s < __stats_end; s++) {
+        if (strcmp(s->name, name) == 0) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+uint64_t stat_read(const stat_desc_t *stat) {
+    uint64_t total = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        total += *(volatile uint64_t *)stat_cpu_ptr(stat->counter, cpu);
+    }
+    return total;
+}
+
+uint64_t stat_read_cpu(const stat_desc_t *stat, int cpu) {
+    if (cpu < 0 || cpu >= MAX_CPUS) {
+        return 0;
+    }
+    return *(volatile uint64_t *)stat_cpu_ptr(stat->counter, cpu);
+}
+
+void stat_reset(const stat_desc_t *stat) {
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        *(volatile uint64_t *)stat_cpu_ptr(stat->counter, cpu) = 0;
+    }
+}
+
+void stat_export(void (*write)(const char *buf, size_t len)) {
+    char line[160];
+    int len;
+
+    len = ksnprintf(line, sizeof(line), "# squirel-stats 1 cpus=%d count=%d\n",
+                    cpu_count(), stat_count());
+    write(line, (size_t)len);
+
+    for (const stat_desc_t *s = __stats_start; s < __stats_end; s++) {
+        len = ksnprintf(line, sizeof(line), "%s %llu", s->name, stat_read(s));
+        for (int cpu = 0; cpu < cpu_count() && len < (int)sizeof(line) - 1; cpu++) {
+            len += ksnprintf(line + len, sizeof(line) - (size_t)len, " %llu",
+                             stat_read_cpu(s, cpu));
+        }
+        if (len > (int)sizeof(line) - 2) {
+            len = (int)sizeof(line) - 2;    /* Truncated; still one line */
+        }
+        line[len++] = '\n';
+        write(line, (size_t)len);
+    }
+
+    write("# end\n", 6);
+}
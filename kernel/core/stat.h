@@ -0,0 +1,160 @@
+/**
+ * @file stat.h
+ * @brief Per-CPU statistics counters
+ *
+ * Counters are defined anywhere with DEFINE_STAT() and bumped with
+ * stat_inc()/stat_add(). Each CPU only ever writes its own copy, so the
+ * hot path is a single unlocked add to a line no other CPU touches;
+ * readers sum the copies when they ask (stat_read()).
+ *
+ * LAYOUT:
+ *   DEFINE_STAT places the CPU 0 copy of the counter in .bss.percpu and
+ *   a descriptor in .stats. The linker script gathers all .bss.percpu
+ *   counters into one cache-line-aligned block and reserves MAX_CPUS - 1
+ *   more copies of that block right after it:
+ *
+ *     __percpu_start  [cpu0: a b c ... pad to 64B]
+ *                     [cpu1: a b c ... pad to 64B]
+ *                     ...
+ *
+ *   CPU n's copy of a counter lives n * stat_percpu_stride() bytes after
+ *   CPU 0's. The .stats section is the registry: __stats_start ..
+ *   __stats_end is an array of every descriptor in the kernel, so
+ *   nothing has to call a register function.
+ *
+ * ATOMICITY:
+ *   The add is one read-modify-write instruction, so an interrupt on
+ *   the same CPU cannot split it; no lock prefix is needed because no
+ *   other CPU writes the same copy. Aligned 64-bit loads never tear, so
+ *   a reader sees each copy either before or after an update.
+ *
+ * @example
+ *   DEFINE_STAT(disk_reads, "Sectors read");
+ *   ...
+ *   stat_inc(disk_reads);
+ */
+
+#ifndef _CORE_STAT_H
+#define _CORE_STAT_H
+
+#include <squirel/types.h>
+#include <arch/x86_64/cpu/cpu.h>
+
+/* ============================================================================
+ * Types
+ * ============================================================================ */
+
+/**
+ * @brief Registry entry emitted by DEFINE_STAT (one per counter)
+ *
+ * Sized and aligned to 32 bytes so the .stats section is a plain array
+ * whatever alignment the compiler would otherwise pick.
+ */
+typedef struct {
+    const char *name;       /**< Identifier, also the export name */
+    const char *help;       /**< One-line description */
+    uint64_t *counter;      /**< CPU 0's copy */
+    uint64_t reserved;
+} ALIGNED(32) stat_desc_t;
+
+/* Linker script symbols */
+extern char __percpu_start[];
+extern char __percpu_end[];
+
+/* ============================================================================
+ * Definition Macros
+ * ============================================================================ */
+
+/**
+ * @brief Define a counter and register it
+ *
+ * @param var   C identifier (stat_inc(var), shown as "var")
+ * @param help  Description string
+ */
+#define DEFINE_STAT(var, help)                                              \
+    uint64_t stat_pcpu_##var __attribute__((section(".bss.percpu")));       \
+    static const stat_desc_t stat_desc_##var                                \
+        __attribute__((section(".stats"), used)) =                          \
+        { #var, help, &stat_pcpu_##var, 0 }
+
+/**
+ * @brief Use a counter defined in another file
+ */
+#define DECLARE_STAT(var)   extern uint64_t stat_pcpu_##var
+
+/** @brief Add one to a counter on the calling CPU */
+#define stat_inc(var)       stat_add_raw(&stat_pcpu_##var, 1)
+
+/** @brief Add n to a counter on the calling CPU */
+#define stat_add(var, n)    stat_add_raw(&stat_pcpu_##var, (uint64_t)(n))
+
+/* ============================================================================
+ * Hot Path
+ * ============================================================================ */
+
+/**
+ * @brief Bytes between one CPU's copy of a counter and the next CPU's
+ */
+static ALWAYS_INLINE size_t stat_percpu_stride(void) {
+    return (size_t)(__percpu_end - __percpu_start);
+}
+
+/**
+ * @brief Address of a CPU's copy of a counter
+ */
+static ALWAYS_INLINE uint64_t *stat_cpu_ptr(uint64_t *counter, int cpu) {
+    return (uint64_t *)((char *)counter + (size_t)cpu * stat_percpu_stride());
+}
+
+static ALWAYS_INLINE void stat_add_raw(uint64_t *counter, uint64_t n) {
+    uint64_t *p = stat_cpu_ptr(counter, cpu_id());
+    __asm__ volatile("addq %1, %0" : "+m"(*p) : "er"(n));
+}
+
+/* ============================================================================
+ * Reading
+ * ============================================================================ */
+
+/**
+ * @brief Number of registered counters
+ */
+int stat_count(void);
+
+/**
+ * @brief Get a registered counter by index (0 .. stat_count()-1)
+ */
+const stat_desc_t *stat_get(int index);
+
+/**
+ * @brief Find a registered counter by name
+ */
+const stat_desc_t *stat_find(const char *name);
+
+/**
+ * @brief Sum a counter over all CPUs
+ */
+uint64_t stat_read(const stat_desc_t *stat);
+
+/**
+ * @brief Read one CPU's copy of a counter
+ */
+uint64_t stat_read_cpu(const stat_desc_t *stat, int cpu);
+
+/**
+ * @brief Zero every CPU's copy of a counter
+ */
+void stat_reset(const stat_desc_t *stat);
+
+/**
+ * @brief Write all counters in the line-based export format
+ *
+ * FORMAT (one record per line, fields separated by single spaces):
+ *   # squirel-stats 1 cpus=<n> count=<counters>
+ *   <name> <total> <cpu0> ... <cpuN-1>
+ *   # end
+ *
+ * @param write  Output function (e.g. serial_write)
+ */
+void stat_export(void (*write)(const char *buf, size_t len));
+
+#endif /* _CORE_STAT_H */
@@ -0,0 +1,346 @@
+/**
+ * @file ata.c
+ * @brief ATA PIO disk driver implementation
+ */
+
+#include "ata.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/io/port.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <core/initcall.h>
+#include <core/stat.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/* Command block registers (offsets from ATA_PRIMARY_IO) */
+#define REG_DATA            0
+#define REG_ERROR           1
+#define REG_SECCOUNT        2
+#define REG_LBA0            3
+#define REG_LBA1            4
+#define REG_LBA2            5
+#define REG_DRIVE           6
+#define REG_STATUS          7
+#define REG_COMMAND         7
+
+/* Status bits */
+#define STATUS_ERR          0x01
+#define STATUS_DRQ          0x08
+#define STATUS_DF           0x20
+#define STATUS_BSY          0x80
+
+/* Device control: no interrupts, we poll */
+#define CTRL_NIEN           0x02
+
+#define CMD_READ_SECTORS        0x20
+#define CMD_READ_SECTORS_EXT    0x24
+#define CMD_WRITE_SECTORS       0x30
+#define CMD_WRITE_SECTORS_EXT   0x34
+#define CMD_FLUSH_CACHE         0xE7
+#define CMD_FLUSH_CACHE_EXT     0xEA
+#define CMD_IDENTIFY            0xEC
+
+/** @brief Drive register: master, LBA addressing */
+#define DRIVE_MASTER_LBA    0xE0
+
+/** @brief Sectors per READ/WRITE SECTORS command (a count of 0 means 256) */
+#define MAX_PER_COMMAND     256
+
+/** @brief Longest wait for BSY to clear or DRQ to set */
+#define ATA_TIMEOUT_US      1000000
+
+#define LBA28_LIMIT         (1ull << 28)
+
+/* IDENTIFY words */
+#define ID_MODEL            27
+#define ID_MODEL_WORDS      20
+#define ID_LBA28_SECTORS    60
+#define ID_COMMAND_SETS     83
+#define ID_LBA48_SECTORS    100
+#define ID_LBA48_SUPPORTED  (1u << 10)
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static bool disk_present = false;
+static uint64_t disk_sectors = 0;
+static bool disk_lba48 = false;
+static char disk_model[ID_MODEL_WORDS * 2 + 1];
+
+DEFINE_STAT(ata_sectors_read, "Sectors read from the ATA disk");
+DEFINE_STAT(ata_sectors_written, "Sectors written to the ATA disk");
+DEFINE_STAT(ata_errors, "ATA commands that failed or timed out");
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static inline uint8_t status(void) {
+    return inb(ATA_PRIMARY_IO + REG_STATUS);
+}
+
+/**
+ * @brief Give the device the 400ns it needs to update its status
+ */
+static void delay_400ns(void) {
+    for (int i = 0; i < 4; i++) {
+        inb(ATA_PRIMARY_CTRL);
+    }
+}
+
+/**
+ * @brief Wait until BSY clears
+ *
+ * @return The status, or 0xFF on timeout
+ */
+static uint8_t wait_not_busy(void) {
+    uint64_t deadline = rdtsc() + tsc_us_to_cycles(ATA_TIMEOUT_US);
+    uint8_t st;
+    while ((st = status()) & STATUS_BSY) {
+        if (rdtsc() > deadline) {
+            return 0xFF;
+        }
+        cpu_relax();
+    }
+    return st;
+}
+
+/**
+ * @brief Wait for a sector to be ready in the data port
+ */
+static bool wait_drq(void) {
+    uint64_t deadline = rdtsc() + tsc_us_to_cycles(ATA_TIMEOUT_US);
+    for (;;) {
+        uint8_t st = status();
+        if (!(st & STATUS_BSY)) {
+            if (st & (STATUS_ERR | STATUS_DF)) {
+                return false;
+            }
+            if (st & STATUS_DRQ) {
+                return true;
+            }
+        }
+        if (rdtsc() > deadline) {
+            return false;
+        }
+        cpu_relax();
+    }
+}
+
+/**
+ * @brief Copy the byte-swapped, space-padded IDENTIFY model string
+ */
+static void read_model(const uint16_t *id) {
+    int len = 0;
+    for (int i = 0; i < ID_MODEL_WORDS; i++) {
+        disk_model[len++] = (char)(id[ID_MODEL + i] >> 8);
+        disk_model[len++] = (char)(id[ID_MODEL + i] & 0xFF);
+    }
+    while (len > 0 && disk_model[len - 1] == ' ') {
+        len--;
+    }
+    disk_model[len] = '\0';
+}
+
+/**
+ * @brief Start a sector transfer command
+ *
+ * @param cmd  LBA28 command, or its EXT form when ext is set
+ */
+static void issue(uint64_t lba, uint32_t count, bool ext, uint8_t cmd) {
+    uint16_t io = ATA_PRIMARY_IO;
+
+    if (ext) {
+        /* High bytes first, then the low ones (count 0 means 65536) */
+        outb(io + REG_DRIVE, DRIVE_MASTER_LBA & ~0x10);
+        outb(io + REG_SECCOUNT, (uint8_t)(count >> 8));
+        outb(io + REG_LBA0, (uint8_t)(lba >> 24));
+        outb(io + REG_LBA1, (uint8_t)(lba >> 32));
+        outb(io + REG_LBA2, (uint8_t)(lba >> 40));
+        outb(io + REG_SECCOUNT, (uint8_t)count);
+        outb(io + REG_LBA0, (uint8_t)lba);
+        outb(io + REG_LBA1, (uint8_t)(lba >> 8));
+        outb(io + REG_LBA2, (uint8_t)(lba >> 16));
+    } else {
+        outb(io + REG_DRIVE, DRIVE_MASTER_LBA | (uint8_t)((lba >> 24) & 0x0F));
+        outb(io + REG_SECCOUNT, (uint8_t)count);   /* 256 wraps to 0 */
+        outb(io + REG_LBA0, (uint8_t)lba);
+        outb(io + REG_LBA1, (uint8_t)(lba >> 8));
+        outb(io + REG_LBA2, (uint8_t)(lba >> 16));
+    }
+    outb(io + REG_COMMAND, cmd);
+}
+
+/**
+ * @brief Check that a range lies on the disk
+ */
+static bool in_range(uint64_t lba, uint32_t count) {
+    return disk_present && lba + count <= disk_sectors && lba + count >= lba;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool ata_init(void) {
+    uint16_t io = ATA_PRIMARY_IO;
+    uint16_t id[256];
+
+    disk_present = false;
+    outb(ATA_PRIMARY_CTRL, CTRL_NIEN);
+    outb(io + REG_DRIVE, DRIVE_MASTER_LBA);
+    delay_400ns();
+    if (status() == 0xFF) {
+        return false;           /* Floating bus: no channel */
+    }
+
+    outb(io + REG_SECCOUNT, 0);
+    outb(io + REG_LBA0, 0);
+    outb(io + REG_LBA1, 0);
+    outb(io + REG_LBA2, 0);
+    outb(io + REG_COMMAND, CMD_IDENTIFY);
+    delay_400ns();
+    if (status() == 0 || wait_not_busy() == 0xFF) {
+        return false;           /* No device, or it never answered */
+    }
+    if (inb(io + REG_LBA1) != 0 || inb(io + REG_LBA2) != 0) {
+        return false;           /* ATAPI/SATA signature: not a plain disk */
+    }
+    if (!wait_drq()) {
+        return false;
+    }
+    insw(io + REG_DATA, id, 256);
+
+    disk_lba48 = (id[ID_COMMAND_SETS] & ID_LBA48_SUPPORTED) != 0;
+    if (disk_lba48) {
+        disk_sectors = (uint64_t)id[ID_LBA48_SECTORS] |
+                       (uint64_t)id[ID_LBA48_SECTORS + 1] << 16 |
+                       (uint64_t)id[ID_LBA48_SECTORS + 2] << 32 |
+                       (uint64_t)id[ID_LBA48_SECTORS + 3] << 48;
+    }
+    if (!disk_lba48 || disk_sectors == 0) {
+        disk_sectors = (uint64_t)id[ID_LBA28_SECTORS] |
+                       (uint64_t)id[ID_LBA28_SECTORS + 1] << 16;
+    }
+    read_model(id);
+    disk_present = disk_sectors != 0;
+    return disk_present;
+}
+
+/* Nothing waits for the disk until a module is needed */
+DEFINE_INITCALL(ata, ata_init, "tsc", INITCALL_ASYNC);
+
+bool ata_present(void) {
+    return disk_present;
+}
+
+uint64_t ata_sectors(void) {
+    return disk_present ? disk_sectors : 0;
+}
+
+const char *ata_model(void) {
+    return disk_present ? disk_model : "";
+}
+
+bool ata_read(uint64_t lba, uint32_t count, void *buf) {
+    uint8_t *dst = buf;
+
+    if (!in_range(lba, count)) {
+        return false;
+    }
+
+    while (count > 0) {
+        uint32_t n = count > MAX_PER_COMMAND ? MAX_PER_COMMAND : count;
+
+        if (wait_not_busy() == 0xFF) {
+            stat_inc(ata_errors);
+            return false;
+        }
+        /* Only sectors past LBA28's reach need the 48-bit command */
+        if (lba + n > LBA28_LIMIT) {
+            issue(lba, n, true, CMD_READ_SECTORS_EXT);
+        } else {
+            issue(lba, n, false, CMD_READ_SECTORS);
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            delay_400ns();
+            if (!wait_drq()) {
+                stat_inc(ata_errors);
+                return false;
+            }
+            insw(ATA_PRIMARY_IO + REG_DATA, dst, ATA_SECTOR_SIZE / 2);
+            dst += ATA_SECTOR_SIZE;
+        }
+        stat_add(ata_sectors_read, n);
+        lba += n;
+        count -= n;
+    }
+    return true;
+}
+
+bool ata_write(uint64_t lba, uint32_t count, const void *buf) {
+    const uint8_t *src = buf;
+
+    if (!in_range(lba, count)) {
+        return false;
+    }
+
+    while (count > 0) {
+        uint32_t n = count > MAX_PER_COMMAND ? MAX_PER_COMMAND : count;
+
+        if (wait_not_busy() == 0xFF) {
+            stat_inc(ata_errors);
+            return false;
+        }
+        if (lba + n > LBA28_LIMIT) {
+            issue(lba, n, true, CMD_WRITE_SECTORS_EXT);
+        } else {
+            issue(lba, n, false, CMD_WRITE_SECTORS);
+        }
+
+        /* The device asks for each sector with DRQ */
+        for (uint32_t i = 0; i < n; i++) {
+            delay_400ns();
+            if (!wait_drq()) {
+                stat_inc(ata_errors);
+                return false;
+            }
+            outsw(ATA_PRIMARY_IO + REG_DATA, src, ATA_SECTOR_SIZE / 2);
+            src += ATA_SECTOR_SIZE;
+        }
+
+        /* BSY stays set until the last sector is taken */
+        delay_400ns();
+        uint8_t st = wait_not_busy();
+        if (st == 0xFF || (st & (STATUS_ERR | STATUS_DF))) {
+            stat_inc(ata_errors);
+            return false;
+        }
+        stat_add(ata_sectors_written, n);
+        lba += n;
+        count -= n;
+    }
+    return true;
+}
+
+bool ata_flush(void) {
+    if (!disk_present || wait_not_busy() == 0xFF) {
+        return false;
+    }
+
+    outb(ATA_PRIMARY_IO + REG_DRIVE, DRIVE_MASTER_LBA);
+    outb(ATA_PRIMARY_IO + REG_COMMAND, disk_lba48 ? CMD_FLUSH_CACHE_EXT : CMD_FLUSH_CACHE);
+    delay_400ns();
+
+    uint8_t st = wait_not_busy();
+    if (st == 0xFF || (st & (STATUS_ERR | STATUS_DF))) {
+        stat_inc(ata_errors);
+        return false;
+    }
+    return true;
+}
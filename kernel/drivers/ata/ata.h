@@ -0,0 +1,80 @@
+/**
+ * @file ata.h
+ * @brief ATA PIO disk driver interface (primary master)
+ *
+ * QEMU attaches "-drive format=raw,file=..." to the primary IDE channel
+ * as the master device, so this is the disk the BIOS booted from. The
+ * module archive (core/module.h) is read from it and hibernation images
+ * (core/hibernate.h) are written to it.
+ *
+ * TRANSFERS:
+ *   Programmed I/O with interrupts masked (nIEN): each READ SECTORS or
+ *   WRITE SECTORS command moves up to 256 sectors, 256 words per sector
+ *   through the data port, polling the status register between sectors.
+ *   LBA28 is used below 2^28 sectors and LBA48 above. Writes may sit in
+ *   the drive's cache until ata_flush().
+ *
+ * DETECTION:
+ *   A status of 0xFF means nothing drives the bus. Otherwise IDENTIFY
+ *   DEVICE gives the size and model; ATAPI devices (which abort it) are
+ *   not used.
+ */
+
+#ifndef _DRIVERS_ATA_H
+#define _DRIVERS_ATA_H
+
+#include <squirel/types.h>
+
+/** @brief Bytes per sector */
+#define ATA_SECTOR_SIZE     512
+
+/**
+ * @brief Probe the primary master
+ *
+ * @return true if an ATA disk answered IDENTIFY
+ */
+bool ata_init(void);
+
+/**
+ * @brief Check whether a disk was found
+ */
+bool ata_present(void);
+
+/**
+ * @brief Disk size in sectors (0 without a disk)
+ */
+uint64_t ata_sectors(void);
+
+/**
+ * @brief Model string from IDENTIFY (empty without a disk)
+ */
+const char *ata_model(void);
+
+/**
+ * @brief Read sectors
+ *
+ * @param lba    First sector
+ * @param count  Number of sectors
+ * @param buf    Destination, count * ATA_SECTOR_SIZE bytes
+ * @return       false on a device error, timeout, or a range past the end
+ */
+bool ata_read(uint64_t lba, uint32_t count, void *buf);
+
+/**
+ * @brief Write sectors
+ *
+ * @param lba    First sector
+ * @param count  Number of sectors
+ * @param buf    Source, count * ATA_SECTOR_SIZE bytes
+ * @return       false on a device error, timeout, or a range past the end
+ */
+bool ata_write(uint64_t lba, uint32_t count, const void *buf);
+
+/**
+ * @brief Wait until written sectors have left the drive's write cache
+ *
+ * @return false on a device error or timeout
+ */
+bool ata_flush(void);
+
+#endif /* _DRIVERS_ATA_H */
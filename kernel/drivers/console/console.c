@@ -0,0 +1,193 @@
+/**
+ * @file console.c
+ * @brief Console backend abstraction implementation
+ */
+
+#include "console.h"
+#include <squirel/config.h>
+#include <drivers/vga/vga_text.h>
+#include <drivers/serial/serial.h>
+#include <drivers/debugcon/debugcon.h>
+#include <drivers/virtio/virtio_console.h>
+#include <drivers/fw_cfg/fw_cfg.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <core/stat.h>
+
+/* ============================================================================
+ * Backend Adapters
+ * ============================================================================ */
+
+static bool vga_available(void) {
+    return true;
+}
+
+static bool vclog_available(void) {
+    return true;
+}
+
+static void vclog_write(const char *buf, size_t len) {
+    /* Already shown there if the log console is the one selected */
+    if (vga_console_current() != VC_LOG) {
+        vga_console_write(VC_LOG, buf, len);
+    }
+}
+
+static bool serial_available(void) {
+    return true;
+}
+
+static bool virtio_available(void) {
+    return virtio_console_port_ready(VIRTIO_CONSOLE_PORT_CONSOLE);
+}
+
+static void virtio_write(const char *buf, size_t len) {
+    virtio_console_write(VIRTIO_CONSOLE_PORT_CONSOLE, buf, len);
+}
+
+static void virtio_flush(void) {
+    virtio_console_flush(VIRTIO_CONSOLE_PORT_CONSOLE);
+}
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static const console_backend_t backends[] = {
+    { "vga",      CONSOLE_SINK_VGA,      vga_available,     vga_write,       NULL },
+    { "vclog",    CONSOLE_SINK_VCLOG,    vclog_available,   vclog_write,     NULL },
+    { "serial",   CONSOLE_SINK_SERIAL,   serial_available,  serial_write,    NULL },
+    { "debugcon", CONSOLE_SINK_DEBUGCON, debugcon_present,  debugcon_write,  NULL },
+    { "virtio",   CONSOLE_SINK_VIRTIO,   virtio_available,  virtio_write,    virtio_flush },
+};
+
+#define NUM_BACKENDS ((int)(sizeof(backends) / sizeof(backends[0])))
+
+/** @brief Enabled sinks (VGA only until console_init runs) */
+static uint32_t enabled_sinks = CONSOLE_SINK_VGA;
+
+/** @brief Log ring and the number of bytes ever written to it */
+static char log_ring[CONSOLE_LOG_SIZE];
+static uint64_t log_written = 0;
+
+DEFINE_STAT(console_writes, "Buffers written to the console sinks");
+DEFINE_STAT(console_bytes, "Bytes written to the console sinks");
+
+/* ============================================================================
+ * Log Ring
+ * ============================================================================ */
+
+static void log_append(const char *buf, size_t len) {
+    if (len > CONSOLE_LOG_SIZE) {
+        log_written += len - CONSOLE_LOG_SIZE;
+        buf += len - CONSOLE_LOG_SIZE;
+        len = CONSOLE_LOG_SIZE;
+    }
+    size_t at = log_written % CONSOLE_LOG_SIZE;
+    size_t first = CONSOLE_LOG_SIZE - at < len ? CONSOLE_LOG_SIZE - at : len;
+    memcpy(log_ring + at, buf, first);
+    memcpy(log_ring, buf + first, len - first);
+    log_written += len;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void console_init(void) {
+    uint32_t sinks;
+    char list[64];
+
+    if (console_parse_sinks(CONSOLE_DEFAULT_SINKS, &sinks)) {
+        enabled_sinks = sinks;
+    }
+
+    if (fw_cfg_read_file(CONSOLE_FW_CFG_FILE, list, sizeof(list)) > 0 &&
+        console_parse_sinks(list, &sinks)) {
+        enabled_sinks = sinks;
+    }
+}
+
+void console_write(const char *buf, size_t len) {
+    stat_inc(console_writes);
+    stat_add(console_bytes, len);
+    log_append(buf, len);
+
+    for (int i = 0; i < NUM_BACKENDS; i++) {
+        if ((enabled_sinks & backends[i].sink) && backends[i].available()) {
+            backends[i].write(buf, len);
+        }
+    }
+}
+
+void console_flush(void) {
+    for (int i = 0; i < NUM_BACKENDS; i++) {
+        if ((enabled_sinks & backends[i].sink) && backends[i].flush &&
+            backends[i].available()) {
+            backends[i].flush();
+        }
+    }
+}
+
+uint32_t console_get_sinks(void) {
+    return enabled_sinks;
+}
+
+void console_set_sinks(uint32_t sinks) {
+    enabled_sinks = sinks;
+}
+
+bool console_parse_sinks(const char *list, uint32_t *out) {
+    uint32_t mask = 0;
+    char name[16];
+
+    while (*list) {
+        /* Skip separators (and a trailing newline from -fw_cfg file=) */
+        while (*list == ',' || *list == '+' || isspace(*list)) {
+            list++;
+        }
+        if (*list == '\0') {
+            break;
+        }
+
+        size_t n = 0;
+        while (*list && *list != ',' && *list != '+' && !isspace(*list)) {
+            if (n < sizeof(name) - 1) {
+                name[n++] = *list;
+            }
+            list++;
+        }
+        name[n] = '\0';
+
+        int i;
+        for (i = 0; i < NUM_BACKENDS; i++) {
+            if (strcmp(name, backends[i].name) == 0) {
+                mask |= backends[i].sink;
+                break;
+            }
+        }
+        if (i == NUM_BACKENDS) {
+            return false;
+        }
+    }
+
+    *out = mask;
+    return true;
+}
+
+size_t console_log_read(char *out, size_t max) {
+    size_t n = log_written < CONSOLE_LOG_SIZE ? (size_t)log_written : CONSOLE_LOG_SIZE;
+    if (n > max) {
+        n = max;
+    }
+    uint64_t first = log_written - n;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = log_ring[(first + i) % CONSOLE_LOG_SIZE];
+    }
+    return n;
+}
+
+int console_get_backends(const console_backend_t **out_backends) {
+    *out_backends = backends;
+    return NUM_BACKENDS;
+}
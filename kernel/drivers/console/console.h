@@ -0,0 +1,115 @@
+/**
+ * @file console.h
+ * @brief Console backend abstraction (kprintf sinks)
+ *
+ * Every output device that can carry the kernel log registers as a
+ * console backend. kprintf formats once into a small buffer and hands
+ * whole chunks to each enabled backend, so devices with a bulk path
+ * (rep outsb, virtqueues) get buffers instead of single characters.
+ *
+ * BACKENDS:
+ *   vga       - VGA text screen (always available)
+ *   serial    - COM1 16550 UART, polled per byte
+ *   debugcon  - QEMU/Bochs port 0xE9, bulk writes with rep outsb
+ *   virtio    - virtio-console port 0, one descriptor per chunk
+ *
+ * LOG RING:
+ *   Whatever any sink is given is also kept in a ring of the last
+ *   CONSOLE_LOG_SIZE bytes, whichever sinks are enabled, so a crash dump
+ *   (core/kdump.h) carries the log leading up to the crash.
+ *
+ * SINK SELECTION:
+ *   The enabled set starts as CONSOLE_DEFAULT_SINKS and is replaced at
+ *   boot by the fw_cfg file CONSOLE_FW_CFG_FILE when the host provides
+ *   one. The 'console' shell command changes it at runtime.
+ */
+
+#ifndef _DRIVERS_CONSOLE_H
+#define _DRIVERS_CONSOLE_H
+
+#include <squirel/types.h>
+
+/* ============================================================================
+ * Sink Bits
+ * ============================================================================ */
+
+#define CONSOLE_SINK_VGA        (1u << 0)
+#define CONSOLE_SINK_SERIAL     (1u << 1)
+#define CONSOLE_SINK_DEBUGCON   (1u << 2)
+#define CONSOLE_SINK_VIRTIO     (1u << 3)
+#define CONSOLE_SINK_VCLOG      (1u << 4)
+
+/* ============================================================================
+ * Backend Descriptor
+ * ============================================================================ */
+
+/**
+ * @brief A console output device
+ */
+typedef struct {
+    const char *name;                           /**< Name used in sink lists */
+    uint32_t sink;                              /**< CONSOLE_SINK_* bit */
+    bool (*available)(void);                    /**< Device detected? */
+    void (*write)(const char *buf, size_t len); /**< Bulk write */
+    void (*flush)(void);                        /**< Push out batched data (may be NULL) */
+} console_backend_t;
+
+/* ============================================================================
+ * Console Functions
+ * ============================================================================ */
+
+/**
+ * @brief Select the boot-time sinks
+ *
+ * Applies CONSOLE_DEFAULT_SINKS, then the fw_cfg override if present.
+ * Call after the backend drivers have been probed.
+ */
+void console_init(void);
+
+/**
+ * @brief Write a buffer to every enabled, available sink
+ */
+void console_write(const char *buf, size_t len);
+
+/**
+ * @brief Flush sinks that batch output (end of a kprintf call)
+ */
+void console_flush(void);
+
+/**
+ * @brief Get the enabled sink mask
+ */
+uint32_t console_get_sinks(void);
+
+/**
+ * @brief Replace the enabled sink mask
+ */
+void console_set_sinks(uint32_t sinks);
+
+/**
+ * @brief Parse a sink list ("vga,debugcon" or "vga+debugcon")
+ *
+ * @param list  Sink names separated by ',', '+' or spaces
+ * @param out   Resulting mask
+ * @return      false if a name is not recognized
+ */
+bool console_parse_sinks(const char *list, uint32_t *out);
+
+/**
+ * @brief Copy the most recent output out of the log ring
+ *
+ * @param out  Destination, oldest byte first
+ * @param max  Room in out
+ * @return     Bytes copied (at most CONSOLE_LOG_SIZE)
+ */
+size_t console_log_read(char *out, size_t max);
+
+/**
+ * @brief Get the backend table
+ *
+ * @param out_backends  Receives a pointer to the table
+ * @return              Number of backends
+ */
+int console_get_backends(const console_backend_t **out_backends);
+
+#endif /* _DRIVERS_CONSOLE_H */
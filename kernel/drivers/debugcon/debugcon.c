@@ -0,0 +1,37 @@
+/**
+ * @file debugcon.c
+ * @brief QEMU/Bochs debug console (port 0xE9) driver implementation
+ */
+
+#include "debugcon.h"
+#include <squirel/config.h>
+#include <arch/x86_64/io/port.h>
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static bool debugcon_detected = false;
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool debugcon_init(void) {
+    debugcon_detected = (inb(DEBUGCON_PORT) == DEBUGCON_PORT);
+    return debugcon_detected;
+}
+
+bool debugcon_present(void) {
+    return debugcon_detected;
+}
+
+void debugcon_putchar(char c) {
+    outb(DEBUGCON_PORT, (uint8_t)c);
+}
+
+void debugcon_write(const char *buf, size_t len) {
+    if (len > 0) {
+        outsb(DEBUGCON_PORT, buf, len);
+    }
+}
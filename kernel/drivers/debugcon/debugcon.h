@@ -0,0 +1,44 @@
+/**
+ * @file debugcon.h
+ * @brief QEMU/Bochs debug console (port 0xE9) driver interface
+ *
+ * The debug console is a write-only byte sink: every OUT to port 0xE9
+ * is forwarded to the host (QEMU: -debugcon file:out.log). There is no
+ * status register to poll and no baud rate, so it sits between the
+ * 16550 UART and virtio-console in cost and complexity.
+ *
+ * DETECTION:
+ *   Reading port 0xE9 returns 0xE9 when the device is present.
+ */
+
+#ifndef _DRIVERS_DEBUGCON_H
+#define _DRIVERS_DEBUGCON_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Probe for the debug console
+ *
+ * @return true if port 0xE9 is backed by a debugcon device
+ */
+bool debugcon_init(void);
+
+/**
+ * @brief Check whether the debug console was detected
+ */
+bool debugcon_present(void);
+
+/**
+ * @brief Write a single byte
+ */
+void debugcon_putchar(char c);
+
+/**
+ * @brief Write a buffer with one string I/O instruction (rep outsb)
+ *
+ * @param buf  Data
+ * @param len  Length in bytes
+ */
+void debugcon_write(const char *buf, size_t len);
+
+#endif /* _DRIVERS_DEBUGCON_H */
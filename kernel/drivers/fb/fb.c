@@ -0,0 +1,416 @@
+/**
+ * @file fb.c
+ * @brief Linear framebuffer driver implementation
+ */
+
+#include "fb.h"
+#include <squirel/config.h>
+#include <squirel/bootinfo.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/mm/paging.h>
+#include <lib/memory/memory.h>
+#include <core/metrics.h>
+
+/* ============================================================================
+ * Private Types and State
+ * ============================================================================ */
+
+/** @brief Copy one row of pixels */
+typedef void (*row_copy_fn)(void *dst, const void *src, size_t bytes);
+
+/**
+ * @brief A blitter: a cached copy for the back buffer and a streaming
+ *        copy for video memory
+ */
+typedef struct {
+    const char *name;
+    uint32_t required;          /**< CPU_FEAT_* needed */
+    row_copy_fn copy;           /**< RAM to RAM (result is read back later) */
+    row_copy_fn stream;         /**< RAM to video memory (never read back) */
+} blitter_ops_t;
+
+static fb_info_t info;
+static bool present = false;
+
+/** @brief Video memory (identity mapped by stage 2) */
+static uint8_t *vram;
+
+/** @brief Back buffer; rows are info.width pixels apart */
+static uint32_t back[FB_MAX_WIDTH * FB_MAX_HEIGHT] ALIGNED(64);
+static size_t back_pitch;
+
+/** @brief Damage rectangle [x0, x1) x [y0, y1); empty when x0 >= x1 */
+static int dmg_x0, dmg_y0, dmg_x1, dmg_y1;
+
+/** @brief Pixel field layout */
+static uint8_t red_pos, red_size, green_pos, green_size, blue_pos, blue_size;
+
+static const blitter_ops_t *blit;
+static fb_blitter_t blit_id;
+
+static uint64_t stat_flushes = 0;
+static uint64_t stat_bytes = 0;
+
+/* ============================================================================
+ * Row Copies
+ * ============================================================================ */
+
+static void copy_row_scalar(void *dst, const void *src, size_t bytes) {
+    memcpy(dst, src, bytes);
+}
+
+static void copy_row_sse(void *dst, const void *src, size_t bytes) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    for (; bytes >= 64; bytes -= 64, d += 64, s += 64) {
+        __asm__ volatile(
+            "movdqu   (%1), %%xmm0\n\t"
+            "movdqu 16(%1), %%xmm1\n\t"
+            "movdqu 32(%1), %%xmm2\n\t"
+            "movdqu 48(%1), %%xmm3\n\t"
+            "movdqu %%xmm0,   (%0)\n\t"
+            "movdqu %%xmm1, 16(%0)\n\t"
+            "movdqu %%xmm2, 32(%0)\n\t"
+            "movdqu %%xmm3, 48(%0)"
+            : : "r"(d), "r"(s) : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+    }
+    for (; bytes >= 16; bytes -= 16, d += 16, s += 16) {
+        __asm__ volatile(
+            "movdqu (%1), %%xmm0\n\t"
+            "movdqu %%xmm0, (%0)"
+            : : "r"(d), "r"(s) : "xmm0", "memory");
+    }
+    if (bytes) {
+        memcpy(d, s, bytes);
+    }
+}
+
+static void stream_row_sse(void *dst, const void *src, size_t bytes) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    /* movntdq needs a 16-byte aligned destination */
+    if ((uintptr_t)d & 15) {
+        copy_row_sse(dst, src, bytes);
+        return;
+    }
+
+    for (; bytes >= 64; bytes -= 64, d += 64, s += 64) {
+        __asm__ volatile(
+            "movdqu   (%1), %%xmm0\n\t"
+            "movdqu 16(%1), %%xmm1\n\t"
+            "movdqu 32(%1), %%xmm2\n\t"
+            "movdqu 48(%1), %%xmm3\n\t"
+            "movntdq %%xmm0,   (%0)\n\t"
+            "movntdq %%xmm1, 16(%0)\n\t"
+            "movntdq %%xmm2, 32(%0)\n\t"
+            "movntdq %%xmm3, 48(%0)"
+            : : "r"(d), "r"(s) : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+    }
+    for (; bytes >= 16; bytes -= 16, d += 16, s += 16) {
+        __asm__ volatile(
+            "movdqu (%1), %%xmm0\n\t"
+            "movntdq %%xmm0, (%0)"
+            : : "r"(d), "r"(s) : "xmm0", "memory");
+    }
+    if (bytes) {
+        memcpy(d, s, bytes);
+    }
+}
+
+static void copy_row_avx(void *dst, const void *src, size_t bytes) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    for (; bytes >= 128; bytes -= 128, d += 128, s += 128) {
+        __asm__ volatile(
+            "vmovdqu   (%1), %%ymm0\n\t"
+            "vmovdqu 32(%1), %%ymm1\n\t"
+            "vmovdqu 64(%1), %%ymm2\n\t"
+            "vmovdqu 96(%1), %%ymm3\n\t"
+            "vmovdqu %%ymm0,   (%0)\n\t"
+            "vmovdqu %%ymm1, 32(%0)\n\t"
+            "vmovdqu %%ymm2, 64(%0)\n\t"
+            "vmovdqu %%ymm3, 96(%0)"
+            : : "r"(d), "r"(s) : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+    }
+    for (; bytes >= 32; bytes -= 32, d += 32, s += 32) {
+        __asm__ volatile(
+            "vmovdqu (%1), %%ymm0\n\t"
+            "vmovdqu %%ymm0, (%0)"
+            : : "r"(d), "r"(s) : "xmm0", "memory");
+    }
+    /* Avoid the AVX-SSE transition penalty in later SSE code */
+    __asm__ volatile("vzeroupper");
+    if (bytes) {
+        memcpy(d, s, bytes);
+    }
+}
+
+static void stream_row_avx(void *dst, const void *src, size_t bytes) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    /* vmovntdq needs a 32-byte aligned destination */
+    if ((uintptr_t)d & 31) {
+        copy_row_avx(dst, src, bytes);
+        return;
+    }
+
+    for (; bytes >= 128; bytes -= 128, d += 128, s += 128) {
+        __asm__ volatile(
+            "vmovdqu   (%1), %%ymm0\n\t"
+            "vmovdqu 32(%1), %%ymm1\n\t"
+            "vmovdqu 64(%1), %%ymm2\n\t"
+            "vmovdqu 96(%1), %%ymm3\n\t"
+            "vmovntdq %%ymm0,   (%0)\n\t"
+            "vmovntdq %%ymm1, 32(%0)\n\t"
+            "vmovntdq %%ymm2, 64(%0)\n\t"
+            "vmovntdq %%ymm3, 96(%0)"
+            : : "r"(d), "r"(s) : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+    }
+    for (; bytes >= 32; bytes -= 32, d += 32, s += 32) {
+        __asm__ volatile(
+            "vmovdqu (%1), %%ymm0\n\t"
+            "vmovntdq %%ymm0, (%0)"
+            : : "r"(d), "r"(s) : "xmm0", "memory");
+    }
+    __asm__ volatile("vzeroupper");
+    if (bytes) {
+        memcpy(d, s, bytes);
+    }
+}
+
+static const blitter_ops_t blitters[FB_BLIT_COUNT] = {
+    [FB_BLIT_SCALAR] = { "scalar", 0,             copy_row_scalar, copy_row_scalar },
+    [FB_BLIT_SSE]    = { "sse",    CPU_FEAT_SSE2, copy_row_sse,    stream_row_sse },
+    [FB_BLIT_AVX]    = { "avx",    CPU_FEAT_AVX,  copy_row_avx,    stream_row_avx },
+};
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static void fill_row(uint32_t *dst, uint32_t color, size_t count) {
+    __asm__ volatile("rep stosl"
+                     : "+D"(dst), "+c"(count)
+                     : "a"(color)
+                     : "memory");
+}
+
+/**
+ * @brief Clip a rectangle to the screen
+ *
+ * @return false if nothing is left
+ */
+static bool clip(int *x, int *y, int *w, int *h) {
+    if (*x < 0) { *w += *x; *x = 0; }
+    if (*y < 0) { *h += *y; *y = 0; }
+    if (*x + *w > (int)info.width)  *w = (int)info.width - *x;
+    if (*y + *h > (int)info.height) *h = (int)info.height - *y;
+    return *w > 0 && *h > 0;
+}
+
+static inline uint32_t *back_at(int x, int y) {
+    return (uint32_t *)((uint8_t *)back + (size_t)y * back_pitch) + x;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool fb_init(void) {
+    const boot_info_t *bi = boot_info();
+
+    if (!bi || !(bi->flags & BOOT_INFO_FB) || bi->fb_bpp != 32 ||
+        bi->fb_width > FB_MAX_WIDTH || bi->fb_height > FB_MAX_HEIGHT) {
+        return false;
+    }
+
+    info.phys   = bi->fb_addr;
+    info.width  = bi->fb_width;
+    info.height = bi->fb_height;
+    info.pitch  = bi->fb_pitch;
+    info.bpp    = bi->fb_bpp;
+
+    red_pos   = bi->fb_red_pos;   red_size   = bi->fb_red_size;
+    green_pos = bi->fb_green_pos; green_size = bi->fb_green_size;
+    blue_pos  = bi->fb_blue_pos;  blue_size  = bi->fb_blue_size;
+
+    vram = (uint8_t *)(uintptr_t)info.phys;
+    back_pitch = (size_t)info.width * 4;
+
+    /* Best available blitter */
+    blit_id = FB_BLIT_SCALAR;
+    for (int i = FB_BLIT_COUNT - 1; i > FB_BLIT_SCALAR; i--) {
+        if (cpu_has(blitters[i].required)) {
+            blit_id = (fb_blitter_t)i;
+            break;
+        }
+    }
+    blit = &blitters[blit_id];
+
+    dmg_x0 = dmg_y0 = dmg_x1 = dmg_y1 = 0;
+    present = true;
+
+    /* Write-combining where available (ignore failure: stays UC) */
+    fb_set_write_combining(true);
+    return true;
+}
+
+bool fb_present(void) {
+    return present;
+}
+
+const fb_info_t *fb_get_info(void) {
+    return &info;
+}
+
+uint32_t fb_rgb(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)(r >> (8 - red_size)) << red_pos) |
+           ((uint32_t)(g >> (8 - green_size)) << green_pos) |
+           ((uint32_t)(b >> (8 - blue_size)) << blue_pos);
+}
+
+void fb_damage(int x, int y, int w, int h) {
+    if (!clip(&x, &y, &w, &h)) {
+        return;
+    }
+
+    int x0 = x & ~7;
+    int x1 = (x + w + 7) & ~7;
+    if (x1 > (int)info.width) {
+        x1 = (int)info.width;
+    }
+
+    if (dmg_x0 >= dmg_x1) {
+        dmg_x0 = x0; dmg_x1 = x1;
+        dmg_y0 = y;  dmg_y1 = y + h;
+        return;
+    }
+    if (x0 < dmg_x0)    dmg_x0 = x0;
+    if (x1 > dmg_x1)    dmg_x1 = x1;
+    if (y < dmg_y0)     dmg_y0 = y;
+    if (y + h > dmg_y1) dmg_y1 = y + h;
+}
+
+void fb_fill(int x, int y, int w, int h, uint32_t color) {
+    if (!present || !clip(&x, &y, &w, &h)) {
+        return;
+    }
+    for (int row = 0; row < h; row++) {
+        fill_row(back_at(x, y + row), color, (size_t)w);
+    }
+    fb_damage(x, y, w, h);
+}
+
+void fb_blit(int x, int y, int w, int h, const uint32_t *src, size_t src_pitch) {
+    /* Callers draw whole cells; partially visible blits are dropped */
+    if (!present || x < 0 || y < 0 ||
+        x + w > (int)info.width || y + h > (int)info.height) {
+        return;
+    }
+    const uint8_t *s = (const uint8_t *)src;
+    for (int row = 0; row < h; row++) {
+        blit->copy(back_at(x, y + row), s, (size_t)w * 4);
+        s += src_pitch;
+    }
+    fb_damage(x, y, w, h);
+}
+
+void fb_scroll(int rows, uint32_t color) {
+    if (!present || rows <= 0) {
+        return;
+    }
+    if (rows > (int)info.height) {
+        rows = (int)info.height;
+    }
+
+    size_t keep = (size_t)(info.height - rows) * back_pitch;
+    memmove(back, back_at(0, rows), keep);
+    fb_fill(0, (int)info.height - rows, (int)info.width, rows, color);
+    fb_damage(0, 0, (int)info.width, (int)info.height);
+}
+
+void fb_flush(void) {
+    if (!present || dmg_x0 >= dmg_x1) {
+        return;
+    }
+
+    size_t bytes = (size_t)(dmg_x1 - dmg_x0) * 4;
+    uint8_t *dst = vram + (size_t)dmg_y0 * info.pitch + (size_t)dmg_x0 * 4;
+
+    for (int y = dmg_y0; y < dmg_y1; y++) {
+        blit->stream(dst, back_at(dmg_x0, y), bytes);
+        dst += info.pitch;
+    }
+    /* Non-temporal stores are weakly ordered; drain them */
+    sfence();
+
+    stat_flushes++;
+    stat_bytes += bytes * (uint64_t)(dmg_y1 - dmg_y0);
+    dmg_x0 = dmg_x1 = 0;
+}
+
+void fb_fill_direct(int x, int y, int w, int h, uint32_t color) {
+    if (!present || !clip(&x, &y, &w, &h)) {
+        return;
+    }
+    for (int row = 0; row < h; row++) {
+        fill_row((uint32_t *)(vram + (size_t)(y + row) * info.pitch) + x,
+                 color, (size_t)w);
+    }
+}
+
+bool fb_set_blitter(fb_blitter_t blitter) {
+    if (blitter >= FB_BLIT_COUNT || !cpu_has(blitters[blitter].required)) {
+        return false;
+    }
+    blit_id = blitter;
+    blit = &blitters[blitter];
+    return true;
+}
+
+fb_blitter_t fb_get_blitter(void) {
+    return blit_id;
+}
+
+const char *fb_blitter_name(fb_blitter_t blitter) {
+    return blitter < FB_BLIT_COUNT ? blitters[blitter].name : "?";
+}
+
+bool fb_set_write_combining(bool enable) {
+    if (!present) {
+        return false;
+    }
+    return paging_set_cache(info.phys, (uint64_t)info.pitch * info.height,
+                            enable ? PAGE_CACHE_WC : PAGE_CACHE_UC);
+}
+
+bool fb_write_combining(void) {
+    return present && paging_get_cache(info.phys) == PAGE_CACHE_WC;
+}
+
+void fb_stats(uint64_t *flushes, uint64_t *bytes) {
+    *flushes = stat_flushes;
+    *bytes = stat_bytes;
+}
+
+/* ============================================================================
+ * Metrics
+ * ============================================================================ */
+
+static uint64_t metric_flushes(void) {
+    return stat_flushes;
+}
+
+static uint64_t metric_flush_bytes(void) {
+    return stat_bytes;
+}
+
+DEFINE_METRIC(fb_flushes_total, METRIC_COUNTER,
+              "Non-empty framebuffer flushes", 1, metric_flushes);
+DEFINE_METRIC(fb_flush_bytes_total, METRIC_COUNTER,
+              "Bytes copied to video memory", 1, metric_flush_bytes);
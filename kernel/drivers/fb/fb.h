@@ -0,0 +1,161 @@
+/**
+ * @file fb.h
+ * @brief Linear framebuffer driver (VBE LFB set up by stage 2)
+ *
+ * All drawing goes to a back buffer in RAM; only the damaged region is
+ * copied to video memory on fb_flush(). Reading video memory is very
+ * slow (it is uncached MMIO), so scrolling moves pixels inside the back
+ * buffer and never reads the framebuffer itself.
+ *
+ * DAMAGE TRACKING:
+ *   A single bounding rectangle accumulates every change since the last
+ *   flush. Its horizontal edges are rounded to 8-pixel (32-byte)
+ *   boundaries so the SIMD row copies always see aligned destinations.
+ *
+ * BLITTERS:
+ *   scalar - rep movsq
+ *   sse    - 4 x 16-byte movdqu loads, movntdq stores to video memory
+ *   avx    - 4 x 32-byte vmovdqu loads, vmovntdq stores to video memory
+ *   The best supported one is selected at init; fb_set_blitter() lets
+ *   benchmarks compare them.
+ *
+ * MEMORY TYPE:
+ *   Video memory is mapped write-combining through the PAT when the CPU
+ *   supports it, so the streaming stores leave as full-line bursts
+ *   instead of one uncached transaction each.
+ */
+
+#ifndef _DRIVERS_FB_H
+#define _DRIVERS_FB_H
+
+#include <squirel/types.h>
+
+/* ============================================================================
+ * Types
+ * ============================================================================ */
+
+/**
+ * @brief Framebuffer geometry
+ */
+typedef struct {
+    uint64_t phys;          /**< Physical address of video memory */
+    uint32_t width;         /**< Pixels */
+    uint32_t height;        /**< Pixels */
+    uint32_t pitch;         /**< Bytes per scanline in video memory */
+    uint32_t bpp;           /**< Bits per pixel */
+} fb_info_t;
+
+/**
+ * @brief Row copy implementations
+ */
+typedef enum {
+    FB_BLIT_SCALAR = 0,
+    FB_BLIT_SSE,
+    FB_BLIT_AVX,
+    FB_BLIT_COUNT
+} fb_blitter_t;
+
+/* ============================================================================
+ * Framebuffer Functions
+ * ============================================================================ */
+
+/**
+ * @brief Take over the framebuffer described by the boot info block
+ *
+ * @return false if stage 2 did not set a usable 32bpp mode
+ * @note Requires cpu_init() (the blitters use SSE/AVX)
+ */
+bool fb_init(void);
+
+/**
+ * @brief Check whether a framebuffer is active
+ */
+bool fb_present(void);
+
+/**
+ * @brief Get the framebuffer geometry
+ */
+const fb_info_t *fb_get_info(void);
+
+/**
+ * @brief Build a pixel value from 8-bit components
+ */
+uint32_t fb_rgb(uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Fill a rectangle of the back buffer
+ */
+void fb_fill(int x, int y, int w, int h, uint32_t color);
+
+/**
+ * @brief Copy pixels into the back buffer
+ *
+ * @param src        Source pixels
+ * @param src_pitch  Bytes between source rows
+ */
+void fb_blit(int x, int y, int w, int h, const uint32_t *src, size_t src_pitch);
+
+/**
+ * @brief Scroll the whole back buffer up
+ *
+ * @param rows   Pixel rows to scroll by
+ * @param color  Fill color for the exposed rows
+ */
+void fb_scroll(int rows, uint32_t color);
+
+/**
+ * @brief Mark a rectangle as needing a copy to video memory
+ */
+void fb_damage(int x, int y, int w, int h);
+
+/**
+ * @brief Copy the damaged region to video memory
+ */
+void fb_flush(void);
+
+/**
+ * @brief Fill a rectangle directly in video memory (bypasses the back buffer)
+ *
+ * Used for overlays such as the text cursor; the next flush of the
+ * same area restores the back buffer contents.
+ */
+void fb_fill_direct(int x, int y, int w, int h, uint32_t color);
+
+/**
+ * @brief Select a row copy implementation
+ *
+ * @return false if the CPU does not support it
+ */
+bool fb_set_blitter(fb_blitter_t blitter);
+
+/**
+ * @brief Get the active row copy implementation
+ */
+fb_blitter_t fb_get_blitter(void);
+
+/**
+ * @brief Get the name of a row copy implementation
+ */
+const char *fb_blitter_name(fb_blitter_t blitter);
+
+/**
+ * @brief Map video memory write-combining (true) or uncached (false)
+ *
+ * @return false if the mapping could not be changed
+ */
+bool fb_set_write_combining(bool enable);
+
+/**
+ * @brief Check whether video memory is mapped write-combining
+ */
+bool fb_write_combining(void);
+
+/**
+ * @brief Get flush statistics
+ *
+ * @param flushes  Non-empty flushes so far
+ * @param bytes    Bytes written to video memory by flushes
+ */
+void fb_stats(uint64_t *flushes, uint64_t *bytes);
+
+#endif /* _DRIVERS_FB_H */
@@ -0,0 +1,240 @@
+/**
+ * @file fb_console.c
+ * @brief Text console rendered on the linear framebuffer
+ */
+
+#include "fb_console.h"
+#include "fb.h"
+#include <squirel/config.h>
+#include <squirel/bootinfo.h>
+#include <lib/memory/memory.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define MAX_COLS    (FB_MAX_WIDTH / FBCON_GLYPH_WIDTH)
+#define MAX_ROWS    (FB_MAX_HEIGHT / FBCON_GLYPH_HEIGHT)
+
+#define GLYPH_PIXELS    (FBCON_GLYPH_WIDTH * FBCON_GLYPH_HEIGHT)
+#define GLYPH_PITCH     (FBCON_GLYPH_WIDTH * sizeof(uint32_t))
+
+/** @brief Marks an unused cache slot (real attributes fit in 8 bits) */
+#define SLOT_EMPTY      0xFFFF
+
+/** @brief Cursor underline: last two scanlines, like the VGA cursor */
+#define CURSOR_START    14
+#define CURSOR_LINES    2
+
+/* ============================================================================
+ * Private Types and State
+ * ============================================================================ */
+
+/**
+ * @brief Pre-rendered glyphs for one attribute
+ */
+typedef struct {
+    uint16_t attr;                          /**< Attribute or SLOT_EMPTY */
+    uint64_t rendered[256 / 64];            /**< Which glyphs are valid */
+    uint32_t pixels[256][GLYPH_PIXELS];     /**< Ready-to-copy 8x16 blocks */
+} glyph_slot_t;
+
+/** @brief Standard VGA palette */
+static const uint8_t vga_palette[16][3] = {
+    { 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0xAA }, { 0x00, 0xAA, 0x00 }, { 0x00, 0xAA, 0xAA },
+    { 0xAA, 0x00, 0x00 }, { 0xAA, 0x00, 0xAA }, { 0xAA, 0x55, 0x00 }, { 0xAA, 0xAA, 0xAA },
+    { 0x55, 0x55, 0x55 }, { 0x55, 0x55, 0xFF }, { 0x55, 0xFF, 0x55 }, { 0x55, 0xFF, 0xFF },
+    { 0xFF, 0x55, 0x55 }, { 0xFF, 0x55, 0xFF }, { 0xFF, 0xFF, 0x55 }, { 0xFF, 0xFF, 0xFF },
+};
+
+static bool active = false;
+static int cols, rows;
+
+/** @brief BIOS font copied by stage 2 */
+static const uint8_t *font;
+
+/** @brief Palette converted to the framebuffer pixel format */
+static uint32_t palette[16];
+
+/** @brief Cell contents (char | attr << 8), needed to redraw under the cursor */
+static uint16_t cells[MAX_COLS * MAX_ROWS];
+
+static glyph_slot_t slots[FBCON_GLYPH_SLOTS];
+static glyph_slot_t *last_slot;
+static int next_victim = 0;
+
+static int cursor_x = 0, cursor_y = 0;
+static bool cursor_visible = true;
+
+/** @brief Where the cursor was last drawn (-1 = not drawn) */
+static int drawn_x = -1, drawn_y = -1;
+
+static uint64_t stat_hits = 0;
+static uint64_t stat_renders = 0;
+
+/* ============================================================================
+ * Glyph Cache
+ * ============================================================================ */
+
+static glyph_slot_t *slot_for(uint8_t attr) {
+    if (last_slot && last_slot->attr == attr) {
+        return last_slot;
+    }
+    for (int i = 0; i < FBCON_GLYPH_SLOTS; i++) {
+        if (slots[i].attr == attr) {
+            return last_slot = &slots[i];
+        }
+    }
+
+    glyph_slot_t *slot = &slots[next_victim];
+    next_victim = (next_victim + 1) % FBCON_GLYPH_SLOTS;
+    slot->attr = attr;
+    memset(slot->rendered, 0, sizeof(slot->rendered));
+    return last_slot = slot;
+}
+
+static void glyph_render(uint32_t *px, uint8_t c, uint8_t attr) {
+    const uint8_t *bits = font + (size_t)c * FBCON_GLYPH_HEIGHT;
+    uint32_t fg = palette[attr & 0x0F];
+    uint32_t bg = palette[attr >> 4];
+
+    for (int y = 0; y < FBCON_GLYPH_HEIGHT; y++) {
+        uint8_t line = bits[y];
+        for (int x = 0; x < FBCON_GLYPH_WIDTH; x++) {
+            *px++ = (line & (0x80 >> x)) ? fg : bg;
+        }
+    }
+}
+
+static const uint32_t *glyph_get(uint8_t c, uint8_t attr) {
+    glyph_slot_t *slot = slot_for(attr);
+    uint64_t bit = 1ull << (c & 63);
+
+    if (!(slot->rendered[c >> 6] & bit)) {
+        glyph_render(slot->pixels[c], c, attr);
+        slot->rendered[c >> 6] |= bit;
+        stat_renders++;
+    } else {
+        stat_hits++;
+    }
+    return slot->pixels[c];
+}
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static void draw_cell(int x, int y) {
+    uint16_t cell = cells[y * cols + x];
+    fb_blit(x * FBCON_GLYPH_WIDTH, y * FBCON_GLYPH_HEIGHT,
+            FBCON_GLYPH_WIDTH, FBCON_GLYPH_HEIGHT,
+            glyph_get((uint8_t)cell, (uint8_t)(cell >> 8)), GLYPH_PITCH);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool fbcon_init(void) {
+    const boot_info_t *bi = boot_info();
+
+    if (!bi || !(bi->flags & BOOT_INFO_FONT) ||
+        bi->font_height != FBCON_GLYPH_HEIGHT || !fb_init()) {
+        return false;
+    }
+
+    const fb_info_t *fbi = fb_get_info();
+    font = (const uint8_t *)(uintptr_t)bi->font_addr;
+    cols = (int)(fbi->width / FBCON_GLYPH_WIDTH);
+    rows = (int)(fbi->height / FBCON_GLYPH_HEIGHT);
+
+    for (int i = 0; i < 16; i++) {
+        palette[i] = fb_rgb(vga_palette[i][0], vga_palette[i][1], vga_palette[i][2]);
+    }
+    for (int i = 0; i < FBCON_GLYPH_SLOTS; i++) {
+        slots[i].attr = SLOT_EMPTY;
+    }
+
+    active = true;
+    return true;
+}
+
+bool fbcon_active(void) {
+    return active;
+}
+
+int fbcon_cols(void) {
+    return cols;
+}
+
+int fbcon_rows(void) {
+    return rows;
+}
+
+void fbcon_putc(int x, int y, char c, uint8_t attr) {
+    if (x < 0 || x >= cols || y < 0 || y >= rows) {
+        return;
+    }
+    cells[y * cols + x] = (uint16_t)(uint8_t)c | ((uint16_t)attr << 8);
+    draw_cell(x, y);
+}
+
+void fbcon_clear(uint8_t attr) {
+    uint16_t blank = (uint16_t)' ' | ((uint16_t)attr << 8);
+    for (int i = 0; i < cols * rows; i++) {
+        cells[i] = blank;
+    }
+    fb_fill(0, 0, cols * FBCON_GLYPH_WIDTH, rows * FBCON_GLYPH_HEIGHT,
+            palette[attr >> 4]);
+}
+
+void fbcon_scroll(uint8_t attr) {
+    uint16_t blank = (uint16_t)' ' | ((uint16_t)attr << 8);
+
+    memmove(cells, cells + cols, (size_t)(rows - 1) * cols * sizeof(uint16_t));
+    for (int i = (rows - 1) * cols; i < rows * cols; i++) {
+        cells[i] = blank;
+    }
+    fb_scroll(FBCON_GLYPH_HEIGHT, palette[attr >> 4]);
+
+    /* The old cursor image moved with the pixels; it is gone after the flush */
+    drawn_x = drawn_y = -1;
+}
+
+void fbcon_set_cursor(int x, int y) {
+    cursor_x = x;
+    cursor_y = y;
+}
+
+void fbcon_show_cursor(bool show) {
+    cursor_visible = show;
+}
+
+void fbcon_flush(void) {
+    if (!active) {
+        return;
+    }
+
+    /* Restore the cell the cursor was drawn over if it moved */
+    if (drawn_x >= 0 && (drawn_x != cursor_x || drawn_y != cursor_y || !cursor_visible)) {
+        fb_damage(drawn_x * FBCON_GLYPH_WIDTH, drawn_y * FBCON_GLYPH_HEIGHT,
+                  FBCON_GLYPH_WIDTH, FBCON_GLYPH_HEIGHT);
+        drawn_x = drawn_y = -1;
+    }
+
+    fb_flush();
+
+    if (cursor_visible && cursor_x < cols && cursor_y < rows) {
+        uint8_t attr = (uint8_t)(cells[cursor_y * cols + cursor_x] >> 8);
+        fb_fill_direct(cursor_x * FBCON_GLYPH_WIDTH,
+                       cursor_y * FBCON_GLYPH_HEIGHT + CURSOR_START,
+                       FBCON_GLYPH_WIDTH, CURSOR_LINES, palette[attr & 0x0F]);
+        drawn_x = cursor_x;
+        drawn_y = cursor_y;
+    }
+}
+
+void fbcon_cache_stats(uint64_t *hits, uint64_t *renders) {
+    *hits = stat_hits;
+    *renders = stat_renders;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file fb_console.h
+ * @brief Text console rendered on the linear framebuffer
+ *
+ * Provides the same cell model as VGA text mode (character + attribute
+ * byte, 16-color palette) on top of fb.c, with 8x16 glyphs from the
+ * BIOS font that stage 2 copied to low memory. At 1024x768 this gives
+ * a 128x48 grid instead of 80x25.
+ *
+ * GLYPH CACHE:
+ *   Expanding a 1-bit glyph into 32-bit pixels costs a branch per pixel,
+ *   so each (attribute, character) pair is rendered once and kept as a
+ *   ready-to-copy 8x16 pixel block. FBCON_GLYPH_SLOTS attributes are
+ *   cached (round-robin replacement); glyphs within a slot are rendered
+ *   lazily on first use. Drawing a cached cell is 16 row copies of 32
+ *   bytes into the back buffer.
+ *
+ * CURSOR:
+ *   Drawn straight into video memory after each flush as an underline,
+ *   so it never pollutes the back buffer.
+ */
+
+#ifndef _DRIVERS_FB_CONSOLE_H
+#define _DRIVERS_FB_CONSOLE_H
+
+#include <squirel/types.h>
+
+/** @brief Glyph cell size in pixels */
+#define FBCON_GLYPH_WIDTH   8
+#define FBCON_GLYPH_HEIGHT  16
+
+/**
+ * @brief Set up the console on the framebuffer
+ *
+ * @return false if there is no framebuffer or no font
+ */
+bool fbcon_init(void);
+
+/**
+ * @brief Check whether the framebuffer console is in use
+ */
+bool fbcon_active(void);
+
+/**
+ * @brief Grid size in cells
+ */
+int fbcon_cols(void);
+int fbcon_rows(void);
+
+/**
+ * @brief Draw one cell (character + VGA attribute byte)
+ */
+void fbcon_putc(int x, int y, char c, uint8_t attr);
+
+/**
+ * @brief Fill the screen with blanks in the given attribute
+ */
+void fbcon_clear(uint8_t attr);
+
+/**
+ * @brief Scroll the grid up one row, blanking the last row
+ */
+void fbcon_scroll(uint8_t attr);
+
+/**
+ * @brief Move the cursor
+ */
+void fbcon_set_cursor(int x, int y);
+
+/**
+ * @brief Show or hide the cursor
+ */
+void fbcon_show_cursor(bool show);
+
+/**
+ * @brief Push pending changes (and the cursor) to the screen
+ */
+void fbcon_flush(void);
+
+/**
+ * @brief Get glyph cache statistics
+ *
+ * @param hits     Cells drawn from an already rendered glyph
+ * @param renders  Glyphs rendered into the cache
+ */
+void fbcon_cache_stats(uint64_t *hits, uint64_t *renders);
+
+#endif /* _DRIVERS_FB_CONSOLE_H */
@@ -0,0 +1,89 @@
+/**
+ * @file fw_cfg.c
+ * @brief QEMU firmware configuration (fw_cfg) implementation
+ */
+
+#include "fw_cfg.h"
+#include <arch/x86_64/io/port.h>
+#include <lib/string/string.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define FW_CFG_PORT_SEL     0x510
+#define FW_CFG_PORT_DATA    0x511
+
+#define FW_CFG_SIGNATURE    0x0000
+#define FW_CFG_FILE_DIR     0x0019
+
+#define FW_CFG_NAME_LEN     56
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static void fw_cfg_select(uint16_t key) {
+    outw(FW_CFG_PORT_SEL, key);
+}
+
+static void fw_cfg_read(void *buf, size_t len) {
+    uint8_t *p = (uint8_t *)buf;
+    while (len--) {
+        *p++ = inb(FW_CFG_PORT_DATA);
+    }
+}
+
+static uint32_t fw_cfg_read_be32(void) {
+    uint8_t b[4];
+    fw_cfg_read(b, 4);
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) |
+           ((uint32_t)b[2] << 8) | b[3];
+}
+
+static uint16_t fw_cfg_read_be16(void) {
+    uint8_t b[2];
+    fw_cfg_read(b, 2);
+    return (uint16_t)((b[0] << 8) | b[1]);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool fw_cfg_present(void) {
+    char sig[4];
+    fw_cfg_select(FW_CFG_SIGNATURE);
+    fw_cfg_read(sig, sizeof(sig));
+    return sig[0] == 'Q' && sig[1] == 'E' && sig[2] == 'M' && sig[3] == 'U';
+}
+
+ssize_t fw_cfg_read_file(const char *name, char *buf, size_t buflen) {
+    if (buflen == 0 || !fw_cfg_present()) {
+        return -1;
+    }
+
+    fw_cfg_select(FW_CFG_FILE_DIR);
+    uint32_t count = fw_cfg_read_be32();
+
+    for (uint32_t i = 0; i < count; i++) {
+        char entry_name[FW_CFG_NAME_LEN];
+        uint32_t size = fw_cfg_read_be32();
+        uint16_t select = fw_cfg_read_be16();
+        fw_cfg_read_be16();  /* Reserved */
+        fw_cfg_read(entry_name, FW_CFG_NAME_LEN);
+        entry_name[FW_CFG_NAME_LEN - 1] = '\0';
+
+        if (strcmp(entry_name, name) != 0) {
+            continue;
+        }
+
+        size_t len = size < buflen - 1 ? size : buflen - 1;
+        fw_cfg_select(select);
+        fw_cfg_read(buf, len);
+        buf[len] = '\0';
+        return (ssize_t)len;
+    }
+
+    return -1;
+}
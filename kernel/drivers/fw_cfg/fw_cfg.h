@@ -0,0 +1,38 @@
+/**
+ * @file fw_cfg.h
+ * @brief QEMU firmware configuration (fw_cfg) interface
+ *
+ * fw_cfg is QEMU's channel for passing boot-time data to the guest.
+ * We use it as a kernel command line: the host attaches named files
+ * with -fw_cfg name=opt/...,string=... and the kernel reads them.
+ *
+ * I/O INTERFACE (x86):
+ *   0x510: Selector (16-bit write) - selects an item and rewinds it
+ *   0x511: Data (8-bit read)       - reads the selected item sequentially
+ *
+ * FILE DIRECTORY (selector 0x0019):
+ *   u32 count (big-endian), then count entries of:
+ *     u32 size (BE), u16 select (BE), u16 reserved, char name[56]
+ */
+
+#ifndef _DRIVERS_FW_CFG_H
+#define _DRIVERS_FW_CFG_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Check whether fw_cfg is present (QEMU signature)
+ */
+bool fw_cfg_present(void);
+
+/**
+ * @brief Read a named fw_cfg file as a string
+ *
+ * @param name    File name (e.g. "opt/squirel/console")
+ * @param buf     Destination buffer (always null-terminated on success)
+ * @param buflen  Size of buf
+ * @return        Bytes read (excluding null), or -1 if the file is absent
+ */
+ssize_t fw_cfg_read_file(const char *name, char *buf, size_t buflen);
+
+#endif /* _DRIVERS_FW_CFG_H */
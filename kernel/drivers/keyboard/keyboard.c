@@ -2,7 +2,9 @@
  * @file keyboard.c
  * @brief PS/2 keyboard driver implementation
  * 
- * Implements keyboard input using polling (not interrupts for now).
+ * Implements keyboard input using polling. IRQ 1 is enabled only to wake
+ * the CPU from cpu_idle() when a key arrives; the handler leaves the
+ * scancode in the controller for the polling path to read.
  * Uses Scancode Set 1 which is the default on most systems.
  * 
  * SCANCODE SET 1 (partial):
@@ -16,11 +18,19 @@
  *   R-Shift    0x36  0xB6
  *   L-Ctrl     0x1D  0x9D
  *   L-Alt      0x38  0xB8
+ *   F1-F6      0x3B-0x40
+ *
+ * Alt+F1..F6 switch virtual consoles here and are not passed on.
  */
 
 #include "keyboard.h"
 #include <squirel/config.h>
 #include <arch/x86_64/io/port.h>
+#include <arch/x86_64/cpu/irq.h>
+#include <drivers/vga/vga_text.h>
+#include <core/cpustat.h>
+#include <core/stat.h>
+#include <core/export.h>
 
 /* ============================================================================
  * Scancode to ASCII Translation Table
@@ -82,6 +92,8 @@ static bool shift_pressed = false;
 static bool ctrl_pressed = false;
 static bool alt_pressed = false;
 
+DEFINE_STAT(kbd_scancodes, "Scancodes read from the PS/2 controller");
+
 /* ============================================================================
  * Private Helper Functions
  * ============================================================================ */
@@ -104,6 +116,12 @@ static void keyboard_wait_output(void) {
     }
 }
 
+/**
+ * @brief IRQ 1 handler: wake-up only, the data port is read by polling
+ */
+static void keyboard_irq(void) {
+}
+
 /* ============================================================================
  * Public Functions
  * ============================================================================ */
@@ -125,6 +143,8 @@ void keyboard_init(void) {
     /* Wait for ACK */
     keyboard_wait_output();
     inb(KEYBOARD_DATA_PORT);  /* Should be 0xFA (ACK) */
+    
+    irq_register(IRQ_KEYBOARD, "keyboard", keyboard_irq);
 }
 
 bool keyboard_has_key(void) {
@@ -143,6 +163,7 @@ int keyboard_getchar_nonblock(void) {
     if (scancode == 0) {
         return KEY_NONE;
     }
+    stat_inc(kbd_scancodes);
     
     /* Check for key release (bit 7 set) */
     bool released = (scancode & 0x80) != 0;
@@ -169,6 +190,12 @@ int keyboard_getchar_nonblock(void) {
         return KEY_NONE;
     }
     
+    /* Alt+F1..F6: virtual console switch */
+    if (alt_pressed && scancode >= 0x3B && scancode < 0x3B + VGA_NUM_CONSOLES) {
+        vga_console_switch(scancode - 0x3B);
+        return KEY_NONE;
+    }
+    
     /* Handle special keys (arrow keys, function keys, etc.) */
     switch (scancode) {
         case 0x48: return KEY_UP;
@@ -212,13 +239,13 @@ int keyboard_getchar_nonblock(void) {
     
     return c;
 }
+EXPORT_SYMBOL(keyboard_getchar_nonblock);
 
 int keyboard_getchar(void) {
     int c;
     while ((c = keyboard_getchar_nonblock()) == KEY_NONE) {
-        /* Busy wait - polling mode since interrupts are disabled */
-        /* Note: In a real OS with interrupts enabled, we could use HLT */
-        __asm__ volatile("pause");  /* CPU hint: we're in a spin loop */
+        /* Halt until the next interrupt (IRQ 1 or the timer tick) */
+        cpu_idle();
     }
     return c;
 }
@@ -0,0 +1,103 @@
+/**
+ * @file pci.c
+ * @brief PCI configuration space access implementation
+ *
+ * Uses configuration mechanism #1. Sub-dword reads are done by reading
+ * the containing dword and shifting, which every chipset supports.
+ * Sub-dword writes go through the matching byte lane of 0xCFC.
+ */
+
+#include "pci.h"
+#include <arch/x86_64/io/port.h>
+
+/* ============================================================================
+ * Configuration Ports
+ * ============================================================================ */
+
+#define PCI_CONFIG_ADDRESS  0xCF8
+#define PCI_CONFIG_DATA     0xCFC
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief Build a configuration address for port 0xCF8
+ */
+static uint32_t pci_config_address(pci_addr_t addr, uint8_t offset) {
+    return (1u << 31) |
+           ((uint32_t)addr.bus << 16) |
+           ((uint32_t)(addr.device & 0x1F) << 11) |
+           ((uint32_t)(addr.function & 0x07) << 8) |
+           (offset & 0xFC);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+uint32_t pci_read32(pci_addr_t addr, uint8_t offset) {
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(addr, offset));
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint16_t pci_read16(pci_addr_t addr, uint8_t offset) {
+    return (uint16_t)(pci_read32(addr, offset) >> ((offset & 2) * 8));
+}
+
+uint8_t pci_read8(pci_addr_t addr, uint8_t offset) {
+    return (uint8_t)(pci_read32(addr, offset) >> ((offset & 3) * 8));
+}
+
+void pci_write32(pci_addr_t addr, uint8_t offset, uint32_t value) {
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(addr, offset));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+void pci_write16(pci_addr_t addr, uint8_t offset, uint16_t value) {
+    /* Word write so a COMMAND update never touches the RW1C STATUS bits */
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(addr, offset));
+    outw(PCI_CONFIG_DATA + (offset & 2), value);
+}
+
+bool pci_find_device(uint16_t vendor, uint16_t device, pci_addr_t *out) {
+    for (int bus = 0; bus < 256; bus++) {
+        for (int dev = 0; dev < 32; dev++) {
+            pci_addr_t addr = { (uint8_t)bus, (uint8_t)dev, 0 };
+
+            if (pci_read16(addr, PCI_VENDOR_ID) == 0xFFFF) {
+                continue;  /* No device in this slot */
+            }
+
+            /* Bit 7 of the header type marks a multi-function device */
+            int functions = (pci_read8(addr, PCI_HEADER_TYPE) & 0x80) ? 8 : 1;
+
+            for (int fn = 0; fn < functions; fn++) {
+                addr.function = (uint8_t)fn;
+                uint32_t id = pci_read32(addr, PCI_VENDOR_ID);
+                if ((id & 0xFFFF) == vendor && (id >> 16) == device) {
+                    *out = addr;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+uint32_t pci_bar_base(pci_addr_t addr, int bar) {
+    uint32_t value = pci_read32(addr, PCI_BAR0 + bar * 4);
+    if (value & 0x1) {
+        return value & ~0x3u;   /* I/O BAR */
+    }
+    return value & ~0xFu;       /* Memory BAR */
+}
+
+bool pci_bar_is_io(pci_addr_t addr, int bar) {
+    return (pci_read32(addr, PCI_BAR0 + bar * 4) & 0x1) != 0;
+}
+
+void pci_enable(pci_addr_t addr, uint16_t command_bits) {
+    uint16_t cmd = pci_read16(addr, PCI_COMMAND);
+    pci_write16(addr, PCI_COMMAND, cmd | command_bits);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file pci.h
+ * @brief PCI configuration space access
+ *
+ * Provides legacy configuration mechanism #1 access (ports 0xCF8/0xCFC)
+ * and a simple bus scan to locate devices by vendor/device ID.
+ *
+ * CONFIGURATION ADDRESS (written to 0xCF8):
+ *   Bit 31:     Enable
+ *   Bits 23-16: Bus number
+ *   Bits 15-11: Device number
+ *   Bits 10-8:  Function number
+ *   Bits 7-2:   Register offset (dword aligned)
+ */
+
+#ifndef _DRIVERS_PCI_H
+#define _DRIVERS_PCI_H
+
+#include <squirel/types.h>
+
+/* ============================================================================
+ * Configuration Space Offsets
+ * ============================================================================ */
+
+#define PCI_VENDOR_ID       0x00
+#define PCI_DEVICE_ID       0x02
+#define PCI_COMMAND         0x04
+#define PCI_STATUS          0x06
+#define PCI_HEADER_TYPE     0x0E
+#define PCI_BAR0            0x10
+#define PCI_SUBSYSTEM_ID    0x2E
+#define PCI_INTERRUPT_LINE  0x3C
+
+/* Command register bits */
+#define PCI_COMMAND_IO      0x0001  /* Respond to I/O space accesses */
+#define PCI_COMMAND_MEMORY  0x0002  /* Respond to memory space accesses */
+#define PCI_COMMAND_MASTER  0x0004  /* Allow bus mastering (DMA) */
+
+/* ============================================================================
+ * Device Address
+ * ============================================================================ */
+
+/**
+ * @brief Location of a PCI function
+ */
+typedef struct {
+    uint8_t bus;
+    uint8_t device;
+    uint8_t function;
+} pci_addr_t;
+
+/* ============================================================================
+ * PCI Functions
+ * ============================================================================ */
+
+uint32_t pci_read32(pci_addr_t addr, uint8_t offset);
+uint16_t pci_read16(pci_addr_t addr, uint8_t offset);
+uint8_t  pci_read8(pci_addr_t addr, uint8_t offset);
+void     pci_write32(pci_addr_t addr, uint8_t offset, uint32_t value);
+void     pci_write16(pci_addr_t addr, uint8_t offset, uint16_t value);
+
+/**
+ * @brief Find the first function matching a vendor/device ID
+ *
+ * @param vendor  Vendor ID
+ * @param device  Device ID
+ * @param out     Filled with the function's location on success
+ * @return        true if found
+ */
+bool pci_find_device(uint16_t vendor, uint16_t device, pci_addr_t *out);
+
+/**
+ * @brief Read a Base Address Register
+ *
+ * @param addr  Function location
+ * @param bar   BAR index (0-5)
+ * @return      BAR base (I/O port or 32-bit memory address), flag bits masked
+ */
+uint32_t pci_bar_base(pci_addr_t addr, int bar);
+
+/**
+ * @brief Check whether a BAR decodes I/O space
+ */
+bool pci_bar_is_io(pci_addr_t addr, int bar);
+
+/**
+ * @brief Set bits in the command register (e.g. enable I/O + bus master)
+ */
+void pci_enable(pci_addr_t addr, uint16_t command_bits);
+
+#endif /* _DRIVERS_PCI_H */
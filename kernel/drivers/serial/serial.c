@@ -3,7 +3,8 @@
  * @brief Serial port driver implementation
  * 
  * Implements serial port output for debugging via QEMU.
- * Uses polling (not interrupts) for simplicity.
+ * Output uses polling; a port can additionally raise its IRQ when
+ * received data is available (see serial_port_enable_rx_irq()).
  */
 
 #include "serial.h"
@@ -23,15 +24,29 @@
 #define SERIAL_LINE_STATUS  5   /* Line status */
 #define SERIAL_MODEM_STATUS 6   /* Modem status */
 
+#define SERIAL_SCRATCH      7   /* Scratch register */
+
 /* Line status register bits */
+#define SERIAL_STATUS_DR    0x01  /* Received data ready */
 #define SERIAL_STATUS_THRE  0x20  /* Transmit holding register empty */
 
+/* Interrupt enable register bits */
+#define SERIAL_IER_RX       0x01  /* Received data available */
+
 /* ============================================================================
  * Public Functions
  * ============================================================================ */
 
 void serial_init(void) {
-    uint16_t port = COM1_PORT;
+    serial_port_init(COM1_PORT);
+}
+
+bool serial_port_init(uint16_t port) {
+    /* An absent UART floats the bus: the scratch register reads 0xFF */
+    outb(port + SERIAL_SCRATCH, 0x5A);
+    if (inb(port + SERIAL_SCRATCH) != 0x5A) {
+        return false;
+    }
     
     /* Disable interrupts */
     outb(port + SERIAL_INT_ENABLE, 0x00);
@@ -66,6 +81,28 @@ void serial_init(void) {
      * Enable DTR, RTS, and OUT2 (interrupt enable in some systems)
      */
     outb(port + SERIAL_MODEM_CTRL, 0x0B);
+    return true;
+}
+
+void serial_port_enable_rx_irq(uint16_t port) {
+    /* OUT2 (set by serial_port_init) gates the IRQ line on PC hardware */
+    outb(port + SERIAL_INT_ENABLE, SERIAL_IER_RX);
+}
+
+int serial_port_read(uint16_t port) {
+    if (!(inb(port + SERIAL_LINE_STATUS) & SERIAL_STATUS_DR)) {
+        return -1;
+    }
+    return inb(port + SERIAL_DATA);
+}
+
+void serial_port_write(uint16_t port, const char *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        while (!(inb(port + SERIAL_LINE_STATUS) & SERIAL_STATUS_THRE)) {
+            /* Busy wait */
+        }
+        outb(port + SERIAL_DATA, (uint8_t)buf[i]);
+    }
 }
 
 bool serial_ready(void) {
@@ -91,6 +128,15 @@ void serial_print(const char *str) {
     }
 }
 
+void serial_write(const char *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] == '\n') {
+            serial_putchar('\r');
+        }
+        serial_putchar(buf[i]);
+    }
+}
+
 /* Simple serial printf (limited implementation) */
 int serial_printf(const char *fmt, ...) {
     char buf[256];
@@ -9,6 +9,9 @@
  *   COM1 is at I/O port 0x3F8
  *   Baud rate is typically 115200
  *   
+ *   COM2 (0x2F8) is driven through the serial_port_*() functions, which
+ *   take the base port and never translate newlines.
+ *   
  *   Port offsets:
  *     +0: Data (read/write)
  *     +1: Interrupt Enable
@@ -32,6 +35,38 @@
  */
 void serial_init(void);
 
+/**
+ * @brief Initialize any 16550-compatible port at 115200 8N1
+ * 
+ * @param port  Base I/O port (e.g. COM2_PORT)
+ * @return      false if no UART answers at that address
+ */
+bool serial_port_init(uint16_t port);
+
+/**
+ * @brief Raise the port's IRQ whenever received data is available
+ * 
+ * @param port  Base I/O port
+ */
+void serial_port_enable_rx_irq(uint16_t port);
+
+/**
+ * @brief Read one received byte without waiting
+ * 
+ * @param port  Base I/O port
+ * @return      The byte, or -1 if none is pending
+ */
+int serial_port_read(uint16_t port);
+
+/**
+ * @brief Write raw bytes to a port (no CRLF expansion)
+ * 
+ * @param port  Base I/O port
+ * @param buf   Data
+ * @param len   Length in bytes
+ */
+void serial_port_write(uint16_t port, const char *buf, size_t len);
+
 /**
  * @brief Check if transmit buffer is empty
  * 
@@ -53,6 +88,14 @@ void serial_putchar(char c);
  */
 void serial_print(const char *str);
 
+/**
+ * @brief Write a buffer to serial port
+ * 
+ * @param buf  Data (newlines are expanded to CRLF)
+ * @param len  Length in bytes
+ */
+void serial_write(const char *buf, size_t len);
+
 /**
  * @brief Printf-style output to serial port
  * 
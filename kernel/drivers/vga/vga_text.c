@@ -11,27 +11,69 @@
  *   - We maintain cursor position in software
  *   - Hardware cursor is updated via VGA CRT controller ports
  *   - Scrolling copies memory and clears the bottom line
+ *
+ * FRAMEBUFFER MODE:
+ *   When stage 2 switched to a VBE graphics mode, the same cell model is
+ *   drawn by fb_console instead and the screen grows to the framebuffer
+ *   grid. Cursor updates and framebuffer flushes are deferred to the end
+ *   of each vga_write() call rather than done per character.
+ *
+ * VIRTUAL CONSOLES:
+ *   Every console owns a shadow cell buffer in RAM plus its own cursor
+ *   and attribute. Output always lands in the shadow of the selected
+ *   console; only the foreground console is also pushed to the display.
+ *   Scrolling moves the shadow and rewrites VRAM from it, so video
+ *   memory is never read back.
  */
 
 #include "vga_text.h"
 #include <squirel/config.h>
+#include <arch/x86_64.h>
 #include <arch/x86_64/io/port.h>
+#include <drivers/fb/fb_console.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <core/stat.h>
 
 /* ============================================================================
  * Private State
  * ============================================================================ */
 
+/** @brief Largest grid any display mode can have */
+#define VC_MAX_CELLS \
+    ((FB_MAX_WIDTH / FBCON_GLYPH_WIDTH) * (FB_MAX_HEIGHT / FBCON_GLYPH_HEIGHT))
+
+/**
+ * @brief One virtual console
+ */
+typedef struct {
+    uint16_t cells[VC_MAX_CELLS];   /**< Shadow buffer, screen_w cells per row */
+    int cursor_x;                   /**< Cursor column */
+    int cursor_y;                   /**< Cursor row */
+    uint8_t attr;                   /**< Current attribute byte (color) */
+} vga_console_t;
+
 /** @brief Pointer to VGA text buffer (memory-mapped I/O) */
 static uint16_t *vga_buffer = (uint16_t *)VGA_BUFFER_ADDR;
 
-/** @brief Current cursor column (0-79) */
-static int cursor_x = 0;
+/** @brief Screen size in cells (larger in framebuffer mode) */
+static int screen_w = VGA_WIDTH;
+static int screen_h = VGA_HEIGHT;
 
-/** @brief Current cursor row (0-24) */
-static int cursor_y = 0;
+/** @brief Drawing through fb_console instead of 0xB8000 */
+static bool use_fb = false;
 
-/** @brief Current attribute byte (color) */
-static uint8_t current_attr = 0x07;  /* Light gray on black */
+static vga_console_t consoles[VGA_NUM_CONSOLES];
+
+/** @brief Console receiving output */
+static vga_console_t *vc = &consoles[0];
+static int vc_index = 0;
+
+/** @brief Console shown on the display */
+static int fg_index = 0;
+
+DEFINE_STAT(vga_scrolls, "Console scrolls (all virtual consoles)");
+DEFINE_STAT(vga_switches, "Virtual console switches");
 
 /* ============================================================================
  * Private Helper Functions
@@ -74,7 +116,20 @@ static uint16_t vga_make_entry(char c, uint8_t attr) {
  *   0x0F - Cursor location low byte
  */
 static void vga_update_cursor(void) {
-    uint16_t pos = cursor_y * VGA_WIDTH + cursor_x;
+    if (vc_index != fg_index) {
+        return;
+    }
+
+    if (use_fb) {
+        fbcon_set_cursor(vc->cursor_x, vc->cursor_y);
+        fbcon_flush();
+        return;
+    }
+
+    /* Drain write-combined cell stores before touching the CRTC */
+    sfence();
+    
+    uint16_t pos = vc->cursor_y * VGA_WIDTH + vc->cursor_x;
     
     outb(0x3D4, 0x0F);           /* Select cursor low register */
     outb(0x3D5, (uint8_t)(pos & 0xFF));
@@ -83,100 +138,167 @@ static void vga_update_cursor(void) {
     outb(0x3D5, (uint8_t)((pos >> 8) & 0xFF));
 }
 
-/* ============================================================================
- * Public Functions
- * ============================================================================ */
-
-void vga_init(void) {
-    /* Set default colors: light gray on black */
-    current_attr = vga_make_attr(VGA_LIGHT_GRAY, VGA_BLACK);
-    
-    /* Clear the screen */
-    vga_clear();
-    
-    /* Enable hardware cursor */
-    vga_cursor_enable(true);
-}
-
-void vga_clear(void) {
-    uint16_t blank = vga_make_entry(' ', current_attr);
-    
-    /* Fill entire buffer with blank spaces */
-    for (int i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
-        vga_buffer[i] = blank;
+/**
+ * @brief Copy a whole shadow buffer to the display
+ */
+static void vga_redraw(const vga_console_t *con) {
+    if (use_fb) {
+        for (int y = 0; y < screen_h; y++) {
+            const uint16_t *row = &con->cells[y * screen_w];
+            for (int x = 0; x < screen_w; x++) {
+                fbcon_putc(x, y, (char)(row[x] & 0xFF), (uint8_t)(row[x] >> 8));
+            }
+        }
+    } else {
+        memcpy(vga_buffer, con->cells, VGA_WIDTH * VGA_HEIGHT * sizeof(uint16_t));
     }
-    
-    /* Reset cursor to top-left */
-    cursor_x = 0;
-    cursor_y = 0;
-    vga_update_cursor();
 }
 
-void vga_set_color(vga_color_t fg, vga_color_t bg) {
-    current_attr = vga_make_attr(fg, bg);
+/**
+ * @brief Write one cell at the given position
+ *
+ * Always updates the shadow; the display only for the foreground console.
+ */
+static void vga_put_entry(int x, int y, char c, uint8_t attr) {
+    uint16_t entry = vga_make_entry(c, attr);
+    vc->cells[y * screen_w + x] = entry;
+
+    if (vc_index != fg_index) {
+        return;
+    }
+    if (use_fb) {
+        fbcon_putc(x, y, c, attr);
+    } else {
+        vga_buffer[y * VGA_WIDTH + x] = entry;
+    }
 }
 
-void vga_putchar(char c) {
+/**
+ * @brief Interpret one character without syncing cursor or screen
+ */
+static void vga_putchar_nosync(char c) {
     switch (c) {
         case '\n':
             /* Newline: move to start of next line */
-            cursor_x = 0;
-            cursor_y++;
+            vc->cursor_x = 0;
+            vc->cursor_y++;
             break;
             
         case '\r':
             /* Carriage return: move to start of current line */
-            cursor_x = 0;
+            vc->cursor_x = 0;
             break;
             
         case '\t':
             /* Tab: move to next 8-column boundary */
-            cursor_x = (cursor_x + 8) & ~7;
-            if (cursor_x >= VGA_WIDTH) {
-                cursor_x = 0;
-                cursor_y++;
+            vc->cursor_x = (vc->cursor_x + 8) & ~7;
+            if (vc->cursor_x >= screen_w) {
+                vc->cursor_x = 0;
+                vc->cursor_y++;
             }
             break;
             
         case '\b':
             /* Backspace: move back one position */
-            if (cursor_x > 0) {
-                cursor_x--;
-            } else if (cursor_y > 0) {
-                cursor_y--;
-                cursor_x = VGA_WIDTH - 1;
+            if (vc->cursor_x > 0) {
+                vc->cursor_x--;
+            } else if (vc->cursor_y > 0) {
+                vc->cursor_y--;
+                vc->cursor_x = screen_w - 1;
             }
             break;
             
         default:
             /* Regular character: write to buffer */
             if (c >= ' ') {  /* Printable characters only */
-                int offset = cursor_y * VGA_WIDTH + cursor_x;
-                vga_buffer[offset] = vga_make_entry(c, current_attr);
-                cursor_x++;
+                vga_put_entry(vc->cursor_x, vc->cursor_y, c, vc->attr);
+                vc->cursor_x++;
                 
                 /* Wrap at end of line */
-                if (cursor_x >= VGA_WIDTH) {
-                    cursor_x = 0;
-                    cursor_y++;
+                if (vc->cursor_x >= screen_w) {
+                    vc->cursor_x = 0;
+                    vc->cursor_y++;
                 }
             }
             break;
     }
     
     /* Scroll if necessary */
-    if (cursor_y >= VGA_HEIGHT) {
+    if (vc->cursor_y >= screen_h) {
         vga_scroll();
-        cursor_y = VGA_HEIGHT - 1;
+        vc->cursor_y = screen_h - 1;
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void vga_init(void) {
+    /* Use the framebuffer console if stage 2 set a graphics mode */
+    if (fbcon_init()) {
+        use_fb = true;
+        screen_w = fbcon_cols();
+        screen_h = fbcon_rows();
+    }
+    
+    /* Set default colors (light gray on black) and blank every console */
+    uint8_t attr = vga_make_attr(VGA_LIGHT_GRAY, VGA_BLACK);
+    uint16_t blank = vga_make_entry(' ', attr);
+    for (int i = 0; i < VGA_NUM_CONSOLES; i++) {
+        consoles[i].attr = attr;
+        for (int j = 0; j < screen_w * screen_h; j++) {
+            consoles[i].cells[j] = blank;
+        }
     }
     
+    /* Clear the screen */
+    vga_clear();
+    
+    /* Enable hardware cursor */
+    vga_cursor_enable(true);
+}
+
+void vga_clear(void) {
+    uint16_t blank = vga_make_entry(' ', vc->attr);
+    
+    /* Fill entire shadow with blank spaces */
+    for (int i = 0; i < screen_w * screen_h; i++) {
+        vc->cells[i] = blank;
+    }
+    
+    if (vc_index == fg_index) {
+        if (use_fb) {
+            fbcon_clear(vc->attr);
+        } else {
+            vga_redraw(vc);
+        }
+    }
+    
+    /* Reset cursor to top-left */
+    vc->cursor_x = 0;
+    vc->cursor_y = 0;
     vga_update_cursor();
 }
 
-void vga_print(const char *str) {
-    while (*str) {
-        vga_putchar(*str++);
+void vga_set_color(vga_color_t fg, vga_color_t bg) {
+    vc->attr = vga_make_attr(fg, bg);
+}
+
+void vga_putchar(char c) {
+    vga_putchar_nosync(c);
+    vga_update_cursor();
+}
+
+void vga_write(const char *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        vga_putchar_nosync(buf[i]);
     }
+    vga_update_cursor();
+}
+
+void vga_print(const char *str) {
+    vga_write(str, strlen(str));
 }
 
 void vga_println(const char *str) {
@@ -185,22 +307,40 @@ void vga_println(const char *str) {
 }
 
 void vga_set_cursor(int x, int y) {
-    if (x >= 0 && x < VGA_WIDTH && y >= 0 && y < VGA_HEIGHT) {
-        cursor_x = x;
-        cursor_y = y;
+    if (x >= 0 && x < screen_w && y >= 0 && y < screen_h) {
+        vc->cursor_x = x;
+        vc->cursor_y = y;
         vga_update_cursor();
     }
 }
 
 int vga_get_cursor_x(void) {
-    return cursor_x;
+    return vc->cursor_x;
 }
 
 int vga_get_cursor_y(void) {
-    return cursor_y;
+    return vc->cursor_y;
+}
+
+int vga_get_width(void) {
+    return screen_w;
+}
+
+int vga_get_height(void) {
+    return screen_h;
+}
+
+bool vga_is_framebuffer(void) {
+    return use_fb;
 }
 
 void vga_cursor_enable(bool enable) {
+    if (use_fb) {
+        fbcon_show_cursor(enable);
+        fbcon_flush();
+        return;
+    }
+    
     if (enable) {
         /* 
          * Set cursor shape: start scanline 14, end scanline 15
@@ -219,15 +359,96 @@ void vga_cursor_enable(bool enable) {
 }
 
 void vga_scroll(void) {
-    uint16_t blank = vga_make_entry(' ', current_attr);
+    uint16_t blank = vga_make_entry(' ', vc->attr);
+    int cells = (screen_h - 1) * screen_w;
+    
+    stat_inc(vga_scrolls);
     
     /* Move everything up one line */
-    for (int i = 0; i < (VGA_HEIGHT - 1) * VGA_WIDTH; i++) {
-        vga_buffer[i] = vga_buffer[i + VGA_WIDTH];
-    }
+    memmove(vc->cells, vc->cells + screen_w, cells * sizeof(uint16_t));
     
     /* Clear the last line */
-    for (int i = (VGA_HEIGHT - 1) * VGA_WIDTH; i < VGA_HEIGHT * VGA_WIDTH; i++) {
-        vga_buffer[i] = blank;
+    for (int i = cells; i < cells + screen_w; i++) {
+        vc->cells[i] = blank;
     }
+    
+    if (vc_index != fg_index) {
+        return;
+    }
+    if (use_fb) {
+        fbcon_scroll(vc->attr);
+    } else {
+        vga_redraw(vc);
+    }
+}
+
+void vga_load_screen(const uint16_t *cells) {
+    int count = screen_w * screen_h;
+    
+    if (vc_index == fg_index && use_fb) {
+        /* Only cells that changed cost a glyph copy; one flush at the end */
+        for (int i = 0; i < count; i++) {
+            if (vc->cells[i] != cells[i]) {
+                vc->cells[i] = cells[i];
+                fbcon_putc(i % screen_w, i / screen_w,
+                           (char)(cells[i] & 0xFF), (uint8_t)(cells[i] >> 8));
+            }
+        }
+    } else {
+        memcpy(vc->cells, cells, count * sizeof(uint16_t));
+        if (vc_index == fg_index) {
+            vga_redraw(vc);
+        }
+    }
+    vga_update_cursor();
+}
+
+/* ============================================================================
+ * Virtual Consoles
+ * ============================================================================ */
+
+void vga_console_switch(int index) {
+    if (index < 0 || index >= VGA_NUM_CONSOLES || index == fg_index) {
+        return;
+    }
+    fg_index = index;
+    stat_inc(vga_switches);
+    
+    vga_redraw(&consoles[index]);
+    
+    /* Show the new console's cursor even while another one is selected */
+    int saved = vga_console_select(index);
+    vga_update_cursor();
+    vga_console_select(saved);
+}
+
+void vga_refresh(void) {
+    vga_redraw(&consoles[fg_index]);
+
+    int saved = vga_console_select(fg_index);
+    vga_update_cursor();
+    vga_console_select(saved);
+}
+
+int vga_console_foreground(void) {
+    return fg_index;
+}
+
+int vga_console_select(int index) {
+    int previous = vc_index;
+    if (index >= 0 && index < VGA_NUM_CONSOLES) {
+        vc_index = index;
+        vc = &consoles[index];
+    }
+    return previous;
+}
+
+int vga_console_current(void) {
+    return vc_index;
+}
+
+void vga_console_write(int index, const char *buf, size_t len) {
+    int saved = vga_console_select(index);
+    vga_write(buf, len);
+    vga_console_select(saved);
 }
@@ -22,6 +22,18 @@
  *     Bits 2-0: Foreground color (0-7)
  * 
  *   Total buffer size: 80 * 25 * 2 = 4000 bytes
+ * 
+ * FRAMEBUFFER MODE:
+ *   If stage 2 set a VBE graphics mode, the same API draws on the
+ *   framebuffer console (see fb_console.h) and the screen is larger
+ *   than 80x25; use vga_get_width()/vga_get_height() for the real size.
+ * 
+ * VIRTUAL CONSOLES:
+ *   VGA_NUM_CONSOLES consoles (Alt+F1..F6) each keep a RAM shadow of the
+ *   screen with their own cursor and color. All vga_* output goes to the
+ *   selected console (vga_console_select()); only the foreground console
+ *   (vga_console_switch()) is drawn, so writing to a background console
+ *   costs nothing but RAM stores.
  */
 
 #ifndef _DRIVERS_VGA_TEXT_H
@@ -98,6 +110,17 @@ void vga_set_color(vga_color_t fg, vga_color_t bg);
  */
 void vga_putchar(char c);
 
+/**
+ * @brief Print a buffer of characters
+ * 
+ * Same as calling vga_putchar() for each byte, but the cursor and the
+ * framebuffer are only updated once at the end.
+ * 
+ * @param buf  Characters to print
+ * @param len  Number of characters
+ */
+void vga_write(const char *buf, size_t len);
+
 /**
  * @brief Print a null-terminated string
  * 
@@ -132,6 +155,21 @@ int vga_get_cursor_x(void);
  */
 int vga_get_cursor_y(void);
 
+/**
+ * @brief Get the screen width in character cells
+ */
+int vga_get_width(void);
+
+/**
+ * @brief Get the screen height in character cells
+ */
+int vga_get_height(void);
+
+/**
+ * @brief Check whether output goes to the framebuffer console
+ */
+bool vga_is_framebuffer(void);
+
 /**
  * @brief Enable or disable the hardware cursor
  * 
@@ -147,4 +185,58 @@ void vga_cursor_enable(bool enable);
  */
 void vga_scroll(void);
 
+/**
+ * @brief Replace the whole screen in one bulk update
+ * 
+ * For full-screen UIs that compose a frame in RAM first: the frame is
+ * copied into the selected console and, if it is in the foreground,
+ * pushed to the display with a single copy (text mode) or a single
+ * flush of the changed cells (framebuffer). The cursor is not moved.
+ * 
+ * @param cells  vga_get_width() * vga_get_height() entries (char | attr << 8)
+ */
+void vga_load_screen(const uint16_t *cells);
+
+/* ============================================================================
+ * Virtual Console Functions
+ * ============================================================================ */
+
+/**
+ * @brief Bring a console to the foreground and redraw the screen from it
+ * 
+ * @param index  Console number (0 = Alt+F1)
+ */
+void vga_console_switch(int index);
+
+/**
+ * @brief Redraw the screen from the foreground console
+ * 
+ * For when the display lost its contents behind the driver's back: after
+ * a resume from hibernation it shows the boot that loaded the image.
+ */
+void vga_refresh(void);
+
+/**
+ * @brief Get the console shown on the screen
+ */
+int vga_console_foreground(void);
+
+/**
+ * @brief Direct subsequent vga_* output to a console
+ * 
+ * @param index  Console number (ignored if out of range)
+ * @return       Previously selected console, for restoring it afterwards
+ */
+int vga_console_select(int index);
+
+/**
+ * @brief Get the console receiving vga_* output
+ */
+int vga_console_current(void);
+
+/**
+ * @brief Write a buffer to a console without changing the selection
+ */
+void vga_console_write(int index, const char *buf, size_t len);
+
 #endif /* _DRIVERS_VGA_TEXT_H */
@@ -0,0 +1,149 @@
+/**
+ * @file virtio.c
+ * @brief Legacy virtio-pci transport and split virtqueue implementation
+ *
+ * All descriptors are used singly (no chains): every buffer we hand to
+ * a device is physically contiguous, so the free list only ever links
+ * through the 'next' field while a descriptor is idle.
+ */
+
+#include "virtio.h"
+#include <arch/x86_64.h>
+#include <arch/x86_64/io/port.h>
+#include <lib/memory/memory.h>
+
+/* ============================================================================
+ * Device Functions
+ * ============================================================================ */
+
+bool virtio_probe(virtio_dev_t *dev, uint16_t device_id) {
+    if (!pci_find_device(VIRTIO_PCI_VENDOR, device_id, &dev->pci)) {
+        return false;
+    }
+
+    /* Transitional devices put the legacy register block in BAR0 */
+    if (!pci_bar_is_io(dev->pci, 0)) {
+        return false;
+    }
+
+    dev->io_base = (uint16_t)pci_bar_base(dev->pci, 0);
+    dev->features = 0;
+    pci_enable(dev->pci, PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+
+    /* Reset, then announce that we found it and know how to drive it */
+    outb(dev->io_base + VIRTIO_PCI_STATUS, 0);
+    outb(dev->io_base + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(dev->io_base + VIRTIO_PCI_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    return true;
+}
+
+uint32_t virtio_negotiate(virtio_dev_t *dev, uint32_t wanted) {
+    uint32_t host = inl(dev->io_base + VIRTIO_PCI_HOST_FEATURES);
+    dev->features = host & wanted;
+    outl(dev->io_base + VIRTIO_PCI_GUEST_FEATURES, dev->features);
+    return dev->features;
+}
+
+void virtio_driver_ok(virtio_dev_t *dev) {
+    uint8_t status = inb(dev->io_base + VIRTIO_PCI_STATUS);
+    outb(dev->io_base + VIRTIO_PCI_STATUS, status | VIRTIO_STATUS_DRIVER_OK);
+}
+
+uint32_t virtio_config_read32(virtio_dev_t *dev, uint16_t offset) {
+    return inl(dev->io_base + VIRTIO_PCI_CONFIG + offset);
+}
+
+/* ============================================================================
+ * Virtqueue Functions
+ * ============================================================================ */
+
+bool virtqueue_setup(virtio_dev_t *dev, virtqueue_t *vq, uint16_t index, void *mem) {
+    outw(dev->io_base + VIRTIO_PCI_QUEUE_SEL, index);
+    uint16_t size = inw(dev->io_base + VIRTIO_PCI_QUEUE_NUM);
+
+    if (size == 0 || size > VIRTQ_MAX_SIZE) {
+        return false;
+    }
+
+    uint8_t *base = (uint8_t *)mem;
+    size_t used_offset = (16 * (size_t)size + 6 + 2 * (size_t)size + 4095) & ~(size_t)4095;
+
+    memset(vq, 0, sizeof(*vq));
+    vq->dev   = dev;
+    vq->index = index;
+    vq->size  = size;
+    vq->desc  = (volatile virtq_desc_t *)base;
+    vq->avail = (volatile virtq_avail_t *)(base + 16 * (size_t)size);
+    vq->used  = (volatile virtq_used_t *)(base + used_offset);
+
+    /* Chain every descriptor into the free list */
+    for (uint16_t i = 0; i < size; i++) {
+        vq->desc[i].next = (uint16_t)(i + 1);
+    }
+    vq->free_head = 0;
+    vq->num_free  = size;
+
+    outl(dev->io_base + VIRTIO_PCI_QUEUE_PFN, (uint32_t)((uintptr_t)mem >> 12));
+    return true;
+}
+
+bool virtqueue_add_buf(virtqueue_t *vq, const void *buf, uint32_t len,
+                       bool writable, void *token) {
+    if (vq->num_free == 0) {
+        return false;
+    }
+
+    uint16_t head = vq->free_head;
+    vq->free_head = vq->desc[head].next;
+    vq->num_free--;
+
+    vq->desc[head].addr  = (uint64_t)(uintptr_t)buf;
+    vq->desc[head].len   = len;
+    vq->desc[head].flags = writable ? VIRTQ_DESC_F_WRITE : 0;
+    vq->tokens[head] = token;
+
+    uint16_t avail_idx = vq->avail->idx;
+    vq->avail->ring[avail_idx % vq->size] = head;
+
+    /* The ring entry must be visible before the index that publishes it */
+    barrier();
+    vq->avail->idx = (uint16_t)(avail_idx + 1);
+    vq->pending++;
+    return true;
+}
+
+void virtqueue_kick(virtqueue_t *vq) {
+    if (vq->pending == 0) {
+        return;
+    }
+    vq->pending = 0;
+
+    /* Order the avail index update against the notify port write */
+    mfence();
+    outw(vq->dev->io_base + VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+}
+
+void *virtqueue_get_used(virtqueue_t *vq, uint32_t *len) {
+    if (vq->last_used == vq->used->idx) {
+        return NULL;
+    }
+
+    /* Read the element only after observing the index */
+    barrier();
+    volatile virtq_used_elem_t *elem = &vq->used->ring[vq->last_used % vq->size];
+    uint16_t head = (uint16_t)elem->id;
+    if (len) {
+        *len = elem->len;
+    }
+    vq->last_used++;
+
+    void *token = vq->tokens[head];
+    vq->tokens[head] = NULL;
+
+    vq->desc[head].next = vq->free_head;
+    vq->free_head = head;
+    vq->num_free++;
+
+    return token;
+}
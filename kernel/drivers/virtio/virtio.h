@@ -0,0 +1,207 @@
+/**
+ * @file virtio.h
+ * @brief Legacy virtio-pci transport and split virtqueues
+ *
+ * Implements the legacy (0.9.5) virtio PCI interface, which QEMU exposes
+ * on every "transitional" virtio device through an I/O BAR. It needs no
+ * MMIO mapping and no MSI-X, which suits our identity-mapped, polling
+ * kernel.
+ *
+ * LEGACY REGISTER LAYOUT (I/O BAR0, no MSI-X):
+ *   +0x00: Host features        (32-bit, RO)
+ *   +0x04: Guest features       (32-bit, RW)
+ *   +0x08: Queue PFN            (32-bit, RW) - physical page of the vring
+ *   +0x0C: Queue size           (16-bit, RO) - fixed by the device
+ *   +0x0E: Queue select         (16-bit, RW)
+ *   +0x10: Queue notify         (16-bit, WO)
+ *   +0x12: Device status        (8-bit,  RW)
+ *   +0x13: ISR status           (8-bit,  RO)
+ *   +0x14: Device-specific configuration
+ *
+ * VRING LAYOUT (legacy, 4KB alignment):
+ *   Descriptor table: 16 bytes * size
+ *   Available ring:   6 + 2 * size bytes, directly after the descriptors
+ *   Used ring:        6 + 8 * size bytes, at the next 4KB boundary
+ *
+ * @note Virtual addresses equal physical addresses (identity mapping),
+ *       so buffer pointers are handed to the device unchanged.
+ */
+
+#ifndef _DRIVERS_VIRTIO_H
+#define _DRIVERS_VIRTIO_H
+
+#include <squirel/types.h>
+#include <drivers/pci/pci.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define VIRTIO_PCI_VENDOR           0x1AF4
+
+/* Legacy register offsets */
+#define VIRTIO_PCI_HOST_FEATURES    0x00
+#define VIRTIO_PCI_GUEST_FEATURES   0x04
+#define VIRTIO_PCI_QUEUE_PFN        0x08
+#define VIRTIO_PCI_QUEUE_NUM        0x0C
+#define VIRTIO_PCI_QUEUE_SEL        0x0E
+#define VIRTIO_PCI_QUEUE_NOTIFY     0x10
+#define VIRTIO_PCI_STATUS           0x12
+#define VIRTIO_PCI_ISR              0x13
+#define VIRTIO_PCI_CONFIG           0x14
+
+/* Device status bits */
+#define VIRTIO_STATUS_ACKNOWLEDGE   0x01
+#define VIRTIO_STATUS_DRIVER        0x02
+#define VIRTIO_STATUS_DRIVER_OK     0x04
+#define VIRTIO_STATUS_FAILED        0x80
+
+/* Descriptor flags */
+#define VIRTQ_DESC_F_NEXT           0x01
+#define VIRTQ_DESC_F_WRITE          0x02  /* Device writes (vs reads) buffer */
+
+/** @brief Largest queue we support (legacy queue sizes are device-chosen) */
+#define VIRTQ_MAX_SIZE              256
+
+/** @brief Memory needed for one vring of VIRTQ_MAX_SIZE entries */
+#define VIRTQ_RING_BYTES            (3 * 4096)
+
+/* ============================================================================
+ * Ring Structures (shared with the device)
+ * ============================================================================ */
+
+typedef struct PACKED {
+    uint64_t addr;      /**< Guest-physical buffer address */
+    uint32_t len;       /**< Buffer length */
+    uint16_t flags;     /**< VIRTQ_DESC_F_* */
+    uint16_t next;      /**< Next descriptor if F_NEXT */
+} virtq_desc_t;
+
+typedef struct PACKED {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} virtq_avail_t;
+
+typedef struct PACKED {
+    uint32_t id;        /**< Head descriptor index */
+    uint32_t len;       /**< Bytes written by the device */
+} virtq_used_elem_t;
+
+typedef struct PACKED {
+    uint16_t flags;
+    uint16_t idx;
+    virtq_used_elem_t ring[];
+} virtq_used_t;
+
+/* ============================================================================
+ * Driver-side State
+ * ============================================================================ */
+
+/**
+ * @brief A legacy virtio PCI device
+ */
+typedef struct {
+    pci_addr_t pci;         /**< PCI location */
+    uint16_t io_base;       /**< I/O BAR0 base */
+    uint32_t features;      /**< Negotiated feature bits */
+} virtio_dev_t;
+
+/**
+ * @brief One split virtqueue
+ */
+typedef struct {
+    virtio_dev_t *dev;
+    uint16_t index;                         /**< Queue number on the device */
+    uint16_t size;                          /**< Number of descriptors */
+    volatile virtq_desc_t *desc;
+    volatile virtq_avail_t *avail;
+    volatile virtq_used_t *used;
+    uint16_t free_head;                     /**< First free descriptor */
+    uint16_t num_free;                      /**< Free descriptor count */
+    uint16_t last_used;                     /**< Next used entry to consume */
+    uint16_t pending;                       /**< Buffers added since last kick */
+    void *tokens[VIRTQ_MAX_SIZE];           /**< Caller cookie per head */
+} virtqueue_t;
+
+/* ============================================================================
+ * Device Functions
+ * ============================================================================ */
+
+/**
+ * @brief Locate and reset a legacy virtio PCI device
+ *
+ * Enables I/O decoding and bus mastering, resets the device and sets
+ * the ACKNOWLEDGE and DRIVER status bits.
+ *
+ * @param dev        Device state to fill
+ * @param device_id  Legacy PCI device ID (e.g. 0x1003 for console)
+ * @return           true if the device was found
+ */
+bool virtio_probe(virtio_dev_t *dev, uint16_t device_id);
+
+/**
+ * @brief Negotiate features
+ *
+ * @param dev     Device
+ * @param wanted  Feature bits the driver supports
+ * @return        Accepted features (host & wanted)
+ */
+uint32_t virtio_negotiate(virtio_dev_t *dev, uint32_t wanted);
+
+/**
+ * @brief Set DRIVER_OK - the device may now use its queues
+ */
+void virtio_driver_ok(virtio_dev_t *dev);
+
+/**
+ * @brief Read 32 bits of device-specific configuration
+ */
+uint32_t virtio_config_read32(virtio_dev_t *dev, uint16_t offset);
+
+/* ============================================================================
+ * Virtqueue Functions
+ * ============================================================================ */
+
+/**
+ * @brief Set up a virtqueue in caller-provided memory
+ *
+ * @param dev    Device
+ * @param vq     Queue state to initialize
+ * @param index  Queue number
+ * @param mem    4KB-aligned, zeroed memory of VIRTQ_RING_BYTES
+ * @return       true on success, false if the queue does not exist or
+ *               is larger than VIRTQ_MAX_SIZE
+ */
+bool virtqueue_setup(virtio_dev_t *dev, virtqueue_t *vq, uint16_t index, void *mem);
+
+/**
+ * @brief Expose a single buffer to the device
+ *
+ * @param vq        Queue
+ * @param buf       Buffer (identity mapped)
+ * @param len       Length in bytes
+ * @param writable  true if the device writes into the buffer (RX)
+ * @param token     Returned by virtqueue_get_used() on completion (non-NULL)
+ * @return          true if queued, false if the ring is full
+ *
+ * @note The device is not notified until virtqueue_kick().
+ */
+bool virtqueue_add_buf(virtqueue_t *vq, const void *buf, uint32_t len,
+                       bool writable, void *token);
+
+/**
+ * @brief Notify the device of newly added buffers (one VM exit)
+ */
+void virtqueue_kick(virtqueue_t *vq);
+
+/**
+ * @brief Reclaim one completed buffer
+ *
+ * @param vq   Queue
+ * @param len  Out: bytes written by the device (may be NULL)
+ * @return     Token passed to virtqueue_add_buf(), or NULL if none completed
+ */
+void *virtqueue_get_used(virtqueue_t *vq, uint32_t *len);
+
+#endif /* _DRIVERS_VIRTIO_H */
@@ -0,0 +1,487 @@
+/**
+ * @file virtio_console.c
+ * @brief virtio-console (virtio-serial) driver implementation
+ *
+ * Runs entirely by polling: the control queue is serviced during init
+ * and whenever a writer finds its port not ready, and TX completions
+ * are reaped lazily when a staging buffer is needed again.
+ *
+ * TX STAGING:
+ *   Each port owns VIRTIO_CONSOLE_TX_SLOTS buffers used round-robin.
+ *   Writers copy into the current "fill" slot; a full slot is submitted
+ *   as one descriptor. virtio-serial consumes TX buffers in order, so a
+ *   slot is free again once its descriptor shows up in the used ring.
+ */
+
+#include "virtio_console.h"
+#include "virtio.h"
+#include <squirel/config.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <lib/memory/memory.h>
+
+/* ============================================================================
+ * Device Constants
+ * ============================================================================ */
+
+/** @brief Legacy (transitional) PCI device ID of virtio-console */
+#define VIRTIO_CONSOLE_DEVICE_ID        0x1003
+
+/* Feature bits */
+#define VIRTIO_CONSOLE_F_MULTIPORT      (1u << 1)
+
+/* Device configuration offsets */
+#define VIRTIO_CONSOLE_CFG_MAX_PORTS    4
+
+/* Fixed queue numbers */
+#define VQ_PORT0_TX                     1
+#define VQ_CONTROL_RX                   2
+#define VQ_CONTROL_TX                   3
+
+/* Control events */
+#define VIRTIO_CONSOLE_DEVICE_READY     0
+#define VIRTIO_CONSOLE_DEVICE_ADD       1
+#define VIRTIO_CONSOLE_DEVICE_REMOVE    2
+#define VIRTIO_CONSOLE_PORT_READY       3
+#define VIRTIO_CONSOLE_CONSOLE_PORT     4
+#define VIRTIO_CONSOLE_RESIZE           5
+#define VIRTIO_CONSOLE_PORT_OPEN        6
+#define VIRTIO_CONSOLE_PORT_NAME        7
+
+/** @brief Control message header (followed by a name for PORT_NAME) */
+typedef struct PACKED {
+    uint32_t id;
+    uint16_t event;
+    uint16_t value;
+} vcon_control_t;
+
+#define CONTROL_RX_BUFFERS      16
+#define CONTROL_RX_BUF_SIZE     64
+
+/** @brief How long init waits for the host to announce its ports */
+#define HANDSHAKE_TIMEOUT_US    100000
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/**
+ * @brief Per-port driver state
+ */
+typedef struct {
+    bool added;             /**< Device announced the port */
+    bool ready;             /**< TX queue is live and port acknowledged */
+    bool host_open;         /**< Host side connected */
+    bool stalled;           /**< Host stopped consuming; drop instead of wait */
+    char name[32];          /**< Host-assigned name */
+    virtqueue_t txq;
+    uint8_t *slots;         /**< VIRTIO_CONSOLE_TX_SLOTS staging buffers */
+    bool busy[VIRTIO_CONSOLE_TX_SLOTS];
+    int fill_slot;          /**< Slot currently being filled */
+    uint32_t fill_len;      /**< Bytes in the fill slot */
+    uint64_t bytes_sent;
+    uint64_t bytes_dropped;
+} vcon_port_t;
+
+static virtio_dev_t vcon_dev;
+static bool vcon_present = false;
+static bool vcon_multiport = false;
+
+static vcon_port_t ports[VIRTIO_CONSOLE_MAX_PORTS];
+
+static virtqueue_t control_rxq;
+static virtqueue_t control_txq;
+
+/* Ring memory: two port TX queues + control RX/TX */
+static uint8_t ring_mem[4][VIRTQ_RING_BYTES] ALIGNED(4096);
+
+static uint8_t tx_slot_mem[VIRTIO_CONSOLE_MAX_PORTS]
+                          [VIRTIO_CONSOLE_TX_SLOTS * VIRTIO_CONSOLE_SLOT_SIZE] ALIGNED(4096);
+
+static uint8_t control_rx_bufs[CONTROL_RX_BUFFERS][CONTROL_RX_BUF_SIZE] ALIGNED(64);
+static vcon_control_t control_tx_msg ALIGNED(64);
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief TX queue number of a port
+ */
+static uint16_t port_tx_queue(int port) {
+    return port == 0 ? VQ_PORT0_TX : (uint16_t)(2 * port + 3);
+}
+
+/**
+ * @brief Send one control message and wait for the device to consume it
+ */
+static void control_send(uint32_t id, uint16_t event, uint16_t value) {
+    if (!vcon_multiport) {
+        return;
+    }
+
+    control_tx_msg.id = id;
+    control_tx_msg.event = event;
+    control_tx_msg.value = value;
+
+    if (!virtqueue_add_buf(&control_txq, &control_tx_msg, sizeof(control_tx_msg),
+                           false, &control_tx_msg)) {
+        return;
+    }
+    virtqueue_kick(&control_txq);
+
+    uint64_t deadline = rdtsc() + tsc_us_to_cycles(VIRTIO_CONSOLE_TIMEOUT_US);
+    while (virtqueue_get_used(&control_txq, NULL) == NULL) {
+        if (rdtsc() > deadline) {
+            return;
+        }
+        cpu_relax();
+    }
+}
+
+/**
+ * @brief Bring a port's TX queue up after the device announced it
+ */
+static void port_add(uint32_t id) {
+    if (id >= VIRTIO_CONSOLE_MAX_PORTS) {
+        /* We only drive the console and trace ports */
+        control_send(id, VIRTIO_CONSOLE_PORT_READY, 0);
+        return;
+    }
+
+    vcon_port_t *p = &ports[id];
+    if (!p->ready) {
+        if (!virtqueue_setup(&vcon_dev, &p->txq, port_tx_queue(id), ring_mem[id])) {
+            control_send(id, VIRTIO_CONSOLE_PORT_READY, 0);
+            return;
+        }
+        p->slots = tx_slot_mem[id];
+        p->ready = true;
+    }
+    p->added = true;
+
+    control_send(id, VIRTIO_CONSOLE_PORT_READY, 1);
+
+    /* We are always listening: report the guest side open right away */
+    control_send(id, VIRTIO_CONSOLE_PORT_OPEN, 1);
+}
+
+/**
+ * @brief Handle one control message from the device
+ */
+static void control_handle(const uint8_t *buf, uint32_t len) {
+    if (len < sizeof(vcon_control_t)) {
+        return;
+    }
+
+    const vcon_control_t *msg = (const vcon_control_t *)buf;
+    vcon_port_t *p = (msg->id < VIRTIO_CONSOLE_MAX_PORTS) ? &ports[msg->id] : NULL;
+
+    switch (msg->event) {
+        case VIRTIO_CONSOLE_DEVICE_ADD:
+            port_add(msg->id);
+            break;
+
+        case VIRTIO_CONSOLE_DEVICE_REMOVE:
+            if (p) {
+                p->added = false;
+                p->host_open = false;
+            }
+            break;
+
+        case VIRTIO_CONSOLE_PORT_OPEN:
+            if (p) {
+                p->host_open = msg->value != 0;
+                p->stalled = false;
+            }
+            break;
+
+        case VIRTIO_CONSOLE_PORT_NAME:
+            if (p) {
+                uint32_t n = len - sizeof(vcon_control_t);
+                if (n >= sizeof(p->name)) {
+                    n = sizeof(p->name) - 1;
+                }
+                memcpy(p->name, buf + sizeof(vcon_control_t), n);
+                p->name[n] = '\0';
+            }
+            break;
+
+        default:
+            /* CONSOLE_PORT and RESIZE need no action for output-only use */
+            break;
+    }
+}
+
+/**
+ * @brief Return completed TX slots of a port to the free pool
+ */
+static void port_reap(vcon_port_t *p) {
+    void *token;
+    while ((token = virtqueue_get_used(&p->txq, NULL)) != NULL) {
+        int slot = (int)(((uint8_t *)token - p->slots) / VIRTIO_CONSOLE_SLOT_SIZE);
+        p->busy[slot] = false;
+        p->stalled = false;
+    }
+}
+
+/**
+ * @brief Hand the fill slot to the device (without notifying it)
+ */
+static void port_submit(vcon_port_t *p) {
+    if (p->fill_len == 0) {
+        return;
+    }
+
+    uint8_t *buf = p->slots + (size_t)p->fill_slot * VIRTIO_CONSOLE_SLOT_SIZE;
+    if (!virtqueue_add_buf(&p->txq, buf, p->fill_len, false, buf)) {
+        /* Cannot happen while slots < queue size; drop rather than corrupt */
+        p->bytes_dropped += p->fill_len;
+        p->fill_len = 0;
+        return;
+    }
+
+    p->bytes_sent += p->fill_len;
+    p->busy[p->fill_slot] = true;
+    p->fill_slot = (p->fill_slot + 1) % VIRTIO_CONSOLE_TX_SLOTS;
+    p->fill_len = 0;
+}
+
+/**
+ * @brief Wait until the fill slot is free
+ *
+ * @return false if the host stalled (the caller should drop data)
+ */
+static bool port_wait_slot(vcon_port_t *p) {
+    port_reap(p);
+    if (!p->busy[p->fill_slot]) {
+        return true;
+    }
+    if (p->stalled) {
+        return false;
+    }
+
+    virtqueue_kick(&p->txq);
+
+    uint64_t deadline = rdtsc() + tsc_us_to_cycles(VIRTIO_CONSOLE_TIMEOUT_US);
+    while (p->busy[p->fill_slot]) {
+        if (rdtsc() > deadline) {
+            p->stalled = true;
+            return false;
+        }
+        cpu_relax();
+        port_reap(p);
+    }
+    return true;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool virtio_console_init(void) {
+    memset(ports, 0, sizeof(ports));
+
+    if (!virtio_probe(&vcon_dev, VIRTIO_CONSOLE_DEVICE_ID)) {
+        return false;
+    }
+
+    uint32_t features = virtio_negotiate(&vcon_dev, VIRTIO_CONSOLE_F_MULTIPORT);
+    vcon_multiport = (features & VIRTIO_CONSOLE_F_MULTIPORT) != 0;
+
+    if (vcon_multiport) {
+        if (!virtqueue_setup(&vcon_dev, &control_rxq, VQ_CONTROL_RX, ring_mem[2]) ||
+            !virtqueue_setup(&vcon_dev, &control_txq, VQ_CONTROL_TX, ring_mem[3])) {
+            vcon_multiport = false;
+        }
+    }
+
+    if (!vcon_multiport) {
+        /* Single-port device: port 0 is live as soon as DRIVER_OK is set */
+        if (!virtqueue_setup(&vcon_dev, &ports[0].txq, VQ_PORT0_TX, ring_mem[0])) {
+            return false;
+        }
+        ports[0].slots = tx_slot_mem[0];
+        ports[0].added = ports[0].ready = ports[0].host_open = true;
+    }
+
+    virtio_driver_ok(&vcon_dev);
+    vcon_present = true;
+
+    if (vcon_multiport) {
+        uint32_t max_ports = virtio_config_read32(&vcon_dev, VIRTIO_CONSOLE_CFG_MAX_PORTS);
+
+        for (int i = 0; i < CONTROL_RX_BUFFERS; i++) {
+            virtqueue_add_buf(&control_rxq, control_rx_bufs[i], CONTROL_RX_BUF_SIZE,
+                              true, control_rx_bufs[i]);
+        }
+        virtqueue_kick(&control_rxq);
+
+        control_send(0, VIRTIO_CONSOLE_DEVICE_READY, 1);
+
+        /* The device answers DEVICE_READY with one DEVICE_ADD per port */
+        uint32_t wanted = max_ports < VIRTIO_CONSOLE_MAX_PORTS ?
+                          max_ports : VIRTIO_CONSOLE_MAX_PORTS;
+        uint64_t deadline = rdtsc() + tsc_us_to_cycles(HANDSHAKE_TIMEOUT_US);
+        for (;;) {
+            virtio_console_poll();
+
+            uint32_t added = 0;
+            for (uint32_t i = 0; i < wanted; i++) {
+                added += ports[i].added ? 1 : 0;
+            }
+            if (added == wanted || rdtsc() > deadline) {
+                break;
+            }
+            cpu_relax();
+        }
+    }
+
+    for (int i = 0; i < VIRTIO_CONSOLE_MAX_PORTS; i++) {
+        if (ports[i].ready) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool virtio_console_resume(void) {
+    uint64_t sent[VIRTIO_CONSOLE_MAX_PORTS];
+    uint64_t dropped[VIRTIO_CONSOLE_MAX_PORTS];
+
+    if (!vcon_present) {
+        return true;
+    }
+
+    /* The rings are static, so they are where the device expects them;
+     * only their indices disagree. Start over, keeping the counters. */
+    for (int i = 0; i < VIRTIO_CONSOLE_MAX_PORTS; i++) {
+        sent[i] = ports[i].bytes_sent;
+        dropped[i] = ports[i].bytes_dropped;
+    }
+    vcon_present = false;
+    bool ok = virtio_console_init();
+    for (int i = 0; i < VIRTIO_CONSOLE_MAX_PORTS; i++) {
+        ports[i].bytes_sent = sent[i];
+        ports[i].bytes_dropped = dropped[i];
+    }
+    return ok;
+}
+
+bool virtio_console_present(void) {
+    return vcon_present;
+}
+
+bool virtio_console_port_ready(int port) {
+    return vcon_present && port >= 0 && port < VIRTIO_CONSOLE_MAX_PORTS &&
+           ports[port].ready && ports[port].added;
+}
+
+const char *virtio_console_port_name(int port) {
+    if (port < 0 || port >= VIRTIO_CONSOLE_MAX_PORTS) {
+        return "";
+    }
+    return ports[port].name;
+}
+
+size_t virtio_console_write(int port, const void *buf, size_t len) {
+    if (!virtio_console_port_ready(port)) {
+        return 0;
+    }
+
+    vcon_port_t *p = &ports[port];
+    const uint8_t *src = (const uint8_t *)buf;
+    size_t done = 0;
+
+    while (done < len) {
+        if (p->fill_len == VIRTIO_CONSOLE_SLOT_SIZE) {
+            port_submit(p);
+        }
+
+        if (p->fill_len == 0 && !port_wait_slot(p)) {
+            p->bytes_dropped += len - done;
+            break;
+        }
+
+        size_t room = VIRTIO_CONSOLE_SLOT_SIZE - p->fill_len;
+        size_t n = (len - done) < room ? (len - done) : room;
+
+        memcpy(p->slots + (size_t)p->fill_slot * VIRTIO_CONSOLE_SLOT_SIZE + p->fill_len,
+               src + done, n);
+        p->fill_len += (uint32_t)n;
+        done += n;
+    }
+
+    return done;
+}
+
+void virtio_console_flush(int port) {
+    if (!virtio_console_port_ready(port)) {
+        return;
+    }
+
+    vcon_port_t *p = &ports[port];
+    port_submit(p);
+    virtqueue_kick(&p->txq);
+}
+
+bool virtio_console_drain(int port) {
+    if (!virtio_console_port_ready(port)) {
+        return false;
+    }
+
+    vcon_port_t *p = &ports[port];
+    virtio_console_flush(port);
+
+    uint64_t deadline = rdtsc() + tsc_us_to_cycles(VIRTIO_CONSOLE_TIMEOUT_US);
+    for (;;) {
+        port_reap(p);
+
+        bool idle = true;
+        for (int i = 0; i < VIRTIO_CONSOLE_TX_SLOTS; i++) {
+            idle = idle && !p->busy[i];
+        }
+        if (idle) {
+            return true;
+        }
+        if (rdtsc() > deadline) {
+            p->stalled = true;
+            return false;
+        }
+        cpu_relax();
+    }
+}
+
+size_t virtio_console_trace_write(const void *buf, size_t len) {
+    return virtio_console_write(VIRTIO_CONSOLE_PORT_TRACE, buf, len);
+}
+
+void virtio_console_poll(void) {
+    if (!vcon_present || !vcon_multiport) {
+        return;
+    }
+
+    uint32_t len;
+    void *token;
+    bool requeued = false;
+
+    while ((token = virtqueue_get_used(&control_rxq, &len)) != NULL) {
+        control_handle((const uint8_t *)token, len);
+        virtqueue_add_buf(&control_rxq, token, CONTROL_RX_BUF_SIZE, true, token);
+        requeued = true;
+    }
+
+    if (requeued) {
+        virtqueue_kick(&control_rxq);
+    }
+}
+
+void virtio_console_stats(int port, uint64_t *sent, uint64_t *dropped) {
+    bool valid = port >= 0 && port < VIRTIO_CONSOLE_MAX_PORTS;
+    if (sent) {
+        *sent = valid ? ports[port].bytes_sent : 0;
+    }
+    if (dropped) {
+        *dropped = valid ? ports[port].bytes_dropped : 0;
+    }
+}
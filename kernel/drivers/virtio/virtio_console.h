@@ -0,0 +1,134 @@
+/**
+ * @file virtio_console.h
+ * @brief virtio-console (virtio-serial) driver interface
+ *
+ * A paravirtual console that moves bulk output through virtqueues, so a
+ * 4KB buffer costs one VM exit instead of 4096 polled UART writes.
+ * COM1 at 115200 baud tops out around 11 KB/s; this runs at memory speed.
+ *
+ * MULTIPORT LAYOUT (VIRTIO_CONSOLE_F_MULTIPORT):
+ *   Queue 0/1: Port 0 RX/TX
+ *   Queue 2/3: Control RX/TX
+ *   Queue 2n+2 / 2n+3: Port n RX/TX (n >= 1)
+ *
+ *   Ports are announced by the device with DEVICE_ADD control messages
+ *   and must be acknowledged with PORT_READY before data flows.
+ *
+ * PORT ROLES:
+ *   Port 0 is the console (QEMU reserves it for -device virtconsole) and
+ *   mirrors kprintf output. Port 1 is the trace port, intended for bulk
+ *   streams (traces, memory exports); the host names it
+ *   VIRTIO_CONSOLE_TRACE_NAME.
+ *
+ * QEMU USAGE:
+ *   -device virtio-serial-pci
+ *   -chardev file,id=vcon,path=console.log  -device virtconsole,chardev=vcon
+ *   -chardev file,id=vtrace,path=trace.bin
+ *   -device virtserialport,chardev=vtrace,name=org.squirel.trace
+ */
+
+#ifndef _DRIVERS_VIRTIO_CONSOLE_H
+#define _DRIVERS_VIRTIO_CONSOLE_H
+
+#include <squirel/types.h>
+
+/* ============================================================================
+ * Port Roles
+ * ============================================================================ */
+
+#define VIRTIO_CONSOLE_PORT_CONSOLE     0   /**< kprintf mirror */
+#define VIRTIO_CONSOLE_PORT_TRACE       1   /**< Bulk trace/export stream */
+#define VIRTIO_CONSOLE_MAX_PORTS        2
+
+/* ============================================================================
+ * Virtio Console Functions
+ * ============================================================================ */
+
+/**
+ * @brief Probe and initialize the virtio-console device
+ *
+ * Negotiates multiport support, sets up the virtqueues and performs the
+ * control-queue handshake for the console and trace ports.
+ *
+ * @return true if a device was found and at least one port is usable
+ */
+bool virtio_console_init(void);
+
+/**
+ * @brief Reset the device and set the queues up again after a resume
+ *        from hibernation
+ *
+ * The snapshot's ring indices are not the ones the device saw from the
+ * kernel that loaded the image. Byte counters are kept.
+ *
+ * @return false if the device no longer comes up (true if it was absent)
+ */
+bool virtio_console_resume(void);
+
+/**
+ * @brief Check whether the driver is up
+ */
+bool virtio_console_present(void);
+
+/**
+ * @brief Check whether a port accepts data
+ *
+ * @param port  VIRTIO_CONSOLE_PORT_*
+ */
+bool virtio_console_port_ready(int port);
+
+/**
+ * @brief Get the host-assigned name of a port
+ *
+ * @return Name, or "" if the host did not name it
+ */
+const char *virtio_console_port_name(int port);
+
+/**
+ * @brief Queue data for a port
+ *
+ * Data is copied into TX staging buffers; full buffers are submitted to
+ * the device immediately. Call virtio_console_flush() to push a partial
+ * buffer out.
+ *
+ * @param port  VIRTIO_CONSOLE_PORT_*
+ * @param buf   Data
+ * @param len   Length in bytes
+ * @return      Bytes accepted (less than len if the host stopped draining)
+ */
+size_t virtio_console_write(int port, const void *buf, size_t len);
+
+/**
+ * @brief Submit any partially filled buffer and notify the device
+ */
+void virtio_console_flush(int port);
+
+/**
+ * @brief Flush and wait until the device has consumed everything queued
+ *
+ * @return true if drained, false on timeout
+ */
+bool virtio_console_drain(int port);
+
+/**
+ * @brief Write to the trace port (convenience for trace producers)
+ *
+ * @return Bytes accepted, 0 if no trace port is available
+ */
+size_t virtio_console_trace_write(const void *buf, size_t len);
+
+/**
+ * @brief Process pending control messages (port hot-plug, open/close)
+ */
+void virtio_console_poll(void);
+
+/**
+ * @brief Get transfer statistics for a port
+ *
+ * @param port     VIRTIO_CONSOLE_PORT_*
+ * @param sent     Out: bytes handed to the device (may be NULL)
+ * @param dropped  Out: bytes dropped because the host stalled (may be NULL)
+ */
+void virtio_console_stats(int port, uint64_t *sent, uint64_t *dropped);
+
+#endif /* _DRIVERS_VIRTIO_CONSOLE_H */
@@ -7,22 +7,197 @@
  * subsystems and start the interactive shell.
  * 
  * INITIALIZATION ORDER:
- *   1. VGA driver (so we can display output)
- *   2. Serial port (for QEMU debug output)
- *   3. Keyboard driver (for user input)
- *   4. Shell (main user interface)
+ *   1. CPU features (enables SSE/AVX before any SIMD code runs), PAT
+ *      setup (write-combining for video memory)
+ *   2. VGA driver (so we can display output; framebuffer if stage 2 set one)
+ *   3. Serial port (for QEMU debug output)
+ *   4. Initcalls (core/initcall.h), in dependency order:
+ *        topology, checksum   cache/TLB geometry, CRC32C/xxHash choice
+ *        tsc                  TSC calibration (timeouts and benchmarks)
+ *        gdt idt cpustat irq  own GDT/IDT, remapped PIC, CPU time
+ *        pit                  periodic tick; interrupts enabled
+ *        pmm vmalloc          frame allocator, huge page collapser
+ *        virtio_console       fast log/trace sink, if present
+ *        debugcon console     port 0xE9 probe, console sink selection
+ *        keyboard             user input
+ *      and, from the idle loop once the shell waits for input:
+ *        ksm                  same-page merging scanner
+ *        metrics_serve        metrics scrapes on COM2
+ *      Drivers declare their own initcalls next to their code.
+ *   5. Shell (main user interface)
  * 
  * @note This function should NEVER return. If it does, the CPU halts.
  */
 
+#include <stdarg.h>
 #include <squirel/types.h>
 #include <squirel/config.h>
 #include <drivers/vga/vga_text.h>
 #include <drivers/keyboard/keyboard.h>
 #include <drivers/serial/serial.h>
+#include <drivers/virtio/virtio_console.h>
+#include <drivers/debugcon/debugcon.h>
+#include <drivers/console/console.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/topology.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/cpu/gdt.h>
+#include <arch/x86_64/cpu/idt.h>
+#include <arch/x86_64/cpu/irq.h>
+#include <arch/x86_64/cpu/pit.h>
+#include <core/cpustat.h>
+#include <core/metrics.h>
+#include <core/initcall.h>
+#include <arch/x86_64/mm/paging.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <arch/x86_64/mm/ksm.h>
 #include <lib/printf/printf.h>
+#include <lib/checksum/checksum.h>
 #include <shell/shell.h>
 
+/* ============================================================================
+ * Boot Messages
+ * ============================================================================ */
+
+/**
+ * @brief Print a green "[OK] " and then a formatted line
+ */
+static void boot_ok(const char *fmt, ...) {
+    va_list args;
+
+    vga_set_color(VGA_LIGHT_GREEN, VGA_BLACK);
+    vga_print("[OK] ");
+    vga_set_color(VGA_WHITE, VGA_BLACK);
+    va_start(args, fmt);
+    kvprintf(fmt, args);
+    va_end(args);
+}
+
+/* ============================================================================
+ * Initcalls
+ *
+ * Boot-critical subsystems whose init functions predate the initcall
+ * registry. Their order comes from the dependency lists, not from the
+ * order below.
+ * ============================================================================ */
+
+static bool topology_initcall(void) {
+    topology_init();
+    return true;
+}
+DEFINE_INITCALL(topology, topology_initcall, "", 0);
+
+/* Picks CRC32C/xxHash implementations for the features cpu_init() found */
+static bool checksum_initcall(void) {
+    checksum_init();
+    return true;
+}
+DEFINE_INITCALL(checksum, checksum_initcall, "", 0);
+
+static bool tsc_initcall(void) {
+    tsc_init();
+    return true;
+}
+DEFINE_INITCALL(tsc, tsc_initcall, "", 0);
+
+static bool gdt_initcall(void) {
+    gdt_init();
+    return true;
+}
+DEFINE_INITCALL(gdt, gdt_initcall, "", 0);
+
+static bool idt_initcall(void) {
+    idt_init();
+    return true;
+}
+DEFINE_INITCALL(idt, idt_initcall, "gdt", 0);
+
+static bool cpustat_initcall(void) {
+    cpustat_init();
+    return true;
+}
+DEFINE_INITCALL(cpustat, cpustat_initcall, "", 0);
+
+static bool irq_initcall(void) {
+    irq_init();
+    return true;
+}
+DEFINE_INITCALL(irq, irq_initcall, "idt cpustat", 0);
+
+static bool pit_initcall(void) {
+    pit_init();
+    boot_ok("Interrupts enabled (PIT %d Hz)\n", PIT_TICK_HZ);
+    return true;
+}
+DEFINE_INITCALL(pit, pit_initcall, "irq", 0);
+
+/* Hands the RAM above the kernel to the frame allocator */
+static bool pmm_initcall(void) {
+    pmm_init();
+    return true;
+}
+DEFINE_INITCALL(pmm, pmm_initcall, "", 0);
+
+static bool vmalloc_initcall(void) {
+    pmm_stats_t mem;
+
+    vmalloc_init();
+    pmm_get_stats(&mem);
+    boot_ok("Frame allocator: %llu MB free of %llu MB\n",
+            mem.free * PMM_FRAME_SIZE >> 20, mem.mem_top >> 20);
+    return true;
+}
+DEFINE_INITCALL(vmalloc, vmalloc_initcall, "pmm", 0);
+
+static bool ksm_initcall(void) {
+    ksm_init();
+    return true;
+}
+DEFINE_INITCALL(ksm, ksm_initcall, "vmalloc", INITCALL_ASYNC);
+
+/* A kprintf sink when present; device timeouts need the TSC */
+static bool virtio_console_initcall(void) {
+    if (!virtio_console_init()) {
+        return false;
+    }
+    boot_ok("Virtio console initialized\n");
+    return true;
+}
+DEFINE_INITCALL(virtio_console, virtio_console_initcall, "tsc", 0);
+
+static bool debugcon_initcall(void) {
+    debugcon_init();
+    return debugcon_present();
+}
+DEFINE_INITCALL(debugcon, debugcon_initcall, "", 0);
+
+/* Picks the kprintf sinks among those found (fw_cfg may override) */
+static bool console_initcall(void) {
+    console_init();
+    boot_ok(debugcon_present() ? "Console sinks selected (debugcon present)\n"
+                               : "Console sinks selected\n");
+    return true;
+}
+DEFINE_INITCALL(console, console_initcall, "virtio_console debugcon", 0);
+
+/* Answers metrics scrapes on COM2 when the host connected one */
+static bool metrics_serve_initcall(void) {
+    return metrics_serve_init();
+}
+DEFINE_INITCALL(metrics_serve, metrics_serve_initcall, "", INITCALL_ASYNC);
+
+static bool keyboard_initcall(void) {
+    keyboard_init();
+    boot_ok("Keyboard initialized\n");
+    return true;
+}
+DEFINE_INITCALL(keyboard, keyboard_initcall, "irq", 0);
+
+/* ============================================================================
+ * Kernel Entry
+ * ============================================================================ */
+
 /**
  * @brief Kernel main function
  * 
@@ -34,44 +209,49 @@ NORETURN void kmain(void) {
      * Phase 1: Early Initialization
      * ==================================================================== */
     
+    /* Enable SSE/AVX - the framebuffer blitters depend on it */
+    cpu_init();
+    
+    /* Program the PAT so video memory can be mapped write-combining */
+    paging_init();
+    
     /* Initialize VGA text mode - must be first for visual output */
     vga_init();
     
     /* Print early boot message */
-    vga_set_color(VGA_LIGHT_GREEN, VGA_BLACK);
-    vga_print("[OK] ");
-    vga_set_color(VGA_WHITE, VGA_BLACK);
-    vga_println("VGA text mode initialized");
+    if (vga_is_framebuffer()) {
+        boot_ok("Framebuffer console initialized (%dx%d cells)\n",
+                vga_get_width(), vga_get_height());
+    } else {
+        boot_ok("VGA text mode initialized\n");
+    }
     
     /* Initialize serial port for debug output */
     serial_init();
-    vga_set_color(VGA_LIGHT_GREEN, VGA_BLACK);
-    vga_print("[OK] ");
-    vga_set_color(VGA_WHITE, VGA_BLACK);
-    vga_println("Serial port initialized (COM1)");
+    boot_ok("Serial port initialized (COM1)\n");
     
     /* Send message to serial for QEMU console */
     serial_print("Squirel OS booting...\n");
     
     /* ====================================================================
-     * Phase 2: Hardware Initialization
+     * Phase 2: Subsystems, in dependency order
      * ==================================================================== */
     
-    /* Initialize keyboard */
-    keyboard_init();
-    vga_set_color(VGA_LIGHT_GREEN, VGA_BLACK);
-    vga_print("[OK] ");
-    vga_set_color(VGA_WHITE, VGA_BLACK);
-    vga_println("Keyboard initialized");
+    initcall_run();
+    
+    initcall_summary_t boot;
+    initcall_get_summary(&boot);
+    boot_ok("Boot: %d initcalls in %llu.%03llu ms, critical path %llu.%03llu ms "
+            "(%d deferred)\n", boot.count - boot.deferred,
+            boot.wall_ns / 1000000, boot.wall_ns / 1000 % 1000,
+            boot.critical_ns / 1000000, boot.critical_ns / 1000 % 1000,
+            boot.deferred);
     
     /* ====================================================================
      * Phase 3: Start Shell
      * ==================================================================== */
     
-    vga_set_color(VGA_LIGHT_GREEN, VGA_BLACK);
-    vga_print("[OK] ");
-    vga_set_color(VGA_WHITE, VGA_BLACK);
-    vga_println("Starting shell...");
+    boot_ok("Starting shell...\n");
     
     /* Run the shell - this never returns */
     shell_run();
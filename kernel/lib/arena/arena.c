@@ -0,0 +1,140 @@
+/**
+ * @file arena.c
+ * @brief Bump-pointer arena allocator implementation
+ */
+
+#include "arena.h"
+#include <lib/memory/memory.h>
+#include <lib/string/string.h>
+#include <arch/x86_64/mm/pmm.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define CHUNK_SIZE          4096
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static inline size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+/**
+ * @brief Move on to the chunk after current, taking a frame if needed
+ *
+ * @return false if no frame is free
+ */
+static bool next_chunk(arena_t *arena) {
+    arena_chunk_t *next = arena->current->next;
+    if (!next) {
+        uint64_t frame = pmm_alloc();
+        if (!frame) {
+            return false;
+        }
+        next = (arena_chunk_t *)(uintptr_t)frame;
+        next->next = NULL;
+        next->size = CHUNK_SIZE;
+        arena->current->next = next;
+        arena->chunks++;
+    }
+
+    arena->base += arena->current->size;
+    arena->current = next;
+    arena->used = sizeof(arena_chunk_t);
+    return true;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void arena_init(arena_t *arena, void *buf, size_t size) {
+    arena_chunk_t *first = (arena_chunk_t *)buf;
+    first->next = NULL;
+    first->size = size;
+
+    arena->first = first;
+    arena->current = first;
+    arena->used = sizeof(arena_chunk_t);
+    arena->base = 0;
+    arena->chunks = 0;
+    arena->peak = 0;
+}
+
+void *arena_alloc_aligned(arena_t *arena, size_t size, size_t align) {
+    if (size > CHUNK_SIZE || align >= CHUNK_SIZE) {
+        return NULL;
+    }
+
+    uintptr_t chunk = (uintptr_t)arena->current;
+    size_t at = align_up(chunk + arena->used, align) - chunk;
+    if (at + size > arena->current->size) {
+        /* Only a fresh frame chunk is left to try (page aligned, so at is fixed) */
+        at = align_up(sizeof(arena_chunk_t), align);
+        if (at + size > CHUNK_SIZE || !next_chunk(arena)) {
+            return NULL;
+        }
+        chunk = (uintptr_t)arena->current;
+    }
+
+    arena->used = at + size;
+    size_t in_use = arena->base + arena->used;
+    if (in_use > arena->peak) {
+        arena->peak = in_use;
+    }
+    return (void *)(chunk + at);
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    return arena_alloc_aligned(arena, size, ARENA_ALIGN);
+}
+
+void *arena_zalloc(arena_t *arena, size_t size) {
+    void *p = arena_alloc(arena, size);
+    if (p) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+char *arena_strdup(arena_t *arena, const char *str) {
+    size_t len = strlen(str);
+    char *copy = arena_alloc_aligned(arena, len + 1, 1);
+    if (copy) {
+        memcpy(copy, str, len + 1);
+    }
+    return copy;
+}
+
+arena_mark_t arena_mark(const arena_t *arena) {
+    arena_mark_t mark = { arena->current, arena->used, arena->base };
+    return mark;
+}
+
+void arena_reset(arena_t *arena, arena_mark_t mark) {
+    arena->current = mark.chunk;
+    arena->used = mark.used;
+    arena->base = mark.base;
+}
+
+size_t arena_used(const arena_t *arena) {
+    return arena->base + arena->used;
+}
+
+uint64_t arena_trim(arena_t *arena) {
+    uint64_t freed = 0;
+    arena_chunk_t *chunk = arena->current->next;
+    arena->current->next = NULL;
+
+    while (chunk) {
+        arena_chunk_t *next = chunk->next;
+        pmm_free((uint64_t)(uintptr_t)chunk);
+        chunk = next;
+        freed++;
+    }
+    arena->chunks -= freed;
+    return freed;
+}
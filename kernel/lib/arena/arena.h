@@ -0,0 +1,124 @@
+/**
+ * @file arena.h
+ * @brief Bump-pointer arena allocator
+ *
+ * An arena hands out memory by moving a pointer forward through a chunk,
+ * and frees everything allocated since a saved mark in one step. It suits
+ * short-lived allocations that all die together, such as everything a
+ * shell command needs while it runs.
+ *
+ * CHUNKS:
+ *   The first chunk is a buffer supplied by the owner (usually static),
+ *   so a small arena works before the frame allocator is up and never
+ *   touches it. When a chunk is full the arena moves on to the next one,
+ *   taking a 4KB frame from pmm_alloc() if there is none yet. Chunks form
+ *   a list in the order they were first used.
+ *
+ * MARKS:
+ *   A mark is the current chunk and offset. Resetting to a mark restores
+ *   both, which is O(1) however much was allocated: later chunks are not
+ *   freed, they stay on the list and are reused by the next allocations.
+ *   arena_trim() gives them back to the frame allocator. Marks nest, so
+ *   a caller may reset to its own mark without disturbing older ones.
+ *
+ * LIMITS:
+ *   A single allocation must fit in a chunk (ARENA_MAX_ALLOC when chunks
+ *   come from the frame allocator). There is no per-allocation free and
+ *   no locking; an arena belongs to one context.
+ */
+
+#ifndef _LIB_ARENA_H
+#define _LIB_ARENA_H
+
+#include <squirel/types.h>
+
+/** @brief Header at the start of every chunk */
+typedef struct arena_chunk {
+    struct arena_chunk *next;       /**< Next chunk (later in use order) */
+    size_t size;                    /**< Chunk size, header included */
+} arena_chunk_t;
+
+/** @brief Largest allocation that fits in a grown (4KB frame) chunk */
+#define ARENA_MAX_ALLOC     (4096 - sizeof(arena_chunk_t))
+
+/** @brief Default alignment of arena_alloc() */
+#define ARENA_ALIGN         16
+
+/**
+ * @brief An arena
+ */
+typedef struct {
+    arena_chunk_t *first;           /**< Owner's buffer */
+    arena_chunk_t *current;         /**< Chunk being filled */
+    size_t used;                    /**< Offset of the free space in current */
+    size_t base;                    /**< Size of the chunks before current */
+    uint64_t chunks;                /**< Chunks taken from the frame allocator */
+    uint64_t peak;                  /**< Most bytes in use at once */
+} arena_t;
+
+/**
+ * @brief A saved position
+ */
+typedef struct {
+    arena_chunk_t *chunk;
+    size_t used;
+    size_t base;
+} arena_mark_t;
+
+/**
+ * @brief Set up an arena over a buffer
+ *
+ * @param arena  Arena to initialize
+ * @param buf    First chunk (at least 64 bytes, 16-byte aligned)
+ * @param size   Size of buf
+ */
+void arena_init(arena_t *arena, void *buf, size_t size);
+
+/**
+ * @brief Allocate memory aligned to ARENA_ALIGN
+ *
+ * @return The memory (not cleared), or NULL if size does not fit in a
+ *         chunk or no frame is free
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * @brief Allocate memory with a given alignment (power of two, below 4096)
+ */
+void *arena_alloc_aligned(arena_t *arena, size_t size, size_t align);
+
+/**
+ * @brief Allocate zeroed memory
+ */
+void *arena_zalloc(arena_t *arena, size_t size);
+
+/**
+ * @brief Copy a string into the arena
+ *
+ * @return The copy, or NULL
+ */
+char *arena_strdup(arena_t *arena, const char *str);
+
+/**
+ * @brief Save the current position
+ */
+arena_mark_t arena_mark(const arena_t *arena);
+
+/**
+ * @brief Free everything allocated since a mark (O(1))
+ */
+void arena_reset(arena_t *arena, arena_mark_t mark);
+
+/**
+ * @brief Bytes in use (chunk headers and alignment padding included)
+ */
+size_t arena_used(const arena_t *arena);
+
+/**
+ * @brief Return the chunks after the current one to the frame allocator
+ *
+ * @return Chunks freed
+ */
+uint64_t arena_trim(arena_t *arena);
+
+#endif /* _LIB_ARENA_H */
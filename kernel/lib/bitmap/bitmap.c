@@ -0,0 +1,133 @@
+/**
+ * @file bitmap.c
+ * @brief Bitmap search and counting implementation
+ */
+
+#include "bitmap.h"
+#include <arch/x86_64/cpu/cpu.h>
+#include <core/export.h>
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief Mask of n bits (1..64) starting at bit off
+ */
+static inline uint64_t word_mask(size_t off, size_t n) {
+    uint64_t bits = (n >= 64) ? ~0ull : (1ull << n) - 1;
+    return bits << off;
+}
+
+/**
+ * @brief First bit at or after start that differs from the invert pattern
+ *        (0 finds set bits, all-ones finds clear bits)
+ */
+static size_t find_next(const uint64_t *map, size_t nbits, size_t start, uint64_t invert) {
+    if (start >= nbits) {
+        return nbits;
+    }
+
+    size_t words = BITMAP_WORDS(nbits);
+    size_t w = start / 64;
+    uint64_t word = (map[w] ^ invert) & (~0ull << (start % 64));
+    while (!word) {
+        if (++w >= words) {
+            return nbits;
+        }
+        word = map[w] ^ invert;
+    }
+
+    size_t bit = w * 64 + bit_ffs64(word);
+    return bit < nbits ? bit : nbits;
+}
+
+static inline uint64_t popcnt64(uint64_t x) {
+    uint64_t r;
+    __asm__("popcnt %1, %0" : "=r"(r) : "rm"(x) : "cc");
+    return r;
+}
+
+static inline uint64_t swar_count64(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (x * 0x0101010101010101ull) >> 56;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+size_t bitmap_find_next_set(const uint64_t *map, size_t nbits, size_t start) {
+    return find_next(map, nbits, start, 0);
+}
+EXPORT_SYMBOL(bitmap_find_next_set);
+
+size_t bitmap_find_next_zero(const uint64_t *map, size_t nbits, size_t start) {
+    return find_next(map, nbits, start, ~0ull);
+}
+EXPORT_SYMBOL(bitmap_find_next_zero);
+
+size_t bitmap_find_zero_run(const uint64_t *map, size_t nbits, size_t start, size_t len) {
+    for (;;) {
+        start = bitmap_find_next_zero(map, nbits, start);
+        if (start >= nbits || len > nbits - start) {
+            return nbits;
+        }
+        /* A set bit inside the candidate run restarts the search after it */
+        size_t end = start + len;
+        size_t set = find_next(map, end, start, 0);
+        if (set >= end) {
+            return start;
+        }
+        start = set + 1;
+    }
+}
+EXPORT_SYMBOL(bitmap_find_zero_run);
+
+void bitmap_set_range(uint64_t *map, size_t start, size_t len) {
+    while (len) {
+        size_t off = start % 64;
+        size_t n = (64 - off < len) ? 64 - off : len;
+        map[start / 64] |= word_mask(off, n);
+        start += n;
+        len -= n;
+    }
+}
+EXPORT_SYMBOL(bitmap_set_range);
+
+void bitmap_clear_range(uint64_t *map, size_t start, size_t len) {
+    while (len) {
+        size_t off = start % 64;
+        size_t n = (64 - off < len) ? 64 - off : len;
+        map[start / 64] &= ~word_mask(off, n);
+        start += n;
+        len -= n;
+    }
+}
+EXPORT_SYMBOL(bitmap_clear_range);
+
+size_t bitmap_weight(const uint64_t *map, size_t nbits) {
+    size_t full = nbits / 64;
+    size_t tail = nbits % 64;
+    size_t count = 0;
+
+    if (cpu_has(CPU_FEAT_POPCNT)) {
+        for (size_t i = 0; i < full; i++) {
+            count += popcnt64(map[i]);
+        }
+        if (tail) {
+            count += popcnt64(map[full] & word_mask(0, tail));
+        }
+    } else {
+        for (size_t i = 0; i < full; i++) {
+            count += swar_count64(map[i]);
+        }
+        if (tail) {
+            count += swar_count64(map[full] & word_mask(0, tail));
+        }
+    }
+    return count;
+}
+EXPORT_SYMBOL(bitmap_weight);
@@ -0,0 +1,93 @@
+/**
+ * @file bitmap.h
+ * @brief Bitmaps over 64-bit words
+ *
+ * Bit n of a bitmap is bit (n % 64) of word n / 64. Searches skip whole
+ * words that cannot match (all clear when looking for a set bit, all set
+ * when looking for a clear one) and locate the bit inside a word with a
+ * single TZCNT, so scanning costs one compare per 64 bits.
+ *
+ * INSTRUCTIONS:
+ *   TZCNT executes as BSF on CPUs without BMI1, which gives the same
+ *   answer for the nonzero words it is used on, so no check is needed.
+ *   bitmap_weight() uses POPCNT when the CPU has it and a SWAR bit count
+ *   otherwise.
+ *
+ * Bits at and beyond nbits in the last word are ignored by every search.
+ * Nothing here is atomic.
+ */
+
+#ifndef _LIB_BITMAP_H
+#define _LIB_BITMAP_H
+
+#include <squirel/types.h>
+
+/** @brief Words needed for a bitmap of n bits */
+#define BITMAP_WORDS(n)     (((n) + 63) / 64)
+
+static inline void bitmap_set(uint64_t *map, size_t bit) {
+    map[bit / 64] |= 1ull << (bit % 64);
+}
+
+static inline void bitmap_clear(uint64_t *map, size_t bit) {
+    map[bit / 64] &= ~(1ull << (bit % 64));
+}
+
+static inline bool bitmap_test(const uint64_t *map, size_t bit) {
+    return (map[bit / 64] >> (bit % 64)) & 1;
+}
+
+/**
+ * @brief Index of the lowest set bit of a nonzero word
+ */
+static inline unsigned bit_ffs64(uint64_t word) {
+    uint64_t r;
+    __asm__("tzcnt %1, %0" : "=r"(r) : "rm"(word) : "cc");
+    return (unsigned)r;
+}
+
+/**
+ * @brief First set bit at or after start
+ *
+ * @return Its index, or nbits if there is none
+ */
+size_t bitmap_find_next_set(const uint64_t *map, size_t nbits, size_t start);
+
+/**
+ * @brief First clear bit at or after start
+ *
+ * @return Its index, or nbits if there is none
+ */
+size_t bitmap_find_next_zero(const uint64_t *map, size_t nbits, size_t start);
+
+static inline size_t bitmap_find_first_set(const uint64_t *map, size_t nbits) {
+    return bitmap_find_next_set(map, nbits, 0);
+}
+
+static inline size_t bitmap_find_first_zero(const uint64_t *map, size_t nbits) {
+    return bitmap_find_next_zero(map, nbits, 0);
+}
+
+/**
+ * @brief First run of len clear bits at or after start
+ *
+ * @return Index of the run, or nbits if there is none
+ */
+size_t bitmap_find_zero_run(const uint64_t *map, size_t nbits, size_t start, size_t len);
+
+/**
+ * @brief Set bits [start, start + len)
+ */
+void bitmap_set_range(uint64_t *map, size_t start, size_t len);
+
+/**
+ * @brief Clear bits [start, start + len)
+ */
+void bitmap_clear_range(uint64_t *map, size_t start, size_t len);
+
+/**
+ * @brief Number of set bits among the first nbits
+ */
+size_t bitmap_weight(const uint64_t *map, size_t nbits);
+
+#endif /* _LIB_BITMAP_H */
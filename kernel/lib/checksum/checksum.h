@@ -0,0 +1,109 @@
+/**
+ * @file checksum.h
+ * @brief CRC32C and xxHash checksums with per-CPU implementation choice
+ *
+ * Checksums for verifying disk images, memory regions and on-disk
+ * structures. Every algorithm has several implementations; the fastest
+ * one the CPU supports is selected by checksum_init(), and all of them
+ * stay callable through the tables below for benchmarking.
+ *
+ * CRC32C (Castagnoli, iSCSI/ext4/btrfs polynomial 0x1EDC6F41):
+ *   table      - byte-at-a-time lookup table, any CPU
+ *   sse42      - one crc32q chain, 8 bytes per instruction
+ *   sse42x3    - three independent crc32q chains over adjacent blocks,
+ *                which hides the instruction's 3-cycle latency; the
+ *                block CRCs are combined by multiplying by x^(8n) mod P
+ *                in software
+ *   pclmul     - as sse42x3, with the combine done by one PCLMULQDQ and
+ *                one crc32q
+ *
+ * XXH64:
+ *   Scalar only: its lanes depend on 64x64 bit multiplies, which SSE2
+ *   and AVX2 do not have.
+ *
+ * XXH3 (64-bit, default secret, seed 0):
+ *   scalar     - eight 64-bit lanes in general registers
+ *   sse2       - four 128-bit lanes (PMULUDQ for the 32x32 products)
+ *   avx2       - two 256-bit lanes
+ *
+ * All functions may be called from interrupt handlers except the AVX2
+ * XXH3 implementation (handlers only save SSE state).
+ */
+
+#ifndef _LIB_CHECKSUM_H
+#define _LIB_CHECKSUM_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief A CRC32C implementation
+ */
+typedef struct {
+    const char *name;
+    uint32_t required;                  /**< CPU_FEAT_* bits it needs */
+    uint32_t (*fn)(uint32_t crc, const void *data, size_t len);
+} crc32c_impl_t;
+
+/**
+ * @brief An XXH3 implementation
+ */
+typedef struct {
+    const char *name;
+    uint32_t required;                  /**< CPU_FEAT_* bits it needs */
+    uint64_t (*fn)(const void *data, size_t len);
+} xxh3_impl_t;
+
+/**
+ * @brief Pick the fastest implementations for this CPU
+ *
+ * @note Call after cpu_init(); until then the portable ones are used
+ */
+void checksum_init(void);
+
+/**
+ * @brief CRC32C of a buffer
+ *
+ * @param crc   0 to start, or the result for the preceding data to
+ *              continue (crc32c(crc32c(0, a), b) == crc32c(0, a||b))
+ * @return      The CRC (standard pre/post inversion applied)
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+/**
+ * @brief XXH64 of a buffer
+ */
+uint64_t xxh64(const void *data, size_t len, uint64_t seed);
+
+/**
+ * @brief XXH3 64-bit hash of a buffer
+ */
+uint64_t xxh3_64(const void *data, size_t len);
+
+/**
+ * @brief Get the CRC32C implementation table
+ *
+ * @param selected  Receives the index checksum_init() picked (may be NULL)
+ * @return          Number of entries
+ */
+int crc32c_get_impls(const crc32c_impl_t **out, int *selected);
+
+/**
+ * @brief Get the XXH3 implementation table
+ *
+ * @param selected  Receives the index checksum_init() picked (may be NULL)
+ * @return          Number of entries
+ */
+int xxh3_get_impls(const xxh3_impl_t **out, int *selected);
+
+/**
+ * @brief Select the XXH3 implementations (called by checksum_init())
+ */
+void xxh3_init(void);
+
+/**
+ * @brief Build the tables and select the CRC32C implementation
+ *        (called by checksum_init())
+ */
+void crc32c_init(void);
+
+#endif /* _LIB_CHECKSUM_H */
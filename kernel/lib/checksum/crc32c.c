@@ -0,0 +1,275 @@
+/**
+ * @file crc32c.c
+ * @brief CRC32C implementations and checksum setup
+ *
+ * All CRCs here work on the bit-reflected register, as the crc32
+ * instruction does: bit 31 holds the x^0 coefficient.
+ *
+ * COMBINING BLOCKS:
+ *   The three-way versions run one CRC over each of three adjacent
+ *   blocks of n bytes, the last two starting from 0. Since CRC is linear,
+ *   crc(A || B) = crc(A) * x^(8n) mod P  xor  crc0(B), so the three are
+ *   folded together with two "shift by n zero bytes" steps per round.
+ *   In software that is a 32-step carry-less multiply by a precomputed
+ *   x^(8n) mod P; with PCLMULQDQ the 32x32 product takes one instruction
+ *   and the crc32 instruction itself reduces it mod P.
+ */
+
+#include "checksum.h"
+#include <arch/x86_64/cpu/cpu.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+/** @brief Reflected Castagnoli polynomial */
+#define CRC32C_POLY         0x82F63B78u
+
+/** @brief Block sizes of the three-way rounds (bytes per stream) */
+#define LONG_BLOCK          8192
+#define SHORT_BLOCK         256
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+static uint32_t table[256];
+static bool table_ready = false;
+
+/** @brief x^(8n) mod P for the block sizes (software combine) */
+static uint32_t shift_long = 0;
+static uint32_t shift_short = 0;
+
+/** @brief x^(8n-33) mod P for the block sizes (PCLMULQDQ combine) */
+static uint64_t clmul_long = 0;
+static uint64_t clmul_short = 0;
+
+/* ============================================================================
+ * GF(2) Arithmetic
+ * ============================================================================ */
+
+/**
+ * @brief a * b mod P (reflected)
+ */
+static uint32_t multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+/**
+ * @brief x^n mod P (reflected), by square-and-multiply
+ */
+static uint32_t xpowmodp(uint64_t n) {
+    uint32_t result = 1u << 31;     /* x^0 */
+    uint32_t square = 1u << 30;     /* x^1, then x^2, x^4, ... */
+    while (n) {
+        if (n & 1) {
+            result = multmodp(square, result);
+        }
+        square = multmodp(square, square);
+        n >>= 1;
+    }
+    return result;
+}
+
+/* ============================================================================
+ * Instructions
+ * ============================================================================ */
+
+typedef uint64_t v2u64 __attribute__((vector_size(16)));
+
+static inline uint64_t crc32_u64(uint64_t crc, uint64_t v) {
+    __asm__("crc32q %1, %0" : "+r"(crc) : "rm"(v));
+    return crc;
+}
+
+static inline uint32_t crc32_u8(uint32_t crc, uint8_t v) {
+    __asm__("crc32b %1, %0" : "+r"(crc) : "rm"(v));
+    return crc;
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ * @brief Shift a CRC over n zero bytes: software
+ */
+static inline uint32_t shift_sw(uint32_t crc, uint32_t xpow) {
+    return multmodp(xpow, crc);
+}
+
+/**
+ * @brief Shift a CRC over n zero bytes: carry-less multiply by
+ *        x^(8n-33), reduced by crc32q
+ */
+static inline uint32_t shift_clmul(uint32_t crc, uint64_t k) {
+    v2u64 a = { crc, 0 };
+    v2u64 b = { k, 0 };
+    __asm__("pclmulqdq $0x00, %1, %0" : "+x"(a) : "x"(b));
+    return (uint32_t)crc32_u64(0, a[0]);
+}
+
+/* ============================================================================
+ * Implementations (raw register in, raw register out)
+ * ============================================================================ */
+
+static uint32_t crc_table_raw(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len--) {
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static uint32_t crc_sse42_raw(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len && ((uintptr_t)p & 7)) {
+        crc = crc32_u8(crc, *p++);
+        len--;
+    }
+    uint64_t c = crc;
+    while (len >= 8) {
+        c = crc32_u64(c, read64(p));
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)c;
+    while (len--) {
+        crc = crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+/**
+ * @brief Three chains over blocks of n bytes, as long as 3n bytes remain
+ */
+static ALWAYS_INLINE uint32_t crc_rounds(uint32_t crc, const uint8_t **pp, size_t *lenp,
+                                         size_t n, bool clmul, uint32_t xpow, uint64_t k) {
+    const uint8_t *p = *pp;
+    size_t len = *lenp;
+
+    while (len >= 3 * n) {
+        uint64_t c0 = crc;
+        uint64_t c1 = 0;
+        uint64_t c2 = 0;
+        for (size_t i = 0; i < n; i += 8) {
+            c0 = crc32_u64(c0, read64(p + i));
+            c1 = crc32_u64(c1, read64(p + n + i));
+            c2 = crc32_u64(c2, read64(p + 2 * n + i));
+        }
+        if (clmul) {
+            crc = shift_clmul((uint32_t)c0, k) ^ (uint32_t)c1;
+            crc = shift_clmul(crc, k) ^ (uint32_t)c2;
+        } else {
+            crc = shift_sw((uint32_t)c0, xpow) ^ (uint32_t)c1;
+            crc = shift_sw(crc, xpow) ^ (uint32_t)c2;
+        }
+        p += 3 * n;
+        len -= 3 * n;
+    }
+
+    *pp = p;
+    *lenp = len;
+    return crc;
+}
+
+static ALWAYS_INLINE uint32_t crc_3way_raw(uint32_t crc, const uint8_t *p, size_t len,
+                                           bool clmul) {
+    while (len && ((uintptr_t)p & 7)) {
+        crc = crc32_u8(crc, *p++);
+        len--;
+    }
+    crc = crc_rounds(crc, &p, &len, LONG_BLOCK, clmul, shift_long, clmul_long);
+    crc = crc_rounds(crc, &p, &len, SHORT_BLOCK, clmul, shift_short, clmul_short);
+    return crc_sse42_raw(crc, p, len);
+}
+
+/* ============================================================================
+ * Public Entry Points
+ * ============================================================================ */
+
+static void build_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int b = 0; b < 8; b++) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        }
+        table[i] = c;
+    }
+    table_ready = true;
+}
+
+static uint32_t crc32c_table(uint32_t crc, const void *data, size_t len) {
+    if (!table_ready) {
+        build_table();
+    }
+    return ~crc_table_raw(~crc, (const uint8_t *)data, len);
+}
+
+static uint32_t crc32c_sse42(uint32_t crc, const void *data, size_t len) {
+    return ~crc_sse42_raw(~crc, (const uint8_t *)data, len);
+}
+
+static uint32_t crc32c_sse42x3(uint32_t crc, const void *data, size_t len) {
+    return ~crc_3way_raw(~crc, (const uint8_t *)data, len, false);
+}
+
+static uint32_t crc32c_pclmul(uint32_t crc, const void *data, size_t len) {
+    return ~crc_3way_raw(~crc, (const uint8_t *)data, len, true);
+}
+
+/** @brief Slowest first; checksum_init() picks the last one supported */
+static const crc32c_impl_t impls[] = {
+    { "table",   0,                                crc32c_table },
+    { "sse42",   CPU_FEAT_SSE42,                   crc32c_sse42 },
+    { "sse42x3", CPU_FEAT_SSE42,                   crc32c_sse42x3 },
+    { "pclmul",  CPU_FEAT_SSE42 | CPU_FEAT_PCLMUL, crc32c_pclmul },
+};
+
+#define IMPL_COUNT  (int)(sizeof(impls) / sizeof(impls[0]))
+
+static int selected = 0;
+
+void crc32c_init(void) {
+    build_table();
+    shift_long = xpowmodp(8ull * LONG_BLOCK);
+    shift_short = xpowmodp(8ull * SHORT_BLOCK);
+    clmul_long = xpowmodp(8ull * LONG_BLOCK - 33);
+    clmul_short = xpowmodp(8ull * SHORT_BLOCK - 33);
+
+    for (int i = IMPL_COUNT - 1; i >= 0; i--) {
+        if (cpu_has(impls[i].required)) {
+            selected = i;
+            break;
+        }
+    }
+}
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
+    return impls[selected].fn(crc, data, len);
+}
+
+int crc32c_get_impls(const crc32c_impl_t **out, int *sel) {
+    *out = impls;
+    if (sel) {
+        *sel = selected;
+    }
+    return IMPL_COUNT;
+}
+
+void checksum_init(void) {
+    crc32c_init();
+    xxh3_init();
+}
@@ -0,0 +1,396 @@
+/**
+ * @file xxhash.c
+ * @brief XXH64 and XXH3 (64-bit) implementations
+ *
+ * Follows the reference xxHash 0.8 algorithms, so results match
+ * xxhsum -H1 / -H3 and the common libraries. XXH3 is the default-secret,
+ * seed-0 variant; its long-input loop comes in scalar, SSE2 and AVX2
+ * versions that produce identical results.
+ */
+
+#include "checksum.h"
+#include <arch/x86_64/cpu/cpu.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define PRIME32_1   0x9E3779B1u
+#define PRIME32_2   0x85EBCA77u
+#define PRIME32_3   0xC2B2AE3Du
+
+#define PRIME64_1   0x9E3779B185EBCA87ull
+#define PRIME64_2   0xC2B2AE3D27D4EB4Full
+#define PRIME64_3   0x165667B19E3779F9ull
+#define PRIME64_4   0x85EBCA77C2B2AE63ull
+#define PRIME64_5   0x27D4EB2F165667C5ull
+
+#define PRIME_MX1   0x165667919E3779F9ull
+#define PRIME_MX2   0x9FB21C651E98DF25ull
+
+#define STRIPE_LEN          64
+#define SECRET_SIZE         192
+#define SECRET_CONSUME_RATE 8
+#define STRIPES_PER_BLOCK   ((SECRET_SIZE - STRIPE_LEN) / SECRET_CONSUME_RATE)
+#define BLOCK_LEN           (STRIPE_LEN * STRIPES_PER_BLOCK)
+#define MIDSIZE_MAX         240
+
+/** @brief Default XXH3 secret (from FARSH) */
+static const uint8_t secret[SECRET_SIZE] ALIGNED(64) = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/** @brief 64x64 -> 128 bit multiply, halves xored */
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+/* ============================================================================
+ * XXH64
+ * ============================================================================ */
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val) {
+    acc ^= xxh64_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t xxh64(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        do {
+            v1 = xxh64_round(v1, read64(p));
+            v2 = xxh64_round(v2, read64(p + 8));
+            v3 = xxh64_round(v3, read64(p + 16));
+            v4 = xxh64_round(v4, read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += (uint64_t)len;
+    while (end - p >= 8) {
+        h ^= xxh64_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p++) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+    return xxh64_avalanche(h);
+}
+
+/* ============================================================================
+ * XXH3: Short Inputs
+ * ============================================================================ */
+
+static inline uint64_t xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static uint64_t xxh3_len_0to16(const uint8_t *p, size_t len) {
+    if (len > 8) {
+        uint64_t lo = read64(p) ^ (read64(secret + 24) ^ read64(secret + 32));
+        uint64_t hi = read64(p + len - 8) ^ (read64(secret + 40) ^ read64(secret + 48));
+        uint64_t acc = len + __builtin_bswap64(lo) + hi + mul128_fold64(lo, hi);
+        return xxh3_avalanche(acc);
+    }
+    if (len >= 4) {
+        uint64_t input64 = read32(p + len - 4) + ((uint64_t)read32(p) << 32);
+        uint64_t keyed = input64 ^ (read64(secret + 8) ^ read64(secret + 16));
+        return xxh3_rrmxmx(keyed, len);
+    }
+    if (len) {
+        uint32_t combined = ((uint32_t)p[0] << 16) | ((uint32_t)p[len >> 1] << 24) |
+                            p[len - 1] | ((uint32_t)len << 8);
+        uint64_t keyed = (uint64_t)combined ^ (read32(secret) ^ read32(secret + 4));
+        return xxh64_avalanche(keyed);
+    }
+    return xxh64_avalanche(read64(secret + 56) ^ read64(secret + 64));
+}
+
+static inline uint64_t mix16(const uint8_t *p, const uint8_t *s) {
+    return mul128_fold64(read64(p) ^ read64(s), read64(p + 8) ^ read64(s + 8));
+}
+
+static uint64_t xxh3_len_17to128(const uint8_t *p, size_t len) {
+    uint64_t acc = len * PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += mix16(p + 48, secret + 96);
+                acc += mix16(p + len - 64, secret + 112);
+            }
+            acc += mix16(p + 32, secret + 64);
+            acc += mix16(p + len - 48, secret + 80);
+        }
+        acc += mix16(p + 16, secret + 32);
+        acc += mix16(p + len - 32, secret + 48);
+    }
+    acc += mix16(p, secret);
+    acc += mix16(p + len - 16, secret + 16);
+    return xxh3_avalanche(acc);
+}
+
+static uint64_t xxh3_len_129to240(const uint8_t *p, size_t len) {
+    uint64_t acc = len * PRIME64_1;
+    unsigned rounds = (unsigned)len / 16;
+
+    for (unsigned i = 0; i < 8; i++) {
+        acc += mix16(p + 16 * i, secret + 16 * i);
+    }
+    acc = xxh3_avalanche(acc);
+
+    uint64_t acc_end = mix16(p + len - 16, secret + 136 - 17);
+    for (unsigned i = 8; i < rounds; i++) {
+        acc_end += mix16(p + 16 * i, secret + 16 * (i - 8) + 3);
+    }
+    return xxh3_avalanche(acc + acc_end);
+}
+
+/* ============================================================================
+ * XXH3: Long Inputs
+ *
+ * Eight 64-bit accumulators. Per 64-byte stripe, lane i gets
+ *   acc[i ^ 1] += data[i]
+ *   acc[i]     += lo32(data[i] ^ key[i]) * hi32(data[i] ^ key[i])
+ * and after every block the accumulators are scrambled with the end
+ * of the secret. Only the accumulate step differs between versions.
+ * ============================================================================ */
+
+typedef void (*accumulate_fn)(uint64_t *acc, const uint8_t *p, const uint8_t *s, size_t stripes);
+
+static void accumulate_scalar(uint64_t *acc, const uint8_t *p, const uint8_t *s,
+                              size_t stripes) {
+    for (size_t n = 0; n < stripes; n++) {
+        const uint8_t *in = p + n * STRIPE_LEN;
+        const uint8_t *key = s + n * SECRET_CONSUME_RATE;
+        for (int i = 0; i < 8; i++) {
+            uint64_t data = read64(in + 8 * i);
+            uint64_t dk = data ^ read64(key + 8 * i);
+            acc[i ^ 1] += data;
+            acc[i] += (dk & 0xFFFFFFFF) * (dk >> 32);
+        }
+    }
+}
+
+typedef uint64_t v2u64 __attribute__((vector_size(16)));
+typedef int32_t v4i32 __attribute__((vector_size(16)));
+typedef uint64_t v4u64 __attribute__((vector_size(32)));
+typedef int32_t v8i32 __attribute__((vector_size(32)));
+
+static void accumulate_sse2(uint64_t *acc, const uint8_t *p, const uint8_t *s,
+                            size_t stripes) {
+    v2u64 a[4];
+    __builtin_memcpy(a, acc, sizeof(a));
+
+    for (size_t n = 0; n < stripes; n++) {
+        const uint8_t *in = p + n * STRIPE_LEN;
+        const uint8_t *key = s + n * SECRET_CONSUME_RATE;
+        for (int i = 0; i < 4; i++) {
+            v2u64 data, k;
+            __builtin_memcpy(&data, in + 16 * i, sizeof(data));
+            __builtin_memcpy(&k, key + 16 * i, sizeof(k));
+            v2u64 dk = data ^ k;
+            v2u64 product = (v2u64)__builtin_ia32_pmuludq128((v4i32)dk, (v4i32)(dk >> 32));
+            v2u64 swapped = __builtin_shuffle(data, (v2u64){ 1, 0 });
+            a[i] += swapped + product;
+        }
+    }
+    __builtin_memcpy(acc, a, sizeof(a));
+}
+
+__attribute__((target("avx2")))
+static void accumulate_avx2(uint64_t *acc, const uint8_t *p, const uint8_t *s,
+                            size_t stripes) {
+    v4u64 a[2];
+    __builtin_memcpy(a, acc, sizeof(a));
+
+    for (size_t n = 0; n < stripes; n++) {
+        const uint8_t *in = p + n * STRIPE_LEN;
+        const uint8_t *key = s + n * SECRET_CONSUME_RATE;
+        for (int i = 0; i < 2; i++) {
+            v4u64 data, k;
+            __builtin_memcpy(&data, in + 32 * i, sizeof(data));
+            __builtin_memcpy(&k, key + 32 * i, sizeof(k));
+            v4u64 dk = data ^ k;
+            v4u64 product = (v4u64)__builtin_ia32_pmuludq256((v8i32)dk, (v8i32)(dk >> 32));
+            v4u64 swapped = __builtin_shuffle(data, (v4u64){ 1, 0, 3, 2 });
+            a[i] += swapped + product;
+        }
+    }
+    __builtin_memcpy(acc, a, sizeof(a));
+}
+
+static void scramble(uint64_t *acc, const uint8_t *s) {
+    for (int i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(s + 8 * i);
+        acc[i] = a * PRIME32_1;
+    }
+}
+
+static ALWAYS_INLINE uint64_t xxh3_long(const uint8_t *p, size_t len, accumulate_fn accumulate) {
+    uint64_t acc[8] = {
+        PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+        PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1,
+    };
+
+    size_t blocks = (len - 1) / BLOCK_LEN;
+    for (size_t b = 0; b < blocks; b++) {
+        accumulate(acc, p + b * BLOCK_LEN, secret, STRIPES_PER_BLOCK);
+        scramble(acc, secret + SECRET_SIZE - STRIPE_LEN);
+    }
+
+    /* Last partial block, then the last stripe (which may overlap it) */
+    size_t stripes = ((len - 1) - BLOCK_LEN * blocks) / STRIPE_LEN;
+    accumulate(acc, p + blocks * BLOCK_LEN, secret, stripes);
+    accumulate(acc, p + len - STRIPE_LEN, secret + SECRET_SIZE - STRIPE_LEN - 7, 1);
+
+    uint64_t result = len * PRIME64_1;
+    for (int i = 0; i < 4; i++) {
+        result += mul128_fold64(acc[2 * i] ^ read64(secret + 11 + 16 * i),
+                                acc[2 * i + 1] ^ read64(secret + 11 + 16 * i + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+static ALWAYS_INLINE uint64_t xxh3_any(const void *data, size_t len, accumulate_fn accumulate) {
+    const uint8_t *p = (const uint8_t *)data;
+    if (len <= 16) {
+        return xxh3_len_0to16(p, len);
+    }
+    if (len <= 128) {
+        return xxh3_len_17to128(p, len);
+    }
+    if (len <= MIDSIZE_MAX) {
+        return xxh3_len_129to240(p, len);
+    }
+    return xxh3_long(p, len, accumulate);
+}
+
+static uint64_t xxh3_scalar(const void *data, size_t len) {
+    return xxh3_any(data, len, accumulate_scalar);
+}
+
+static uint64_t xxh3_sse2(const void *data, size_t len) {
+    return xxh3_any(data, len, accumulate_sse2);
+}
+
+static uint64_t xxh3_avx2(const void *data, size_t len) {
+    return xxh3_any(data, len, accumulate_avx2);
+}
+
+/* ============================================================================
+ * Dispatch
+ * ============================================================================ */
+
+/** @brief Slowest first; xxh3_init() picks the last one supported */
+static const xxh3_impl_t impls[] = {
+    { "scalar", 0,             xxh3_scalar },
+    { "sse2",   CPU_FEAT_SSE2, xxh3_sse2 },
+    { "avx2",   CPU_FEAT_AVX2, xxh3_avx2 },
+};
+
+#define IMPL_COUNT  (int)(sizeof(impls) / sizeof(impls[0]))
+
+static int selected = 0;
+
+void xxh3_init(void) {
+    for (int i = IMPL_COUNT - 1; i >= 0; i--) {
+        if (cpu_has(impls[i].required)) {
+            selected = i;
+            break;
+        }
+    }
+}
+
+uint64_t xxh3_64(const void *data, size_t len) {
+    return impls[selected].fn(data, len);
+}
+
+int xxh3_get_impls(const xxh3_impl_t **out, int *sel) {
+    *out = impls;
+    if (sel) {
+        *sel = selected;
+    }
+    return IMPL_COUNT;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file hashtable.c
+ * @brief Open-addressing hash table and wyhash implementation
+ */
+
+#include "hashtable.h"
+#include <core/export.h>
+
+/* ============================================================================
+ * wyhash
+ * ============================================================================ */
+
+static const uint64_t wyp[4] = {
+    0x2D358DCCAA6C78A5ull, 0x8BB84B93962EACC9ull,
+    0x4B33A62ED433D4A3ull, 0x4D5A2DA51DE1AA47ull,
+};
+
+static inline uint64_t wyr8(const uint8_t *p) {
+    uint64_t v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wyr4(const uint8_t *p) {
+    uint32_t v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/** @brief 1 to 3 bytes: first, middle and last */
+static inline uint64_t wyr3(const uint8_t *p, size_t len) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+}
+
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t a;
+    uint64_t b;
+
+    seed ^= hash_mix(seed ^ wyp[0], wyp[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (wyr4(p) << 32) | wyr4(p + mid);
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            /* Three independent lanes per 48 bytes */
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+            do {
+                seed = hash_mix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = hash_mix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = hash_mix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = hash_mix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+
+    a ^= wyp[1];
+    b ^= seed;
+    __uint128_t r = (__uint128_t)a * b;
+    a = (uint64_t)r;
+    b = (uint64_t)(r >> 64);
+    return hash_mix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+EXPORT_SYMBOL(hash_bytes);
+
+/* ============================================================================
+ * Table
+ * ============================================================================ */
+
+static inline size_t home_slot(const hashtable_t *ht, uint64_t key) {
+    return (size_t)hash_u64(key) & ht->mask;
+}
+
+void ht_init(hashtable_t *ht, ht_slot_t *slots, size_t count) {
+    ht->slots = slots;
+    ht->mask = count - 1;
+    ht_clear(ht);
+}
+EXPORT_SYMBOL(ht_init);
+
+void ht_clear(hashtable_t *ht) {
+    for (size_t i = 0; i <= ht->mask; i++) {
+        ht->slots[i].key = HT_EMPTY_KEY;
+    }
+    ht->count = 0;
+}
+
+bool ht_insert(hashtable_t *ht, uint64_t key, uint64_t value) {
+    if (key == HT_EMPTY_KEY) {
+        return false;
+    }
+
+    size_t i = home_slot(ht, key);
+    while (ht->slots[i].key != HT_EMPTY_KEY) {
+        if (ht->slots[i].key == key) {
+            ht->slots[i].value = value;
+            return true;
+        }
+        i = (i + 1) & ht->mask;
+    }
+
+    if (ht->count + 1 > (ht->mask + 1) / 8 * 7) {
+        return false;
+    }
+    ht->slots[i].key = key;
+    ht->slots[i].value = value;
+    ht->count++;
+    return true;
+}
+EXPORT_SYMBOL(ht_insert);
+
+bool ht_lookup(const hashtable_t *ht, uint64_t key, uint64_t *value) {
+    if (key == HT_EMPTY_KEY) {
+        return false;
+    }
+
+    for (size_t i = home_slot(ht, key); ht->slots[i].key != HT_EMPTY_KEY;
+         i = (i + 1) & ht->mask) {
+        if (ht->slots[i].key == key) {
+            if (value) {
+                *value = ht->slots[i].value;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+EXPORT_SYMBOL(ht_lookup);
+
+bool ht_remove(hashtable_t *ht, uint64_t key) {
+    if (key == HT_EMPTY_KEY) {
+        return false;
+    }
+
+    size_t hole = home_slot(ht, key);
+    while (ht->slots[hole].key != key) {
+        if (ht->slots[hole].key == HT_EMPTY_KEY) {
+            return false;
+        }
+        hole = (hole + 1) & ht->mask;
+    }
+
+    /* Shift back entries that probed past the hole, until a free slot */
+    size_t j = hole;
+    for (;;) {
+        j = (j + 1) & ht->mask;
+        if (ht->slots[j].key == HT_EMPTY_KEY) {
+            break;
+        }
+        size_t home = home_slot(ht, ht->slots[j].key);
+        if (((j - home) & ht->mask) >= ((j - hole) & ht->mask)) {
+            ht->slots[hole] = ht->slots[j];
+            hole = j;
+        }
+    }
+
+    ht->slots[hole].key = HT_EMPTY_KEY;
+    ht->count--;
+    return true;
+}
+EXPORT_SYMBOL(ht_remove);
@@ -0,0 +1,105 @@
+/**
+ * @file hashtable.h
+ * @brief Open-addressing hash table and wyhash hashing
+ *
+ * Maps 64-bit keys to 64-bit values (an integer, or a pointer cast to
+ * one) in a flat array of slots supplied by the caller, so the table
+ * never allocates and a lookup touches one or two cache lines.
+ *
+ * PROBING:
+ *   Linear probing from the key's hash. Removal shifts later entries of
+ *   the same probe run back into the hole (no tombstones), so lookups
+ *   never slow down after many deletions. Insertion refuses to fill the
+ *   table beyond 7/8, which keeps probe runs short.
+ *
+ * HASHING:
+ *   hash_u64() mixes a key with one 64x64->128 bit multiply (the wyhash
+ *   mixer), enough to spread sequential or aligned keys such as page
+ *   addresses. hash_bytes() is wyhash for arbitrary byte strings.
+ *
+ * The key HT_EMPTY_KEY marks free slots and cannot be stored. Nothing
+ * here locks.
+ */
+
+#ifndef _LIB_HASHTABLE_H
+#define _LIB_HASHTABLE_H
+
+#include <squirel/types.h>
+
+/** @brief Key value reserved for free slots */
+#define HT_EMPTY_KEY    UINT64_MAX
+
+/**
+ * @brief One slot
+ */
+typedef struct {
+    uint64_t key;
+    uint64_t value;
+} ht_slot_t;
+
+/**
+ * @brief A table
+ */
+typedef struct {
+    ht_slot_t *slots;
+    size_t mask;            /**< Slot count - 1 */
+    size_t count;           /**< Keys stored */
+} hashtable_t;
+
+/**
+ * @brief wyhash 64x64 multiply, folded to 64 bits
+ */
+static inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+/**
+ * @brief Hash a 64-bit key
+ */
+static inline uint64_t hash_u64(uint64_t key) {
+    return hash_mix(key ^ 0x2D358DCCAA6C78A5ull, 0x8BB84B93962EACC9ull);
+}
+
+/**
+ * @brief Hash a byte string (wyhash)
+ */
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed);
+
+/**
+ * @brief Set up an empty table
+ *
+ * @param ht     Table
+ * @param slots  Slot array
+ * @param count  Slots in the array (power of two)
+ */
+void ht_init(hashtable_t *ht, ht_slot_t *slots, size_t count);
+
+/**
+ * @brief Insert a key, or replace its value
+ *
+ * @return false if the table is 7/8 full or key is HT_EMPTY_KEY
+ */
+bool ht_insert(hashtable_t *ht, uint64_t key, uint64_t value);
+
+/**
+ * @brief Look up a key
+ *
+ * @param value  Receives the value (may be NULL)
+ * @return       false if the key is not present
+ */
+bool ht_lookup(const hashtable_t *ht, uint64_t key, uint64_t *value);
+
+/**
+ * @brief Remove a key
+ *
+ * @return false if the key was not present
+ */
+bool ht_remove(hashtable_t *ht, uint64_t key);
+
+/**
+ * @brief Remove every key
+ */
+void ht_clear(hashtable_t *ht);
+
+#endif /* _LIB_HASHTABLE_H */
@@ -0,0 +1,135 @@
+/**
+ * @file histogram.c
+ * @brief Fixed-size log-linear latency histogram implementation
+ */
+
+#include "histogram.h"
+#include <lib/memory/memory.h>
+#include <lib/printf/printf.h>
+
+/* ============================================================================
+ * Bucket Mapping
+ * ============================================================================ */
+
+int hist_bucket_index(uint64_t value) {
+    if (value < HIST_SUB_BUCKETS) {
+        return (int)value;
+    }
+
+    int msb = 63 - __builtin_clzll(value);
+    if (msb >= HIST_MAX_BITS) {
+        return HIST_BUCKETS - 1;
+    }
+
+    /* Row by power of two, column by the HIST_SUB_BITS bits below the MSB */
+    int shift = msb - HIST_SUB_BITS;
+    int slice = (int)(value >> shift) - HIST_SUB_BUCKETS;
+    return (shift + 1) * HIST_SUB_BUCKETS + slice;
+}
+
+uint64_t hist_bucket_low(int index) {
+    if (index < HIST_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int shift = index / HIST_SUB_BUCKETS - 1;
+    uint64_t slice = (uint64_t)(index % HIST_SUB_BUCKETS);
+    return (HIST_SUB_BUCKETS + slice) << shift;
+}
+
+/**
+ * @brief Width of a bucket
+ */
+static uint64_t hist_bucket_width(int index) {
+    if (index < HIST_SUB_BUCKETS) {
+        return 1;
+    }
+    return 1ull << (index / HIST_SUB_BUCKETS - 1);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void hist_init(histogram_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void hist_record(histogram_t *h, uint64_t value) {
+    h->counts[hist_bucket_index(value)]++;
+    h->total++;
+    h->sum += value;
+    if (value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+void hist_merge(histogram_t *dst, const histogram_t *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+uint64_t hist_percentile(const histogram_t *h, uint32_t per10k) {
+    if (h->total == 0) {
+        return 0;
+    }
+    if (per10k >= 10000) {
+        return h->max;
+    }
+
+    /* Rank of the sample we want, 1-based, rounded up */
+    uint64_t rank = (h->total * per10k + 9999) / 10000;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t value = hist_bucket_low(i) + hist_bucket_width(i) / 2;
+            if (value < h->min) {
+                value = h->min;
+            }
+            if (value > h->max) {
+                value = h->max;
+            }
+            return value;
+        }
+    }
+    return h->max;
+}
+
+uint64_t hist_mean(const histogram_t *h) {
+    return h->total ? h->sum / h->total : 0;
+}
+
+int hist_format(const histogram_t *h, uint64_t scale, char *buf, size_t size) {
+    if (scale == 0) {
+        scale = 1;
+    }
+    if (h->total == 0) {
+        return ksnprintf(buf, size, "n=0");
+    }
+    int len = ksnprintf(buf, size,
+                        "n=%llu min=%llu p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu mean=%llu",
+                        h->total, h->min / scale,
+                        hist_percentile(h, 5000) / scale,
+                        hist_percentile(h, 9000) / scale,
+                        hist_percentile(h, 9900) / scale,
+                        hist_percentile(h, 9990) / scale,
+                        h->max / scale, hist_mean(h) / scale);
+    return (len < (int)size) ? len : (int)size - 1;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file histogram.h
+ * @brief Fixed-size log-linear latency histogram (HDR style)
+ *
+ * Records 64-bit values (nanoseconds, cycles, bytes...) into a fixed
+ * array of buckets, so memory use is constant and recording is O(1):
+ * one bit scan, one shift, one increment. Percentiles are answered from
+ * the buckets with a bounded relative error.
+ *
+ * BUCKETS:
+ *   Values below HIST_SUB_BUCKETS get one exact bucket each. Above that,
+ *   every power of two [2^e, 2^(e+1)) is split into HIST_SUB_BUCKETS
+ *   equal slices, so a bucket is never wider than 1/16 of the values it
+ *   holds (6.25% worst case, half that for the reported midpoint).
+ *   Values of 2^HIST_MAX_BITS and above land in the last bucket; min,
+ *   max and sum stay exact.
+ *
+ *     value   0..15   16..31   32..63        64..127       ...
+ *     width     1       1        2             4
+ *
+ * MERGING:
+ *   Histograms with the same layout add bucket by bucket, so hot paths
+ *   keep one instance per CPU (no shared cache lines, no locks) and
+ *   readers merge them into a scratch instance before querying.
+ */
+
+#ifndef _LIB_HISTOGRAM_H
+#define _LIB_HISTOGRAM_H
+
+#include <squirel/types.h>
+
+/** @brief log2 of the slices per power of two */
+#define HIST_SUB_BITS       4
+#define HIST_SUB_BUCKETS    (1 << HIST_SUB_BITS)
+
+/** @brief Values are resolved up to 2^HIST_MAX_BITS (~18 minutes in ns) */
+#define HIST_MAX_BITS       40
+
+/** @brief Total buckets: exact range plus one row per power of two */
+#define HIST_BUCKETS        ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+/**
+ * @brief A histogram (about 4.7 KB)
+ */
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;         /**< Samples recorded */
+    uint64_t sum;           /**< Sum of all samples (for the mean) */
+    uint64_t min;           /**< Smallest sample (UINT64_MAX when empty) */
+    uint64_t max;           /**< Largest sample */
+} histogram_t;
+
+/**
+ * @brief Empty a histogram
+ */
+void hist_init(histogram_t *h);
+
+/**
+ * @brief Record one sample
+ */
+void hist_record(histogram_t *h, uint64_t value);
+
+/**
+ * @brief Add every sample of src to dst
+ */
+void hist_merge(histogram_t *dst, const histogram_t *src);
+
+/**
+ * @brief Value below which a fraction of the samples fall
+ *
+ * @param per10k  Percentile in hundredths of a percent
+ *                (5000 = p50, 9900 = p99, 9990 = p99.9, 10000 = max)
+ * @return        Midpoint of the matching bucket, clamped to [min, max];
+ *                0 for an empty histogram
+ */
+uint64_t hist_percentile(const histogram_t *h, uint32_t per10k);
+
+/**
+ * @brief Mean of the recorded samples (0 when empty)
+ */
+uint64_t hist_mean(const histogram_t *h);
+
+/**
+ * @brief Bucket a value is recorded in
+ */
+int hist_bucket_index(uint64_t value);
+
+/**
+ * @brief Smallest value recorded in a bucket
+ */
+uint64_t hist_bucket_low(int index);
+
+/**
+ * @brief Format a one-line summary
+ *
+ * "n=1000 min=12 p50=40 p90=52 p99=95 p99.9=140 max=151 mean=43"
+ * with every value divided by scale (e.g. 1000 to print ns as us).
+ *
+ * @return Characters written (excluding the terminator)
+ */
+int hist_format(const histogram_t *h, uint64_t scale, char *buf, size_t size);
+
+#endif /* _LIB_HISTOGRAM_H */
@@ -0,0 +1,127 @@
+/**
+ * @file list.h
+ * @brief Intrusive circular doubly-linked list
+ *
+ * The links live inside the objects being listed (a list_node_t member),
+ * so adding and removing never allocates, and container_of() gets back
+ * from a node to its object. A list head is a node whose next and prev
+ * point at itself when empty, which removes every special case for the
+ * first and last element.
+ *
+ *   typedef struct { uint64_t deadline; list_node_t link; } timer_t;
+ *
+ *   list_node_t timers = LIST_INIT(timers);
+ *   list_add_tail(&timers, &t->link);
+ *   list_for_each_entry(pos, &timers, timer_t, link) { ... }
+ *
+ * All operations are O(1) except the iterators. Nothing here locks.
+ */
+
+#ifndef _LIB_LIST_H
+#define _LIB_LIST_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief List node, also used as the list head
+ */
+typedef struct list_node {
+    struct list_node *next;
+    struct list_node *prev;
+} list_node_t;
+
+/** @brief Static initializer for an empty list head */
+#define LIST_INIT(name) { &(name), &(name) }
+
+/**
+ * @brief Make a head (or an unlinked node) an empty list
+ */
+static inline void list_init(list_node_t *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static inline bool list_empty(const list_node_t *head) {
+    return head->next == head;
+}
+
+/**
+ * @brief Link node between two adjacent nodes
+ */
+static inline void list_insert_between(list_node_t *node, list_node_t *prev,
+                                       list_node_t *next) {
+    node->prev = prev;
+    node->next = next;
+    prev->next = node;
+    next->prev = node;
+}
+
+/**
+ * @brief Insert at the front (stack order)
+ */
+static inline void list_add(list_node_t *head, list_node_t *node) {
+    list_insert_between(node, head, head->next);
+}
+
+/**
+ * @brief Insert at the back (queue order)
+ */
+static inline void list_add_tail(list_node_t *head, list_node_t *node) {
+    list_insert_between(node, head->prev, head);
+}
+
+/**
+ * @brief Unlink a node; it is left as an empty list, so removing twice is safe
+ */
+static inline void list_del(list_node_t *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    list_init(node);
+}
+
+/**
+ * @brief Move a node to the back of a (possibly different) list
+ */
+static inline void list_move_tail(list_node_t *head, list_node_t *node) {
+    list_del(node);
+    list_add_tail(head, node);
+}
+
+/**
+ * @brief Append every node of src to dst, leaving src empty
+ */
+static inline void list_splice_tail(list_node_t *dst, list_node_t *src) {
+    if (list_empty(src)) {
+        return;
+    }
+    src->next->prev = dst->prev;
+    dst->prev->next = src->next;
+    src->prev->next = dst;
+    dst->prev = src->prev;
+    list_init(src);
+}
+
+/** @brief First node, or NULL if the list is empty */
+static inline list_node_t *list_first(const list_node_t *head) {
+    return list_empty(head) ? NULL : head->next;
+}
+
+/** @brief Object a node is embedded in */
+#define list_entry(node, type, member) container_of(node, type, member)
+
+/** @brief Walk the nodes (the current node must stay linked) */
+#define list_for_each(pos, head) \
+    for (list_node_t *pos = (head)->next; pos != (head); pos = pos->next)
+
+/** @brief Walk the nodes, allowing the current one to be removed */
+#define list_for_each_safe(pos, head) \
+    for (list_node_t *pos = (head)->next, *pos##_next = pos->next; \
+         pos != (head); pos = pos##_next, pos##_next = pos->next)
+
+/** @brief Walk the objects */
+#define list_for_each_entry(pos, head, type, member) \
+    for (type *pos = list_entry((head)->next, type, member); \
+         &pos->member != (head); \
+         pos = list_entry(pos->member.next, type, member))
+
+#endif /* _LIB_LIST_H */
@@ -0,0 +1,212 @@
+/**
+ * @file lz4.c
+ * @brief LZ4 block compression implementation
+ */
+
+#include "lz4.h"
+#include <lib/memory/memory.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define MIN_MATCH           4
+#define MFLIMIT             12      /* No match may start in the last 12 bytes */
+#define LAST_LITERALS       5       /* The last 5 bytes are always literals */
+#define HASH_BITS           12
+#define MAX_OFFSET          65535
+#define RUN_MASK            15      /* Nibble value meaning "length continues" */
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * @brief Bytes a length of n takes beyond its token nibble
+ */
+static inline size_t ext_bytes(size_t n) {
+    return n >= RUN_MASK ? (n - RUN_MASK) / 255 + 1 : 0;
+}
+
+/**
+ * @brief Write the 255-valued extension of a length whose nibble is full
+ */
+static uint8_t *write_ext(uint8_t *op, size_t n) {
+    for (n -= RUN_MASK; n >= 255; n -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+/**
+ * @brief Read a length extension
+ *
+ * @return false if the input ends inside it
+ */
+static bool read_ext(const uint8_t **ip, const uint8_t *iend, size_t *n) {
+    uint8_t b;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        b = *(*ip)++;
+        *n += b;
+    } while (b == 255);
+    return true;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+size_t lz4_compress(const void *src, size_t src_len, void *dst, size_t dst_cap, void *work) {
+    const uint8_t *in = (const uint8_t *)src;
+    const uint8_t *iend = in + src_len;
+    const uint8_t *ip = in;
+    const uint8_t *anchor = in;
+    uint8_t *op = (uint8_t *)dst;
+    uint8_t *oend = op + dst_cap;
+    uint16_t *table = (uint16_t *)work;
+
+    if (src_len > LZ4_MAX_INPUT) {
+        return 0;
+    }
+    memset(table, 0, LZ4_WORK_SIZE);
+
+    if (src_len > MFLIMIT) {
+        const uint8_t *mflimit = iend - MFLIMIT;
+        const uint8_t *matchlimit = iend - LAST_LITERALS;
+
+        while (ip < mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = hash4(seq);
+            const uint8_t *ref = in + table[h];
+            table[h] = (uint16_t)(ip - in);
+
+            if (ref >= ip || read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            /* Extend backwards over literals, then forwards */
+            while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *mp = ip + MIN_MATCH;
+            const uint8_t *rp = ref + MIN_MATCH;
+            while (mp < matchlimit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            size_t lit = (size_t)(ip - anchor);
+            size_t mlen = (size_t)(mp - ip) - MIN_MATCH;
+            if ((size_t)(oend - op) < 1 + ext_bytes(lit) + lit + 2 + ext_bytes(mlen)) {
+                return 0;
+            }
+
+            uint8_t *token = op++;
+            *token = (uint8_t)(((lit >= RUN_MASK ? RUN_MASK : lit) << 4) |
+                               (mlen >= RUN_MASK ? RUN_MASK : mlen));
+            if (lit >= RUN_MASK) {
+                op = write_ext(op, lit);
+            }
+            memcpy(op, anchor, lit);
+            op += lit;
+
+            size_t offset = (size_t)(ip - ref);
+            *op++ = (uint8_t)offset;
+            *op++ = (uint8_t)(offset >> 8);
+            if (mlen >= RUN_MASK) {
+                op = write_ext(op, mlen);
+            }
+
+            ip = mp;
+            anchor = ip;
+        }
+    }
+
+    /* Trailing literals */
+    size_t lit = (size_t)(iend - anchor);
+    if ((size_t)(oend - op) < 1 + ext_bytes(lit) + lit) {
+        return 0;
+    }
+    *op++ = (uint8_t)((lit >= RUN_MASK ? RUN_MASK : lit) << 4);
+    if (lit >= RUN_MASK) {
+        op = write_ext(op, lit);
+    }
+    memcpy(op, anchor, lit);
+    op += lit;
+
+    return (size_t)(op - (uint8_t *)dst);
+}
+
+int lz4_decompress(const void *src, size_t src_len, void *dst, size_t dst_cap) {
+    const uint8_t *ip = (const uint8_t *)src;
+    const uint8_t *iend = ip + src_len;
+    uint8_t *out = (uint8_t *)dst;
+    uint8_t *op = out;
+    uint8_t *oend = out + dst_cap;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t lit = token >> 4;
+        if (lit == RUN_MASK && !read_ext(&ip, iend, &lit)) {
+            return -1;
+        }
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+
+        if (ip == iend) {
+            break;      /* Last sequence: literals only */
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - out)) {
+            return -1;
+        }
+
+        size_t mlen = token & RUN_MASK;
+        if (mlen == RUN_MASK && !read_ext(&ip, iend, &mlen)) {
+            return -1;
+        }
+        mlen += MIN_MATCH;
+        if (mlen > (size_t)(oend - op)) {
+            return -1;
+        }
+
+        /* Overlapping matches (offset < length) repeat a pattern byte by byte */
+        const uint8_t *match = op - offset;
+        if (offset >= mlen) {
+            memcpy(op, match, mlen);
+            op += mlen;
+        } else {
+            while (mlen--) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return (int)(op - out);
+}
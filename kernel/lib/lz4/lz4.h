@@ -0,0 +1,63 @@
+/**
+ * @file lz4.h
+ * @brief LZ4 block compression
+ *
+ * Produces and reads the standard LZ4 block format (no frame header), so
+ * output can be checked with the reference tools. Aimed at page-sized
+ * inputs: fast to decompress, a greedy single-probe matcher to compress.
+ *
+ * BLOCK FORMAT:
+ *   A block is a list of sequences, each
+ *     token       high nibble = literal count, low nibble = match length - 4
+ *     [lit ext]   255-valued bytes extending a literal count of 15
+ *     literals
+ *     offset      2 bytes, little endian, distance back to the match
+ *     [match ext] 255-valued bytes extending a match length of 19
+ *   The last sequence has literals only. The last 5 bytes are always
+ *   literals and no match starts within 12 bytes of the end.
+ *
+ * COMPRESSOR:
+ *   A 4096-entry hash of the 4-byte sequence at each position remembers
+ *   where it was last seen; a hit is verified, extended both ways and
+ *   emitted. The table lives in caller memory (LZ4_WORK_SIZE bytes), so
+ *   the code is reentrant and uses no stack to speak of.
+ */
+
+#ifndef _LIB_LZ4_H
+#define _LIB_LZ4_H
+
+#include <squirel/types.h>
+
+/** @brief Largest input lz4_compress() accepts (offsets are 16 bits) */
+#define LZ4_MAX_INPUT       65535
+
+/** @brief Scratch memory lz4_compress() needs */
+#define LZ4_WORK_SIZE       (4096 * sizeof(uint16_t))
+
+/**
+ * @brief Compress a buffer into an LZ4 block
+ *
+ * @param src      Input
+ * @param src_len  Input size (at most LZ4_MAX_INPUT)
+ * @param dst      Output
+ * @param dst_cap  Output capacity
+ * @param work     LZ4_WORK_SIZE bytes of scratch memory
+ * @return         Compressed size, or 0 if it does not fit in dst_cap
+ */
+size_t lz4_compress(const void *src, size_t src_len, void *dst, size_t dst_cap, void *work);
+
+/**
+ * @brief Decompress an LZ4 block
+ *
+ * Never reads or writes outside the given buffers, whatever the input.
+ *
+ * @param src      Compressed block
+ * @param src_len  Block size
+ * @param dst      Output
+ * @param dst_cap  Output capacity
+ * @return         Decompressed size, or -1 if the block is malformed or
+ *                 does not fit
+ */
+int lz4_decompress(const void *src, size_t src_len, void *dst, size_t dst_cap);
+
+#endif /* _LIB_LZ4_H */
@@ -8,11 +8,16 @@
  * IMPLEMENTATION APPROACH:
  *   This uses a "put character" callback approach so the same formatting
  *   code can output to VGA, serial, or a buffer.
+ *
+ *   kprintf output is batched into small chunks and handed to the console
+ *   layer, which fans each chunk out to the enabled sinks (VGA, serial,
+ *   debugcon, virtio).
  */
 
 #include "printf.h"
-#include <drivers/vga/vga_text.h>
+#include <drivers/console/console.h>
 #include <lib/string/string.h>
+#include <core/export.h>
 
 /* ============================================================================
  * Private Types and State
@@ -26,10 +31,32 @@ typedef void (*putchar_fn)(char c, void *ctx);
  * ============================================================================ */
 
 /**
- * @brief Print character to VGA (for kprintf)
+ * @brief Chunk buffer for kprintf
+ *
+ * Characters are batched so each sink sees one bulk write per chunk
+ * instead of one device access per character.
  */
-static void vga_putchar_wrapper(char c, void *ctx UNUSED) {
-    vga_putchar(c);
+typedef struct {
+    char buf[128];
+    size_t len;
+} console_ctx_t;
+
+static void console_chunk_flush(console_ctx_t *cctx) {
+    if (cctx->len > 0) {
+        console_write(cctx->buf, cctx->len);
+        cctx->len = 0;
+    }
+}
+
+/**
+ * @brief Print character to the console sinks (for kprintf)
+ */
+static void console_putchar(char c, void *ctx) {
+    console_ctx_t *cctx = (console_ctx_t *)ctx;
+    cctx->buf[cctx->len++] = c;
+    if (cctx->len == sizeof(cctx->buf)) {
+        console_chunk_flush(cctx);
+    }
 }
 
 /**
@@ -244,7 +271,7 @@ static int do_printf(putchar_fn putc, void *ctx, const char *fmt, va_list args)
             }
             
             case 'l': {
-                /* Handle %ld, %lu, %lx, %llx etc. */
+                /* Handle %ld, %lu, %lx, %llX etc. */
                 fmt++;
                 bool is_long_long = false;
                 if (*fmt == 'l') {
@@ -266,10 +293,11 @@ static int do_printf(putchar_fn putc, void *ctx, const char *fmt, va_list args)
                         count += print_uint(putc, ctx, val, 10, false, width, zeropad);
                         break;
                     }
-                    case 'x': {
+                    case 'x':
+                    case 'X': {
                         uint64_t val = is_long_long ?
                             va_arg(args, unsigned long long) : va_arg(args, unsigned long);
-                        count += print_uint(putc, ctx, val, 16, false, width, zeropad);
+                        count += print_uint(putc, ctx, val, 16, *fmt == 'X', width, zeropad);
                         break;
                     }
                     default:
@@ -302,13 +330,19 @@ static int do_printf(putchar_fn putc, void *ctx, const char *fmt, va_list args)
 int kprintf(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    int ret = do_printf(vga_putchar_wrapper, NULL, fmt, args);
+    int ret = kvprintf(fmt, args);
     va_end(args);
     return ret;
 }
+EXPORT_SYMBOL(kprintf);
 
 int kvprintf(const char *fmt, va_list args) {
-    return do_printf(vga_putchar_wrapper, NULL, fmt, args);
+    console_ctx_t cctx;
+    cctx.len = 0;
+    int ret = do_printf(console_putchar, &cctx, fmt, args);
+    console_chunk_flush(&cctx);
+    console_flush();
+    return ret;
 }
 
 int ksprintf(char *buf, const char *fmt, ...) {
@@ -322,11 +356,17 @@ int ksprintf(char *buf, const char *fmt, ...) {
 }
 
 int ksnprintf(char *buf, size_t size, const char *fmt, ...) {
-    sprintf_ctx_t ctx = { buf, 0, size };
     va_list args;
     va_start(args, fmt);
-    int ret = do_printf(buf_putchar, &ctx, fmt, args);
+    int ret = kvsnprintf(buf, size, fmt, args);
     va_end(args);
+    return ret;
+}
+EXPORT_SYMBOL(ksnprintf);
+
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list args) {
+    sprintf_ctx_t ctx = { buf, 0, size };
+    int ret = do_printf(buf_putchar, &ctx, fmt, args);
     if (size > 0) {
         buf[ctx.pos] = '\0';
     }
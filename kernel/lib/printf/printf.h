@@ -74,4 +74,15 @@ int ksprintf(char *buf, const char *fmt, ...);
  */
 int ksnprintf(char *buf, size_t size, const char *fmt, ...);
 
+/**
+ * @brief Snprintf with va_list
+ * 
+ * @param buf   Destination buffer
+ * @param size  Buffer size (including space for null)
+ * @param fmt   Format string
+ * @param args  Variable argument list
+ * @return      Number of characters that would have been written
+ */
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list args);
+
 #endif /* _LIB_PRINTF_H */
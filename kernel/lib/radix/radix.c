@@ -0,0 +1,244 @@
+/**
+ * @file radix.c
+ * @brief Radix tree implementation
+ */
+
+#include "radix.h"
+#include <lib/memory/memory.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <core/export.h>
+
+/* ============================================================================
+ * Constants
+ * ============================================================================ */
+
+#define FRAME_SIZE          4096
+#define NODES_PER_FRAME     (FRAME_SIZE / sizeof(radix_node_t))
+#define SLOT_MASK           (RADIX_SLOTS - 1)
+
+/* ============================================================================
+ * Node Cache
+ * ============================================================================ */
+
+/** @brief Free nodes, linked through slots[0] */
+static radix_node_t *free_nodes = NULL;
+static uint64_t nodes_used = 0;
+static uint64_t nodes_cached = 0;
+
+static radix_node_t *node_alloc(void) {
+    uint64_t flags = irq_save();
+    if (!free_nodes) {
+        uint64_t frame = pmm_alloc();
+        if (!frame) {
+            irq_restore(flags);
+            return NULL;
+        }
+        radix_node_t *nodes = (radix_node_t *)(uintptr_t)frame;
+        for (size_t i = 0; i < NODES_PER_FRAME; i++) {
+            nodes[i].slots[0] = free_nodes;
+            free_nodes = &nodes[i];
+        }
+        nodes_cached += NODES_PER_FRAME;
+    }
+
+    radix_node_t *node = free_nodes;
+    free_nodes = (radix_node_t *)node->slots[0];
+    nodes_cached--;
+    nodes_used++;
+    irq_restore(flags);
+
+    memset(node, 0, sizeof(*node));
+    return node;
+}
+
+static void node_free(radix_node_t *node) {
+    uint64_t flags = irq_save();
+    node->slots[0] = free_nodes;
+    free_nodes = node;
+    nodes_used--;
+    nodes_cached++;
+    irq_restore(flags);
+}
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+/**
+ * @brief Largest index a tree of the given height can hold
+ */
+static inline uint64_t max_index(int height) {
+    int bits = height * RADIX_BITS;
+    return bits >= 64 ? UINT64_MAX : (1ull << bits) - 1;
+}
+
+static inline unsigned slot_of(uint64_t index, int level) {
+    return (unsigned)(index >> (level * RADIX_BITS)) & SLOT_MASK;
+}
+
+/**
+ * @brief Add levels on top until index fits
+ */
+static bool grow(radix_tree_t *tree, uint64_t index) {
+    while (index > max_index(tree->height)) {
+        if (tree->root) {
+            radix_node_t *node = node_alloc();
+            if (!node) {
+                return false;
+            }
+            node->slots[0] = tree->root;
+            node->count = 1;
+            tree->root = node;
+        }
+        tree->height++;
+    }
+    return true;
+}
+
+static void destroy_node(radix_node_t *node, int level) {
+    if (level > 0) {
+        for (int i = 0; i < RADIX_SLOTS; i++) {
+            if (node->slots[i]) {
+                destroy_node(node->slots[i], level - 1);
+            }
+        }
+    }
+    node_free(node);
+}
+
+/**
+ * @brief radix_next() below one node; level 0 holds items
+ */
+static void *next_in_node(const radix_node_t *node, int level, uint64_t start,
+                          uint64_t base, uint64_t *index) {
+    for (unsigned i = slot_of(start, level); i < RADIX_SLOTS; i++) {
+        void *slot = node->slots[i];
+        uint64_t at = base | ((uint64_t)i << (level * RADIX_BITS));
+        if (!slot) {
+            continue;
+        }
+        if (level == 0) {
+            *index = at;
+            return slot;
+        }
+        /* Only the first child visited starts mid-way */
+        uint64_t sub_start = (at > start) ? at : start;
+        void *item = next_in_node(slot, level - 1, sub_start, at, index);
+        if (item) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+bool radix_insert(radix_tree_t *tree, uint64_t index, void *item) {
+    if (!item || !grow(tree, index)) {
+        return false;
+    }
+
+    radix_node_t **link = &tree->root;
+    radix_node_t *parent = NULL;
+    for (int level = tree->height - 1; ; level--) {
+        if (!*link) {
+            *link = node_alloc();
+            if (!*link) {
+                return false;   /* Empty nodes left behind are reused by later inserts */
+            }
+            if (parent) {
+                parent->count++;
+            }
+        }
+        radix_node_t *node = *link;
+        void **slot = &node->slots[slot_of(index, level)];
+        if (level == 0) {
+            if (!*slot) {
+                node->count++;
+            }
+            *slot = item;
+            return true;
+        }
+        parent = node;
+        link = (radix_node_t **)slot;
+    }
+}
+EXPORT_SYMBOL(radix_insert);
+
+void *radix_lookup(const radix_tree_t *tree, uint64_t index) {
+    if (index > max_index(tree->height)) {
+        return NULL;
+    }
+
+    const radix_node_t *node = tree->root;
+    for (int level = tree->height - 1; node && level > 0; level--) {
+        node = node->slots[slot_of(index, level)];
+    }
+    return node ? node->slots[slot_of(index, 0)] : NULL;
+}
+EXPORT_SYMBOL(radix_lookup);
+
+void *radix_delete(radix_tree_t *tree, uint64_t index) {
+    radix_node_t *path[RADIX_MAX_HEIGHT];
+
+    if (index > max_index(tree->height) || !tree->root) {
+        return NULL;
+    }
+
+    radix_node_t *node = tree->root;
+    for (int level = tree->height - 1; level > 0; level--) {
+        path[level] = node;
+        node = node->slots[slot_of(index, level)];
+        if (!node) {
+            return NULL;
+        }
+    }
+    path[0] = node;
+
+    void *item = node->slots[slot_of(index, 0)];
+    if (!item) {
+        return NULL;
+    }
+
+    /* Clear the slot, then free nodes left empty, bottom up */
+    for (int level = 0; level < tree->height; level++) {
+        node = path[level];
+        node->slots[slot_of(index, level)] = NULL;
+        if (--node->count > 0) {
+            break;
+        }
+        node_free(node);
+        if (level == tree->height - 1) {
+            tree->root = NULL;
+            tree->height = 0;
+        }
+    }
+    return item;
+}
+EXPORT_SYMBOL(radix_delete);
+
+void *radix_next(const radix_tree_t *tree, uint64_t start, uint64_t *index) {
+    if (!tree->root || start > max_index(tree->height)) {
+        return NULL;
+    }
+    return next_in_node(tree->root, tree->height - 1, start, 0, index);
+}
+EXPORT_SYMBOL(radix_next);
+
+void radix_destroy(radix_tree_t *tree) {
+    if (tree->root) {
+        destroy_node(tree->root, tree->height - 1);
+    }
+    tree->root = NULL;
+    tree->height = 0;
+}
+EXPORT_SYMBOL(radix_destroy);
+
+void radix_get_node_counts(uint64_t *used, uint64_t *cached) {
+    *used = nodes_used;
+    *cached = nodes_cached;
+}
+EXPORT_SYMBOL(radix_get_node_counts);
@@ -0,0 +1,88 @@
+/**
+ * @file radix.h
+ * @brief Radix tree for sparse 64-bit indexes
+ *
+ * Maps 64-bit indexes (page numbers, file offsets, IDs) to pointers.
+ * Each level resolves RADIX_BITS of the index, like a page table, so a
+ * lookup costs one load per level and the tree only has nodes where
+ * there are entries. The tree is as tall as the largest index needs:
+ * an index below 64 needs one level, below 4096 two, and so on.
+ *
+ * NODES:
+ *   Nodes are carved out of 4KB frames and recycled through a shared
+ *   free list, so inserts after the first few rarely touch the frame
+ *   allocator. A node emptied by radix_delete() goes back to the list.
+ *
+ * Stored pointers must be non-NULL (NULL means "no entry"). Trees do
+ * not lock; the node cache is safe against interrupts.
+ */
+
+#ifndef _LIB_RADIX_H
+#define _LIB_RADIX_H
+
+#include <squirel/types.h>
+
+/** @brief Index bits per level */
+#define RADIX_BITS      6
+#define RADIX_SLOTS     (1 << RADIX_BITS)
+
+/** @brief Levels needed for a full 64-bit index */
+#define RADIX_MAX_HEIGHT ((64 + RADIX_BITS - 1) / RADIX_BITS)
+
+/**
+ * @brief Interior or leaf node
+ */
+typedef struct radix_node {
+    void *slots[RADIX_SLOTS];       /**< Children, or items at the bottom level */
+    uint32_t count;                 /**< Non-NULL slots */
+} radix_node_t;
+
+/**
+ * @brief A tree
+ */
+typedef struct {
+    radix_node_t *root;
+    int height;                     /**< Levels below root (0 = empty) */
+} radix_tree_t;
+
+/** @brief Static initializer for an empty tree */
+#define RADIX_TREE_INIT { NULL, 0 }
+
+/**
+ * @brief Store an item at an index, replacing any item already there
+ *
+ * @return false if item is NULL or no memory for a node was left
+ */
+bool radix_insert(radix_tree_t *tree, uint64_t index, void *item);
+
+/**
+ * @brief Item at an index, or NULL
+ */
+void *radix_lookup(const radix_tree_t *tree, uint64_t index);
+
+/**
+ * @brief Remove the item at an index
+ *
+ * @return The item removed, or NULL if there was none
+ */
+void *radix_delete(radix_tree_t *tree, uint64_t index);
+
+/**
+ * @brief Find the item with the smallest index >= start
+ *
+ * @param index  Receives the item's index
+ * @return       The item, or NULL if there is none
+ */
+void *radix_next(const radix_tree_t *tree, uint64_t start, uint64_t *index);
+
+/**
+ * @brief Free every node (the items themselves are left alone)
+ */
+void radix_destroy(radix_tree_t *tree);
+
+/**
+ * @brief Nodes in use by all trees, and nodes cached for reuse
+ */
+void radix_get_node_counts(uint64_t *used, uint64_t *cached);
+
+#endif /* _LIB_RADIX_H */
@@ -0,0 +1,38 @@
+/**
+ * @file random.h
+ * @brief Non-cryptographic pseudo-random numbers for tests and benchmarks
+ *
+ * Marsaglia's xorshift64: three shifts per number, a period of 2^64 - 1
+ * and good enough statistics to scatter keys, shuffle pointer chains or
+ * fill buffers. The caller owns the state, so a sequence is replayed by
+ * storing the same seed again:
+ *
+ *   uint64_t state = 0x9E3779B97F4A7C15ull;
+ *   uint64_t key = xorshift64(&state) % n;
+ *
+ * A zero state stays zero; seed with anything else. Nothing here is
+ * suitable where an attacker must not predict the output.
+ */
+
+#ifndef _LIB_RANDOM_H
+#define _LIB_RANDOM_H
+
+#include <squirel/types.h>
+
+/**
+ * @brief Advance the state and return it
+ *
+ * @param state  Generator state, never zero
+ * @return       Next number of the sequence
+ */
+static inline uint64_t xorshift64(uint64_t *state) {
+    uint64_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+#endif /* _LIB_RANDOM_H */
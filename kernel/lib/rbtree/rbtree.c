@@ -0,0 +1,273 @@
+/**
+ * @file rbtree.c
+ * @brief Intrusive red-black tree implementation
+ *
+ * Textbook (CLRS) insertion and deletion, with NULL standing in for the
+ * black leaves: the deletion fixup therefore carries the parent of the
+ * position being fixed, since that position may be empty.
+ */
+
+#include "rbtree.h"
+#include <core/export.h>
+
+/* ============================================================================
+ * Private Helper Functions
+ * ============================================================================ */
+
+static inline bool is_black(const rb_node_t *node) {
+    return !node || node->color == RB_BLACK;
+}
+
+/**
+ * @brief Put new where old hangs from its parent (or the root)
+ */
+static void replace_child(rb_root_t *root, rb_node_t *old, rb_node_t *new) {
+    rb_node_t *parent = old->parent;
+    if (!parent) {
+        root->node = new;
+    } else if (parent->left == old) {
+        parent->left = new;
+    } else {
+        parent->right = new;
+    }
+}
+
+static void rotate_left(rb_root_t *root, rb_node_t *x) {
+    rb_node_t *y = x->right;
+    x->right = y->left;
+    if (y->left) {
+        y->left->parent = x;
+    }
+    y->parent = x->parent;
+    replace_child(root, x, y);
+    y->left = x;
+    x->parent = y;
+}
+
+static void rotate_right(rb_root_t *root, rb_node_t *x) {
+    rb_node_t *y = x->left;
+    x->left = y->right;
+    if (y->right) {
+        y->right->parent = x;
+    }
+    y->parent = x->parent;
+    replace_child(root, x, y);
+    y->right = x;
+    x->parent = y;
+}
+
+/**
+ * @brief Restore the black height after a black node left the position
+ *        below parent that x now holds (x may be NULL)
+ */
+static void erase_fixup(rb_root_t *root, rb_node_t *x, rb_node_t *parent) {
+    while (x != root->node && is_black(x)) {
+        if (x == parent->left) {
+            rb_node_t *w = parent->right;
+            if (w->color == RB_RED) {
+                w->color = RB_BLACK;
+                parent->color = RB_RED;
+                rotate_left(root, parent);
+                w = parent->right;
+            }
+            if (is_black(w->left) && is_black(w->right)) {
+                w->color = RB_RED;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (is_black(w->right)) {
+                w->left->color = RB_BLACK;
+                w->color = RB_RED;
+                rotate_right(root, w);
+                w = parent->right;
+            }
+            w->color = parent->color;
+            parent->color = RB_BLACK;
+            w->right->color = RB_BLACK;
+            rotate_left(root, parent);
+        } else {
+            rb_node_t *w = parent->left;
+            if (w->color == RB_RED) {
+                w->color = RB_BLACK;
+                parent->color = RB_RED;
+                rotate_right(root, parent);
+                w = parent->left;
+            }
+            if (is_black(w->left) && is_black(w->right)) {
+                w->color = RB_RED;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (is_black(w->left)) {
+                w->right->color = RB_BLACK;
+                w->color = RB_RED;
+                rotate_left(root, w);
+                w = parent->left;
+            }
+            w->color = parent->color;
+            parent->color = RB_BLACK;
+            w->left->color = RB_BLACK;
+            rotate_right(root, parent);
+        }
+        x = root->node;
+        break;
+    }
+    if (x) {
+        x->color = RB_BLACK;
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void rb_insert_color(rb_node_t *node, rb_root_t *root) {
+    rb_node_t *parent;
+
+    while ((parent = node->parent) && parent->color == RB_RED) {
+        rb_node_t *grand = parent->parent;     /* Exists: a red node is never the root */
+
+        if (parent == grand->left) {
+            rb_node_t *uncle = grand->right;
+            if (uncle && uncle->color == RB_RED) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                grand->color = RB_RED;
+                node = grand;
+                continue;
+            }
+            if (node == parent->right) {
+                rotate_left(root, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->color = RB_BLACK;
+            grand->color = RB_RED;
+            rotate_right(root, grand);
+        } else {
+            rb_node_t *uncle = grand->left;
+            if (uncle && uncle->color == RB_RED) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                grand->color = RB_RED;
+                node = grand;
+                continue;
+            }
+            if (node == parent->left) {
+                rotate_right(root, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->color = RB_BLACK;
+            grand->color = RB_RED;
+            rotate_left(root, grand);
+        }
+    }
+    root->node->color = RB_BLACK;
+}
+EXPORT_SYMBOL(rb_insert_color);
+
+void rb_erase(rb_node_t *node, rb_root_t *root) {
+    rb_node_t *child;
+    rb_node_t *parent;
+    int color;
+
+    if (node->left && node->right) {
+        /* Two children: the successor (leftmost on the right) takes its place */
+        rb_node_t *succ = node->right;
+        while (succ->left) {
+            succ = succ->left;
+        }
+
+        child = succ->right;
+        parent = succ->parent;
+        color = succ->color;
+
+        if (parent == node) {
+            parent = succ;
+        } else {
+            if (child) {
+                child->parent = parent;
+            }
+            parent->left = child;
+            succ->right = node->right;
+            node->right->parent = succ;
+        }
+
+        replace_child(root, node, succ);
+        succ->parent = node->parent;
+        succ->color = node->color;
+        succ->left = node->left;
+        node->left->parent = succ;
+    } else {
+        child = node->left ? node->left : node->right;
+        parent = node->parent;
+        color = node->color;
+
+        if (child) {
+            child->parent = parent;
+        }
+        replace_child(root, node, child);
+    }
+
+    if (color == RB_BLACK) {
+        erase_fixup(root, child, parent);
+    }
+}
+EXPORT_SYMBOL(rb_erase);
+
+rb_node_t *rb_first(const rb_root_t *root) {
+    rb_node_t *node = root->node;
+    if (!node) {
+        return NULL;
+    }
+    while (node->left) {
+        node = node->left;
+    }
+    return node;
+}
+EXPORT_SYMBOL(rb_first);
+
+rb_node_t *rb_last(const rb_root_t *root) {
+    rb_node_t *node = root->node;
+    if (!node) {
+        return NULL;
+    }
+    while (node->right) {
+        node = node->right;
+    }
+    return node;
+}
+EXPORT_SYMBOL(rb_last);
+
+rb_node_t *rb_next(const rb_node_t *node) {
+    if (node->right) {
+        node = node->right;
+        while (node->left) {
+            node = node->left;
+        }
+        return (rb_node_t *)node;
+    }
+    while (node->parent && node == node->parent->right) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+EXPORT_SYMBOL(rb_next);
+
+rb_node_t *rb_prev(const rb_node_t *node) {
+    if (node->left) {
+        node = node->left;
+        while (node->right) {
+            node = node->right;
+        }
+        return (rb_node_t *)node;
+    }
+    while (node->parent && node == node->parent->left) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+EXPORT_SYMBOL(rb_prev);
@@ -0,0 +1,105 @@
+/**
+ * @file rbtree.h
+ * @brief Intrusive red-black tree
+ *
+ * A balanced binary search tree whose nodes are embedded in the objects
+ * they order, so the tree never allocates. Lookup, insertion and erasure
+ * are O(log n), and in-order iteration is O(1) amortized per step.
+ *
+ * The tree does not know how to compare objects. Callers walk down from
+ * the root with their own comparison (which keeps it inlined and lets a
+ * lookup compare against a bare key), then link the new node where the
+ * walk ended and let the tree rebalance:
+ *
+ *   rb_node_t **link = &root->node, *parent = NULL;
+ *   while (*link) {
+ *       parent = *link;
+ *       vma_t *v = rb_entry(parent, vma_t, rb);
+ *       link = (new->start < v->start) ? &parent->left : &parent->right;
+ *   }
+ *   rb_link_node(&new->rb, parent, link);
+ *   rb_insert_color(&new->rb, root);
+ *
+ * INVARIANTS:
+ *   The root is black, a red node has black children, and every path
+ *   from a node down to a leaf crosses the same number of black nodes,
+ *   so the longest path is at most twice the shortest.
+ */
+
+#ifndef _LIB_RBTREE_H
+#define _LIB_RBTREE_H
+
+#include <squirel/types.h>
+
+#define RB_RED      0
+#define RB_BLACK    1
+
+/**
+ * @brief Tree node, embedded in the ordered object
+ */
+typedef struct rb_node {
+    struct rb_node *left;
+    struct rb_node *right;
+    struct rb_node *parent;
+    int color;
+} rb_node_t;
+
+/**
+ * @brief Tree root
+ */
+typedef struct {
+    rb_node_t *node;
+} rb_root_t;
+
+/** @brief Static initializer for an empty tree */
+#define RB_ROOT_INIT { NULL }
+
+/** @brief Object a node is embedded in */
+#define rb_entry(node, type, member) container_of(node, type, member)
+
+/**
+ * @brief Attach a node as a red leaf where a search ended
+ *
+ * @param node    Node to attach
+ * @param parent  Last node visited (NULL for an empty tree)
+ * @param link    Child pointer of parent (or &root->node) that was NULL
+ */
+static inline void rb_link_node(rb_node_t *node, rb_node_t *parent, rb_node_t **link) {
+    node->left = NULL;
+    node->right = NULL;
+    node->parent = parent;
+    node->color = RB_RED;
+    *link = node;
+}
+
+/**
+ * @brief Rebalance after rb_link_node()
+ */
+void rb_insert_color(rb_node_t *node, rb_root_t *root);
+
+/**
+ * @brief Remove a node and rebalance
+ */
+void rb_erase(rb_node_t *node, rb_root_t *root);
+
+/**
+ * @brief Smallest node, or NULL for an empty tree
+ */
+rb_node_t *rb_first(const rb_root_t *root);
+
+/**
+ * @brief Largest node, or NULL for an empty tree
+ */
+rb_node_t *rb_last(const rb_root_t *root);
+
+/**
+ * @brief In-order successor, or NULL
+ */
+rb_node_t *rb_next(const rb_node_t *node);
+
+/**
+ * @brief In-order predecessor, or NULL
+ */
+rb_node_t *rb_prev(const rb_node_t *node);
+
+#endif /* _LIB_RBTREE_H */
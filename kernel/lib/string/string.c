@@ -7,6 +7,7 @@
  */
 
 #include "string.h"
+#include <core/export.h>
 
 /* ============================================================================
  * String Length Functions
@@ -19,6 +20,7 @@ size_t strlen(const char *str) {
     }
     return len;
 }
+EXPORT_SYMBOL(strlen);
 
 size_t strnlen(const char *str, size_t maxlen) {
     size_t len = 0;
@@ -39,6 +41,7 @@ int strcmp(const char *s1, const char *s2) {
     }
     return (unsigned char)*s1 - (unsigned char)*s2;
 }
+EXPORT_SYMBOL(strcmp);
 
 int strncmp(const char *s1, const char *s2, size_t n) {
     while (n > 0 && *s1 && (*s1 == *s2)) {
@@ -161,6 +164,46 @@ char *strstr(const char *haystack, const char *needle) {
     return NULL;
 }
 
+/* ============================================================================
+ * Number Conversion Functions
+ * ============================================================================ */
+
+bool kstrtou64(const char *str, unsigned int base, uint64_t *out) {
+    uint64_t val = 0;
+
+    if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X') && (base == 0 || base == 16)) {
+        str += 2;
+        base = 16;
+    } else if (base == 0) {
+        base = 10;
+    }
+    if (*str == '\0' || (base != 10 && base != 16)) {
+        return false;
+    }
+
+    while (*str) {
+        char c = *str++;
+        unsigned int digit;
+        if (c >= '0' && c <= '9') {
+            digit = (unsigned int)(c - '0');
+        } else if (base == 16 && c >= 'a' && c <= 'f') {
+            digit = (unsigned int)(c - 'a' + 10);
+        } else if (base == 16 && c >= 'A' && c <= 'F') {
+            digit = (unsigned int)(c - 'A' + 10);
+        } else {
+            return false;
+        }
+        if (val > (UINT64_MAX - digit) / base) {
+            return false;
+        }
+        val = val * base + digit;
+    }
+
+    *out = val;
+    return true;
+}
+EXPORT_SYMBOL(kstrtou64);
+
 /* ============================================================================
  * Character Classification Functions
  * ============================================================================ */
@@ -137,6 +137,24 @@ char *strrchr(const char *str, int c);
  */
 char *strstr(const char *haystack, const char *needle);
 
+/* ============================================================================
+ * Number Conversion Functions
+ * ============================================================================ */
+
+/**
+ * @brief Parse an unsigned 64-bit number
+ *
+ * The whole string must be digits of the base: no sign, no whitespace
+ * and no trailing characters. Base 16 accepts an optional 0x prefix;
+ * base 0 reads hexadecimal after a 0x prefix and decimal otherwise.
+ *
+ * @param str   Null-terminated string
+ * @param base  10, 16 or 0
+ * @param out   Receives the value (untouched on failure)
+ * @return      false if the string is empty, malformed or does not fit
+ */
+bool kstrtou64(const char *str, unsigned int base, uint64_t *out);
+
 /* ============================================================================
  * Character Classification Functions
  * ============================================================================ */
@@ -0,0 +1,78 @@
+/**
+ * @file cmd_boot.c
+ * @brief Boot timeline
+ *
+ * Lists every initcall in the order it ran, with its start time (from
+ * the start of initcall_run()), its own time, and its critical-path
+ * finish: when it would have finished had every CPU been available to
+ * run independent initcalls side by side. Initcalls on the critical
+ * path are marked with '*'; deferred ones ran from the idle loop after
+ * the shell started and do not count towards the boot time.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <core/initcall.h>
+
+static const char *status_name(const initcall_info_t *info) {
+    switch (info->status) {
+    case INITCALL_OK:       return "ok";
+    case INITCALL_FAILED:   return "absent";
+    default:                return "pending";
+    }
+}
+
+/**
+ * @brief Print nanoseconds as milliseconds with three decimals
+ */
+static void print_ms(uint64_t ns) {
+    kprintf("%5llu.%03llu", ns / 1000000, ns / 1000 % 1000);
+}
+
+/**
+ * @brief Boot command handler
+ *
+ * Usage:
+ *   boot    - Initcall timeline and critical path
+ */
+void cmd_boot(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    kprintf("\n  initcall         start ms  time ms  path ms  status   after\n");
+
+    initcall_info_t info;
+    for (int i = 0; initcall_get(i, &info); i++) {
+        kprintf("%c %-16s", info.critical ? '*' : ' ', info.name);
+        if (info.status == INITCALL_PENDING) {
+            kprintf("         -        -        -");
+        } else {
+            kprintf(" ");
+            print_ms(info.start_ns);
+            kprintf("  ");
+            print_ms(info.time_ns);
+            kprintf("  ");
+            print_ms(info.path_ns);
+        }
+        kprintf("  %-7s  %s%s\n", status_name(&info), info.deps,
+                info.deferred ? " (deferred)" : "");
+    }
+
+    initcall_summary_t sum;
+    initcall_get_summary(&sum);
+    kprintf("\nSynchronous: %d initcalls, ", sum.count - sum.deferred);
+    print_ms(sum.serial_ns);
+    kprintf(" ms serial, critical path ");
+    print_ms(sum.critical_ns);
+    kprintf(" ms\n");
+    kprintf("Deferred:    %d initcalls, ", sum.deferred);
+    print_ms(sum.deferred_ns);
+    kprintf(" ms%s\n", sum.pending ? " so far" : "");
+    kprintf("Power-on:    ");
+    print_ms(sum.ready_ns);
+    kprintf(" ms to the shell, firmware and loader included\n");
+    if (sum.failed) {
+        kprintf("Absent:      %d\n", sum.failed);
+    }
+    kprintf("\n");
+}
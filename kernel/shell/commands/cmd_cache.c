@@ -0,0 +1,333 @@
+/**
+ * @file cmd_cache.c
+ * @brief Cache/TLB topology, page coloring and conflict-miss benchmark
+ *
+ * "cache" lists what CPUID reports. "cache color on [level]" makes the
+ * frame allocator color vmalloc pages for that cache level's geometry.
+ *
+ * "cache bench [level]" shows why. It builds a buffer of 3/4 of the
+ * cache's size out of single frames, placed three ways:
+ *   same color  - every frame has one color (what an uncolored allocator
+ *                 can hand out once free memory is fragmented)
+ *   random      - each frame gets a random color (an allocator that
+ *                 ignores color, in the long run)
+ *   colored     - frame i has color i mod colors (pmm_alloc_color)
+ * and then reads the same line offset of every page in turn (a 4KB
+ * stride), offset after offset. Only the colored buffer fits: the same
+ * color one has room for `ways` pages, and the random one overflows
+ * whichever colors received more than their share.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <lib/random/random.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/cpu/topology.h>
+#include <arch/x86_64/mm/pmm.h>
+
+/** @brief Cache level colored and benchmarked by default */
+#define CACHE_DEFAULT_LEVEL     2
+
+/** @brief Largest benchmark buffer (pages) */
+#define BENCH_MAX_PAGES         8192
+
+/** @brief Loads per timed sweep (rounded up to whole sweeps) */
+#define BENCH_LOADS             (1u << 22)
+
+/** @brief Timed runs per placement (best is reported) */
+#define BENCH_RUNS              3
+
+#define LINE                    64
+
+typedef enum {
+    PLACE_SAME,
+    PLACE_RANDOM,
+    PLACE_COLORED,
+    PLACE_COUNT
+} placement_t;
+
+static const char *const place_names[PLACE_COUNT] = {
+    "same color", "random", "colored"
+};
+
+static uint64_t frames[BENCH_MAX_PAGES];
+
+/** @brief Pages per color of the current placement */
+static uint16_t color_load[PMM_MAX_COLORS];
+
+static uint64_t rng;
+
+/**
+ * @brief Parse a cache level (1-4)
+ */
+static bool parse_level(const char *str, int *out) {
+    if (str[0] < '1' || str[0] > '4' || str[1] != '\0') {
+        return false;
+    }
+    *out = str[0] - '0';
+    return true;
+}
+
+static const char *type_name(uint8_t type) {
+    switch (type) {
+    case TOPO_DATA:         return "data";
+    case TOPO_INSTRUCTION:  return "instruction";
+    case TOPO_UNIFIED:      return "unified";
+    case TOPO_LOAD:         return "load";
+    case TOPO_STORE:        return "store";
+    default:                return "?";
+    }
+}
+
+/**
+ * @brief Print a byte count as KB or MB
+ */
+static void print_size(uint64_t bytes) {
+    if (bytes >= (1u << 20) && (bytes & ((1u << 20) - 1)) == 0) {
+        kprintf("%4llu MB", bytes >> 20);
+    } else {
+        kprintf("%4llu KB", bytes >> 10);
+    }
+}
+
+/**
+ * @brief Page colors of a level, capped to what the allocator supports
+ */
+static uint32_t level_colors(int level) {
+    uint32_t colors = topology_page_colors(level);
+    return colors > PMM_MAX_COLORS ? PMM_MAX_COLORS : colors;
+}
+
+/* ============================================================================
+ * Listing
+ * ============================================================================ */
+
+static void show_topology(void) {
+    const topo_cache_t *caches;
+    int n = topology_get_caches(&caches);
+
+    kprintf("\nCaches:\n");
+    if (n == 0) {
+        kprintf("  (CPUID leaf 4 / 0x8000001D not available)\n");
+    }
+    for (int i = 0; i < n; i++) {
+        const topo_cache_t *c = &caches[i];
+        kprintf("  L%d %-11s ", c->level, type_name(c->type));
+        print_size(c->size);
+        if (c->fully_assoc) {
+            kprintf("  fully assoc");
+        } else {
+            kprintf("  %2u-way", c->ways);
+        }
+        kprintf("  %3u B lines  %5u sets  shared by %3u%s", c->line, c->sets,
+                c->shared_by, c->inclusive ? "  inclusive" : "");
+        if (c->type != TOPO_INSTRUCTION && level_colors(c->level) > 1) {
+            kprintf("  %u colors", level_colors(c->level));
+        }
+        kprintf("\n");
+    }
+
+    const topo_tlb_t *tlbs;
+    n = topology_get_tlbs(&tlbs);
+    kprintf("\nTLBs:\n");
+    if (n == 0) {
+        kprintf("  (CPUID leaf 0x18 not available)\n");
+    }
+    for (int i = 0; i < n; i++) {
+        const topo_tlb_t *t = &tlbs[i];
+        kprintf("  L%d %-11s %5u entries  ", t->level, type_name(t->type), t->entries);
+        if (t->fully_assoc) {
+            kprintf("fully assoc");
+        } else {
+            kprintf("%2u-way     ", t->ways);
+        }
+        kprintf("  pages%s%s%s%s\n",
+                (t->pages & TOPO_PAGE_4K) ? " 4K" : "",
+                (t->pages & TOPO_PAGE_2M) ? " 2M" : "",
+                (t->pages & TOPO_PAGE_4M) ? " 4M" : "",
+                (t->pages & TOPO_PAGE_1G) ? " 1G" : "");
+    }
+
+    const topo_cpu_t *cpu = topology_get_cpu();
+    kprintf("\nTopology: ");
+    if (cpu->valid) {
+        kprintf("x2APIC id %u, %u thread%s per core, %u per package\n", cpu->x2apic_id,
+                cpu->threads_per_core, cpu->threads_per_core == 1 ? "" : "s",
+                cpu->threads_per_package);
+    } else {
+        kprintf("(CPUID leaf 0xB not available)\n");
+    }
+
+    uint32_t colors = pmm_get_colors();
+    if (colors > 1) {
+        kprintf("\nPage coloring: on, %u colors\n\n", colors);
+    } else {
+        kprintf("\nPage coloring: off\n\n");
+    }
+}
+
+/* ============================================================================
+ * Benchmark
+ * ============================================================================ */
+
+static void free_frames(int count) {
+    for (int i = 0; i < count; i++) {
+        pmm_free(frames[i]);
+    }
+}
+
+/**
+ * @brief Allocate pages frames for a placement
+ *
+ * @return Frames allocated (fewer than pages when memory ran out)
+ */
+static int place(placement_t how, int pages, uint32_t colors) {
+    memset(color_load, 0, sizeof(color_load));
+    for (int i = 0; i < pages; i++) {
+        uint64_t color;
+        switch (how) {
+        case PLACE_SAME:    color = 0; break;
+        case PLACE_RANDOM:  color = xorshift64(&rng); break;
+        default:            color = (uint64_t)i; break;
+        }
+        frames[i] = pmm_alloc_color(color);
+        if (!frames[i]) {
+            return i;
+        }
+        color_load[(frames[i] / PMM_FRAME_SIZE) & (colors - 1)]++;
+    }
+    return pages;
+}
+
+/**
+ * @brief Read line o of every page, for every o, until loads are done
+ *
+ * @return Best cycles per sweep of all lines
+ */
+static uint64_t sweep(int pages) {
+    uint64_t per_sweep = (uint64_t)pages * (PMM_FRAME_SIZE / LINE);
+    uint64_t sweeps = (BENCH_LOADS + per_sweep - 1) / per_sweep;
+    uint64_t best = UINT64_MAX;
+    uint64_t sum = 0;
+
+    for (int run = 0; run <= BENCH_RUNS; run++) {
+        uint64_t start = rdtsc();
+        for (uint64_t s = 0; s < sweeps; s++) {
+            for (uint64_t off = 0; off < PMM_FRAME_SIZE; off += LINE) {
+                for (int i = 0; i < pages; i++) {
+                    sum += *(volatile uint64_t *)(uintptr_t)(frames[i] + off);
+                }
+            }
+        }
+        uint64_t cycles = (rdtsc() - start) / sweeps;
+        if (run > 0 && cycles < best) {
+            best = cycles;      /* run 0 only warms the caches */
+        }
+    }
+    __asm__ volatile("" :: "r"(sum));
+    return best;
+}
+
+static void run_bench(int level) {
+    const topo_cache_t *c = topology_find_cache(level);
+    uint32_t colors = level_colors(level);
+    if (!c || colors <= 1) {
+        kprintf("cache: L%d is not reported or has a single page color\n", level);
+        return;
+    }
+
+    uint64_t pages64 = c->size * 3 / 4 / PMM_FRAME_SIZE;
+    int pages = pages64 > BENCH_MAX_PAGES ? BENCH_MAX_PAGES : (int)pages64;
+    uint64_t lines = (uint64_t)pages * (PMM_FRAME_SIZE / LINE);
+
+    kprintf("\nL%d: ", level);
+    print_size(c->size);
+    kprintf(", %u-way, %u colors (%u pages per color fit)\n", c->ways, colors, c->ways);
+    kprintf("Buffer: %d pages (3/4 of the cache), read at a 4KB stride\n\n", pages);
+    kprintf("  placement    max pages/color    ns/load\n");
+
+    uint32_t saved = pmm_get_colors();
+    pmm_set_colors(colors);
+    rng = 0x9E3779B97F4A7C15ull ^ rdtsc();
+
+    for (int how = 0; how < PLACE_COUNT; how++) {
+        int got = place((placement_t)how, pages, colors);
+        if (got < pages) {
+            kprintf("cache: out of memory\n");
+            free_frames(got);
+            break;
+        }
+
+        uint32_t max_load = 0;
+        for (uint32_t col = 0; col < colors; col++) {
+            if (color_load[col] > max_load) {
+                max_load = color_load[col];
+            }
+        }
+
+        uint64_t cycles = sweep(pages);
+        uint64_t tenths = tsc_cycles_to_ns(cycles * 10) / lines;
+        kprintf("  %-12s %15u %6llu.%llu\n", place_names[how], max_load,
+                tenths / 10, tenths % 10);
+        free_frames(pages);
+    }
+
+    pmm_set_colors(saved);
+    kprintf("\n");
+}
+
+/* ============================================================================
+ * Command Handler
+ * ============================================================================ */
+
+/**
+ * @brief Cache command handler
+ *
+ * Usage:
+ *   cache                     - caches, TLBs, topology, coloring state
+ *   cache color on [level]    - color vmalloc pages for a cache level
+ *   cache color off
+ *   cache bench [level]       - strided workload, three placements
+ */
+void cmd_cache(int argc, char *argv[]) {
+    if (argc < 2) {
+        show_topology();
+        return;
+    }
+
+    int level = CACHE_DEFAULT_LEVEL;
+    if (strcmp(argv[1], "bench") == 0) {
+        if (argc >= 3 && !parse_level(argv[2], &level)) {
+            kprintf("cache: invalid level '%s'\n", argv[2]);
+            return;
+        }
+        run_bench(level);
+        return;
+    }
+
+    if (strcmp(argv[1], "color") == 0 && argc >= 3) {
+        if (strcmp(argv[2], "off") == 0) {
+            pmm_set_colors(1);
+            kprintf("Page coloring off\n");
+            return;
+        }
+        if (strcmp(argv[2], "on") == 0) {
+            if (argc >= 4 && !parse_level(argv[3], &level)) {
+                kprintf("cache: invalid level '%s'\n", argv[3]);
+                return;
+            }
+            uint32_t colors = level_colors(level);
+            if (colors <= 1 || !pmm_set_colors(colors)) {
+                kprintf("cache: L%d gives no usable page colors\n", level);
+                return;
+            }
+            kprintf("Page coloring on: %u colors (L%d)\n", colors, level);
+            return;
+        }
+    }
+
+    kprintf("Usage: cache [color on [level] | color off | bench [level]]\n");
+}
@@ -0,0 +1,206 @@
+/**
+ * @file cmd_checksum.c
+ * @brief Checksum command implementation
+ *
+ * "checksum <algo> <addr> <len>" hashes a memory region with the
+ * implementation checksum_init() selected and prints the value with the
+ * throughput. Every page of the region is probed first, so an unmapped
+ * address is reported instead of faulting.
+ *
+ * "checksum bench [KB]" runs every implementation the CPU supports over
+ * the same vmalloc buffer, checks that they agree and prints GB/s.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <lib/checksum/checksum.h>
+#include <lib/random/random.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/uaccess.h>
+#include <arch/x86_64/mm/vmalloc.h>
+
+/** @brief Default and largest benchmark buffer (KB) */
+#define CHECKSUM_BENCH_KB       1024
+#define CHECKSUM_BENCH_MAX_KB   16384
+
+/** @brief Bytes hashed per implementation in the benchmark */
+#define CHECKSUM_BENCH_BYTES    (256ull << 20)
+
+/**
+ * @brief Print bytes per cycles as GB/s with two decimals
+ */
+static void print_rate(uint64_t bytes, uint64_t cycles) {
+    uint64_t ns = tsc_cycles_to_ns(cycles);
+    if (ns == 0) {
+        ns = 1;
+    }
+    uint64_t centi = bytes * 100 / ns;      /* bytes/ns == GB/s */
+    kprintf("%llu.%02llu GB/s", centi / 100, centi % 100);
+}
+
+/**
+ * @brief Check that every page of [addr, addr + len) can be read
+ */
+static bool region_readable(uint64_t addr, uint64_t len) {
+    uint8_t byte;
+    uint64_t end = addr + len;
+    if (end < addr) {
+        return false;
+    }
+    for (uint64_t p = addr; p < end; p = (p & ~0xFFFull) + 0x1000) {
+        if (!probe_kernel_read(&byte, (const void *)p, 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ============================================================================
+ * Benchmark
+ * ============================================================================ */
+
+static void bench(uint64_t kb) {
+    size_t size = (size_t)kb << 10;
+    uint8_t *buf = vmalloc(size);
+    if (!buf) {
+        kprintf("checksum: cannot allocate %llu KB\n", kb);
+        return;
+    }
+
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < size; i += 8) {
+        xorshift64(&x);
+        memcpy(buf + i, &x, 8);
+    }
+
+    uint64_t rounds = CHECKSUM_BENCH_BYTES / size;
+    if (rounds == 0) {
+        rounds = 1;
+    }
+    kprintf("%llu KB buffer, %llu rounds per implementation\n\n", kb, rounds);
+
+    const crc32c_impl_t *crc;
+    int selected;
+    int count = crc32c_get_impls(&crc, &selected);
+    uint32_t expect = crc[0].fn(0, buf, size);
+    for (int i = 0; i < count; i++) {
+        kprintf("  crc32c %-8s ", crc[i].name);
+        if (!cpu_has(crc[i].required)) {
+            kprintf("unsupported\n");
+            continue;
+        }
+        uint32_t value = 0;
+        uint64_t start = rdtsc();
+        for (uint64_t r = 0; r < rounds; r++) {
+            value = crc[i].fn(0, buf, size);
+        }
+        print_rate(rounds * size, rdtsc() - start);
+        kprintf("%s%s\n", value == expect ? "" : "  MISMATCH",
+                i == selected ? "  (selected)" : "");
+    }
+
+    uint64_t h64 = 0;
+    uint64_t start = rdtsc();
+    for (uint64_t r = 0; r < rounds; r++) {
+        h64 = xxh64(buf, size, 0);
+    }
+    kprintf("  xxh64  %-8s ", "scalar");
+    print_rate(rounds * size, rdtsc() - start);
+    kprintf("  (selected)  %016llX\n", h64);
+
+    const xxh3_impl_t *xxh3;
+    count = xxh3_get_impls(&xxh3, &selected);
+    uint64_t expect3 = xxh3[0].fn(buf, size);
+    for (int i = 0; i < count; i++) {
+        kprintf("  xxh3   %-8s ", xxh3[i].name);
+        if (!cpu_has(xxh3[i].required)) {
+            kprintf("unsupported\n");
+            continue;
+        }
+        uint64_t value = 0;
+        start = rdtsc();
+        for (uint64_t r = 0; r < rounds; r++) {
+            value = xxh3[i].fn(buf, size);
+        }
+        print_rate(rounds * size, rdtsc() - start);
+        kprintf("%s%s\n", value == expect3 ? "" : "  MISMATCH",
+                i == selected ? "  (selected)" : "");
+    }
+
+    vfree(buf);
+}
+
+/* ============================================================================
+ * Command Handler
+ * ============================================================================ */
+
+/**
+ * @brief Checksum command handler
+ *
+ * Usage:
+ *   checksum <crc32c|xxh64|xxh3> <addr> <len>
+ *   checksum bench [KB]
+ */
+void cmd_checksum(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        uint64_t kb = CHECKSUM_BENCH_KB;
+        if (argc >= 3 && (!kstrtou64(argv[2], 0, &kb) || kb == 0 || kb > CHECKSUM_BENCH_MAX_KB)) {
+            kprintf("checksum: size must be 1-%d KB\n", CHECKSUM_BENCH_MAX_KB);
+            return;
+        }
+        bench(kb);
+        return;
+    }
+
+    if (argc < 4) {
+        kprintf("Usage: checksum <crc32c|xxh64|xxh3> <addr> <len>\n");
+        kprintf("       checksum bench [KB]\n");
+        return;
+    }
+
+    const char *algo = argv[1];
+    if (strcmp(algo, "crc32c") != 0 && strcmp(algo, "xxh64") != 0 &&
+        strcmp(algo, "xxh3") != 0) {
+        kprintf("checksum: unknown algorithm '%s'\n", algo);
+        return;
+    }
+
+    uint64_t addr;
+    uint64_t len;
+    if (!kstrtou64(argv[2], 16, &addr)) {
+        kprintf("checksum: invalid address '%s'\n", argv[2]);
+        return;
+    }
+    if (!kstrtou64(argv[3], 0, &len)) {
+        kprintf("checksum: invalid length '%s'\n", argv[3]);
+        return;
+    }
+    if (!region_readable(addr, len)) {
+        kprintf("checksum: 0x%llX+%llu is not mapped\n", addr, len);
+        return;
+    }
+
+    const void *data = (const void *)addr;
+    uint64_t cycles;
+    uint64_t start = rdtsc();
+    if (strcmp(algo, "crc32c") == 0) {
+        uint32_t crc = crc32c(0, data, len);
+        cycles = rdtsc() - start;
+        kprintf("crc32c %08X  ", crc);
+    } else if (strcmp(algo, "xxh64") == 0) {
+        uint64_t h = xxh64(data, len, 0);
+        cycles = rdtsc() - start;
+        kprintf("xxh64 %016llX  ", h);
+    } else {
+        uint64_t h = xxh3_64(data, len);
+        cycles = rdtsc() - start;
+        kprintf("xxh3 %016llX  ", h);
+    }
+    kprintf("%llu bytes, ", len);
+    print_rate(len, cycles);
+    kprintf("\n");
+}
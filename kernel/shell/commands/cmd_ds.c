@@ -0,0 +1,577 @@
+/**
+ * @file cmd_ds.c
+ * @brief Container library self-test and microbenchmarks
+ *
+ * "ds test" checks the list, red-black tree, hash table, radix tree and
+ * bitmap code against simple reference answers (sorted arrays, linear
+ * scans), including the tree invariants after every batch of changes.
+ * "ds bench" times the basic operations of each on N random keys and
+ * prints nanoseconds per operation.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <lib/list/list.h>
+#include <lib/rbtree/rbtree.h>
+#include <lib/hashtable/hashtable.h>
+#include <lib/radix/radix.h>
+#include <lib/bitmap/bitmap.h>
+#include <lib/random/random.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <core/initcall.h>
+
+/** @brief Keys used by the self-test */
+#define DS_TEST_KEYS        4096
+
+/** @brief Default and largest benchmark key counts */
+#define DS_BENCH_KEYS       65536
+#define DS_BENCH_MAX_KEYS   131072
+
+/** @brief Bits in the benchmark bitmap */
+#define DS_BITMAP_BITS      (1u << 20)
+
+/** @brief Object carrying every kind of intrusive link */
+typedef struct {
+    uint64_t key;
+    rb_node_t rb;
+    list_node_t link;
+} ds_obj_t;
+
+static uint64_t rng;
+
+static uint64_t next_pow2(uint64_t n) {
+    uint64_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/* ============================================================================
+ * Tree Helpers
+ * ============================================================================ */
+
+static void rb_add(rb_root_t *root, ds_obj_t *obj) {
+    rb_node_t **link = &root->node;
+    rb_node_t *parent = NULL;
+    while (*link) {
+        parent = *link;
+        link = (obj->key < rb_entry(parent, ds_obj_t, rb)->key) ? &parent->left : &parent->right;
+    }
+    rb_link_node(&obj->rb, parent, link);
+    rb_insert_color(&obj->rb, root);
+}
+
+static ds_obj_t *rb_find(const rb_root_t *root, uint64_t key) {
+    rb_node_t *node = root->node;
+    while (node) {
+        ds_obj_t *obj = rb_entry(node, ds_obj_t, rb);
+        if (key == obj->key) {
+            return obj;
+        }
+        node = (key < obj->key) ? node->left : node->right;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Check the red-black rules below a node
+ *
+ * @return Black height, or -1 if a rule is broken
+ */
+static int rb_check(const rb_node_t *node, const rb_node_t *parent) {
+    if (!node) {
+        return 1;
+    }
+    if (node->parent != parent) {
+        return -1;
+    }
+    if (node->color == RB_RED &&
+        ((node->left && node->left->color == RB_RED) ||
+         (node->right && node->right->color == RB_RED))) {
+        return -1;
+    }
+    int left = rb_check(node->left, node);
+    int right = rb_check(node->right, node);
+    if (left < 0 || left != right) {
+        return -1;
+    }
+    return left + (node->color == RB_BLACK);
+}
+
+/* ============================================================================
+ * Self-Test
+ * ============================================================================ */
+
+static bool test_list(ds_obj_t *objs) {
+    list_node_t head = LIST_INIT(head);
+    list_node_t other = LIST_INIT(other);
+
+    for (int i = 0; i < 16; i++) {
+        objs[i].key = (uint64_t)i;
+        list_add_tail(&head, &objs[i].link);
+    }
+    list_for_each_safe(node, &head) {
+        if (list_entry(node, ds_obj_t, link)->key & 1) {
+            list_move_tail(&other, node);
+        }
+    }
+    list_splice_tail(&head, &other);
+
+    /* Evens, then odds, in order */
+    uint64_t expect[16];
+    for (int i = 0; i < 8; i++) {
+        expect[i] = (uint64_t)i * 2;
+        expect[i + 8] = (uint64_t)i * 2 + 1;
+    }
+    int n = 0;
+    list_for_each_entry(obj, &head, ds_obj_t, link) {
+        if (n >= 16 || obj->key != expect[n]) {
+            return false;
+        }
+        n++;
+    }
+    return n == 16 && list_empty(&other);
+}
+
+static bool test_rbtree(ds_obj_t *objs, uint64_t *sorted) {
+    rb_root_t root = RB_ROOT_INIT;
+
+    for (int i = 0; i < DS_TEST_KEYS; i++) {
+        objs[i].key = xorshift64(&rng) % (DS_TEST_KEYS * 2);  /* Duplicates included */
+        sorted[i] = objs[i].key;
+        rb_add(&root, &objs[i]);
+    }
+    if (rb_check(root.node, NULL) < 0) {
+        return false;
+    }
+
+    /* Insertion sort is fine at this size and needs no library */
+    for (int i = 1; i < DS_TEST_KEYS; i++) {
+        uint64_t k = sorted[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > k) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = k;
+    }
+    int i = 0;
+    for (rb_node_t *node = rb_first(&root); node; node = rb_next(node)) {
+        if (i >= DS_TEST_KEYS || rb_entry(node, ds_obj_t, rb)->key != sorted[i++]) {
+            return false;
+        }
+    }
+    if (i != DS_TEST_KEYS) {
+        return false;
+    }
+    for (rb_node_t *node = rb_last(&root); node; node = rb_prev(node)) {
+        if (i <= 0 || rb_entry(node, ds_obj_t, rb)->key != sorted[--i]) {
+            return false;
+        }
+    }
+
+    for (int j = 0; j < DS_TEST_KEYS; j++) {
+        ds_obj_t *obj = &objs[(j * 2053) % DS_TEST_KEYS];   /* Scattered order */
+        if (!rb_find(&root, obj->key)) {
+            return false;
+        }
+        rb_erase(&obj->rb, &root);
+        if (j % 256 == 0 && rb_check(root.node, NULL) < 0) {
+            return false;
+        }
+    }
+    return root.node == NULL;
+}
+
+static bool test_hashtable(uint64_t *present) {
+    static ht_slot_t slots[DS_TEST_KEYS];
+    hashtable_t ht;
+    ht_init(&ht, slots, DS_TEST_KEYS);
+
+    /* present[k] = value + 1 for a stored key, 0 for absent */
+    memset(present, 0, DS_TEST_KEYS * sizeof(uint64_t));
+    for (int it = 0; it < DS_TEST_KEYS * 32; it++) {
+        uint64_t k = xorshift64(&rng) % DS_TEST_KEYS;
+        uint64_t key = k * 4096;        /* Page-aligned keys stress the hash */
+        uint64_t value;
+
+        switch (xorshift64(&rng) % 3) {
+        case 0:
+            value = xorshift64(&rng) >> 1;
+            if (ht_insert(&ht, key, value)) {
+                present[k] = value + 1;
+            } else if (present[k] || ht.count < DS_TEST_KEYS / 8 * 7) {
+                return false;
+            }
+            break;
+        case 1:
+            if (ht_lookup(&ht, key, &value) != (present[k] != 0) ||
+                (present[k] && value != present[k] - 1)) {
+                return false;
+            }
+            break;
+        default:
+            if (ht_remove(&ht, key) != (present[k] != 0)) {
+                return false;
+            }
+            present[k] = 0;
+            break;
+        }
+    }
+    return true;
+}
+
+static bool test_radix(ds_obj_t *objs) {
+    radix_tree_t tree = RADIX_TREE_INIT;
+    uint64_t used_before, used, cached;
+    radix_get_node_counts(&used_before, &cached);
+
+    /* Dense low indexes, sparse ones, and the very top */
+    for (int i = 0; i < DS_TEST_KEYS; i++) {
+        objs[i].key = (i % 4 == 0) ? xorshift64(&rng) :
+                      (i % 4 == 1) ? (uint64_t)i : xorshift64(&rng) % 100000;
+        if (!radix_insert(&tree, objs[i].key, &objs[i])) {
+            return false;
+        }
+    }
+    radix_delete(&tree, objs[0].key);
+    objs[0].key = UINT64_MAX;
+    radix_insert(&tree, UINT64_MAX, &objs[0]);
+
+    for (int i = 0; i < DS_TEST_KEYS; i++) {
+        ds_obj_t *obj = radix_lookup(&tree, objs[i].key);
+        if (!obj || obj->key != objs[i].key) {
+            return false;
+        }
+    }
+
+    /* Ordered walk: every item found again, indexes increasing */
+    uint64_t index = 0;
+    uint64_t start = 0;
+    void *item;
+    while ((item = radix_next(&tree, start, &index)) != NULL) {
+        if (((ds_obj_t *)item)->key != index || index < start) {
+            return false;
+        }
+        if (index == UINT64_MAX) {
+            break;
+        }
+        start = index + 1;
+    }
+    if (index != UINT64_MAX) {
+        return false;
+    }
+
+    for (int i = 0; i < DS_TEST_KEYS; i++) {
+        radix_delete(&tree, objs[i].key);
+    }
+    radix_get_node_counts(&used, &cached);
+    return tree.root == NULL && used == used_before;
+}
+
+static bool test_bitmap(void) {
+    uint64_t map[16];
+
+    for (int round = 0; round < 256; round++) {
+        size_t nbits = 1 + xorshift64(&rng) % 1000;
+        for (int i = 0; i < 16; i++) {
+            map[i] = xorshift64(&rng) & xorshift64(&rng) & xorshift64(&rng);
+            if (round & 1) {
+                map[i] = ~map[i];
+            }
+        }
+
+        size_t start = xorshift64(&rng) % (nbits + 4);
+        size_t set = start;
+        size_t zero = start;
+        while (set < nbits && !bitmap_test(map, set)) {
+            set++;
+        }
+        while (zero < nbits && bitmap_test(map, zero)) {
+            zero++;
+        }
+        if (start >= nbits) {
+            set = zero = nbits;
+        }
+        if (bitmap_find_next_set(map, nbits, start) != set ||
+            bitmap_find_next_zero(map, nbits, start) != zero) {
+            return false;
+        }
+
+        size_t weight = 0;
+        for (size_t i = 0; i < nbits; i++) {
+            weight += bitmap_test(map, i);
+        }
+        if (bitmap_weight(map, nbits) != weight) {
+            return false;
+        }
+
+        size_t len = 1 + xorshift64(&rng) % 8;
+        size_t run = nbits;
+        for (size_t i = start; i + len <= nbits && run == nbits; i++) {
+            size_t j = 0;
+            while (j < len && !bitmap_test(map, i + j)) {
+                j++;
+            }
+            if (j == len) {
+                run = i;
+            }
+        }
+        if (bitmap_find_zero_run(map, nbits, start, len) != run) {
+            return false;
+        }
+
+        size_t from = xorshift64(&rng) % nbits;
+        size_t count = xorshift64(&rng) % (nbits - from + 1);
+        bitmap_set_range(map, from, count);
+        if (count && bitmap_find_next_zero(map, from + count, from) != from + count) {
+            return false;
+        }
+        bitmap_clear_range(map, from, count);
+        if (count && bitmap_find_next_set(map, from + count, from) != from + count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void run_tests(void) {
+    ds_obj_t *objs = vmalloc(DS_TEST_KEYS * sizeof(ds_obj_t));
+    uint64_t *scratch = vmalloc(DS_TEST_KEYS * sizeof(uint64_t));
+    if (!objs || !scratch) {
+        kprintf("ds: out of memory\n");
+        vfree(objs);
+        vfree(scratch);
+        return;
+    }
+
+    rng = 0x9E3779B97F4A7C15ull;
+    kprintf("  list        %s\n", test_list(objs) ? "ok" : "FAIL");
+    kprintf("  rbtree      %s\n", test_rbtree(objs, scratch) ? "ok" : "FAIL");
+    kprintf("  hashtable   %s\n", test_hashtable(scratch) ? "ok" : "FAIL");
+    kprintf("  radix       %s\n", test_radix(objs) ? "ok" : "FAIL");
+    kprintf("  bitmap      %s\n", test_bitmap() ? "ok" : "FAIL");
+
+    vfree(objs);
+    vfree(scratch);
+}
+
+/* ============================================================================
+ * Benchmarks
+ * ============================================================================ */
+
+static void report(const char *what, uint64_t ops, uint64_t cycles) {
+    uint64_t ns = tsc_cycles_to_ns(cycles);
+    kprintf("  %-24s %5llu.%llu ns/op\n", what, ns / ops, ns * 10 / ops % 10);
+}
+
+static void bench_trees(ds_obj_t *objs, uint64_t n) {
+    list_node_t head = LIST_INIT(head);
+    uint64_t t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        list_add_tail(&head, &objs[i].link);
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        list_del(&objs[i].link);
+    }
+    report("list add+del", n, rdtsc() - t);
+
+    rb_root_t root = RB_ROOT_INIT;
+    for (uint64_t i = 0; i < n; i++) {
+        objs[i].key = xorshift64(&rng);
+    }
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        rb_add(&root, &objs[i]);
+    }
+    report("rbtree insert", n, rdtsc() - t);
+
+    uint64_t found = 0;
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        found += rb_find(&root, objs[(i * 7919) % n].key) != NULL;
+    }
+    report("rbtree lookup", n, rdtsc() - t);
+
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        rb_erase(&objs[i].rb, &root);
+    }
+    report("rbtree erase", n, rdtsc() - t);
+    if (found != n) {
+        kprintf("  rbtree lookups missed %llu keys\n", n - found);
+    }
+
+    radix_tree_t tree = RADIX_TREE_INIT;
+    for (uint64_t i = 0; i < n; i++) {
+        objs[i].key = xorshift64(&rng) % (n * 4);      /* Page numbers, 1/4 populated */
+    }
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        radix_insert(&tree, objs[i].key, &objs[i]);
+    }
+    report("radix insert", n, rdtsc() - t);
+
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        found += radix_lookup(&tree, objs[(i * 7919) % n].key) != NULL;
+    }
+    report("radix lookup", n, rdtsc() - t);
+
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        radix_delete(&tree, objs[i].key);
+    }
+    report("radix delete", n, rdtsc() - t);
+    radix_destroy(&tree);
+}
+
+static void bench_hash(uint64_t n) {
+    uint64_t slots_count = next_pow2(n * 2);
+    ht_slot_t *slots = vmalloc(slots_count * sizeof(ht_slot_t));
+    if (!slots) {
+        kprintf("  hashtable: out of memory\n");
+        return;
+    }
+
+    hashtable_t ht;
+    ht_init(&ht, slots, slots_count);
+    uint64_t seed = xorshift64(&rng);
+
+    rng = seed;
+    uint64_t t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        ht_insert(&ht, xorshift64(&rng) >> 1, i);
+    }
+    report("hashtable insert", n, rdtsc() - t);
+
+    rng = seed;
+    uint64_t found = 0;
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        found += ht_lookup(&ht, xorshift64(&rng) >> 1, NULL);
+    }
+    report("hashtable lookup (hit)", n, rdtsc() - t);
+
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        found += ht_lookup(&ht, xorshift64(&rng) >> 1, NULL);
+    }
+    report("hashtable lookup (miss)", n, rdtsc() - t);
+
+    rng = seed;
+    t = rdtsc();
+    for (uint64_t i = 0; i < n; i++) {
+        ht_remove(&ht, xorshift64(&rng) >> 1);
+    }
+    report("hashtable remove", n, rdtsc() - t);
+    vfree(slots);
+
+    static uint8_t buf[4096];
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t)xorshift64(&rng);
+    }
+    uint64_t h = 0;
+    uint64_t rounds = 1024;
+    t = rdtsc();
+    for (uint64_t i = 0; i < rounds; i++) {
+        h ^= hash_bytes(buf, sizeof(buf), i);
+    }
+    uint64_t ns = tsc_cycles_to_ns(rdtsc() - t);
+    if (ns) {
+        kprintf("  %-24s %5llu MB/s (%llx)\n", "wyhash 4KB", rounds * sizeof(buf) * 1000 / ns, h);
+    }
+}
+
+static void bench_bitmap(void) {
+    uint64_t *map = vmalloc(BITMAP_WORDS(DS_BITMAP_BITS) * sizeof(uint64_t));
+    if (!map) {
+        kprintf("  bitmap: out of memory\n");
+        return;
+    }
+
+    /* About one set bit per 64, like a mostly free frame bitmap */
+    memset(map, 0, BITMAP_WORDS(DS_BITMAP_BITS) * sizeof(uint64_t));
+    for (uint32_t i = 0; i < DS_BITMAP_BITS / 64; i++) {
+        bitmap_set(map, xorshift64(&rng) % DS_BITMAP_BITS);
+    }
+
+    uint64_t bits = 0;
+    uint64_t t = rdtsc();
+    for (size_t b = bitmap_find_first_set(map, DS_BITMAP_BITS); b < DS_BITMAP_BITS;
+         b = bitmap_find_next_set(map, DS_BITMAP_BITS, b + 1)) {
+        bits++;
+    }
+    report("bitmap next-set walk", bits ? bits : 1, rdtsc() - t);
+
+    uint64_t weight = 0;
+    t = rdtsc();
+    for (int i = 0; i < 16; i++) {
+        weight += bitmap_weight(map, DS_BITMAP_BITS);
+    }
+    uint64_t ns = tsc_cycles_to_ns(rdtsc() - t);
+    if (ns) {
+        kprintf("  %-24s %5llu MB/s (%s)\n", "bitmap weight",
+                16ull * DS_BITMAP_BITS / 8 * 1000 / ns,
+                cpu_has(CPU_FEAT_POPCNT) ? "popcnt" : "swar");
+    }
+    if (weight != bits * 16) {
+        kprintf("  bitmap weight mismatch: %llu vs %llu\n", weight / 16, bits);
+    }
+    vfree(map);
+}
+
+static void run_bench(uint64_t n) {
+    ds_obj_t *objs = vmalloc(n * sizeof(ds_obj_t));
+    if (!objs) {
+        kprintf("ds: cannot allocate %llu objects\n", n);
+        return;
+    }
+
+    rng = 0x2545F4914F6CDD1Dull;
+    kprintf("\n%llu keys:\n", n);
+    bench_trees(objs, n);
+    bench_hash(n);
+    bench_bitmap();
+    kprintf("\n");
+    vfree(objs);
+}
+
+/**
+ * @brief Ds command handler
+ *
+ * Usage:
+ *   ds test        - Check every container against reference answers
+ *   ds bench [N]   - Time the operations on N keys (default 65536)
+ */
+void cmd_ds(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "test") == 0) {
+        run_tests();
+    } else if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        uint64_t n = DS_BENCH_KEYS;
+        if (argc >= 3 && (!kstrtou64(argv[2], 10, &n) || n == 0 || n > DS_BENCH_MAX_KEYS)) {
+            kprintf("Usage: ds bench [1..%d]\n", DS_BENCH_MAX_KEYS);
+            return;
+        }
+        run_bench(n);
+    } else {
+        kprintf("Usage: ds [test | bench [N]]\n");
+    }
+}
+
+/* ============================================================================
+ * Module Registration
+ * ============================================================================ */
+
+/* Runs at boot when linked in, on first use when built as a module */
+static bool ds_register(void) {
+    shell_register_command("ds", "Container self-test/benchmarks", cmd_ds);
+    return true;
+}
+DEFINE_INITCALL(ds, ds_register, "", 0);
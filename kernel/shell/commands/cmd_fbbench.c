@@ -0,0 +1,181 @@
+/**
+ * @file cmd_fbbench.c
+ * @brief Framebuffer console benchmark command
+ *
+ * Measures glyph throughput (cells drawn and flushed per second) and the
+ * cost of a full-screen scroll for each blitter the CPU supports, then
+ * full-screen redraw bandwidth with video memory mapped uncached versus
+ * write-combining. The screen is overwritten during the run and cleared
+ * before the results are printed.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <drivers/vga/vga_text.h>
+#include <drivers/fb/fb.h>
+#include <drivers/fb/fb_console.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/paging.h>
+
+/** @brief Full screens of glyphs drawn per blitter */
+#define GLYPH_SCREENS       8
+
+/** @brief Full-screen scrolls per blitter */
+#define SCROLL_COUNT        64
+
+/** @brief Full-screen redraws per memory type */
+#define REDRAW_COUNT        32
+
+/**
+ * @brief Results for one blitter
+ */
+typedef struct {
+    bool supported;
+    uint64_t glyph_cycles;
+    uint64_t scroll_cycles;
+} fbbench_result_t;
+
+/**
+ * @brief Fill every cell, screen after screen, flushing once per screen
+ */
+static uint64_t bench_glyphs(int cols, int rows) {
+    uint64_t start = rdtsc();
+    for (int screen = 0; screen < GLYPH_SCREENS; screen++) {
+        for (int y = 0; y < rows; y++) {
+            for (int x = 0; x < cols; x++) {
+                char c = (char)('!' + (x + y + screen) % 94);
+                uint8_t attr = (uint8_t)(0x01 + (y + screen) % 15);
+                fbcon_putc(x, y, c, attr);
+            }
+        }
+        fbcon_flush();
+    }
+    return rdtsc() - start;
+}
+
+/**
+ * @brief Scroll one text row at a time, flushing after each scroll
+ */
+static uint64_t bench_scroll(void) {
+    uint64_t start = rdtsc();
+    for (int i = 0; i < SCROLL_COUNT; i++) {
+        fbcon_scroll(0x07);
+        fbcon_flush();
+    }
+    return rdtsc() - start;
+}
+
+/**
+ * @brief Copy the whole back buffer to video memory repeatedly
+ */
+static uint64_t bench_redraw(const fb_info_t *info) {
+    uint64_t start = rdtsc();
+    for (int i = 0; i < REDRAW_COUNT; i++) {
+        fb_damage(0, 0, (int)info->width, (int)info->height);
+        fb_flush();
+    }
+    return rdtsc() - start;
+}
+
+/**
+ * @brief Print a bandwidth figure in MB/s
+ */
+static void print_mbps(uint64_t bytes, uint64_t cycles) {
+    if (cycles == 0) {
+        cycles = 1;
+    }
+    uint64_t centi = bytes * tsc_khz() * 1000 / cycles * 100 / (1024 * 1024);
+    kprintf("%llu.%02llu MB/s", centi / 100, centi % 100);
+}
+
+/**
+ * @brief Framebuffer benchmark command handler
+ *
+ * Usage:
+ *   fbbench   - Run glyph and scroll benchmarks for each blitter
+ */
+void cmd_fbbench(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+    
+    if (!fbcon_active()) {
+        kprintf("No framebuffer console (stage 2 kept VGA text mode)\n");
+        return;
+    }
+
+    const fb_info_t *info = fb_get_info();
+    int cols = fbcon_cols();
+    int rows = fbcon_rows();
+    fb_blitter_t saved = fb_get_blitter();
+    fbbench_result_t results[FB_BLIT_COUNT];
+    uint64_t hits0, renders0, hits1, renders1;
+    uint64_t flushes0, bytes0, flushes1, bytes1;
+
+    fbcon_cache_stats(&hits0, &renders0);
+    fb_stats(&flushes0, &bytes0);
+
+    for (int b = 0; b < FB_BLIT_COUNT; b++) {
+        results[b].supported = fb_set_blitter((fb_blitter_t)b);
+        if (!results[b].supported) {
+            continue;
+        }
+        results[b].glyph_cycles = bench_glyphs(cols, rows);
+        results[b].scroll_cycles = bench_scroll();
+    }
+
+    fbcon_cache_stats(&hits1, &renders1);
+    fb_stats(&flushes1, &bytes1);
+    fb_set_blitter(saved);
+
+    /* Same redraw with video memory uncached, then write-combining */
+    bool was_wc = fb_write_combining();
+    uint64_t redraw_uc = 0, redraw_wc = 0;
+    bool have_wc = paging_wc_supported();
+    if (fb_set_write_combining(false)) {
+        redraw_uc = bench_redraw(info);
+    }
+    if (have_wc && fb_set_write_combining(true)) {
+        redraw_wc = bench_redraw(info);
+    }
+    fb_set_write_combining(was_wc);
+
+    vga_clear();
+
+    uint64_t glyphs = (uint64_t)GLYPH_SCREENS * cols * rows;
+    kprintf("\nFramebuffer %ux%ux%u, %dx%d cells, pitch %u\n",
+            info->width, info->height, info->bpp, cols, rows, info->pitch);
+    kprintf("%-8s %14s %16s\n", "blitter", "glyphs/sec", "scroll (us)");
+
+    for (int b = 0; b < FB_BLIT_COUNT; b++) {
+        if (!results[b].supported) {
+            kprintf("%-8s %14s\n", fb_blitter_name((fb_blitter_t)b), "unsupported");
+            continue;
+        }
+        uint64_t gcycles = results[b].glyph_cycles ? results[b].glyph_cycles : 1;
+        kprintf("%-8s %14llu %16llu%s\n", fb_blitter_name((fb_blitter_t)b),
+                glyphs * tsc_khz() * 1000 / gcycles,
+                tsc_cycles_to_us(results[b].scroll_cycles) / SCROLL_COUNT,
+                (fb_blitter_t)b == saved ? "  (active)" : "");
+    }
+
+    kprintf("\nGlyph cache: %llu hits, %llu renders; %llu flushes, %llu KB to VRAM\n",
+            hits1 - hits0, renders1 - renders0,
+            flushes1 - flushes0, (bytes1 - bytes0) / 1024);
+
+    uint64_t frame = (uint64_t)info->width * info->height * 4 * REDRAW_COUNT;
+    kprintf("\nFull-screen redraw (%s, MTRR %s):\n",
+            fb_blitter_name(saved), memtype_name(mtrr_get_type(info->phys)));
+    kprintf("  UC: ");
+    print_mbps(frame, redraw_uc);
+    kprintf("\n  WC: ");
+    if (redraw_wc) {
+        print_mbps(frame, redraw_wc);
+        if (redraw_uc) {
+            kprintf("  (%llux faster)", redraw_uc / redraw_wc);
+        }
+    } else {
+        kprintf("unavailable (no PAT)");
+    }
+    kprintf("\n\n");
+}
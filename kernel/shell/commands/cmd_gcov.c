@@ -0,0 +1,70 @@
+/**
+ * @file cmd_gcov.c
+ * @brief Profile counters of a "make pgo" training kernel
+ *
+ * "gcov" shows what the -fprofile-generate build is counting, "gcov
+ * reset" starts the profile over and "gcov export" writes the .gcda
+ * files to debugcon or COM1, where scripts/pgo.py extracts them for the
+ * -fprofile-use build.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <core/gcov.h>
+
+static void show_gcov(void) {
+    gcov_summary_t s;
+
+    gcov_get_summary(&s);
+    kprintf("\nObjects:    %u (%u functions, %llu arc counters)\n", s.objects,
+            s.functions, s.counters);
+    kprintf("Hottest:    %llu executions of one arc\n", s.max_count);
+    kprintf("Export:     %llu KB of .gcda data\n\n", s.export_bytes >> 10);
+}
+
+/**
+ * @brief Gcov command handler
+ *
+ * Usage:
+ *   gcov                              - Objects and counters
+ *   gcov reset                        - Zero every counter
+ *   gcov export [debugcon|serial]     - Write the .gcda files
+ */
+void cmd_gcov(int argc, char *argv[]) {
+    if (!gcov_enabled()) {
+        kprintf("gcov: not a profiling kernel (make pgo builds one)\n");
+        return;
+    }
+
+    if (argc < 2) {
+        show_gcov();
+        return;
+    }
+
+    if (strcmp(argv[1], "reset") == 0) {
+        gcov_reset();
+        kprintf("Profile counters cleared\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "export") == 0) {
+        gcov_sink_t sink = GCOV_SINK_AUTO;
+        if (argc >= 3 && strcmp(argv[2], "debugcon") == 0) {
+            sink = GCOV_SINK_DEBUGCON;
+        } else if (argc >= 3 && strcmp(argv[2], "serial") == 0) {
+            sink = GCOV_SINK_SERIAL;
+        } else if (argc >= 3) {
+            kprintf("gcov: export to debugcon or serial\n");
+            return;
+        }
+        if (!gcov_export(sink)) {
+            kprintf("gcov: no debug console\n");
+            return;
+        }
+        kprintf("Profile exported\n");
+        return;
+    }
+
+    kprintf("Usage: gcov [reset | export [debugcon|serial]]\n");
+}
@@ -8,6 +8,7 @@
 #include <shell/shell.h>
 #include <lib/printf/printf.h>
 #include <lib/string/string.h>
+#include <core/module.h>
 
 /**
  * @brief Command entry structure (mirrored from shell.c)
@@ -21,6 +22,9 @@ typedef struct {
 /* Defined in shell.c */
 extern int shell_get_commands(const shell_command_t **out_commands);
 
+/** @brief Archive entries listed */
+#define HELP_MAX_MODULES    16
+
 /**
  * @brief Help command handler
  * 
@@ -42,5 +46,23 @@ void cmd_help(int argc, char *argv[]) {
         kprintf("  %-10s - %s\n", commands[i].name, commands[i].help);
     }
     
+    /* Commands still on disk, loaded the first time they are typed */
+    module_entry_t mods[HELP_MAX_MODULES];
+    int n = module_list(mods, HELP_MAX_MODULES);
+    bool header = false;
+    for (int i = 0; i < n && i < HELP_MAX_MODULES; i++) {
+        if (module_find(mods[i].name)) {
+            continue;
+        }
+        if (!header) {
+            kprintf("\nLoaded on first use:");
+            header = true;
+        }
+        kprintf(" %s", mods[i].name);
+    }
+    if (header) {
+        kprintf("\n");
+    }
+    
     kprintf("\n");
 }
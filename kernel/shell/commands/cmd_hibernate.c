@@ -0,0 +1,133 @@
+/**
+ * @file cmd_hibernate.c
+ * @brief Hibernation to disk
+ *
+ * "hibernate" writes a snapshot of memory to the boot disk and carries
+ * on; every later boot of this kernel resumes from it, comes back out of
+ * this command and reports how long resuming took next to the cold boot
+ * the snapshot was taken in. "hibernate info" shows the image on disk,
+ * "hibernate discard" removes it.
+ */
+
+#include <shell/shell.h>
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <core/hibernate.h>
+
+/**
+ * @brief Print nanoseconds as milliseconds with three decimals
+ */
+static void print_ms(uint64_t ns) {
+    kprintf("%5llu.%03llu ms", ns / 1000000, ns / 1000 % 1000);
+}
+
+static void show_save(const hibernate_save_stats_t *s) {
+    kprintf("  Pages:       %llu (%llu zero, %llu stored raw)\n", s->pages, s->zero_pages,
+            s->raw_pages);
+    kprintf("  Image:       %llu KB (%llu%% of the pages saved)\n", s->image_bytes >> 10,
+            s->pages ? s->image_bytes * 100 / (s->pages * 4096) : 0);
+    kprintf("  Written in: ");
+    print_ms(s->save_ns);
+    kprintf("\n");
+}
+
+static void show_resume(const hibernate_resume_stats_t *r) {
+    kprintf("  Pages:       %llu (%llu in place, %llu staged), %llu KB read\n", r->pages,
+            r->direct_pages, r->staged_pages, r->image_bytes >> 10);
+    kprintf("  Boot:       ");
+    print_ms(r->boot_ns);
+    kprintf("  power-on until the image was found\n");
+    kprintf("  Load:       ");
+    print_ms(r->load_ns);
+    kprintf("  reading and decompressing\n");
+    kprintf("  Copy:       ");
+    print_ms(r->copy_ns);
+    kprintf("  staged pages into place\n");
+    kprintf("  Devices:    ");
+    print_ms(r->devices_ns);
+    kprintf("  resume steps\n");
+    kprintf("  Resumed:    ");
+    print_ms(r->total_ns);
+    kprintf("  power-on to prompt\n");
+    kprintf("  Cold boot:  ");
+    print_ms(r->cold_ns);
+    kprintf("  power-on to prompt");
+    if (r->total_ns > 0) {
+        uint64_t x10 = r->cold_ns * 10 / r->total_ns;
+        kprintf(" (resume is %llu.%llux faster)", x10 / 10, x10 % 10);
+    }
+    kprintf("\n");
+}
+
+static void show_info(void) {
+    hibernate_image_t img;
+    hibernate_save_stats_t s;
+    hibernate_resume_stats_t r;
+
+    kprintf("\nImage (LBA %u): ", HIBERNATE_LBA);
+    if (!hibernate_image_info(&img)) {
+        kprintf("no disk\n");
+    } else if (!img.valid) {
+        kprintf("none\n");
+    } else {
+        kprintf("%llu pages, %llu KB, %llu MB RAM%s\n", img.pages, img.image_bytes >> 10,
+                img.mem_top >> 20, img.usable ? "" : " (not for this kernel)");
+    }
+
+    if (hibernate_get_save_stats(&s)) {
+        kprintf("\nLast snapshot:\n");
+        show_save(&s);
+    }
+    if (hibernate_get_resume_stats(&r)) {
+        kprintf("\nResumed this boot:\n");
+        show_resume(&r);
+    }
+    kprintf("\n");
+}
+
+/**
+ * @brief Hibernate command handler
+ *
+ * Usage:
+ *   hibernate            - Write a snapshot (resumed at every later boot)
+ *   hibernate info       - Image on disk, last snapshot and resume
+ *   hibernate discard    - Remove the image, so the next boot starts cold
+ */
+void cmd_hibernate(int argc, char *argv[]) {
+    if (argc < 2) {
+        hibernate_save_stats_t s;
+        hibernate_resume_stats_t r;
+
+        switch (hibernate_snapshot()) {
+        case HIBERNATE_SAVED:
+            hibernate_get_save_stats(&s);
+            kprintf("Snapshot written; later boots resume here\n");
+            show_save(&s);
+            break;
+        case HIBERNATE_RESUMED:
+            hibernate_get_resume_stats(&r);
+            kprintf("Resumed from the snapshot\n");
+            show_resume(&r);
+            break;
+        default:
+            break;
+        }
+        return;
+    }
+
+    if (strcmp(argv[1], "info") == 0) {
+        show_info();
+        return;
+    }
+    if (strcmp(argv[1], "discard") == 0) {
+        if (hibernate_discard()) {
+            kprintf("Image discarded; the next boot starts cold\n");
+        } else {
+            kprintf("hibernate: disk write failed\n");
+        }
+        return;
+    }
+
+    kprintf("Usage: hibernate [info|discard]\n");
+}
@@ -0,0 +1,50 @@
+/**
+ * @file cmd_irqlat.c
+ * @brief Interrupt latency report
+ *
+ * Prints percentiles of the timer interrupt latency (PIT edge to
+ * handler, see pit.h) and of the time spent in interrupt handlers,
+ * merged over all CPUs.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/histogram/histogram.h>
+#include <arch/x86_64/cpu/irq.h>
+#include <arch/x86_64/cpu/pit.h>
+
+/** @brief Merge target (too large for the stack) */
+static histogram_t merged;
+
+/**
+ * @brief Irqlat command handler
+ *
+ * Usage:
+ *   irqlat         - Show latency and handler time percentiles (ns)
+ *   irqlat reset   - Clear both histograms
+ */
+void cmd_irqlat(int argc, char *argv[]) {
+    char summary[160];
+
+    if (argc >= 2) {
+        if (strcmp(argv[1], "reset") == 0) {
+            pit_reset_latency();
+            irq_reset_handler_hist();
+            kprintf("Interrupt latency histograms cleared\n");
+        } else {
+            kprintf("Usage: irqlat [reset]\n");
+        }
+        return;
+    }
+
+    kprintf("\nInterrupt latency (ns):\n");
+
+    pit_get_latency(&merged);
+    hist_format(&merged, 1, summary, sizeof(summary));
+    kprintf("  timer edge -> handler  %s\n", summary);
+
+    irq_get_handler_hist(&merged);
+    hist_format(&merged, 1, summary, sizeof(summary));
+    kprintf("  handler duration       %s\n\n", summary);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file cmd_kdump.c
+ * @brief Crash dump settings
+ *
+ * "kdump" shows where a crash would be dumped and whether the disk holds
+ * a dump from an earlier crash. "kdump sink" and "kdump memory" change
+ * the settings; "kdump crash" executes an invalid instruction to try
+ * the whole path, and scripts/kdump2core.py (make kdump) reads the
+ * result.
+ */
+
+#include <shell/shell.h>
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <core/kdump.h>
+
+static const char *memory_names[] = { "auto", "on", "off" };
+
+static void show_kdump(void) {
+    kdump_disk_info_t info;
+    kdump_sink_t sink = kdump_get_sink();
+    kdump_sink_t now = kdump_current_sink();
+    kdump_memory_t memory = kdump_get_memory();
+
+    kprintf("\nSink:    %s", kdump_sink_name(sink));
+    if (sink == KDUMP_SINK_AUTO) {
+        kprintf(" (%s now)", kdump_sink_name(now));
+    }
+    kprintf("\nMemory:  %s", memory_names[memory]);
+    if (memory == KDUMP_MEMORY_AUTO) {
+        kprintf(" (%s)", now == KDUMP_SINK_VIRTIO || now == KDUMP_SINK_DISK ?
+                "pages in use" : "registers, stack and log only");
+    }
+    kprintf("\nLog:     last %u bytes of console output\n", CONSOLE_LOG_SIZE);
+
+    kprintf("\nDisk (LBA %u): ", KDUMP_LBA);
+    if (kdump_disk_info(&info)) {
+        kprintf("%s, %llu.%03llu s after power-on%s\n", info.header.reason,
+                info.uptime_ms / 1000, info.uptime_ms % 1000,
+                (info.header.flags & KDUMP_F_MEMORY) ? ", with memory" : "");
+    } else {
+        kprintf("no dump\n");
+    }
+    kprintf("\n");
+}
+
+/**
+ * @brief Kdump command handler
+ *
+ * Usage:
+ *   kdump                             - Settings and the dump on disk
+ *   kdump sink <auto|virtio|disk|serial|none>
+ *   kdump memory <auto|on|off>        - Include the pages in use
+ *   kdump crash                       - Crash now (invalid opcode)
+ */
+void cmd_kdump(int argc, char *argv[]) {
+    if (argc < 2) {
+        show_kdump();
+        return;
+    }
+
+    if (strcmp(argv[1], "sink") == 0 && argc >= 3) {
+        kdump_sink_t sink;
+        if (!kdump_parse_sink(argv[2], &sink)) {
+            kprintf("kdump: unknown sink '%s'\n", argv[2]);
+            return;
+        }
+        kdump_set_sink(sink);
+        kprintf("Crash dumps go to %s\n", kdump_sink_name(kdump_current_sink()));
+        return;
+    }
+
+    if (strcmp(argv[1], "memory") == 0 && argc >= 3) {
+        for (int m = KDUMP_MEMORY_AUTO; m <= KDUMP_MEMORY_OFF; m++) {
+            if (strcmp(argv[2], memory_names[m]) == 0) {
+                kdump_set_memory((kdump_memory_t)m);
+                return;
+            }
+        }
+        kprintf("kdump: memory is auto, on or off\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "crash") == 0) {
+        __asm__ volatile("ud2");
+        return;
+    }
+
+    kprintf("Usage: kdump [sink <auto|virtio|disk|serial|none> | memory <auto|on|off> | crash]\n");
+}
@@ -0,0 +1,152 @@
+/**
+ * @file cmd_ksm.c
+ * @brief Same-page merging control and report
+ *
+ * Without arguments, prints how many frames are shared and by how many
+ * mappings, the memory saved and what the scanner cost in CPU time.
+ * "ksm test" builds an area full of duplicate and zero pages, scans it
+ * until merged, then writes to every page (copy-on-write) and checks
+ * the contents.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <arch/x86_64/mm/ksm.h>
+#include <core/stat.h>
+
+/** @brief Distinct non-zero contents in the test area */
+#define KSM_TEST_PATTERNS   8
+
+/** @brief Pages per ksm_scan() call in the test (keeps interrupts-off spans short) */
+#define KSM_TEST_BATCH      256
+
+static uint64_t stat_value(const char *name) {
+    const stat_desc_t *stat = stat_find(name);
+    return stat ? stat_read(stat) : 0;
+}
+
+static void show_status(void) {
+    ksm_stats_t k;
+    ksm_get_stats(&k);
+
+    uint64_t scanned = stat_value("ksm_pages_scanned");
+    uint64_t ns = stat_value("ksm_scan_ns");
+
+    kprintf("\nSame-page merging: %s (%d pages every %d ms)\n",
+            ksm_enabled() ? "on" : "off", KSM_PAGES_PER_RUN, KSM_SLEEP_US / 1000);
+    kprintf("  pages shared      %llu\n", k.shared);
+    kprintf("  pages sharing     %llu\n", k.sharing);
+    kprintf("  zero pages        %llu\n", k.zero);
+    kprintf("  memory saved      %llu KB\n", (k.sharing - k.shared + k.zero) * 4);
+    kprintf("  full scans        %llu\n", k.full_scans);
+    kprintf("  pages scanned     %llu in %llu us", scanned, ns / 1000);
+    if (scanned) {
+        kprintf(" (%llu ns/page)", ns / scanned);
+    }
+    kprintf("\n  copy-on-write     %llu\n\n", stat_value("cow_faults"));
+}
+
+/**
+ * @brief Content of test page i: zero, or one of a few patterns
+ */
+static void fill_page(uint8_t *page, uint64_t i) {
+    uint64_t pattern = i % (KSM_TEST_PATTERNS + 1);
+    memset(page, 0, 4096);
+    if (pattern) {
+        for (int b = 0; b < 4096; b += 8) {
+            page[b] = (uint8_t)pattern;
+        }
+    }
+}
+
+static void run_test(uint64_t mb) {
+    static uint8_t expect[4096];
+    uint64_t pages = mb * 256;
+
+    uint8_t *area = vmalloc(pages * 4096);
+    if (!area) {
+        kprintf("ksm: cannot reserve %llu MB\n", mb);
+        return;
+    }
+
+    /* 4KB pages only: 2MB pages are not scanned */
+    bool thp = vmalloc_thp_enabled();
+    vmalloc_set_thp(false);
+    for (uint64_t i = 0; i < pages; i++) {
+        fill_page(area + i * 4096, i);
+    }
+    vmalloc_set_thp(thp);
+
+    ksm_stats_t before;
+    ksm_get_stats(&before);
+    uint64_t ns_before = stat_value("ksm_scan_ns");
+    uint64_t scanned = 0;
+
+    /* Two full passes: one to find candidates, one to catch the rest */
+    ksm_stats_t now = before;
+    while (now.full_scans < before.full_scans + 2) {
+        uint64_t n = ksm_scan(KSM_TEST_BATCH);
+        scanned += n;
+        ksm_get_stats(&now);
+        if (n == 0 && now.full_scans == before.full_scans) {
+            break;
+        }
+    }
+    uint64_t scan_ns = stat_value("ksm_scan_ns") - ns_before;
+
+    uint64_t cow_before = stat_value("cow_faults");
+    uint64_t bad = 0;
+    for (uint64_t i = 0; i < pages; i++) {
+        fill_page(expect, i);
+        if (memcmp(area + i * 4096, expect, sizeof(expect)) != 0) {
+            bad++;
+        }
+        area[i * 4096 + 1] = 0xAA;     /* Unshares the page */
+        if (area[i * 4096] != expect[0] || area[i * 4096 + 1] != 0xAA) {
+            bad++;
+        }
+    }
+    uint64_t cows = stat_value("cow_faults") - cow_before;
+    vfree(area);
+
+    kprintf("\n%llu MB, %llu pages (%d patterns + zero):\n", mb, pages, KSM_TEST_PATTERNS);
+    kprintf("  scanned         %llu pages in %llu us", scanned, scan_ns / 1000);
+    if (scanned) {
+        kprintf(" (%llu ns/page)", scan_ns / scanned);
+    }
+    kprintf("\n  merged          %llu onto %llu frames, %llu zero\n",
+            now.sharing - before.sharing, now.shared - before.shared, now.zero - before.zero);
+    kprintf("  copy-on-write   %llu faults\n", cows);
+    kprintf("  contents        %s\n\n", bad ? "CORRUPT" : "ok");
+}
+
+/**
+ * @brief Ksm command handler
+ *
+ * Usage:
+ *   ksm             - Sharing counters and scanner cost
+ *   ksm on | off    - Start or stop background scanning
+ *   ksm test [MB]   - Merge a duplicate-heavy area, then unshare it
+ */
+void cmd_ksm(int argc, char *argv[]) {
+    if (argc == 1) {
+        show_status();
+    } else if (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0) {
+        ksm_set_enabled(argv[1][1] == 'n');
+        kprintf("Same-page merging: %s\n", ksm_enabled() ? "on" : "off");
+    } else if (strcmp(argv[1], "test") == 0) {
+        uint64_t mb = 4;
+        if (argc >= 3 && (!kstrtou64(argv[2], 10, &mb) || mb == 0)) {
+            kprintf("Usage: ksm test [MB]\n");
+            return;
+        }
+        run_test(mb);
+    } else {
+        kprintf("Usage: ksm [on | off | test [MB]]\n");
+    }
+}
@@ -0,0 +1,488 @@
+/**
+ * @file cmd_membench.c
+ * @brief Memory bandwidth (STREAM) and latency (pointer chase) benchmark
+ *
+ * STREAM:
+ *   The four kernels of McCalpin's STREAM over three arrays a, b, c:
+ *     copy   c = a            16 bytes moved per element
+ *     scale  b = q * c        16
+ *     add    c = a + b        24
+ *     triad  a = b + q * c    24
+ *   Elements are 64-bit integers rather than doubles (the kernel does
+ *   no floating point); the traffic per element is the same. Each kernel
+ *   runs STREAM_TRIALS times, the first trial is dropped and the best of
+ *   the rest is reported, as STREAM does. The arrays are checked against
+ *   the expected values afterwards.
+ *
+ *   The element range is split evenly across the online CPUs, each CPU
+ *   running the kernel over its own slice. Only the boot CPU is started
+ *   today, so it gets the whole range.
+ *
+ * LATENCY:
+ *   Every 64-byte line of a working set holds a pointer to the next one
+ *   in a single cycle through a shuffled line order, so each load depends
+ *   on the previous one and the prefetchers cannot guess the address.
+ *   The time per load is measured for working sets from 4KB up to the
+ *   requested size in steps of 1x and 1.5x powers of two. Latency rises
+ *   in steps as the set outgrows each cache level; a step is reported
+ *   where the latency jumps by more than LAT_STEP_PCT over the previous
+ *   plateau, and the next one is looked for once the latency settles.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/random/random.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <core/initcall.h>
+
+/** @brief Default and largest STREAM array size (MB per array) */
+#define STREAM_DEFAULT_MB   8
+#define STREAM_MAX_MB       256
+
+/** @brief Timed runs per kernel (the first is a warm-up) */
+#define STREAM_TRIALS       6
+
+/** @brief STREAM scale factor */
+#define STREAM_Q            3
+
+/** @brief Default and largest latency working set (MB) */
+#define LAT_DEFAULT_MB      32
+#define LAT_MAX_MB          512
+
+/** @brief Dependent loads per timed pass, and passes per working-set size */
+#define LAT_LOADS           (1u << 19)
+#define LAT_PASSES          4
+
+/** @brief Bytes per chase node (one cache line) */
+#define LAT_LINE            64
+
+/** @brief Latency rise that starts a new level, and the spread of a plateau */
+#define LAT_STEP_PCT        60
+#define LAT_FLAT_PCT        15
+
+/** @brief Most working-set sizes measured (4KB .. 512MB in 1.5x steps) */
+#define LAT_MAX_POINTS      40
+
+/** @brief Width of the staircase bars */
+#define LAT_BAR_WIDTH       40
+
+/** @brief Free memory left over for the rest of the system (MB) */
+#define MEMBENCH_RESERVE_MB 8
+
+/**
+ * @brief Check that size bytes can be populated without starving the system
+ */
+static bool memory_available(uint64_t size) {
+    pmm_stats_t mem;
+    pmm_get_stats(&mem);
+    uint64_t free = mem.free * PMM_FRAME_SIZE;
+    uint64_t reserve = (uint64_t)MEMBENCH_RESERVE_MB << 20;
+    if (free < reserve || size > free - reserve) {
+        kprintf("membench: %llu MB needed, %llu MB free\n", size >> 20, free >> 20);
+        return false;
+    }
+    return true;
+}
+
+/* ============================================================================
+ * STREAM
+ * ============================================================================ */
+
+typedef enum {
+    STREAM_COPY,
+    STREAM_SCALE,
+    STREAM_ADD,
+    STREAM_TRIAD,
+    STREAM_KERNELS
+} stream_kernel_t;
+
+static const char *const stream_names[STREAM_KERNELS] = {
+    "copy", "scale", "add", "triad"
+};
+
+/** @brief Arrays touched per element (reads plus the write) */
+static const uint64_t stream_arrays[STREAM_KERNELS] = { 2, 2, 3, 3 };
+
+typedef struct {
+    uint64_t *a;
+    uint64_t *b;
+    uint64_t *c;
+} stream_arrays_t;
+
+/**
+ * @brief Run one kernel over elements [lo, hi)
+ */
+static void stream_slice(const stream_arrays_t *s, stream_kernel_t k, size_t lo, size_t hi) {
+    uint64_t *a = s->a;
+    uint64_t *b = s->b;
+    uint64_t *c = s->c;
+
+    switch (k) {
+    case STREAM_COPY:
+        for (size_t j = lo; j < hi; j++) {
+            c[j] = a[j];
+        }
+        break;
+    case STREAM_SCALE:
+        for (size_t j = lo; j < hi; j++) {
+            b[j] = STREAM_Q * c[j];
+        }
+        break;
+    case STREAM_ADD:
+        for (size_t j = lo; j < hi; j++) {
+            c[j] = a[j] + b[j];
+        }
+        break;
+    case STREAM_TRIAD:
+        for (size_t j = lo; j < hi; j++) {
+            a[j] = b[j] + STREAM_Q * c[j];
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Run one kernel over all n elements, one slice per online CPU
+ */
+static void stream_run(const stream_arrays_t *s, stream_kernel_t k, size_t n, int cpus) {
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        size_t lo = n * cpu / cpus;
+        size_t hi = n * (cpu + 1) / cpus;
+        stream_slice(s, k, lo, hi);
+    }
+}
+
+/**
+ * @brief Check every element against the values the kernels must produce
+ */
+static bool stream_verify(const stream_arrays_t *s, size_t n, int runs) {
+    uint64_t a = 1;
+    uint64_t b = 2;
+    uint64_t c = 0;
+    for (int r = 0; r < runs; r++) {
+        c = a;
+        b = STREAM_Q * c;
+        c = a + b;
+        a = b + STREAM_Q * c;
+    }
+    for (size_t j = 0; j < n; j++) {
+        if (s->a[j] != a || s->b[j] != b || s->c[j] != c) {
+            kprintf("membench: element %llu is wrong\n", (uint64_t)j);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void run_stream(uint64_t mb) {
+    uint64_t bytes = mb << 20;
+    size_t n = bytes / sizeof(uint64_t);
+    int cpus = cpu_count();
+
+    if (!memory_available(3 * bytes)) {
+        return;
+    }
+
+    stream_arrays_t s;
+    s.a = vmalloc(bytes);
+    s.b = vmalloc(bytes);
+    s.c = vmalloc(bytes);
+    if (!s.a || !s.b || !s.c) {
+        kprintf("membench: cannot reserve 3 x %llu MB\n", mb);
+        vfree(s.a);
+        vfree(s.b);
+        vfree(s.c);
+        return;
+    }
+
+    /* Populate every page before timing anything */
+    for (size_t j = 0; j < n; j++) {
+        s.a[j] = 1;
+        s.b[j] = 2;
+        s.c[j] = 0;
+    }
+
+    uint64_t best[STREAM_KERNELS];
+    uint64_t worst[STREAM_KERNELS];
+    uint64_t total[STREAM_KERNELS];
+    for (int k = 0; k < STREAM_KERNELS; k++) {
+        best[k] = UINT64_MAX;
+        worst[k] = 0;
+        total[k] = 0;
+    }
+
+    for (int trial = 0; trial < STREAM_TRIALS; trial++) {
+        for (int k = 0; k < STREAM_KERNELS; k++) {
+            uint64_t start = rdtsc();
+            stream_run(&s, (stream_kernel_t)k, n, cpus);
+            uint64_t cycles = rdtsc() - start;
+            if (trial == 0) {
+                continue;
+            }
+            if (cycles < best[k]) {
+                best[k] = cycles;
+            }
+            if (cycles > worst[k]) {
+                worst[k] = cycles;
+            }
+            total[k] += cycles;
+        }
+    }
+
+    kprintf("\nSTREAM: 3 arrays x %llu MB, %d CPU%s, best of %d\n\n", mb, cpus,
+            cpus == 1 ? "" : "s", STREAM_TRIALS - 1);
+    kprintf("  kernel     best MB/s    avg us    min us    max us\n");
+    for (int k = 0; k < STREAM_KERNELS; k++) {
+        uint64_t moved = stream_arrays[k] * bytes;
+        uint64_t ns = tsc_cycles_to_ns(best[k]);
+        uint64_t mbps = ns ? moved * 1000 / ns : 0;     /* MB = 10^6 bytes, as STREAM */
+        kprintf("  %-8s %11llu %9llu %9llu %9llu\n", stream_names[k], mbps,
+                tsc_cycles_to_us(total[k] / (STREAM_TRIALS - 1)),
+                tsc_cycles_to_us(best[k]), tsc_cycles_to_us(worst[k]));
+    }
+
+    kprintf("\n  results %s\n\n", stream_verify(&s, n, STREAM_TRIALS) ? "verified" : "WRONG");
+
+    vfree(s.a);
+    vfree(s.b);
+    vfree(s.c);
+}
+
+/* ============================================================================
+ * Latency
+ * ============================================================================ */
+
+static uint64_t rng;
+
+/**
+ * @brief Link the first lines of buf into one random cycle
+ *
+ * @param order  Scratch array of at least lines entries
+ */
+static void build_chain(uint8_t *buf, uint32_t *order, size_t lines) {
+    for (size_t i = 0; i < lines; i++) {
+        order[i] = (uint32_t)i;
+    }
+    /* Fisher-Yates shuffle, then line order[i] points at order[i + 1] */
+    for (size_t i = lines - 1; i > 0; i--) {
+        size_t j = (size_t)(((xorshift64(&rng) >> 32) * (i + 1)) >> 32);
+        uint32_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    for (size_t i = 0; i < lines; i++) {
+        size_t next = (i + 1 < lines) ? order[i + 1] : order[0];
+        *(void **)(buf + (size_t)order[i] * LAT_LINE) = buf + next * LAT_LINE;
+    }
+}
+
+/**
+ * @brief Follow the chain for count loads
+ *
+ * @return Final pointer (keeps the loads live)
+ */
+static void *chase(void *p, uint64_t count) {
+    for (uint64_t i = 0; i < count; i++) {
+        p = *(void **)p;
+    }
+    return p;
+}
+
+/**
+ * @brief Split a size into a whole number of MB, or KB otherwise
+ */
+static uint64_t size_value(uint64_t bytes, const char **unit) {
+    if (bytes >= (1u << 20) && (bytes & ((1u << 20) - 1)) == 0) {
+        *unit = "MB";
+        return bytes >> 20;
+    }
+    *unit = "KB";
+    return bytes >> 10;
+}
+
+static void run_latency(uint64_t mb) {
+    uint64_t max = mb << 20;
+    size_t max_lines = max / LAT_LINE;
+    size_t order_bytes = max_lines * sizeof(uint32_t);
+
+    if (!memory_available(max + order_bytes)) {
+        return;
+    }
+
+    uint8_t *buf = vmalloc(max);
+    uint32_t *order = vmalloc(order_bytes);
+    if (!buf || !order) {
+        kprintf("membench: cannot reserve %llu MB\n", mb);
+        vfree(buf);
+        vfree(order);
+        return;
+    }
+
+    /* 4KB, 6KB, 8KB, 12KB, ... up to max */
+    uint64_t sizes[LAT_MAX_POINTS];
+    uint64_t tenths[LAT_MAX_POINTS];
+    int points = 0;
+    for (uint64_t s = 4096; s <= max && points < LAT_MAX_POINTS; s <<= 1) {
+        sizes[points++] = s;
+        if (s + s / 2 <= max && points < LAT_MAX_POINTS) {
+            sizes[points++] = s + s / 2;
+        }
+    }
+
+    rng = 0x9E3779B97F4A7C15ull ^ rdtsc();
+    kprintf("\nLoad latency, random chase over 64-byte lines (best of %d x %u loads)\n\n",
+            LAT_PASSES, LAT_LOADS);
+
+    void *sink = NULL;
+    for (int i = 0; i < points; i++) {
+        size_t lines = sizes[i] / LAT_LINE;
+        build_chain(buf, order, lines);
+
+        /* One lap to pull the set into the caches and TLB */
+        void *p = chase(buf, lines);
+        uint64_t cycles = UINT64_MAX;
+        for (int pass = 0; pass < LAT_PASSES; pass++) {
+            /* Best pass, so a stray interrupt does not look like a step */
+            uint64_t start = rdtsc();
+            p = chase(p, LAT_LOADS);
+            uint64_t elapsed = rdtsc() - start;
+            if (elapsed < cycles) {
+                cycles = elapsed;
+            }
+        }
+        sink = p;
+
+        tenths[i] = tsc_cycles_to_ns(cycles * 10) / LAT_LOADS;
+    }
+    __asm__ volatile("" :: "r"(sink));
+
+    /* Find the steps: a big rise over the current plateau, then settling */
+    bool boundary[LAT_MAX_POINTS];
+    uint64_t level_ns[LAT_MAX_POINTS];
+    uint64_t plateau = tenths[0];
+    bool rising = false;
+    uint64_t peak = 1;
+    for (int i = 0; i < points; i++) {
+        boundary[i] = false;
+        if (tenths[i] > peak) {
+            peak = tenths[i];
+        }
+        if (i == 0) {
+            continue;
+        }
+        if (rising) {
+            if (tenths[i] * 100 <= tenths[i - 1] * (100 + LAT_FLAT_PCT)) {
+                rising = false;
+                plateau = tenths[i];
+            }
+        } else if (tenths[i] * 100 > plateau * (100 + LAT_STEP_PCT)) {
+            boundary[i - 1] = true;
+            level_ns[i - 1] = plateau;
+            rising = true;
+        }
+    }
+
+    const char *unit;
+    int level = 1;
+    for (int i = 0; i < points; i++) {
+        uint64_t size = size_value(sizes[i], &unit);
+        kprintf("  %5llu %s %4llu.%llu ns  ", size, unit, tenths[i] / 10, tenths[i] % 10);
+        uint64_t bar = tenths[i] * LAT_BAR_WIDTH / peak;
+        for (uint64_t b = 0; b < (bar ? bar : 1); b++) {
+            kprintf("#");
+        }
+        if (boundary[i]) {
+            kprintf("  <- L%d ends", level++);
+        }
+        kprintf("\n");
+    }
+
+    kprintf("\n  Levels:");
+    level = 1;
+    for (int i = 0; i < points; i++) {
+        if (boundary[i]) {
+            uint64_t size = size_value(sizes[i], &unit);
+            kprintf(" L%d ~%llu %s (%llu.%llu ns),", level++, size, unit,
+                    level_ns[i] / 10, level_ns[i] % 10);
+        }
+    }
+    uint64_t size = size_value(sizes[points - 1], &unit);
+    kprintf(" %llu %s: %llu.%llu ns\n\n", size, unit,
+            tenths[points - 1] / 10, tenths[points - 1] % 10);
+
+    vfree(buf);
+    vfree(order);
+}
+
+/* ============================================================================
+ * Command Handler
+ * ============================================================================ */
+
+/**
+ * @brief Memory benchmark command handler
+ *
+ * Usage:
+ *   membench                  - STREAM and latency with default sizes
+ *   membench stream [MB]      - STREAM with MB per array
+ *   membench latency [MB]     - latency up to an MB working set
+ */
+void cmd_membench(int argc, char *argv[]) {
+    bool stream = true;
+    bool latency = true;
+    uint64_t stream_mb = STREAM_DEFAULT_MB;
+    uint64_t lat_mb = LAT_DEFAULT_MB;
+
+    if (argc >= 2) {
+        uint64_t mb = 0;
+        bool has_mb = argc >= 3;
+        if (has_mb && (!kstrtou64(argv[2], 10, &mb) || mb == 0)) {
+            kprintf("membench: invalid size '%s'\n", argv[2]);
+            return;
+        }
+        if (strcmp(argv[1], "stream") == 0) {
+            latency = false;
+            if (has_mb) {
+                stream_mb = mb;
+            }
+        } else if (strcmp(argv[1], "latency") == 0) {
+            stream = false;
+            if (has_mb) {
+                lat_mb = mb;
+            }
+        } else {
+            kprintf("Usage: membench [stream [MB] | latency [MB]]\n");
+            return;
+        }
+    }
+
+    if (stream_mb > STREAM_MAX_MB || lat_mb > LAT_MAX_MB) {
+        kprintf("membench: at most %d MB per STREAM array, %d MB latency set\n",
+                STREAM_MAX_MB, LAT_MAX_MB);
+        return;
+    }
+
+    if (stream) {
+        run_stream(stream_mb);
+    }
+    if (latency) {
+        run_latency(lat_mb);
+    }
+}
+
+/* ============================================================================
+ * Module Registration
+ * ============================================================================ */
+
+/* Runs at boot when linked in, on first use when built as a module */
+static bool membench_register(void) {
+    shell_register_command("membench", "STREAM bandwidth, load latency", cmd_membench);
+    return true;
+}
+DEFINE_INITCALL(membench, membench_register, "", 0);
@@ -3,12 +3,15 @@
  * @brief Memory dump command implementation
  * 
  * Displays memory contents at a specified address in hex format.
+ * Each line is fetched with probe_kernel_read(), so an unmapped or
+ * non-canonical address prints "??" instead of halting the machine.
  */
 
 #include <shell/shell.h>
 #include <lib/printf/printf.h>
 #include <lib/string/string.h>
 #include <drivers/vga/vga_text.h>
+#include <arch/x86_64/mm/uaccess.h>
 
 /**
  * @brief Parse a hex string to uint64_t
@@ -122,9 +125,17 @@ void cmd_memdump(int argc, char *argv[]) {
     kprintf("\nMemory dump at 0x%llX (%llu bytes):\n\n", address, length);
     
     /* Print hex dump */
-    uint8_t *ptr = (uint8_t *)address;
+    const uint8_t *ptr = (const uint8_t *)address;
+    uint64_t bad_lines = 0;
     
     for (uint64_t i = 0; i < length; i += 16) {
+        uint8_t line[16];
+        size_t count = (length - i < 16) ? (size_t)(length - i) : 16;
+        bool ok = probe_kernel_read(line, ptr + i, count);
+        if (!ok) {
+            bad_lines++;
+        }
+        
         /* Print address */
         vga_set_color(VGA_DARK_GRAY, VGA_BLACK);
         kprintf("%08llX: ", address + i);
@@ -132,8 +143,10 @@ void cmd_memdump(int argc, char *argv[]) {
         /* Print hex bytes */
         vga_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
         for (int j = 0; j < 16; j++) {
-            if (i + j < length) {
-                kprintf("%02X ", ptr[i + j]);
+            if (i + j < length && ok) {
+                kprintf("%02X ", line[j]);
+            } else if (i + j < length) {
+                kprintf("?? ");
             } else {
                 kprintf("   ");
             }
@@ -144,11 +157,14 @@ void cmd_memdump(int argc, char *argv[]) {
         vga_set_color(VGA_YELLOW, VGA_BLACK);
         kprintf(" |");
         for (int j = 0; j < 16 && i + j < length; j++) {
-            kprintf("%c", to_printable(ptr[i + j]));
+            kprintf("%c", ok ? to_printable(line[j]) : '?');
         }
         kprintf("|\n");
     }
     
     vga_set_color(VGA_LIGHT_GRAY, VGA_BLACK);
+    if (bad_lines) {
+        kprintf("\n%llu line(s) not mapped\n", bad_lines);
+    }
     kprintf("\n");
 }
@@ -0,0 +1,559 @@
+/**
+ * @file cmd_memtest.c
+ * @brief Memory burn-in test command
+ *
+ * WHAT IS TESTED:
+ *   Stage 2 passes no BIOS memory map, so the usable RAM is what the
+ *   frame allocator manages: everything from the end of the kernel image
+ *   to the top of RAM reported by CMOS. The low page tables (0x1000 -
+ *   0x4000), stage 2, the stack and the kernel sit below that and are
+ *   never handed out. memtest claims every free frame (2MB blocks first,
+ *   then single frames) except for a small reserve, tests them in place
+ *   through the identity map, and gives them back. Frames that are in
+ *   use (vmalloc pages, zram, page tables built later) are not tested.
+ *
+ * TESTS (each over all claimed ranges):
+ *   address      - every qword holds its own address, then its complement
+ *                  (catches address lines that alias)
+ *   movinv       - moving inversions, as in memtest86: fill with a pattern;
+ *                  ascending, check each line and write the complement;
+ *                  descending, check the complement and write the pattern
+ *                  back. Run for 0, all-ones, 0x55.., 0x33.. and 0x0F..
+ *   random       - eight interleaved xorshift streams seeded from each
+ *                  chunk's address, then regenerated and checked
+ *
+ * BANDWIDTH:
+ *   Stores are MOVNTDQ, 64 bytes per iteration, so writes stream to
+ *   memory without first reading the lines into the cache. Checks are
+ *   plain 64-bit loads folded into one error word per line, which keeps
+ *   up with memory. Throughput counts bytes read plus bytes written.
+ *
+ * CPUS:
+ *   The claimed ranges are split into one contiguous share per online
+ *   CPU. Only the boot CPU is started today, so it takes every share.
+ */
+
+#include <shell/shell.h>
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/bitmap/bitmap.h>
+#include <drivers/keyboard/keyboard.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <core/initcall.h>
+
+/** @brief Free memory left to the rest of the system while testing (MB) */
+#define MEMTEST_RESERVE_MB  4
+
+/** @brief Most separate ranges tracked (adjacent frames are merged) */
+#define MEMTEST_MAX_RANGES  256
+
+/** @brief Unit of work between progress updates and key checks */
+#define MEMTEST_CHUNK       (1ull << 20)
+
+/** @brief Most errors printed per test (all are counted) */
+#define MEMTEST_MAX_REPORT  8
+
+/** @brief Bytes per loop iteration (one cache line) */
+#define LINE                64
+
+#define MEMTEST_MAX_FRAMES  (PMM_MAX_MEMORY / PMM_FRAME_SIZE)
+
+typedef uint64_t v2u64 __attribute__((vector_size(16)));
+
+/**
+ * @brief A physically contiguous run of claimed frames
+ */
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+} mt_range_t;
+
+typedef enum {
+    OP_FILL,            /**< write pattern */
+    OP_CHECK,           /**< check pattern */
+    OP_UP,              /**< check pattern, write ~pattern, ascending */
+    OP_DOWN,            /**< check ~pattern, write pattern, descending */
+    OP_ADDR_FILL,       /**< write address ^ pattern */
+    OP_ADDR_CHECK,      /**< check address ^ pattern */
+    OP_RAND_FILL,       /**< write xorshift stream seeded by pattern */
+    OP_RAND_CHECK,      /**< check xorshift stream seeded by pattern */
+} mt_op_t;
+
+/** @brief Claimed frames, one bit per frame */
+static uint64_t claimed[BITMAP_WORDS(MEMTEST_MAX_FRAMES)];
+
+static mt_range_t ranges[MEMTEST_MAX_RANGES];
+static int range_count;
+static uint64_t range_bytes;
+
+/** @brief Errors of the running test */
+static uint64_t errors;
+
+/** @brief Set when a key is pressed to stop the run */
+static bool aborted;
+
+/* ============================================================================
+ * Claiming Memory
+ * ============================================================================ */
+
+static void release_all(void) {
+    size_t f = bitmap_find_first_set(claimed, MEMTEST_MAX_FRAMES);
+    while (f < MEMTEST_MAX_FRAMES) {
+        bitmap_clear(claimed, f);
+        pmm_free(f * PMM_FRAME_SIZE);
+        f = bitmap_find_next_set(claimed, MEMTEST_MAX_FRAMES, f + 1);
+    }
+    range_count = 0;
+    range_bytes = 0;
+}
+
+/**
+ * @brief Claim up to limit bytes of free frames and build the range list
+ *
+ * @return false if nothing could be claimed
+ */
+static bool claim_memory(uint64_t limit) {
+    pmm_stats_t mem;
+    pmm_get_stats(&mem);
+
+    uint64_t reserve = ((uint64_t)MEMTEST_RESERVE_MB << 20) / PMM_FRAME_SIZE;
+    uint64_t budget = mem.free > reserve ? mem.free - reserve : 0;
+    if (budget > limit / PMM_FRAME_SIZE) {
+        budget = limit / PMM_FRAME_SIZE;
+    }
+
+    /* Whole 2MB blocks keep the ranges long; single frames fill the gaps */
+    while (budget >= PMM_HUGE_FRAMES) {
+        uint64_t phys = pmm_alloc_huge();
+        if (!phys) {
+            break;
+        }
+        bitmap_set_range(claimed, phys / PMM_FRAME_SIZE, PMM_HUGE_FRAMES);
+        budget -= PMM_HUGE_FRAMES;
+    }
+    while (budget) {
+        uint64_t phys = pmm_alloc();
+        if (!phys) {
+            break;
+        }
+        bitmap_set(claimed, phys / PMM_FRAME_SIZE);
+        budget--;
+    }
+
+    /* Runs of set bits become ranges; if there are too many, drop the rest */
+    range_count = 0;
+    range_bytes = 0;
+    size_t f = bitmap_find_first_set(claimed, MEMTEST_MAX_FRAMES);
+    while (f < MEMTEST_MAX_FRAMES) {
+        size_t end = bitmap_find_next_zero(claimed, MEMTEST_MAX_FRAMES, f);
+        if (range_count == MEMTEST_MAX_RANGES) {
+            for (size_t i = f; i < end; i++) {
+                bitmap_clear(claimed, i);
+                pmm_free(i * PMM_FRAME_SIZE);
+            }
+        } else {
+            ranges[range_count].start = f * PMM_FRAME_SIZE;
+            ranges[range_count].end = end * PMM_FRAME_SIZE;
+            range_bytes += (end - f) * PMM_FRAME_SIZE;
+            range_count++;
+        }
+        f = bitmap_find_next_set(claimed, MEMTEST_MAX_FRAMES, end);
+    }
+    return range_count > 0;
+}
+
+/* ============================================================================
+ * Line Operations
+ * ============================================================================ */
+
+static inline void store_nt(uint64_t *p, v2u64 v) {
+    __asm__ volatile("movntdq %1, %0" : "=m"(*(v2u64 *)p) : "x"(v));
+}
+
+static inline void store_line(uint64_t *p, v2u64 v) {
+    store_nt(p, v);
+    store_nt(p + 2, v);
+    store_nt(p + 4, v);
+    store_nt(p + 6, v);
+}
+
+/**
+ * @brief Differences between a line and a pattern, OR-ed together
+ */
+static inline uint64_t diff_line(const uint64_t *p, uint64_t pattern) {
+    return (p[0] ^ pattern) | (p[1] ^ pattern) | (p[2] ^ pattern) | (p[3] ^ pattern) |
+           (p[4] ^ pattern) | (p[5] ^ pattern) | (p[6] ^ pattern) | (p[7] ^ pattern);
+}
+
+/**
+ * @brief Count a bad qword, printing the first few
+ */
+static void report(const uint64_t *p, uint64_t expected) {
+    if (errors < MEMTEST_MAX_REPORT) {
+        kprintf("\r    error at 0x%llX: expected %016llX got %016llX (bits %016llX)\n",
+                (uint64_t)(uintptr_t)p, expected, *p, expected ^ *p);
+    }
+    errors++;
+}
+
+/**
+ * @brief Report every qword of a line that differs from a pattern
+ */
+static void report_line(const uint64_t *p, uint64_t expected) {
+    for (int i = 0; i < LINE / 8; i++) {
+        if (p[i] != expected) {
+            report(&p[i], expected);
+        }
+    }
+}
+
+/**
+ * @brief Nonzero seed for stream n of a chunk
+ */
+static inline uint64_t splitmix64(uint64_t seed, uint64_t n) {
+    uint64_t z = seed + (n + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+/**
+ * @brief Seed eight xorshift streams, two per vector
+ */
+static inline void rand_seed(v2u64 *state, uint64_t seed) {
+    for (int k = 0; k < 4; k++) {
+        state[k] = (v2u64){ splitmix64(seed, 2 * k), splitmix64(seed, 2 * k + 1) };
+    }
+}
+
+static inline v2u64 rand_next(v2u64 x) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+/**
+ * @brief Fill [first, last) from eight interleaved streams (one line per step)
+ */
+static void rand_fill(uint64_t *first, uint64_t *last, uint64_t seed) {
+    v2u64 s[4];
+    rand_seed(s, seed);
+    v2u64 s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+
+    for (uint64_t *p = first; p < last; p += LINE / 8) {
+        s0 = rand_next(s0);
+        s1 = rand_next(s1);
+        s2 = rand_next(s2);
+        s3 = rand_next(s3);
+        store_nt(p, s0);
+        store_nt(p + 2, s1);
+        store_nt(p + 4, s2);
+        store_nt(p + 6, s3);
+    }
+}
+
+/**
+ * @brief Check [first, last) against the streams rand_fill() wrote
+ */
+static void rand_check(uint64_t *first, uint64_t *last, uint64_t seed) {
+    v2u64 s[4];
+    rand_seed(s, seed);
+    v2u64 s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+
+    for (uint64_t *p = first; p < last; p += LINE / 8) {
+        s0 = rand_next(s0);
+        s1 = rand_next(s1);
+        s2 = rand_next(s2);
+        s3 = rand_next(s3);
+        const v2u64 *line = (const v2u64 *)p;
+        v2u64 diff = (line[0] ^ s0) | (line[1] ^ s1) | (line[2] ^ s2) | (line[3] ^ s3);
+        if (diff[0] | diff[1]) {
+            v2u64 want[4] = { s0, s1, s2, s3 };
+            for (int i = 0; i < LINE / 8; i++) {
+                if (p[i] != want[i / 2][i % 2]) {
+                    report(&p[i], want[i / 2][i % 2]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Apply an operation to [start, end)
+ */
+static void run_chunk(mt_op_t op, uint64_t start, uint64_t end, uint64_t pattern) {
+    uint64_t *first = (uint64_t *)(uintptr_t)start;
+    uint64_t *last = (uint64_t *)(uintptr_t)end;
+    v2u64 pat = { pattern, pattern };
+    v2u64 inv = { ~pattern, ~pattern };
+
+    switch (op) {
+    case OP_FILL:
+        for (uint64_t *p = first; p < last; p += LINE / 8) {
+            store_line(p, pat);
+        }
+        break;
+
+    case OP_CHECK:
+        for (uint64_t *p = first; p < last; p += LINE / 8) {
+            if (diff_line(p, pattern)) {
+                report_line(p, pattern);
+            }
+        }
+        break;
+
+    case OP_UP:
+        for (uint64_t *p = first; p < last; p += LINE / 8) {
+            if (diff_line(p, pattern)) {
+                report_line(p, pattern);
+            }
+            store_line(p, inv);
+        }
+        break;
+
+    case OP_DOWN:
+        for (uint64_t *p = last; p > first;) {
+            p -= LINE / 8;
+            if (diff_line(p, ~pattern)) {
+                report_line(p, ~pattern);
+            }
+            store_line(p, pat);
+        }
+        break;
+
+    case OP_ADDR_FILL: {
+        v2u64 addr = { start ^ pattern, (start + 8) ^ pattern };
+        v2u64 step = { 16, 16 };
+        for (uint64_t *p = first; p < last; p += 2) {
+            store_nt(p, addr);
+            addr = ((addr ^ pat) + step) ^ pat;
+        }
+        break;
+    }
+
+    case OP_ADDR_CHECK:
+        for (uint64_t *p = first; p < last; p += LINE / 8) {
+            uint64_t diff = 0;
+            for (int i = 0; i < LINE / 8; i++) {
+                diff |= p[i] ^ ((uint64_t)(uintptr_t)&p[i] ^ pattern);
+            }
+            if (diff) {
+                for (int i = 0; i < LINE / 8; i++) {
+                    uint64_t want = (uint64_t)(uintptr_t)&p[i] ^ pattern;
+                    if (p[i] != want) {
+                        report(&p[i], want);
+                    }
+                }
+            }
+        }
+        break;
+
+    case OP_RAND_FILL:
+        rand_fill(first, last, start ^ pattern);
+        break;
+
+    case OP_RAND_CHECK:
+        rand_check(first, last, start ^ pattern);
+        break;
+    }
+
+    __asm__ volatile("sfence" ::: "memory");
+}
+
+/* ============================================================================
+ * Test Driver
+ * ============================================================================ */
+
+/**
+ * @brief Apply an operation to every byte offset [lo, hi) of the ranges
+ *        taken as one list, in chunks, ascending or descending
+ *
+ * @param done   Bytes completed so far (progress)
+ * @param total  Bytes the whole test covers
+ */
+static void run_share(mt_op_t op, uint64_t pattern, uint64_t lo, uint64_t hi,
+                      const char *name, uint64_t *done, uint64_t total) {
+    bool down = op == OP_DOWN;
+    uint64_t base = 0;
+
+    for (int n = 0; n < range_count && !aborted; n++) {
+        int r = down ? range_count - 1 - n : n;
+        uint64_t size = ranges[r].end - ranges[r].start;
+        uint64_t roff = down ? range_bytes - base - size : base;
+        base += size;
+
+        /* Part of this range inside the share */
+        uint64_t from = roff > lo ? roff : lo;
+        uint64_t to = roff + size < hi ? roff + size : hi;
+        if (from >= to) {
+            continue;
+        }
+
+        uint64_t start = ranges[r].start + (from - roff);
+        uint64_t end = ranges[r].start + (to - roff);
+        while (start < end && !aborted) {
+            uint64_t len = end - start < MEMTEST_CHUNK ? end - start : MEMTEST_CHUNK;
+            if (down) {
+                run_chunk(op, end - len, end, pattern);
+                end -= len;
+            } else {
+                run_chunk(op, start, start + len, pattern);
+                start += len;
+            }
+
+            uint64_t before = *done * 20 / total;
+            *done += len;
+            if (*done * 20 / total != before) {
+                kprintf("\r  %-22s %3llu%%", name, *done * 100 / total);
+            }
+            if (keyboard_getchar_nonblock() != KEY_NONE) {
+                aborted = true;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Apply an operation over all claimed memory, one share per CPU
+ */
+static void run_op(mt_op_t op, uint64_t pattern, const char *name,
+                   uint64_t *done, uint64_t total) {
+    int cpus = cpu_count();
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        uint64_t lo = range_bytes * cpu / cpus;
+        uint64_t hi = range_bytes * (cpu + 1) / cpus;
+        run_share(op, pattern, lo, hi, name, done, total);
+    }
+}
+
+/**
+ * @brief Run a sequence of operations as one named test and report it
+ *
+ * @param touches  Bytes read or written per byte of memory, per op
+ */
+static uint64_t run_test(const char *name, const mt_op_t *ops, const uint64_t *touches,
+                         int count, uint64_t pattern) {
+    uint64_t done = 0;
+    uint64_t total = range_bytes * count;
+    uint64_t moved = 0;
+
+    errors = 0;
+    kprintf("  %-22s   0%%", name);
+    uint64_t start = rdtsc();
+    for (int i = 0; i < count && !aborted; i++) {
+        run_op(ops[i], pattern, name, &done, total);
+        moved += range_bytes * touches[i];
+    }
+    uint64_t ns = tsc_cycles_to_ns(rdtsc() - start);
+
+    if (aborted) {
+        kprintf("\r  %-22s stopped\n", name);
+        return errors;
+    }
+    kprintf("\r  %-22s done  %6llu MB/s  %llu error%s\n", name,
+            ns ? moved * 1000 / ns : 0, errors, errors == 1 ? "" : "s");
+    return errors;
+}
+
+static uint64_t test_address(void) {
+    static const mt_op_t ops[] = { OP_ADDR_FILL, OP_ADDR_CHECK };
+    static const uint64_t touches[] = { 1, 1 };
+    uint64_t errs = run_test("address", ops, touches, 2, 0);
+    return errs + run_test("address (inverted)", ops, touches, 2, ~0ull);
+}
+
+static uint64_t test_movinv(void) {
+    static const uint64_t patterns[] = {
+        0, ~0ull, 0x5555555555555555ull, 0x3333333333333333ull, 0x0F0F0F0F0F0F0F0Full,
+    };
+    static const mt_op_t ops[] = { OP_FILL, OP_UP, OP_DOWN };
+    static const uint64_t touches[] = { 1, 2, 2 };
+    char name[32];
+    uint64_t errs = 0;
+
+    for (unsigned i = 0; i < sizeof(patterns) / sizeof(patterns[0]) && !aborted; i++) {
+        ksnprintf(name, sizeof(name), "movinv %016llX", patterns[i]);
+        errs += run_test(name, ops, touches, 3, patterns[i]);
+    }
+    return errs;
+}
+
+static uint64_t test_random(uint64_t seed) {
+    static const mt_op_t ops[] = { OP_RAND_FILL, OP_RAND_CHECK };
+    static const uint64_t touches[] = { 1, 1 };
+    return run_test("random", ops, touches, 2, seed);
+}
+
+/* ============================================================================
+ * Command Handler
+ * ============================================================================ */
+
+/**
+ * @brief Memory test command handler
+ *
+ * Usage:
+ *   memtest [passes] [MB]
+ */
+void cmd_memtest(int argc, char *argv[]) {
+    uint64_t passes = 1;
+    uint64_t mb = PMM_MAX_MEMORY >> 20;
+
+    if ((argc >= 2 && (!kstrtou64(argv[1], 10, &passes) || passes == 0)) ||
+        (argc >= 3 && (!kstrtou64(argv[2], 10, &mb) || mb == 0))) {
+        kprintf("Usage: memtest [passes] [MB]\n");
+        return;
+    }
+
+    if (!claim_memory(mb << 20)) {
+        kprintf("memtest: no free memory to test\n");
+        return;
+    }
+
+    kprintf("\nTesting %llu MB in %d range%s (%d MB left free), any key stops\n",
+            range_bytes >> 20, range_count, range_count == 1 ? "" : "s",
+            MEMTEST_RESERVE_MB);
+    for (int i = 0; i < range_count && i < 4; i++) {
+        kprintf("  0x%09llX - 0x%09llX\n", ranges[i].start, ranges[i].end);
+    }
+    if (range_count > 4) {
+        kprintf("  ... %d more\n", range_count - 4);
+    }
+
+    aborted = false;
+    uint64_t total_errors = 0;
+    for (uint64_t pass = 1; pass <= passes && !aborted; pass++) {
+        kprintf("\nPass %llu of %llu\n", pass, passes);
+        total_errors += test_address();
+        if (!aborted) {
+            total_errors += test_movinv();
+        }
+        if (!aborted) {
+            total_errors += test_random(rdtsc());
+        }
+    }
+
+    /* Drain the key that stopped the run */
+    while (keyboard_getchar_nonblock() != KEY_NONE) {
+    }
+
+    release_all();
+    kprintf("\n%s: %llu error%s\n\n", aborted ? "Stopped" : "Done", total_errors,
+            total_errors == 1 ? "" : "s");
+}
+
+/* ============================================================================
+ * Module Registration
+ * ============================================================================ */
+
+/* Runs at boot when linked in, on first use when built as a module */
+static bool memtest_register(void) {
+    shell_register_command("memtest", "Burn-in test of free RAM", cmd_memtest);
+    return true;
+}
+DEFINE_INITCALL(memtest, memtest_register, "", 0);
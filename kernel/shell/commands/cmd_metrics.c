@@ -0,0 +1,58 @@
+/**
+ * @file cmd_metrics.c
+ * @brief Prometheus metrics command
+ *
+ * Shows the exposition text that a scrape of COM2 would return, or
+ * writes it as a framed dump to COM1 so a host capturing the serial
+ * log can cut it out (see metrics_serve_init() for the frame).
+ */
+
+#include <shell/shell.h>
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <drivers/serial/serial.h>
+#include <core/metrics.h>
+
+/**
+ * @brief Raw COM1 output: the frame length counts LF, not CRLF
+ */
+static void com1_write(const char *buf, size_t len) {
+    serial_port_write(COM1_PORT, buf, len);
+}
+
+/**
+ * @brief Metrics command handler
+ *
+ * Usage:
+ *   metrics        - Print the exposition text
+ *   metrics dump   - Write a framed dump to COM1
+ *   metrics info   - Registry size, snapshot size, COM2 status
+ */
+void cmd_metrics(int argc, char *argv[]) {
+    if (argc < 2) {
+        size_t len;
+        kprintf("%s", metrics_snapshot(&len));
+        return;
+    }
+
+    if (strcmp(argv[1], "dump") == 0) {
+        metrics_dump(com1_write);
+        kprintf("Metrics dumped to COM1\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "info") == 0) {
+        size_t len;
+        metrics_snapshot(&len);
+        kprintf("\nRegistered metrics: %d (plus built-in kernel counters)\n",
+                metrics_count());
+        kprintf("Snapshot:           %llu of %d bytes\n",
+                (uint64_t)len, METRICS_BUF_SIZE);
+        kprintf("COM2 scrapes:       %s\n\n",
+                metrics_serve_active() ? "enabled" : "no UART present");
+        return;
+    }
+
+    kprintf("Usage: metrics [dump | info]\n");
+}
@@ -0,0 +1,102 @@
+/**
+ * @file cmd_module.c
+ * @brief Loadable module listing and loading
+ *
+ * "module" lists the loaded modules (where they sit in vmalloc space,
+ * how long reading and linking took) and what else the archive on the
+ * boot disk offers. "module load <name>" loads one without running it;
+ * typing the name of a command that is not built in does the same.
+ */
+
+#include <shell/shell.h>
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <drivers/ata/ata.h>
+#include <core/module.h>
+#include <core/export.h>
+
+/** @brief Archive entries listed */
+#define LIST_MAX    32
+
+static module_entry_t entries[LIST_MAX];
+
+/**
+ * @brief Print nanoseconds as milliseconds with three decimals
+ */
+static void print_ms(uint64_t ns) {
+    kprintf("%3llu.%03llu", ns / 1000000, ns / 1000 % 1000);
+}
+
+static void show_modules(void) {
+    kprintf("\nDisk: ");
+    if (ata_present()) {
+        kprintf("%s, %llu MB\n", ata_model(), ata_sectors() * ATA_SECTOR_SIZE >> 20);
+    } else {
+        kprintf("none\n");
+    }
+    kprintf("Kernel exports %d symbols\n", ksym_count());
+
+    kprintf("\nLoaded:\n");
+    const module_t *m = module_get(0);
+    if (!m) {
+        kprintf("  (none)\n");
+    } else {
+        kprintf("  name         base                  bytes  relocs  read ms  link ms\n");
+    }
+    for (int i = 0; (m = module_get(i)) != NULL; i++) {
+        kprintf("  %-12s 0x%016llX %6llu %7u  ", m->name, m->base, m->size, m->relocs);
+        print_ms(m->read_ns);
+        kprintf("  ");
+        print_ms(m->link_ns);
+        kprintf("\n");
+    }
+
+    int n = module_list(entries, LIST_MAX);
+    kprintf("\nArchive (LBA %u):\n", MODULE_ARCHIVE_LBA);
+    if (n < 0) {
+        kprintf("  (not found)\n\n");
+        return;
+    }
+    for (int i = 0; i < n && i < LIST_MAX; i++) {
+        kprintf("  %-12s %6u bytes%s\n", entries[i].name, entries[i].size,
+                module_find(entries[i].name) ? "  (loaded)" : "");
+    }
+    if (n > LIST_MAX) {
+        kprintf("  ... %d more\n", n - LIST_MAX);
+    }
+    kprintf("\n");
+}
+
+/**
+ * @brief Module command handler
+ *
+ * Usage:
+ *   module               - Loaded modules and the archive contents
+ *   module load <name>   - Load a module from the archive
+ */
+void cmd_module(int argc, char *argv[]) {
+    if (argc < 2) {
+        show_modules();
+        return;
+    }
+
+    if (strcmp(argv[1], "load") == 0 && argc >= 3) {
+        if (module_find(argv[2])) {
+            kprintf("module: %s is already loaded\n", argv[2]);
+            return;
+        }
+        if (module_load(argv[2])) {
+            const module_t *m = module_find(argv[2]);
+            kprintf("Loaded %s: %llu bytes, %u relocations, read ", m->name, m->size,
+                    m->relocs);
+            print_ms(m->read_ns);
+            kprintf(" ms, linked ");
+            print_ms(m->link_ns);
+            kprintf(" ms\n");
+        }
+        return;
+    }
+
+    kprintf("Usage: module [load <name>]\n");
+}
@@ -0,0 +1,44 @@
+/**
+ * @file cmd_poweroff.c
+ * @brief Poweroff command implementation
+ *
+ * Turns the virtual machine off, so a scripted run (make pgo) ends with
+ * QEMU exiting. There is no ACPI table parser: the command writes the
+ * S5 sleep request to the PM1a control ports the firmware of QEMU (0x604),
+ * older QEMU and Bochs (0xB004) and VirtualBox (0x4004) use.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <drivers/console/console.h>
+#include <arch/x86_64/io/port.h>
+
+/** @brief PM1 control: SLP_EN and the SLP_TYP field (bits 10-12) */
+#define PM1_SLP_EN          0x2000
+#define PM1_SLP_TYP(n)      ((n) << 10)
+
+/** @brief S5 request for QEMU and Bochs, whose \_S5 package is SLP_TYP 0 */
+#define PM1_SLEEP_S5_QEMU   (PM1_SLP_EN | PM1_SLP_TYP(0))
+
+/** @brief S5 request for VirtualBox, whose \_S5 package is SLP_TYP 5 */
+#define PM1_SLEEP_S5_VBOX   (PM1_SLP_EN | PM1_SLP_TYP(5))
+
+/**
+ * @brief Poweroff command handler
+ *
+ * Usage:
+ *   poweroff
+ */
+void cmd_poweroff(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    kprintf("Powering off\n");
+    console_flush();
+
+    outw(0x604, PM1_SLEEP_S5_QEMU);
+    outw(0xB004, PM1_SLEEP_S5_QEMU);
+    outw(0x4004, PM1_SLEEP_S5_VBOX);
+
+    kprintf("poweroff: not supported on this machine\n");
+}
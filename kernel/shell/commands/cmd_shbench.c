@@ -0,0 +1,78 @@
+/**
+ * @file cmd_shbench.c
+ * @brief Shell throughput benchmark
+ *
+ * Runs a fixed script of command lines through shell_execute() with the
+ * console muted, and reports commands per second. The script mixes
+ * builtins, an unknown command, an empty line and a nested "time" run,
+ * so parsing, lookup, the per-command arena and kprintf formatting are
+ * all on the path. Also prints how much of the shell arena was used.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/arena/arena.h>
+#include <drivers/console/console.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+
+/** @brief Default passes over the script */
+#define SHBENCH_DEFAULT_ROUNDS  1000
+
+/** @brief Upper bound on the pass count */
+#define SHBENCH_MAX_ROUNDS      1000000
+
+/** @brief The scripted workload */
+static const char *const script[] = {
+    "echo squirel shell benchmark",
+    "echo a b c d e f g h i j k l m n o",
+    "   ",
+    "nosuchcommand arg1 arg2",
+    "time echo nested",
+    "color",
+    "echo done",
+};
+
+#define SCRIPT_LINES    (int)(sizeof(script) / sizeof(script[0]))
+
+/**
+ * @brief Shbench command handler
+ *
+ * Usage:
+ *   shbench [rounds]   - Run the script that many times (default 1000)
+ */
+void cmd_shbench(int argc, char *argv[]) {
+    uint64_t rounds = SHBENCH_DEFAULT_ROUNDS;
+
+    if (argc >= 2 && (!kstrtou64(argv[1], 10, &rounds) || rounds == 0 ||
+                      rounds > SHBENCH_MAX_ROUNDS)) {
+        kprintf("Usage: shbench [rounds]\n");
+        return;
+    }
+
+    uint32_t sinks = console_get_sinks();
+    console_set_sinks(0);
+
+    uint64_t start = rdtsc();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (int i = 0; i < SCRIPT_LINES; i++) {
+            shell_execute(script[i]);
+        }
+    }
+    uint64_t ns = tsc_cycles_to_ns(rdtsc() - start);
+
+    console_set_sinks(sinks);
+
+    uint64_t lines = rounds * SCRIPT_LINES;
+    const arena_t *arena = shell_get_arena();
+
+    kprintf("\n%llu lines (%llu rounds of %d) in %llu us\n", lines, rounds,
+            SCRIPT_LINES, ns / 1000);
+    if (ns) {
+        kprintf("  throughput      %llu commands/s (%llu ns each)\n",
+                lines * 1000000000ull / ns, ns / lines);
+    }
+    kprintf("  shell arena     %llu bytes in use, peak %llu, %llu frames grown\n\n",
+            (uint64_t)arena_used(arena), arena->peak, arena->chunks);
+}
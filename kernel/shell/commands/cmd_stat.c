@@ -0,0 +1,88 @@
+/**
+ * @file cmd_stat.c
+ * @brief Statistics counter command
+ *
+ * Lists the counters registered with DEFINE_STAT, shows the per-CPU
+ * split of one counter, resets counters, and writes the machine-readable
+ * export (see stat_export()) to COM1 for host-side scrapers.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <drivers/serial/serial.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <core/stat.h>
+
+/**
+ * @brief List every counter with its total
+ */
+static void stat_list(void) {
+    int n = stat_count();
+
+    kprintf("\n%-20s %16s  %s\n", "COUNTER", "TOTAL", "DESCRIPTION");
+    for (int i = 0; i < n; i++) {
+        const stat_desc_t *s = stat_get(i);
+        kprintf("%-20s %16llu  %s\n", s->name, stat_read(s), s->help);
+    }
+    kprintf("\n%d counters, %d CPU(s), %llu bytes per CPU\n\n",
+            n, cpu_count(), (uint64_t)stat_percpu_stride());
+}
+
+/**
+ * @brief Show one counter split by CPU
+ */
+static void stat_show(const stat_desc_t *s) {
+    kprintf("\n%s - %s\n", s->name, s->help);
+    for (int cpu = 0; cpu < cpu_count(); cpu++) {
+        kprintf("  cpu%d   %16llu\n", cpu, stat_read_cpu(s, cpu));
+    }
+    kprintf("  total  %16llu\n\n", stat_read(s));
+}
+
+/**
+ * @brief Stat command handler
+ *
+ * Usage:
+ *   stat                - List all counters
+ *   stat <name>         - Per-CPU values of one counter
+ *   stat reset [name]   - Zero one counter, or all of them
+ *   stat export         - Write all counters to the serial port
+ */
+void cmd_stat(int argc, char *argv[]) {
+    if (argc < 2) {
+        stat_list();
+        return;
+    }
+
+    if (strcmp(argv[1], "reset") == 0) {
+        if (argc >= 3) {
+            const stat_desc_t *s = stat_find(argv[2]);
+            if (!s) {
+                kprintf("Error: No counter named '%s'\n", argv[2]);
+                return;
+            }
+            stat_reset(s);
+        } else {
+            for (int i = 0; i < stat_count(); i++) {
+                stat_reset(stat_get(i));
+            }
+        }
+        kprintf("Counters reset\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "export") == 0) {
+        stat_export(serial_write);
+        kprintf("Exported %d counters to COM1\n", stat_count());
+        return;
+    }
+
+    const stat_desc_t *s = stat_find(argv[1]);
+    if (s) {
+        stat_show(s);
+        return;
+    }
+
+    kprintf("Usage: stat [<name> | reset [name] | export]\n");
+}
@@ -0,0 +1,89 @@
+/**
+ * @file cmd_time.c
+ * @brief Command timing
+ *
+ * Runs another shell command and reports how long it took. With -n the
+ * command is repeated and the run times go through a histogram, so the
+ * report shows percentiles rather than just an average.
+ */
+
+#include <shell/shell.h>
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/histogram/histogram.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+
+/** @brief Upper bound on -n */
+#define TIME_MAX_RUNS       100000
+
+/** @brief Deepest nesting of time (shbench runs "time echo" itself) */
+#define TIME_MAX_DEPTH      4
+
+/**
+ * @brief Run times, one histogram per nesting level (too large for the stack)
+ *
+ * "time -n 20 shbench 100" runs a nested time on every pass; sharing one
+ * histogram would let each inner run wipe the outer one's samples.
+ */
+static histogram_t run_hist[TIME_MAX_DEPTH];
+static int depth;
+
+/**
+ * @brief Time command handler
+ *
+ * Usage:
+ *   time <command> [args]        - Run once, print the elapsed time
+ *   time -n N <command> [args]   - Run N times, print the distribution
+ */
+void cmd_time(int argc, char *argv[]) {
+    uint64_t runs = 1;
+    int first = 1;
+
+    if (argc >= 3 && strcmp(argv[1], "-n") == 0) {
+        if (!kstrtou64(argv[2], 10, &runs) || runs == 0 || runs > TIME_MAX_RUNS) {
+            kprintf("Error: Invalid run count '%s'\n", argv[2]);
+            return;
+        }
+        first = 3;
+    }
+    if (first >= argc) {
+        kprintf("Usage: time [-n N] <command> [args]\n");
+        return;
+    }
+
+    /* The parser has no quoting, so joining argv restores the line */
+    char line[SHELL_MAX_CMD_LEN];
+    line[0] = '\0';
+    for (int i = first; i < argc; i++) {
+        if (i > first) {
+            strncat(line, " ", sizeof(line) - strlen(line) - 1);
+        }
+        strncat(line, argv[i], sizeof(line) - strlen(line) - 1);
+    }
+
+    if (depth == TIME_MAX_DEPTH) {
+        kprintf("time: nested too deeply\n");
+        return;
+    }
+
+    histogram_t *hist = &run_hist[depth++];
+    hist_init(hist);
+    for (uint64_t i = 0; i < runs; i++) {
+        uint64_t start = rdtsc();
+        shell_execute(line);
+        hist_record(hist, tsc_cycles_to_ns(rdtsc() - start));
+    }
+    depth--;
+
+    if (runs == 1) {
+        uint64_t ns = hist->max;
+        kprintf("real %llu.%03llu ms\n", ns / 1000000, (ns / 1000) % 1000);
+        return;
+    }
+
+    char summary[160];
+    hist_format(hist, 1000, summary, sizeof(summary));
+    kprintf("%s (us)\n", summary);
+}
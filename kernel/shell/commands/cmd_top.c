@@ -0,0 +1,362 @@
+/**
+ * @file cmd_top.c
+ * @brief Live system monitor command
+ *
+ * Shows a full-screen dashboard on the dashboard console (Alt+F3) that
+ * refreshes once a second until 'q' or Escape is pressed:
+ *   - per-CPU busy / irq / idle share of the last interval
+ *   - per-line interrupt totals and rates
+ *   - kernel memory footprint
+ *   - the shell commands that used the most CPU time
+ * The first frame shows averages since boot.
+ *
+ * RENDERING:
+ *   Each frame is composed in a RAM cell buffer and handed over with a
+ *   single vga_load_screen() call, so a refresh costs one bulk copy
+ *   rather than a vga_putchar() per cell. Switching away with Alt+Fn
+ *   leaves top running; its frames then only update the console's RAM
+ *   shadow.
+ */
+
+#include <shell/shell.h>
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <drivers/vga/vga_text.h>
+#include <drivers/fb/fb_console.h>
+#include <drivers/keyboard/keyboard.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/cpu.h>
+#include <arch/x86_64/cpu/irq.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <arch/x86_64/mm/zram.h>
+#include <core/cpustat.h>
+
+/** @brief Refresh period */
+#define TOP_INTERVAL_US     1000000
+
+/** @brief Largest screen any display mode can have */
+#define TOP_MAX_CELLS \
+    ((FB_MAX_WIDTH / FBCON_GLYPH_WIDTH) * (FB_MAX_HEIGHT / FBCON_GLYPH_HEIGHT))
+
+/** @brief Shell commands listed at most */
+#define TOP_MAX_COMMANDS    32
+
+/* Colors */
+#define ATTR_NORMAL         0x07    /* Light gray on black */
+#define ATTR_HEADER         0x30    /* Black on cyan */
+#define ATTR_TITLE          0x0E    /* Yellow */
+#define ATTR_BUSY           0x0A    /* Light green */
+#define ATTR_IRQ            0x0C    /* Light red */
+#define ATTR_IDLE           0x08    /* Dark gray */
+
+/* Linker script symbols */
+extern char __kernel_start[];
+extern char __bss_start[];
+extern char __bss_end[];
+
+/**
+ * @brief Counters captured at one refresh
+ */
+typedef struct {
+    cpustat_t cpu[MAX_CPUS];
+    uint64_t irq[IRQ_COUNT];
+    uint64_t spurious;
+} top_sample_t;
+
+/* ============================================================================
+ * Private State
+ * ============================================================================ */
+
+/** @brief Frame being composed (the back half of the double buffer) */
+static uint16_t frame[TOP_MAX_CELLS];
+static int frame_w, frame_h;
+
+static top_sample_t samples[2];
+
+/* ============================================================================
+ * Frame Drawing
+ * ============================================================================ */
+
+static void frame_clear(void) {
+    uint16_t blank = (uint16_t)' ' | ((uint16_t)ATTR_NORMAL << 8);
+    for (int i = 0; i < frame_w * frame_h; i++) {
+        frame[i] = blank;
+    }
+}
+
+/**
+ * @brief Draw text at a position, clipped to the screen
+ */
+static void frame_text(int x, int y, uint8_t attr, const char *text) {
+    if (y < 0 || y >= frame_h) {
+        return;
+    }
+    for (; *text && x < frame_w; text++, x++) {
+        frame[y * frame_w + x] = (uint16_t)(uint8_t)*text | ((uint16_t)attr << 8);
+    }
+}
+
+/**
+ * @brief Fill a whole row with one attribute (header/title bars)
+ */
+static void frame_fill_row(int y, uint8_t attr) {
+    for (int x = 0; x < frame_w; x++) {
+        frame[y * frame_w + x] = (uint16_t)' ' | ((uint16_t)attr << 8);
+    }
+}
+
+/**
+ * @brief Draw a busy/irq/idle bar
+ *
+ * @param busy  Busy share in permille
+ * @param irq   Irq share in permille
+ */
+static void frame_bar(int x, int y, int width, uint64_t busy, uint64_t irq) {
+    int busy_cells = (int)((busy * (uint64_t)width + 500) / 1000);
+    int irq_cells = (int)((irq * (uint64_t)width + 500) / 1000);
+    if (busy_cells + irq_cells > width) {
+        irq_cells = width - busy_cells;
+    }
+
+    for (int i = 0; i < width && x + i < frame_w; i++) {
+        uint16_t cell;
+        if (i < busy_cells) {
+            cell = (uint16_t)'#' | ((uint16_t)ATTR_BUSY << 8);
+        } else if (i < busy_cells + irq_cells) {
+            cell = (uint16_t)'!' | ((uint16_t)ATTR_IRQ << 8);
+        } else {
+            cell = (uint16_t)'.' | ((uint16_t)ATTR_IDLE << 8);
+        }
+        frame[y * frame_w + x + i] = cell;
+    }
+}
+
+/* ============================================================================
+ * Sampling
+ * ============================================================================ */
+
+static void top_sample(top_sample_t *s) {
+    for (int cpu = 0; cpu < cpu_count(); cpu++) {
+        cpustat_get(cpu, &s->cpu[cpu]);
+    }
+    for (int i = 0; i < IRQ_COUNT; i++) {
+        s->irq[i] = irq_get_count(i);
+    }
+    s->spurious = irq_get_spurious();
+}
+
+/**
+ * @brief Share of a delta in permille
+ */
+static uint64_t permille(uint64_t part, uint64_t whole) {
+    return whole ? (part * 1000) / whole : 0;
+}
+
+/**
+ * @brief Events per second over an interval in cycles
+ */
+static uint64_t rate(uint64_t events, uint64_t cycles) {
+    uint64_t us = tsc_cycles_to_us(cycles);
+    return us ? (events * 1000000) / us : 0;
+}
+
+/* ============================================================================
+ * Sections
+ * ============================================================================ */
+
+static int draw_header(int y, const top_sample_t *now) {
+    char line[128];
+    uint64_t secs = tsc_cycles_to_us(now->cpu[0].total) / 1000000;
+
+    frame_fill_row(y, ATTR_HEADER);
+    ksnprintf(line, sizeof(line), " top - %s %s   up %llu:%02llu:%02llu   %d CPU   TSC %llu MHz",
+              SQUIREL_NAME, SQUIREL_VERSION_STRING,
+              secs / 3600, (secs / 60) % 60, secs % 60,
+              cpu_count(), tsc_khz() / 1000);
+    frame_text(0, y, ATTR_HEADER, line);
+    frame_text(frame_w - 10, y, ATTR_HEADER, "q: quit");
+    return y + 2;
+}
+
+static int draw_cpus(int y, const top_sample_t *prev, const top_sample_t *now) {
+    char line[128];
+
+    frame_text(0, y++, ATTR_TITLE, " CPU     busy     irq    idle");
+    for (int cpu = 0; cpu < cpu_count(); cpu++) {
+        const cpustat_t *a = &prev->cpu[cpu];
+        const cpustat_t *b = &now->cpu[cpu];
+        uint64_t total = b->total - a->total;
+        uint64_t busy = permille(b->busy - a->busy, total);
+        uint64_t irq = permille(b->irq - a->irq, total);
+        uint64_t idle = permille(b->idle - a->idle, total);
+
+        ksnprintf(line, sizeof(line), " cpu%d  %3llu.%llu%%  %3llu.%llu%%  %3llu.%llu%%",
+                  cpu, busy / 10, busy % 10, irq / 10, irq % 10,
+                  idle / 10, idle % 10);
+        frame_text(0, y, ATTR_NORMAL, line);
+        frame_bar(33, y, frame_w - 35, busy, irq);
+        y++;
+    }
+    return y + 1;
+}
+
+static int draw_irqs(int y, const top_sample_t *prev, const top_sample_t *now) {
+    char line[128];
+    uint64_t cycles = now->cpu[0].total - prev->cpu[0].total;
+
+    frame_text(0, y++, ATTR_TITLE, " IRQ  VECTOR  NAME             TOTAL     RATE/s");
+    for (int i = 0; i < IRQ_COUNT; i++) {
+        const char *name = irq_name(i);
+        if (!name && now->irq[i] == 0) {
+            continue;
+        }
+        ksnprintf(line, sizeof(line), " %3d  %6d  %-12s %10llu %10llu",
+                  i, IRQ_BASE_VECTOR + i, name ? name : "-",
+                  now->irq[i], rate(now->irq[i] - prev->irq[i], cycles));
+        frame_text(0, y++, ATTR_NORMAL, line);
+    }
+    ksnprintf(line, sizeof(line), "              %-12s %10llu %10llu", "spurious",
+              now->spurious, rate(now->spurious - prev->spurious, cycles));
+    frame_text(0, y++, ATTR_NORMAL, line);
+    return y + 1;
+}
+
+static int draw_memory(int y) {
+    char line[128];
+    uint64_t image = (uint64_t)(__bss_start - __kernel_start);
+    uint64_t bss = (uint64_t)(__bss_end - __bss_start);
+
+    frame_text(0, y++, ATTR_TITLE, " MEMORY");
+    ksnprintf(line, sizeof(line), "  kernel image %7llu KB   at 0x%llx",
+              image / 1024, (uint64_t)(uintptr_t)__kernel_start);
+    frame_text(0, y++, ATTR_NORMAL, line);
+    ksnprintf(line, sizeof(line), "  bss          %7llu KB   (framebuffer, glyph cache, consoles)",
+              bss / 1024);
+    frame_text(0, y++, ATTR_NORMAL, line);
+    ksnprintf(line, sizeof(line), "  stack        %7llu KB   below 0x%x",
+              (uint64_t)KERNEL_STACK_SIZE / 1024, KERNEL_STACK_TOP);
+    frame_text(0, y++, ATTR_NORMAL, line);
+    pmm_stats_t mem;
+    pmm_get_stats(&mem);
+    ksnprintf(line, sizeof(line), "  frames free  %7llu KB   of %llu KB managed",
+              mem.free * PMM_FRAME_SIZE / 1024, mem.total * PMM_FRAME_SIZE / 1024);
+    frame_text(0, y++, ATTR_NORMAL, line);
+
+    static vm_area_t areas[VMALLOC_MAX_AREAS];
+    int n = vmalloc_get_areas(areas, VMALLOC_MAX_AREAS);
+    uint64_t resident = 0;
+    for (int i = 0; i < n; i++) {
+        resident += areas[i].resident;
+    }
+    ksnprintf(line, sizeof(line), "  vmalloc      %7llu KB   resident in %d area(s)",
+              resident * 4, n);
+    frame_text(0, y++, ATTR_NORMAL, line);
+
+    zram_stats_t z;
+    zram_get_stats(&z);
+    ksnprintf(line, sizeof(line), "  zram         %7llu KB   stored in %llu KB",
+              z.stored * 4, z.pool_frames * 4);
+    frame_text(0, y++, ATTR_NORMAL, line);
+    return y + 1;
+}
+
+static int draw_commands(int y, const top_sample_t *now) {
+    static shell_cmd_stats_t stats[TOP_MAX_COMMANDS];
+    char line[128];
+    int n = shell_get_cmd_stats(stats, TOP_MAX_COMMANDS);
+
+    /* Sort by CPU time, highest first */
+    for (int i = 1; i < n; i++) {
+        shell_cmd_stats_t key = stats[i];
+        int j = i - 1;
+        while (j >= 0 && stats[j].cycles < key.cycles) {
+            stats[j + 1] = stats[j];
+            j--;
+        }
+        stats[j + 1] = key;
+    }
+
+    frame_text(0, y++, ATTR_TITLE, " COMMAND       CALLS     TOTAL ms     AVG us   CPU%");
+    for (int i = 0; i < n && y < frame_h; i++) {
+        if (stats[i].calls == 0) {
+            break;
+        }
+        uint64_t share = permille(stats[i].cycles, now->cpu[0].total);
+        ksnprintf(line, sizeof(line), " %-12s %6llu %12llu %10llu  %3llu.%llu",
+                  stats[i].name, stats[i].calls,
+                  tsc_cycles_to_us(stats[i].cycles) / 1000,
+                  tsc_cycles_to_us(stats[i].cycles / stats[i].calls),
+                  share / 10, share % 10);
+        frame_text(0, y++, ATTR_NORMAL, line);
+    }
+    return y;
+}
+
+/**
+ * @brief Compose one full frame
+ */
+static void top_render(const top_sample_t *prev, const top_sample_t *now) {
+    frame_clear();
+
+    int y = draw_header(0, now);
+    y = draw_cpus(y, prev, now);
+    y = draw_irqs(y, prev, now);
+    y = draw_memory(y);
+    draw_commands(y, now);
+}
+
+/* ============================================================================
+ * Command
+ * ============================================================================ */
+
+/**
+ * @brief Top command handler
+ *
+ * Usage:
+ *   top   - Run the dashboard on Alt+F3 until 'q' or Escape
+ */
+void cmd_top(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    int prev_fg = vga_console_foreground();
+    int prev_vc = vga_console_select(VC_DASHBOARD);
+    vga_console_switch(VC_DASHBOARD);
+    frame_w = vga_get_width();
+    frame_h = vga_get_height();
+
+    /* First frame: averages since boot */
+    top_sample_t *prev = &samples[0];
+    top_sample_t *now = &samples[1];
+    memset(prev, 0, sizeof(*prev));
+
+    uint64_t interval = tsc_us_to_cycles(TOP_INTERVAL_US);
+    bool quit = false;
+
+    while (!quit) {
+        top_sample(now);
+        top_render(prev, now);
+        vga_load_screen(frame);
+
+        top_sample_t *tmp = prev;
+        prev = now;
+        now = tmp;
+
+        uint64_t deadline = rdtsc() + interval;
+        while (!quit && rdtsc() < deadline) {
+            int c = keyboard_getchar_nonblock();
+            if (c == 'q' || c == KEY_ESCAPE) {
+                quit = true;
+            } else if (c == KEY_NONE) {
+                cpu_idle();
+            }
+        }
+    }
+
+    vga_console_select(prev_vc);
+    vga_console_switch(prev_fg);
+}
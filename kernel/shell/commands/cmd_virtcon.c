@@ -0,0 +1,139 @@
+/**
+ * @file cmd_virtcon.c
+ * @brief Virtio console status and throughput benchmark command
+ *
+ * Shows the state of the virtio-console ports and measures bulk
+ * transfer throughput against the COM1 UART.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <drivers/serial/serial.h>
+#include <drivers/virtio/virtio_console.h>
+#include <arch/x86_64/cpu/tsc.h>
+
+/** @brief Bytes sent through COM1 for the baseline measurement */
+#define SERIAL_SAMPLE_BYTES     2048
+
+/** @brief Default and largest virtio transfer size in MB */
+#define DEFAULT_BENCH_MB        64
+#define MAX_BENCH_MB            65536
+
+/** @brief Pattern buffer streamed by the benchmark */
+static char bench_buf[4096];
+
+/**
+ * @brief Print a throughput figure as KB/s or MB/s with two decimals
+ */
+static void print_rate(uint64_t bytes, uint64_t cycles) {
+    uint64_t us = tsc_cycles_to_us(cycles);
+    if (us == 0) {
+        us = 1;
+    }
+    /* Split like tsc_cycles_to_us(): bytes * 1000000 overflows past 18 TB */
+    uint64_t bytes_per_sec = (bytes / us) * 1000000 + (bytes % us) * 1000000 / us;
+
+    if (bytes_per_sec >= 1024 * 1024) {
+        uint64_t centi = bytes_per_sec * 100 / (1024 * 1024);
+        kprintf("%llu.%02llu MB/s", centi / 100, centi % 100);
+    } else {
+        uint64_t centi = bytes_per_sec * 100 / 1024;
+        kprintf("%llu.%02llu KB/s", centi / 100, centi % 100);
+    }
+}
+
+/**
+ * @brief Show port status
+ */
+static void virtcon_status(void) {
+    static const char *roles[VIRTIO_CONSOLE_MAX_PORTS] = { "console", "trace" };
+
+    kprintf("\nvirtio-console ports:\n");
+    for (int i = 0; i < VIRTIO_CONSOLE_MAX_PORTS; i++) {
+        uint64_t sent, dropped;
+        virtio_console_stats(i, &sent, &dropped);
+        kprintf("  port %d %-8s %-6s name=%-20s sent=%llu dropped=%llu\n",
+                i, roles[i],
+                virtio_console_port_ready(i) ? "ready" : "absent",
+                virtio_console_port_name(i)[0] ? virtio_console_port_name(i) : "-",
+                sent, dropped);
+    }
+    kprintf("\n");
+}
+
+/**
+ * @brief Stream data through COM1 and the trace port and compare
+ */
+static void virtcon_bench(uint64_t megabytes) {
+    for (size_t i = 0; i < sizeof(bench_buf); i++) {
+        bench_buf[i] = (i % 64 == 63) ? '\n' : (char)('A' + i % 26);
+    }
+
+    /* Baseline: polled 16550 UART */
+    uint64_t start = rdtsc();
+    for (int i = 0; i < SERIAL_SAMPLE_BYTES; i++) {
+        serial_putchar(bench_buf[i]);
+    }
+    uint64_t cycles = rdtsc() - start;
+    kprintf("  serial (COM1):  %d bytes in %llu us, ",
+            SERIAL_SAMPLE_BYTES, tsc_cycles_to_us(cycles));
+    print_rate(SERIAL_SAMPLE_BYTES, cycles);
+    kprintf("\n");
+
+    /* Prefer the trace port so the console log stays readable */
+    int port = virtio_console_port_ready(VIRTIO_CONSOLE_PORT_TRACE) ?
+               VIRTIO_CONSOLE_PORT_TRACE : VIRTIO_CONSOLE_PORT_CONSOLE;
+    uint64_t total = megabytes * 1024 * 1024;
+    uint64_t written = 0;
+
+    start = rdtsc();
+    while (written < total) {
+        size_t n = virtio_console_write(port, bench_buf, sizeof(bench_buf));
+        written += n;
+        if (n < sizeof(bench_buf)) {
+            break;  /* Host stopped draining */
+        }
+    }
+    bool drained = virtio_console_drain(port);
+    cycles = rdtsc() - start;
+
+    kprintf("  virtio port %d:  %llu bytes in %llu us, ",
+            port, written, tsc_cycles_to_us(cycles));
+    print_rate(written, cycles);
+    kprintf("%s\n", drained ? "" : " (host stalled, data dropped)");
+}
+
+/**
+ * @brief Virtio console command handler
+ *
+ * Usage:
+ *   virtcon              - Show port status
+ *   virtcon bench [MB]   - Measure throughput (default 64 MB, at most 64 GB)
+ */
+void cmd_virtcon(int argc, char *argv[]) {
+    if (!virtio_console_present()) {
+        kprintf("No virtio-console device (start QEMU with -device virtio-serial-pci)\n");
+        return;
+    }
+
+    if (argc < 2) {
+        virtcon_status();
+        return;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        uint64_t megabytes = DEFAULT_BENCH_MB;
+        if (argc >= 3 && (!kstrtou64(argv[2], 10, &megabytes) || megabytes == 0 ||
+                          megabytes > MAX_BENCH_MB)) {
+            kprintf("Error: Invalid size '%s'\n", argv[2]);
+            return;
+        }
+        kprintf("\nStreaming %llu MB...\n", megabytes);
+        virtcon_bench(megabytes);
+        kprintf("\n");
+        return;
+    }
+
+    kprintf("Usage: virtcon [bench [MB]]\n");
+}
@@ -0,0 +1,227 @@
+/**
+ * @file cmd_vmalloc.c
+ * @brief Physical memory and demand-zero vmalloc report
+ *
+ * Without arguments, prints the frame allocator totals, the live vmalloc
+ * areas and how many demand-zero faults were served and how long they
+ * took. "vmalloc test" reserves an area, touches it at a stride so each
+ * touched page takes one fault, checks that every page reads back as
+ * zero and frees it again.
+ *
+ * THP BENCHMARK:
+ *   "vmalloc thpbench" populates an area once with 4KB pages and once
+ *   with 2MB pages and times random byte loads over it. With 4KB pages a
+ *   few MB already exceed the TLB reach, so most loads also pay a page
+ *   walk; 2MB pages cover 512 times as much per TLB entry.
+ */
+
+#include <shell/shell.h>
+#include <squirel/config.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/histogram/histogram.h>
+#include <lib/random/random.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/pmm.h>
+#include <arch/x86_64/mm/vmalloc.h>
+
+/** @brief Random loads per thpbench pass */
+#define THPBENCH_LOADS      (4u * 1024 * 1024)
+
+/** @brief Default thpbench area (the VM has 128MB unless run with MEM=) */
+#define THPBENCH_DEFAULT_MB 64
+
+/** @brief Merge target (too large for the stack) */
+static histogram_t merged;
+
+static void show_status(void) {
+    static vm_area_t areas[VMALLOC_MAX_AREAS];
+    char summary[160];
+    pmm_stats_t mem;
+
+    pmm_get_stats(&mem);
+    kprintf("\nPhysical memory: %llu KB free of %llu KB managed (RAM ends at 0x%llx)\n",
+            mem.free * PMM_FRAME_SIZE / 1024, mem.total * PMM_FRAME_SIZE / 1024,
+            mem.mem_top);
+    kprintf("  free 2MB blocks: %llu\n", mem.free_huge);
+
+    int n = vmalloc_get_areas(areas, VMALLOC_MAX_AREAS);
+    kprintf("\nvmalloc areas: %d of %d (huge pages %s)\n", n, VMALLOC_MAX_AREAS,
+            vmalloc_thp_enabled() ? "on" : "off");
+    for (int i = 0; i < n; i++) {
+        kprintf("  0x%llx  %8llu KB reserved  %8llu KB resident  %4llu x 2MB\n",
+                areas[i].start, areas[i].pages * 4, areas[i].resident * 4, areas[i].huge);
+    }
+
+    vmalloc_get_fault_hist(&merged);
+    hist_format(&merged, 1, summary, sizeof(summary));
+    kprintf("\nDemand-zero faults: %llu\n", merged.total);
+    if (merged.total) {
+        kprintf("  service time (ns)  %s\n", summary);
+    }
+    kprintf("\n");
+}
+
+static void run_test(uint64_t kb, uint64_t stride_kb) {
+    uint64_t size = kb * 1024;
+    uint64_t stride = stride_kb * 1024;
+
+    uint8_t *area = vmalloc(size);
+    if (!area) {
+        kprintf("vmalloc: cannot reserve %llu KB\n", kb);
+        return;
+    }
+
+    vmalloc_get_fault_hist(&merged);
+    uint64_t faults_before = merged.total;
+    uint64_t ns_before = merged.sum;
+
+    /* One store per stride: each touches a page that is not mapped yet */
+    uint64_t start = rdtsc();
+    uint64_t touched = 0;
+    for (uint64_t off = 0; off < size; off += stride) {
+        area[off] = 1;
+        touched++;
+    }
+    uint64_t cycles = rdtsc() - start;
+
+    vmalloc_get_fault_hist(&merged);
+    uint64_t faults = merged.total - faults_before;
+    uint64_t fault_ns = merged.sum - ns_before;
+
+    /* In the touched pages, everything but the stored bytes reads as zero */
+    uint64_t dirty = 0;
+    uint64_t checked = ~0ull;
+    for (uint64_t off = 0; off < size; off += stride) {
+        uint64_t page = off & ~4095ull;
+        if (page == checked) {
+            continue;
+        }
+        checked = page;
+        for (uint64_t i = page; i < page + 4096 && i < size; i++) {
+            if (area[i] != (i % stride == 0 ? 1 : 0)) {
+                dirty++;
+            }
+        }
+    }
+
+    vfree(area);
+
+    kprintf("\nTouched %llu KB area at %llu KB stride: %llu stores, %llu faults\n",
+            kb, stride_kb, touched, faults);
+    kprintf("  total            %llu us\n", tsc_cycles_to_us(cycles));
+    if (faults) {
+        kprintf("  per fault        %llu ns (handler %llu ns)\n",
+                tsc_cycles_to_ns(cycles) / faults, fault_ns / faults);
+    }
+    kprintf("  zero fill        %s\n\n", dirty ? "FAILED" : "ok");
+}
+
+/**
+ * @brief One thpbench pass: populate, then time random loads
+ *
+ * @return Cycles per 1000 loads
+ */
+static uint64_t thpbench_pass(uint64_t size, bool huge, uint64_t *faults) {
+    bool saved = vmalloc_thp_enabled();
+    vmalloc_set_thp(huge);
+
+    uint8_t *area = vmalloc(size);
+    if (!area) {
+        vmalloc_set_thp(saved);
+        return 0;
+    }
+
+    vmalloc_get_fault_hist(&merged);
+    uint64_t before = merged.total;
+    for (uint64_t off = 0; off < size; off += 4096) {
+        area[off] = (uint8_t)(off >> 12);
+    }
+    vmalloc_get_fault_hist(&merged);
+    *faults = merged.total - before;
+
+    /* xorshift64 indices scaled to the area, so no page is favoured */
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    uint64_t sum = 0;
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < THPBENCH_LOADS; i++) {
+        sum += area[((xorshift64(&x) >> 32) * size) >> 32];
+    }
+    uint64_t cycles = rdtsc() - start;
+    __asm__ volatile("" :: "r"(sum));
+
+    vfree(area);
+    vmalloc_set_thp(saved);
+    return cycles * 1000 / THPBENCH_LOADS;
+}
+
+static void run_thpbench(uint64_t mb) {
+    uint64_t size = mb << 20;
+    uint64_t faults_4k = 0;
+    uint64_t faults_2m = 0;
+
+    kprintf("\nRandom byte loads over %llu MB (%u per pass):\n", mb, THPBENCH_LOADS);
+
+    uint64_t small = thpbench_pass(size, false, &faults_4k);
+    uint64_t huge = thpbench_pass(size, true, &faults_2m);
+    if (!small || !huge) {
+        kprintf("vmalloc: cannot reserve %llu MB\n", mb);
+        return;
+    }
+
+    kprintf("  4KB pages  %6llu faults  %5llu ns/load\n", faults_4k,
+            tsc_cycles_to_ns(small) / 1000);
+    kprintf("  2MB pages  %6llu faults  %5llu ns/load\n", faults_2m,
+            tsc_cycles_to_ns(huge) / 1000);
+    kprintf("  speedup    %llu.%02llux\n\n", small / huge, small * 100 / huge % 100);
+}
+
+/**
+ * @brief Vmalloc command handler
+ *
+ * Usage:
+ *   vmalloc                          - Memory totals, areas, fault latency
+ *   vmalloc test <KB> [stride_KB]    - Fault in an area, verify, free it
+ *   vmalloc thp [on | off]           - Show or set transparent huge pages
+ *   vmalloc thpbench [MB]            - Random access, 4KB vs 2MB pages
+ */
+void cmd_vmalloc(int argc, char *argv[]) {
+    if (argc == 1) {
+        show_status();
+        return;
+    }
+
+    if (strcmp(argv[1], "thp") == 0) {
+        if (argc >= 3 && strcmp(argv[2], "on") == 0) {
+            vmalloc_set_thp(true);
+        } else if (argc >= 3 && strcmp(argv[2], "off") == 0) {
+            vmalloc_set_thp(false);
+        } else if (argc >= 3) {
+            kprintf("Usage: vmalloc thp [on | off]\n");
+            return;
+        }
+        kprintf("Transparent huge pages: %s\n", vmalloc_thp_enabled() ? "on" : "off");
+        return;
+    }
+
+    if (strcmp(argv[1], "thpbench") == 0) {
+        uint64_t mb = THPBENCH_DEFAULT_MB;
+        if (argc >= 3 && (!kstrtou64(argv[2], 10, &mb) || mb == 0 || mb > 1024)) {
+            kprintf("Usage: vmalloc thpbench [MB (1-1024)]\n");
+            return;
+        }
+        run_thpbench(mb);
+        return;
+    }
+
+    uint64_t kb = 0;
+    uint64_t stride_kb = 4;
+    if (strcmp(argv[1], "test") != 0 || argc < 3 || !kstrtou64(argv[2], 10, &kb) || kb == 0 ||
+        (argc >= 4 && (!kstrtou64(argv[3], 10, &stride_kb) || stride_kb == 0))) {
+        kprintf("Usage: vmalloc [test <KB> [stride_KB] | thp [on | off] | thpbench [MB]]\n");
+        return;
+    }
+
+    run_test(kb, stride_kb);
+}
@@ -0,0 +1,196 @@
+/**
+ * @file cmd_zram.c
+ * @brief Compressed RAM store report and reclaim test
+ *
+ * Without arguments, prints what zram holds, the compression ratio, how
+ * long swap-in faults took and how fast reclaim has been. "zram reclaim"
+ * evicts cold vmalloc pages on demand. "zram test" fills an area with a
+ * mix of zero, text-like and random pages, reclaims all of it, reads it
+ * back through swap-in faults and checks every byte.
+ */
+
+#include <shell/shell.h>
+#include <lib/printf/printf.h>
+#include <lib/string/string.h>
+#include <lib/memory/memory.h>
+#include <lib/histogram/histogram.h>
+#include <lib/random/random.h>
+#include <arch/x86_64.h>
+#include <arch/x86_64/cpu/tsc.h>
+#include <arch/x86_64/mm/vmalloc.h>
+#include <arch/x86_64/mm/zram.h>
+#include <core/stat.h>
+
+/** @brief Merge target (too large for the stack) */
+static histogram_t merged;
+
+static uint64_t stat_value(const char *name) {
+    const stat_desc_t *stat = stat_find(name);
+    return stat ? stat_read(stat) : 0;
+}
+
+/**
+ * @brief Print a ratio with two decimals
+ */
+static void print_ratio(const char *label, uint64_t num, uint64_t den) {
+    if (den == 0) {
+        kprintf("%s      -\n", label);
+        return;
+    }
+    kprintf("%s%4llu.%02llu\n", label, num / den, num * 100 / den % 100);
+}
+
+static void show_status(void) {
+    char summary[160];
+    zram_stats_t z;
+
+    zram_get_stats(&z);
+    kprintf("\nzram: %llu pages (%llu KB), %llu same-filled\n",
+            z.stored, z.stored * 4, z.same);
+    kprintf("  compressed data   %llu KB in %llu KB of pool frames\n",
+            z.compressed_bytes / 1024, z.pool_frames * 4);
+    print_ratio("  compression ratio ", (z.stored - z.same) * 4096, z.compressed_bytes);
+    print_ratio("  memory saved x    ", z.stored, z.pool_frames);
+
+    vmalloc_get_swapin_hist(&merged);
+    kprintf("\nSwap-in faults: %llu\n", merged.total);
+    if (merged.total) {
+        hist_format(&merged, 1, summary, sizeof(summary));
+        kprintf("  fault-in time (ns)  %s\n", summary);
+    }
+
+    uint64_t evicted = stat_value("reclaim_evicted");
+    uint64_t ns = stat_value("reclaim_ns");
+    kprintf("\nReclaim: %llu pages scanned, %llu evicted", stat_value("reclaim_scanned"),
+            evicted);
+    if (ns) {
+        kprintf(", %llu MB/s", evicted * 4096 * 1000 / ns);
+    }
+    kprintf("\n\n");
+}
+
+static void run_reclaim(uint64_t pages) {
+    uint64_t start = rdtsc();
+    uint64_t evicted = vmalloc_reclaim(pages);
+    uint64_t ns = tsc_cycles_to_ns(rdtsc() - start);
+
+    kprintf("Reclaimed %llu of %llu pages in %llu us", evicted, pages, ns / 1000);
+    if (ns) {
+        kprintf(" (%llu MB/s)", evicted * 4096 * 1000 / ns);
+    }
+    kprintf("\n");
+}
+
+/**
+ * @brief Fill page i: zero, text-like (compressible) or random
+ */
+static void fill_page(uint8_t *page, uint64_t i) {
+    switch (i % 4) {
+    case 0:
+        memset(page, 0, 4096);      /* Touched, so it is resident */
+        break;
+    case 3: {
+        uint64_t x = 0x9E3779B97F4A7C15ull ^ i;
+        for (int b = 0; b < 4096; b++) {
+            page[b] = (uint8_t)xorshift64(&x);
+        }
+        break;
+    }
+    default:
+        for (int b = 0; b < 4096; b++) {
+            page[b] = (uint8_t)("squirel page reclaim test "[(b + i) % 26] + (b / 512));
+        }
+        break;
+    }
+}
+
+static void run_test(uint64_t mb) {
+    static uint8_t expect[4096];
+    uint64_t pages = mb * 256;
+
+    uint8_t *area = vmalloc(pages * 4096);
+    if (!area) {
+        kprintf("zram: cannot reserve %llu MB\n", mb);
+        return;
+    }
+
+    /* 4KB pages only: 2MB pages are never reclaimed */
+    bool thp = vmalloc_thp_enabled();
+    vmalloc_set_thp(false);
+    for (uint64_t i = 0; i < pages; i++) {
+        fill_page(area + i * 4096, i);
+    }
+    vmalloc_set_thp(thp);
+
+    zram_stats_t before;
+    zram_get_stats(&before);
+
+    uint64_t start = rdtsc();
+    uint64_t evicted = vmalloc_reclaim(pages);
+    uint64_t reclaim_cycles = rdtsc() - start;
+
+    zram_stats_t after;
+    zram_get_stats(&after);
+
+    vmalloc_get_swapin_hist(&merged);
+    uint64_t faults_before = merged.total;
+
+    uint64_t bad = 0;
+    start = rdtsc();
+    for (uint64_t i = 0; i < pages; i++) {
+        memset(expect, 0, sizeof(expect));
+        fill_page(expect, i);
+        if (memcmp(area + i * 4096, expect, sizeof(expect)) != 0) {
+            bad++;
+        }
+    }
+    uint64_t check_cycles = rdtsc() - start;
+
+    vmalloc_get_swapin_hist(&merged);
+    uint64_t faults = merged.total - faults_before;
+    vfree(area);
+
+    uint64_t reclaim_ns = tsc_cycles_to_ns(reclaim_cycles);
+    kprintf("\n%llu MB (1/4 zero, 1/2 text, 1/4 random pages):\n", mb);
+    kprintf("  reclaimed       %llu of %llu pages in %llu us", evicted, pages,
+            reclaim_ns / 1000);
+    if (reclaim_ns) {
+        kprintf(" (%llu MB/s)", evicted * 4096 * 1000 / reclaim_ns);
+    }
+    kprintf("\n  same-filled     %llu\n", after.same - before.same);
+    print_ratio("  memory saved x  ", after.stored - before.stored,
+                after.pool_frames - before.pool_frames);
+    kprintf("  read back       %llu swap-ins in %llu us", faults,
+            tsc_cycles_to_us(check_cycles));
+    if (faults) {
+        kprintf(" (%llu ns each)", tsc_cycles_to_ns(check_cycles) / faults);
+    }
+    kprintf("\n  contents        %s\n\n", bad ? "CORRUPT" : "ok");
+}
+
+/**
+ * @brief Zram command handler
+ *
+ * Usage:
+ *   zram                  - Store contents, ratio, swap-in latency, reclaim rate
+ *   zram reclaim <pages>  - Compress up to that many cold pages
+ *   zram test [MB]        - Fill, reclaim, read back and verify an area
+ */
+void cmd_zram(int argc, char *argv[]) {
+    uint64_t n;
+
+    if (argc == 1) {
+        show_status();
+    } else if (strcmp(argv[1], "reclaim") == 0 && argc >= 3 && kstrtou64(argv[2], 10, &n)) {
+        run_reclaim(n);
+    } else if (strcmp(argv[1], "test") == 0) {
+        n = 8;
+        if (argc >= 3 && (!kstrtou64(argv[2], 10, &n) || n == 0)) {
+            kprintf("Usage: zram test [MB]\n");
+            return;
+        }
+        run_test(n);
+    } else {
+        kprintf("Usage: zram [reclaim <pages> | test [MB]]\n");
+    }
+}
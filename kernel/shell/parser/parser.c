@@ -31,10 +31,8 @@ bool parser_parse(const char *cmdline, parsed_cmd_t *cmd) {
         return false;
     }
     
-    /* Initialize output */
+    /* Initialize output (only argv[0..argc] is written, not the whole struct) */
     cmd->argc = 0;
-    memset(cmd->argv, 0, sizeof(cmd->argv));
-    memset(cmd->buffer, 0, sizeof(cmd->buffer));
     
     /* Copy command line to buffer */
     size_t len = strlen(cmdline);
@@ -75,5 +73,8 @@ bool parser_parse(const char *cmdline, parsed_cmd_t *cmd) {
         }
     }
     
+    if (cmd->argc < SHELL_MAX_ARGS) {
+        cmd->argv[cmd->argc] = NULL;
+    }
     return true;
 }
@@ -32,6 +32,8 @@ typedef struct {
  * 
  * @note The cmdline is copied into cmd->buffer and modified
  *       (spaces replaced with nulls). argv pointers point into buffer.
+ *       cmd need not be cleared first: only the bytes of the line and
+ *       argv[0..argc] are written (argv[argc] is NULL if there is room).
  */
 bool parser_parse(const char *cmdline, parsed_cmd_t *cmd);
 
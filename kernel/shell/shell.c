@@ -10,6 +10,12 @@
  *   - Enter: Execute command
  *   - Ctrl+C: Cancel current line (future)
  *   - Ctrl+L: Clear screen (future)
+ *
+ * AUTORUN:
+ *   Before the first prompt, the lines of the QEMU fw_cfg file
+ *   SHELL_AUTORUN_FW_CFG_FILE are run as if typed, each echoed after the
+ *   prompt. Empty lines and lines starting with '#' are skipped. "make
+ *   pgo" drives its benchmark runs this way.
  */
 
 #include "shell.h"
@@ -17,9 +23,15 @@
 #include <squirel/config.h>
 #include <drivers/vga/vga_text.h>
 #include <drivers/keyboard/keyboard.h>
+#include <drivers/fw_cfg/fw_cfg.h>
 #include <lib/string/string.h>
 #include <lib/printf/printf.h>
 #include <lib/memory/memory.h>
+#include <lib/arena/arena.h>
+#include <arch/x86_64.h>
+#include <core/stat.h>
+#include <core/export.h>
+#include <core/module.h>
 
 /* ============================================================================
  * Command Table
@@ -41,6 +53,16 @@ typedef struct {
 static shell_command_t commands[MAX_COMMANDS];
 static int num_commands = 0;
 
+/** @brief Usage counters, same index as commands[] */
+static shell_cmd_stats_t cmd_stats[MAX_COMMANDS];
+
+/** @brief Per-command scratch memory: first chunk, then frames as needed */
+static uint8_t arena_buf[SHELL_ARENA_SIZE] ALIGNED(16);
+static arena_t arena;
+
+DEFINE_STAT(shell_commands, "Command lines executed");
+DEFINE_STAT(shell_unknown, "Command lines naming no known command");
+
 /* ============================================================================
  * Forward Declarations for Built-in Commands
  * ============================================================================ */
@@ -51,6 +73,26 @@ extern void cmd_echo(int argc, char *argv[]);
 extern void cmd_info(int argc, char *argv[]);
 extern void cmd_color(int argc, char *argv[]);
 extern void cmd_memdump(int argc, char *argv[]);
+extern void cmd_virtcon(int argc, char *argv[]);
+extern void cmd_console(int argc, char *argv[]);
+extern void cmd_fbbench(int argc, char *argv[]);
+extern void cmd_top(int argc, char *argv[]);
+extern void cmd_stat(int argc, char *argv[]);
+extern void cmd_time(int argc, char *argv[]);
+extern void cmd_irqlat(int argc, char *argv[]);
+extern void cmd_metrics(int argc, char *argv[]);
+extern void cmd_vmalloc(int argc, char *argv[]);
+extern void cmd_zram(int argc, char *argv[]);
+extern void cmd_ksm(int argc, char *argv[]);
+extern void cmd_shbench(int argc, char *argv[]);
+extern void cmd_checksum(int argc, char *argv[]);
+extern void cmd_cache(int argc, char *argv[]);
+extern void cmd_boot(int argc, char *argv[]);
+extern void cmd_module(int argc, char *argv[]);
+extern void cmd_hibernate(int argc, char *argv[]);
+extern void cmd_kdump(int argc, char *argv[]);
+extern void cmd_gcov(int argc, char *argv[]);
+extern void cmd_poweroff(int argc, char *argv[]);
 
 /* ============================================================================
  * Private Functions
@@ -125,6 +167,60 @@ static void shell_init_commands(void) {
     shell_register_command("info",    "Display system information",    cmd_info);
     shell_register_command("color",   "Set text colors",               cmd_color);
     shell_register_command("memdump", "Dump memory at address",        cmd_memdump);
+    shell_register_command("virtcon", "Virtio console status/bench",   cmd_virtcon);
+    shell_register_command("console", "Console sinks/bench",           cmd_console);
+    shell_register_command("fbbench", "Framebuffer console benchmark", cmd_fbbench);
+    shell_register_command("top",     "Live CPU/IRQ/memory monitor",   cmd_top);
+    shell_register_command("stat",    "Per-CPU statistics counters",   cmd_stat);
+    shell_register_command("time",    "Time a command (-n N: percentiles)", cmd_time);
+    shell_register_command("irqlat",  "Interrupt latency percentiles", cmd_irqlat);
+    shell_register_command("metrics", "Prometheus metrics snapshot",   cmd_metrics);
+    shell_register_command("vmalloc", "Memory totals, demand-zero test", cmd_vmalloc);
+    shell_register_command("zram",    "Compressed RAM store, reclaim", cmd_zram);
+    shell_register_command("ksm",     "Same-page merging",             cmd_ksm);
+    shell_register_command("shbench", "Shell commands per second",     cmd_shbench);
+    shell_register_command("checksum", "CRC32C/xxHash of memory, GB/s", cmd_checksum);
+    shell_register_command("cache",   "Cache/TLB topology, page colors", cmd_cache);
+    shell_register_command("boot",    "Initcall timeline, critical path", cmd_boot);
+    shell_register_command("module",  "Loadable modules",              cmd_module);
+    shell_register_command("hibernate", "Snapshot memory to disk, resume at boot", cmd_hibernate);
+    shell_register_command("kdump",   "Crash dump sink and settings",  cmd_kdump);
+    shell_register_command("gcov",    "Profile counters (make pgo)",   cmd_gcov);
+    shell_register_command("poweroff", "Power off (QEMU)",             cmd_poweroff);
+}
+
+/**
+ * @brief Run the command lines of the fw_cfg autorun file, if there is one
+ */
+static void shell_autorun(void) {
+    static char script[SHELL_AUTORUN_MAX];
+    char line[SHELL_MAX_CMD_LEN];
+
+    ssize_t len = fw_cfg_read_file(SHELL_AUTORUN_FW_CFG_FILE, script, sizeof(script));
+    if (len <= 0) {
+        return;
+    }
+
+    for (ssize_t pos = 0; pos < len;) {
+        size_t n = 0;
+        while (pos < len && script[pos] != '\n') {
+            if (n < sizeof(line) - 1 && script[pos] != '\r') {
+                line[n++] = script[pos];
+            }
+            pos++;
+        }
+        pos++;
+        line[n] = '\0';
+
+        if (n == 0 || line[0] == '#') {
+            continue;
+        }
+        vga_set_color(VGA_LIGHT_GREEN, VGA_BLACK);
+        kprintf("%s", SHELL_PROMPT);
+        vga_set_color(VGA_LIGHT_GRAY, VGA_BLACK);
+        kprintf("%s\n", line);
+        shell_execute(line);
+    }
 }
 
 /* ============================================================================
@@ -139,38 +235,63 @@ void shell_register_command(const char *name, const char *help, shell_cmd_fn han
     commands[num_commands].name = name;
     commands[num_commands].help = help;
     commands[num_commands].handler = handler;
+    cmd_stats[num_commands].name = name;
     num_commands++;
 }
+EXPORT_SYMBOL(shell_register_command);
 
 void shell_execute(const char *cmdline) {
-    parsed_cmd_t cmd;
-    
+    /* Everything the command allocates goes when it returns (nested runs too) */
+    arena_mark_t mark = arena_mark(&arena);
+    parsed_cmd_t *cmd = arena_alloc(&arena, sizeof(parsed_cmd_t));
+
     /* Parse command line */
-    if (!parser_parse(cmdline, &cmd)) {
+    if (!cmd || !parser_parse(cmdline, cmd)) {
         kprintf("Error: Failed to parse command\n");
+        arena_reset(&arena, mark);
         return;
     }
-    
+
     /* Empty command */
-    if (cmd.argc == 0) {
+    if (cmd->argc == 0) {
+        arena_reset(&arena, mark);
         return;
     }
-    
-    /* Find and execute command */
-    shell_command_t *command = shell_find_command(cmd.argv[0]);
+
+    /* Find and execute command, loading the module of that name if need be */
+    shell_command_t *command = shell_find_command(cmd->argv[0]);
+    if (command == NULL && module_autoload(cmd->argv[0])) {
+        command = shell_find_command(cmd->argv[0]);
+    }
+    stat_inc(shell_commands);
     if (command != NULL) {
-        command->handler(cmd.argc, cmd.argv);
+        shell_cmd_stats_t *stats = &cmd_stats[command - commands];
+        uint64_t start = rdtsc();
+        command->handler(cmd->argc, cmd->argv);
+        stats->cycles += rdtsc() - start;
+        stats->calls++;
     } else {
-        kprintf("Unknown command: %s\n", cmd.argv[0]);
+        stat_inc(shell_unknown);
+        kprintf("Unknown command: %s\n", cmd->argv[0]);
         kprintf("Type 'help' for available commands.\n");
     }
+    arena_reset(&arena, mark);
+}
+
+void *shell_alloc(size_t size) {
+    return arena_alloc(&arena, size);
+}
+
+const arena_t *shell_get_arena(void) {
+    return &arena;
 }
 
 NORETURN void shell_run(void) {
     char line[SHELL_MAX_CMD_LEN];
     
-    /* Initialize commands */
+    /* Initialize commands and their scratch arena */
     shell_init_commands();
+    arena_init(&arena, arena_buf, sizeof(arena_buf));
     
     /* Welcome message */
     vga_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
@@ -186,6 +307,9 @@ NORETURN void shell_run(void) {
     kprintf("Welcome to Squirel OS v%s\n", SQUIREL_VERSION_STRING);
     kprintf("Type 'help' for available commands.\n\n");
     
+    /* Commands QEMU passed in, if any */
+    shell_autorun();
+    
     /* Main shell loop */
     for (;;) {
         /* Print prompt */
@@ -214,3 +338,11 @@ int shell_get_commands(const shell_command_t **out_commands) {
     *out_commands = commands;
     return num_commands;
 }
+
+int shell_get_cmd_stats(shell_cmd_stats_t *out, int max) {
+    int n = (num_commands < max) ? num_commands : max;
+    for (int i = 0; i < n; i++) {
+        out[i] = cmd_stats[i];
+    }
+    return n;
+}
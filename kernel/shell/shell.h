@@ -11,6 +11,7 @@
 #define _SHELL_H
 
 #include <squirel/types.h>
+#include <lib/arena/arena.h>
 
 /**
  * @brief Start the shell main loop
@@ -27,10 +28,29 @@ NORETURN void shell_run(void);
 /**
  * @brief Execute a single command
  * 
+ * The parsed line and anything the command gets from shell_alloc() come
+ * from the shell arena, and are freed in one step when it returns.
+ * 
  * @param cmdline  The full command line to execute
  */
 void shell_execute(const char *cmdline);
 
+/**
+ * @brief Scratch memory for the running command
+ * 
+ * Freed automatically when the command returns; never pass it to
+ * anything that outlives the command.
+ * 
+ * @param size  Bytes wanted (at most ARENA_MAX_ALLOC)
+ * @return      16-byte aligned memory (not cleared), or NULL
+ */
+void *shell_alloc(size_t size);
+
+/**
+ * @brief The shell arena, for reporting its size and peak use
+ */
+const arena_t *shell_get_arena(void);
+
 /**
  * @brief Register a shell command
  * 
@@ -42,4 +62,22 @@ typedef void (*shell_cmd_fn)(int argc, char *argv[]);
 
 void shell_register_command(const char *name, const char *help, shell_cmd_fn handler);
 
+/**
+ * @brief CPU time used by one command
+ */
+typedef struct {
+    const char *name;           /**< Command name */
+    uint64_t calls;             /**< Completed runs */
+    uint64_t cycles;            /**< TSC cycles spent in the handler, summed */
+} shell_cmd_stats_t;
+
+/**
+ * @brief Copy the per-command usage counters
+ * 
+ * @param out  Array receiving one entry per registered command
+ * @param max  Capacity of out
+ * @return     Number of entries written
+ */
+int shell_get_cmd_stats(shell_cmd_stats_t *out, int max);
+
 #endif /* _SHELL_H */
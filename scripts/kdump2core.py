@@ -0,0 +1,402 @@
+#!/usr/bin/env python3
+"""
+kdump2core.py - Turn a Squirel OS crash dump into an ELF core file for gdb
+
+The kernel writes crash dumps (kernel/core/kdump.h) to the virtio trace
+port, the boot disk or COM1. Each input is searched for the last complete
+dump, and the first input that has one is used:
+
+  build/trace.bin      virtio trace port: the dump follows whatever else
+                       was traced, so the file is searched for its magic
+  build/squirel.img    boot disk: the dump at KDUMP_LBA
+  a serial log         base64 between BEGIN/END SQUIREL KDUMP lines
+
+The core holds one NT_PRSTATUS note (the registers at the exception) and
+a PT_LOAD segment per run of contiguous dumped memory: the faulting stack,
+and with a memory dump every page in use (identity-mapped frames at their
+physical address, vmalloc pages at their virtual one). The console log
+goes next to the core with a .log suffix.
+
+Usage:
+  scripts/kdump2core.py [-o build/kdump.core] [--gdb build/kernel.elf] INPUT...
+
+  make kdump does this for build/trace.bin and build/squirel.img and
+  starts gdb.
+"""
+
+import argparse
+import base64
+import mmap
+import os
+import struct
+import sys
+
+# kernel/core/kdump.h
+KDUMP_MAGIC = b"SQKDUMP1"
+KDUMP_VERSION = 1
+KDUMP_F_MEMORY = 1 << 0
+REC_END, REC_CPU, REC_STACK, REC_LOG, REC_PAGE = 0, 1, 2, 3, 4
+HEADER = struct.Struct("<8sIIQQ96s")
+RECORD = struct.Struct("<II")
+
+# include/squirel/config.h
+KDUMP_LBA = 2105344
+SECTOR = 512
+
+PAGE_SIZE = 4096
+
+SERIAL_BEGIN = b"-----BEGIN SQUIREL KDUMP-----"
+SERIAL_END = b"-----END SQUIREL KDUMP-----"
+
+# interrupt_frame_t (kernel/arch/x86_64/cpu/idt.h), then kdump_cpu_t's extras
+FRAME_FIELDS = ("r15", "r14", "r13", "r12", "r11", "r10", "r9", "r8",
+                "rbp", "rdi", "rsi", "rdx", "rcx", "rbx", "rax",
+                "vector", "error_code", "rip", "cs", "rflags", "rsp", "ss",
+                "cr0", "cr2", "cr3", "cr4", "fs_base", "gs_base")
+
+EXCEPTION_SIGNALS = {0: 8, 1: 5, 3: 5, 4: 8, 5: 11, 6: 4, 16: 8, 19: 8}
+SIGSEGV = 11
+
+
+class DumpError(Exception):
+    pass
+
+
+# ============================================================================
+# CRC32C and LZ4
+# ============================================================================
+
+def _crc32c_table():
+    table = []
+    for i in range(256):
+        c = i
+        for _ in range(8):
+            c = (c >> 1) ^ 0x82F63B78 if c & 1 else c >> 1
+        table.append(c)
+    return table
+
+
+_CRC_TABLE = _crc32c_table()
+
+
+try:
+    import crc32c as _fast_crc      # pip install crc32c: much faster on big dumps
+except ImportError:
+    _fast_crc = None
+
+
+def crc32c(data, crc=0):
+    if _fast_crc:
+        return _fast_crc.crc32c(bytes(data), crc)
+    crc ^= 0xFFFFFFFF
+    table = _CRC_TABLE
+    for b in bytes(data):
+        crc = table[(crc ^ b) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
+def lz4_block(src, size):
+    """Decompress one LZ4 block that must expand to exactly size bytes."""
+    dst = bytearray()
+    i = 0
+    n = len(src)
+    while i < n:
+        token = src[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = src[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        dst += src[i:i + lit]
+        i += lit
+        if i >= n:
+            break
+        off = src[i] | src[i + 1] << 8
+        i += 2
+        match = token & 15
+        if match == 15:
+            while True:
+                b = src[i]
+                i += 1
+                match += b
+                if b != 255:
+                    break
+        match += 4
+        start = len(dst) - off
+        if off == 0 or start < 0:
+            raise DumpError("bad LZ4 offset")
+        if off >= match:
+            dst += dst[start:start + match]
+        else:
+            for k in range(match):
+                dst.append(dst[start + k])
+    if len(dst) != size:
+        raise DumpError("LZ4 block expands to %d bytes, not %d" % (len(dst), size))
+    return bytes(dst)
+
+
+# ============================================================================
+# Dump parsing
+# ============================================================================
+
+def parse(buf, off):
+    """Parse the dump at buf[off:]; raises DumpError unless it is complete."""
+    if len(buf) < off + HEADER.size:
+        raise DumpError("truncated header")
+    magic, version, flags, tsc, tsc_khz, reason = HEADER.unpack_from(buf, off)
+    if magic != KDUMP_MAGIC or version != KDUMP_VERSION:
+        raise DumpError("no dump header")
+
+    dump = {
+        "flags": flags,
+        "tsc": tsc,
+        "tsc_khz": tsc_khz,
+        "reason": reason.split(b"\0", 1)[0].decode("ascii", "replace"),
+        "cpu": None,
+        "log": b"",
+        "pages": {},
+        "stats": {"pages": 0, "zero": 0, "raw": 0, "bytes": 0},
+    }
+    pos = off + HEADER.size
+    while True:
+        if len(buf) < pos + RECORD.size:
+            raise DumpError("dump cut short (no end record)")
+        rtype, length = RECORD.unpack_from(buf, pos)
+        data_at = pos + RECORD.size
+        if len(buf) < data_at + length:
+            raise DumpError("dump cut short in a record")
+        data = buf[data_at:data_at + length]
+
+        if rtype == REC_END:
+            if length != 4:
+                raise DumpError("bad end record")
+            (crc,) = struct.unpack("<I", data)
+            if crc32c(buf[off:pos]) != crc:
+                raise DumpError("checksum mismatch")
+            dump["stats"]["bytes"] = data_at + length - off
+            return dump
+        elif rtype == REC_CPU:
+            if length < 8 * len(FRAME_FIELDS):
+                raise DumpError("short register record")
+            values = struct.unpack_from("<%dQ" % len(FRAME_FIELDS), data)
+            dump["cpu"] = dict(zip(FRAME_FIELDS, values))
+        elif rtype in (REC_STACK, REC_PAGE) and length < 8:
+            raise DumpError("short memory record")
+        elif rtype == REC_STACK:
+            (addr,) = struct.unpack_from("<Q", data)
+            body = bytes(data[8:])
+            for i in range(0, len(body), PAGE_SIZE):
+                page = body[i:i + PAGE_SIZE].ljust(PAGE_SIZE, b"\0")
+                dump["pages"].setdefault(addr + i, page)
+        elif rtype == REC_LOG:
+            dump["log"] = bytes(data)
+        elif rtype == REC_PAGE:
+            (addr,) = struct.unpack_from("<Q", data)
+            body = bytes(data[8:])
+            if not body:
+                page = bytes(PAGE_SIZE)
+                dump["stats"]["zero"] += 1
+            elif len(body) == PAGE_SIZE:
+                page = body
+                dump["stats"]["raw"] += 1
+            else:
+                try:
+                    page = lz4_block(body, PAGE_SIZE)
+                except IndexError:
+                    raise DumpError("LZ4 block overruns its record")
+            dump["pages"][addr] = page
+            dump["stats"]["pages"] += 1
+        # Unknown record types are skipped: newer kernels may add some
+        pos = data_at + length
+
+
+def find_dump(path):
+    """The last complete dump in a file, or None."""
+    with open(path, "rb") as f:
+        if os.fstat(f.fileno()).st_size == 0:
+            return None
+        buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        error = None
+
+        # Boot disk image
+        disk_off = KDUMP_LBA * SECTOR
+        if buf[disk_off:disk_off + len(KDUMP_MAGIC)] == KDUMP_MAGIC:
+            try:
+                return parse(buf, disk_off)
+            except DumpError as e:
+                error = e
+
+        # Serial log. The marker and the magic also turn up inside dumped
+        # memory (the kernel's own strings), so every candidate is tried,
+        # newest first.
+        begin = buf.rfind(SERIAL_BEGIN)
+        while begin >= 0:
+            end = buf.find(SERIAL_END, begin)
+            if end >= 0:
+                text = buf[begin + len(SERIAL_BEGIN):end]
+                try:
+                    return parse(base64.b64decode(b"".join(text.split()), validate=True), 0)
+                except (DumpError, ValueError) as e:
+                    error = error or e
+            begin = buf.rfind(SERIAL_BEGIN, 0, begin)
+
+        # Anything else (trace port capture): the dump follows other traffic
+        at = buf.rfind(KDUMP_MAGIC)
+        while at >= 0:
+            try:
+                return parse(buf, at)
+            except DumpError as e:
+                error = error or e
+            at = buf.rfind(KDUMP_MAGIC, 0, at)
+
+        if error:
+            raise DumpError("%s: %s" % (path, error))
+        return None
+
+
+# ============================================================================
+# ELF core
+# ============================================================================
+
+def prstatus(cpu, signal):
+    regs = (cpu["r15"], cpu["r14"], cpu["r13"], cpu["r12"], cpu["rbp"], cpu["rbx"],
+            cpu["r11"], cpu["r10"], cpu["r9"], cpu["r8"], cpu["rax"], cpu["rcx"],
+            cpu["rdx"], cpu["rsi"], cpu["rdi"], 0xFFFFFFFFFFFFFFFF, cpu["rip"], cpu["cs"],
+            cpu["rflags"], cpu["rsp"], cpu["ss"], cpu["fs_base"], cpu["gs_base"],
+            cpu["ss"], cpu["ss"], 0, 0)
+    out = bytearray(336)                        # struct elf_prstatus (x86_64)
+    struct.pack_into("<iii", out, 0, signal, 0, 0)
+    struct.pack_into("<h", out, 12, signal)
+    struct.pack_into("<iiii", out, 32, 1, 0, 1, 1)
+    struct.pack_into("<27Q", out, 112, *regs)
+    return bytes(out)
+
+
+def prpsinfo():
+    out = bytearray(136)                        # struct elf_prpsinfo (x86_64)
+    struct.pack_into("<cc", out, 0, b"\0", b"R")
+    struct.pack_into("<iiii", out, 24, 1, 0, 1, 1)
+    out[40:40 + 7] = b"squirel"
+    out[56:56 + 6] = b"kernel"
+    return bytes(out)
+
+
+def note(name, ntype, desc):
+    name = name + b"\0"
+    pad = lambda b: b + bytes(-len(b) % 4)
+    return struct.pack("<III", len(name), len(desc), ntype) + pad(name) + pad(desc)
+
+
+def runs(pages):
+    """Group page addresses into (start, [pages]) runs of contiguous memory."""
+    out = []
+    for addr in sorted(pages):
+        if out and out[-1][0] + len(out[-1][1]) * PAGE_SIZE == addr:
+            out[-1][1].append(pages[addr])
+        else:
+            out.append((addr, [pages[addr]]))
+    return out
+
+
+def write_core(dump, path):
+    cpu = dump["cpu"]
+    signal = EXCEPTION_SIGNALS.get(cpu["vector"], SIGSEGV)
+    notes = note(b"CORE", 1, prstatus(cpu, signal)) + note(b"CORE", 3, prpsinfo())
+    segments = runs(dump["pages"])
+
+    phnum = 1 + len(segments)
+    offset = 64 + 56 * phnum
+    note_off = offset
+    offset += len(notes)
+    offset += -offset % PAGE_SIZE
+
+    phdrs = [struct.pack("<IIQQQQQQ", 4, 0, note_off, 0, 0, len(notes), 0, 4)]
+    for start, data in segments:
+        size = len(data) * PAGE_SIZE
+        # Identity-mapped memory: physical address = virtual address
+        paddr = start if start < (1 << 47) else 0
+        phdrs.append(struct.pack("<IIQQQQQQ", 1, 7, offset, start, paddr, size, size,
+                                 PAGE_SIZE))
+        offset += size
+
+    ident = b"\x7fELF" + bytes([2, 1, 1, 0]) + bytes(8)
+    ehdr = ident + struct.pack("<HHIQQQIHHHHHH", 4, 62, 1, 0, 64, 0, 0, 64, 56, phnum,
+                               0, 0, 0)
+    with open(path, "wb") as f:
+        f.write(ehdr)
+        f.write(b"".join(phdrs))
+        f.write(notes)
+        f.write(bytes(-f.tell() % PAGE_SIZE))
+        for _, data in segments:
+            for page in data:
+                f.write(page)
+
+
+# ============================================================================
+# Main
+# ============================================================================
+
+def summary(dump, source):
+    cpu = dump["cpu"]
+    s = dump["stats"]
+    ms = dump["tsc"] // dump["tsc_khz"] if dump["tsc_khz"] else 0
+    print("Dump:    %s, %d KB" % (source, s["bytes"] >> 10))
+    print("Crash:   %s, %d.%03d s after power-on" % (dump["reason"], ms // 1000, ms % 1000))
+    if cpu:
+        names = ("rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp",
+                 "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+                 "rip", "rflags", "cr2", "cr3", "error_code")
+        for i in range(0, len(names), 4):
+            print("  " + "  ".join("%-6s %016x" % (n, cpu[n]) for n in names[i:i + 4]))
+    if dump["flags"] & KDUMP_F_MEMORY:
+        print("Memory:  %d pages (%d zero, %d stored raw)" % (s["pages"], s["zero"], s["raw"]))
+    else:
+        print("Memory:  stack only")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Convert a Squirel OS crash dump to an ELF core")
+    ap.add_argument("inputs", nargs="+", help="trace.bin, disk image or serial log")
+    ap.add_argument("-o", "--output", default="build/kdump.core", help="core file to write")
+    ap.add_argument("--gdb", metavar="ELF", help="start gdb on ELF (build/kernel.elf) and the core")
+    args = ap.parse_args()
+
+    dump = None
+    source = None
+    for path in args.inputs:
+        if not os.path.exists(path):
+            continue
+        try:
+            dump = find_dump(path)
+        except DumpError as e:
+            print("kdump2core: %s" % e, file=sys.stderr)
+            continue
+        if dump:
+            source = path
+            break
+    if not dump:
+        sys.exit("kdump2core: no complete crash dump in %s" % ", ".join(args.inputs))
+    if not dump["cpu"]:
+        sys.exit("kdump2core: dump has no registers")
+
+    summary(dump, source)
+    write_core(dump, args.output)
+    log_path = os.path.splitext(args.output)[0] + ".log"
+    if log_path == args.output:
+        log_path = args.output + ".log"
+    with open(log_path, "wb") as f:
+        f.write(dump["log"])
+    print("Core:    %s" % args.output)
+    print("Log:     %s (%d bytes)" % (log_path, len(dump["log"])))
+
+    if args.gdb:
+        sys.stdout.flush()
+        os.execvp("gdb", ["gdb", "-q", args.gdb, args.output])
+
+
+if __name__ == "__main__":
+    main()
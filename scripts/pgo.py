@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""
+pgo.py - Host side of "make pgo"
+
+extract   A training kernel (-fprofile-generate) exports its .gcda files
+          over debugcon or COM1 with "gcov export" (kernel/core/gcov.h):
+          base64 between BEGIN/END SQUIREL GCOV lines. The last complete
+          export in the log is written out, one .gcda per object, under
+          the name the -fprofile-use build looks for (the object's name
+          in the output directory).
+
+report    Compares the benchmark suite (scripts/pgo-bench.txt) as run by
+          the plain and the PGO kernel: the percentiles of every
+          "time -n", shbench throughput, per-backend console throughput
+          and the interrupt latency and handler time from irqlat. A
+          "time -n N" that recorded other than N samples stops the report.
+
+Usage:
+  scripts/pgo.py extract LOG -o DIR
+  scripts/pgo.py report PLAIN_LOG PGO_LOG
+"""
+
+import argparse
+import base64
+import os
+import re
+import struct
+import sys
+
+EXPORT_BEGIN = b"-----BEGIN SQUIREL GCOV-----"
+EXPORT_END = b"-----END SQUIREL GCOV-----"
+
+# include/squirel/config.h
+SHELL_PROMPT = "squirel$ "
+
+
+class ExportError(Exception):
+    pass
+
+
+# ============================================================================
+# CRC32C
+# ============================================================================
+
+def _crc32c_table():
+    table = []
+    for i in range(256):
+        c = i
+        for _ in range(8):
+            c = (c >> 1) ^ 0x82F63B78 if c & 1 else c >> 1
+        table.append(c)
+    return table
+
+
+_CRC_TABLE = _crc32c_table()
+
+
+try:
+    import crc32c as _fast_crc      # pip install crc32c
+except ImportError:
+    _fast_crc = None
+
+
+def crc32c(data, crc=0):
+    if _fast_crc:
+        return _fast_crc.crc32c(bytes(data), crc)
+    crc ^= 0xFFFFFFFF
+    table = _CRC_TABLE
+    for b in bytes(data):
+        crc = table[(crc ^ b) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
+# ============================================================================
+# Profile export
+# ============================================================================
+
+def parse_export(data):
+    """List of (gcda path, contents); raises ExportError unless complete."""
+    files = []
+    pos = 0
+    while True:
+        if len(data) < pos + 4:
+            raise ExportError("export cut short")
+        (name_len,) = struct.unpack_from("<I", data, pos)
+        pos += 4
+        if name_len == 0:
+            break
+        name = data[pos:pos + name_len].decode("utf-8", "replace")
+        pos += name_len
+        if len(data) < pos + 4:
+            raise ExportError("export cut short")
+        (data_len,) = struct.unpack_from("<I", data, pos)
+        pos += 4
+        if len(data) < pos + data_len:
+            raise ExportError("export cut short in %s" % name)
+        files.append((name, data[pos:pos + data_len]))
+        pos += data_len
+
+    if len(data) < pos + 4:
+        raise ExportError("no checksum")
+    (crc,) = struct.unpack_from("<I", data, pos)
+    if crc32c(data[:pos]) != crc:
+        raise ExportError("checksum mismatch")
+    return files
+
+
+def find_export(path):
+    """The last complete export in a log."""
+    with open(path, "rb") as f:
+        buf = f.read()
+    error = None
+    begin = buf.rfind(EXPORT_BEGIN)
+    while begin >= 0:
+        end = buf.find(EXPORT_END, begin)
+        if end >= 0:
+            text = buf[begin + len(EXPORT_BEGIN):end]
+            try:
+                return parse_export(base64.b64decode(b"".join(text.split()), validate=True))
+            except (ExportError, ValueError) as e:
+                error = error or e
+        begin = buf.rfind(EXPORT_BEGIN, 0, begin)
+    raise ExportError("%s: %s" % (path, error or "no profile export"))
+
+
+def extract(args):
+    try:
+        files = find_export(args.log)
+    except (OSError, ExportError) as e:
+        sys.exit("pgo: %s" % e)
+
+    os.makedirs(args.output, exist_ok=True)
+    total = 0
+    for name, data in files:
+        with open(os.path.join(args.output, os.path.basename(name)), "wb") as f:
+            f.write(data)
+        total += len(data)
+    print("[PGO] %d profiles, %d KB, in %s" % (len(files), total >> 10, args.output))
+
+
+# ============================================================================
+# Benchmark report
+# ============================================================================
+
+HIST_RE = re.compile(r"n=(\d+) min=(\d+) p50=(\d+) p90=(\d+) p99=(\d+) "
+                     r"p99\.9=(\d+) max=(\d+) mean=(\d+)")
+CONSOLE_RE = re.compile(r"^\s+(\S+)\s+\d+ us\s+(\d+) chars/s$")
+SHBENCH_RE = re.compile(r"^\s+throughput\s+(\d+) commands/s")
+TIME_RUNS_RE = re.compile(r"^time -n (\d+) ")
+IRQLAT_RE = re.compile(r"^\s+(timer edge -> handler|handler duration)\s+" + HIST_RE.pattern)
+
+
+def results(path):
+    """Ordered list of (name, value, lower is better) from one suite run."""
+    with open(path, "rb") as f:
+        lines = f.read().decode("ascii", "replace").splitlines()
+
+    out = []
+    command = ""
+    for line in lines:
+        if line.startswith(SHELL_PROMPT):
+            command = line[len(SHELL_PROMPT):].strip()
+            continue
+        m = HIST_RE.search(line)
+        if command.startswith("time ") and m and line.rstrip().endswith("(us)"):
+            runs = TIME_RUNS_RE.match(command)
+            if runs and runs.group(1) != m.group(1):
+                sys.exit("pgo: %s: \"%s\" recorded n=%s" % (path, command, m.group(1)))
+            out.append(("%s  p50 us" % command, int(m.group(3)), True))
+            out.append(("%s  p90 us" % command, int(m.group(4)), True))
+            continue
+        m = SHBENCH_RE.match(line)
+        if m and command.startswith("shbench"):
+            out.append(("%s  commands/s" % command, int(m.group(1)), False))
+            continue
+        m = CONSOLE_RE.match(line)
+        if m and command.startswith("console bench"):
+            out.append(("console bench %s  chars/s" % m.group(1), int(m.group(2)), False))
+            continue
+        m = IRQLAT_RE.match(line)
+        if m:
+            out.append(("irq %s  p50 ns" % m.group(1), int(m.group(4)), True))
+            out.append(("irq %s  mean ns" % m.group(1), int(m.group(9)), True))
+    return out
+
+
+def report(args):
+    plain = results(args.plain)
+    pgo = dict((name, value) for name, value, _ in results(args.pgo))
+    if not plain:
+        sys.exit("pgo: no benchmark results in %s" % args.plain)
+
+    width = max(len(name) for name, _, _ in plain)
+    print("\n%-*s %12s %12s %9s" % (width, "Benchmark", "plain", "pgo", "change"))
+    for name, base, lower_better in plain:
+        if name not in pgo:
+            print("%-*s %12d %12s" % (width, name, base, "-"))
+            continue
+        value = pgo[name]
+        if base == 0:
+            print("%-*s %12d %12d %9s" % (width, name, base, value, "-"))
+            continue
+        change = (value - base) * 100.0 / base
+        better = change < 0 if lower_better else change > 0
+        print("%-*s %12d %12d %+8.1f%%%s" % (width, name, base, value, change,
+                                            "  better" if better and change else
+                                            "  worse" if change else ""))
+    print()
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Squirel OS profile-guided build helper")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("extract", help="write the .gcda files of a profile export")
+    p.add_argument("log", help="debugcon or serial log of the training run")
+    p.add_argument("-o", "--output", required=True, help="directory of the -fprofile-use build")
+    p.set_defaults(func=extract)
+
+    p = sub.add_parser("report", help="compare two runs of the benchmark suite")
+    p.add_argument("plain", help="log of the plain kernel")
+    p.add_argument("pgo", help="log of the PGO kernel")
+    p.set_defaults(func=report)
+
+    args = ap.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()